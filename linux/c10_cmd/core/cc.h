@@ -15,6 +15,7 @@
       { "opc.mac_addr_lo",       "0x7FC80000",           CC_HEX,        &cc.opc_mac_addr_lo,       1 },
       { "opc.ip_addr",           "0xC0A8013C",           CC_HEX,        &cc.opc_ip_addr,           1 },
       { "opc.cm_udp_port",       "0x00000ADD",           CC_HEX,        &cc.opc_cm_udp_port,       1 },
+      { "opc.media",             "2",                    CC_UINT,       &cc.opc_media,             1 },
       { "daq.opcmd",             "0x00000000",           CC_HEX,        &cc.daq_opcmd,             1 },
       { "daq.file",              "daq_data.csv",         CC_STR,        &cc.daq_file,              1 },
       { "daq.packets",           "32",                   CC_UINT,       &cc.daq_packets,           1 },
@@ -23,4 +24,32 @@
       { "daq.file_stamp",        "0",                    CC_UINT,       &cc.daq_file_stamp,        1 },
       { "daq.real",              "0",                    CC_UINT,       &cc.daq_real,              1 },
       { "daq.ramp",              "0",                    CC_UINT,       &cc.daq_ramp,              1 },
+      { "daq.mmap",              "0",                    CC_UINT,       &cc.daq_mmap,              1 },
+      { "daq.mmap_mb",           "16",                   CC_UINT,       &cc.daq_mmap_mb,           1 },
+      { "daq.stats",             "0",                    CC_UINT,       &cc.daq_stats,             1 },
+      { "daq.stats_ms",          "1000",                 CC_UINT,       &cc.daq_stats_ms,          1 },
+      { "daq.rate",              "0",                    CC_UINT,       &cc.daq_rate,              1 },
+      { "daq.sched",             "0",                    CC_UINT,       &cc.daq_sched,             1 },
+      { "daq.prof",              "0",                    CC_UINT,       &cc.daq_prof,              1 },
+      { "cp.window",             "8",                    CC_UINT,       &cc.cp_window,             1 },
+      { "cp.timeout",            "1000",                 CC_UINT,       &cc.cp_timeout,            1 },
+      { "mem.addr",              "0x00000000",           CC_HEX,        &cc.mem_addr,              1 },
+      { "mem.len",               "65536",                CC_UINT,       &cc.mem_len,               1 },
+      { "mem.width",             "4",                    CC_UINT,       &cc.mem_width,             1 },
+      { "mem.file",              "mem_data.bin",         CC_STR,        &cc.mem_file,              1 },
+      { "mem.stream",            "0",                    CC_UINT,       &cc.mem_stream,            1 },
+      { "xlt.file",              "xlt_trace.bin",        CC_STR,        &cc.xlt_file,              1 },
+      { "xlt.stream",            "0",                    CC_UINT,       &cc.xlt_stream,            1 },
+      { "xlt.time_ms",           "0",                    CC_UINT,       &cc.xlt_time_ms,           1 },
+      { "xlt.poll_ms",           "100",                  CC_UINT,       &cc.xlt_poll_ms,           1 },
+      { "prof.time_ms",          "1000",                 CC_UINT,       &cc.prof_time_ms,          1 },
+      { "prof.clear",            "0",                    CC_UINT,       &cc.prof_clear,            1 },
+      { "sim.enable",            "0",                    CC_UINT,       &cc.sim_enable,            1 },
+      { "sim.rate",              "500",                  CC_UINT,       &cc.sim_rate,              1 },
+      { "sim.pace",              "0",                    CC_UINT,       &cc.sim_pace,              1 },
+      { "sim.wave",              "0",                    CC_UINT,       &cc.sim_wave,              1 },
+      { "sim.loss",              "0",                    CC_UINT,       &cc.sim_loss,              1 },
+      { "sim.reorder",           "0",                    CC_UINT,       &cc.sim_reorder,           1 },
+      { "sim.latency_us",        "0",                    CC_UINT,       &cc.sim_latency_us,        1 },
+      { "sim.fw",                "",                     CC_STR,        &cc.sim_fw,                1 },
    };
@@ -18,7 +18,8 @@
 
    1.4 Module Test Specification Reference
 
-      None
+      cm_bench(), run with the -b command line option, measures the
+      message queue free list with 1, 2 and 4 competing threads.
 
    1.5 Compilation Information
 
@@ -74,7 +75,7 @@
         7.18 cm_send_msg()
         7.19 cm_local()
         7.20 cm_send_req()
-        7.21 cm_pipe_reg()
+        7.21 cm_pipe_sub()
         7.22 cm_pipe_send()
         7.23 cm_send_reg_req()
         7.24 cm_qmsg()
@@ -82,6 +83,26 @@
         7.26 cm_log()
         7.27 cm_timer_callback()
         7.28 cm_final()
+        7.29 cm_pipe_exists()
+        7.30 cm_qstats()
+        7.31 cm_dequeue()
+        7.32 cm_log_thread()
+        7.33 cm_log_text()
+        7.34 cm_pipe_unsub()
+        7.35 cm_pipe_get()
+        7.36 cm_pipe_free()
+        7.37 cm_pipe_src()
+        7.38 cm_timer_start()
+        7.39 cm_timer_cancel()
+        7.40 cm_tmr_thread()
+        7.41 cm_tmr_expire()
+        7.42 cm_tmr_now()
+        7.43 cm_tmr_grow()
+        7.44 cm_tmr_sift()
+        7.45 cm_tmr_remove()
+        7.46 cm_pipe_dropped()
+        7.47 cm_bench()
+        7.48 cm_bench_thread()
 
 -----------------------------------------------------------------------------*/
 
@@ -102,17 +123,34 @@
 
 // 5 LOCAL CONSTANTS AND MACROS
 
+   // message queue free list and statistics
+   #define CM_LOAD(x)         __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+   #define CM_CAS(x, o, n)    __atomic_compare_exchange_n(&(x), &(o), (n), TRUE, \
+                                 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+   #define CM_COUNT(x)        __atomic_fetch_add(&(x), 1, __ATOMIC_RELAXED)
+
 // 6 MODULE DATA STRUCTURES
 
 // 6.1  Local Function Prototypes
 
    static   void *cm_thread(void *data);
+   static   pcmq_t cm_dequeue(void);
+   static   void *cm_log_thread(void *data);
+   static   void  cm_log_text(FILE *out, pcm_log_hdr_t h, uint8_t *data);
+   static   void *cm_tmr_thread(void *data);
+   static   uint32_t cm_tmr_expire(void);
+   static   uint64_t cm_tmr_now(void);
+   static   uint32_t cm_tmr_grow(void);
+   static   void  cm_tmr_sift(uint32_t pos);
+   static   void  cm_tmr_remove(uint32_t idx);
+   static   void *cm_bench_thread(void *data);
 
 // 6.2  Local Data Structures
 
    static   cm_t        cm = {0};
    static   cmq_t       cmq[CM_MSGQ_SLOTS] = {{0}};
-   static   size_t      cm_timer;
+   static   cmq_cell_t  cmq_fifo[CM_MSGQ_SLOTS] = {{0}};
+   static   cm_log_rec_t cm_log_ring[CM_LOG_SLOTS] = {{0}};
 
    static uint8_t crc_array[] = {
       0x00, 0x5e, 0xbc, 0xe2, 0x61, 0x3f, 0xdd, 0x83,
@@ -176,11 +214,10 @@ uint32_t cm_init(void) {
 
    uint32_t   result = LIN_ERROR_OK;
    uint32_t   i;
-   char       line[256];
-   char       build_time[64], build_date[64];
 
-   struct tm* c_tm;
-   time_t time_now;
+   cm_log_file_t  hdr;
+
+   pthread_condattr_t tmr_attr;
 
 // 7.1.5   Code
 
@@ -194,9 +231,6 @@ uint32_t cm_init(void) {
    cm.devid = CM_DEV_WIN;
    cm.log   = NULL;
 
-   // Init Log Mutex
-   pthread_mutex_init(&cm.log_mutex, NULL);
-
    // Initialize the CM Objects
    for (i=0;i<=CM_MAX_OBJS;i++) {
       cm.obj[i].id    = CM_ID_NULL;
@@ -206,24 +240,32 @@ uint32_t cm_init(void) {
       cm.obj[i].sub   = NULL;
    }
 
-   // Initialize the CM Pipes
-   for (i=0;i<CM_MAX_PIPES;i++) {
-      cm.pipe[i].cmid = CM_ID_NULL;
-      cm.pipe[i].msgid = CM_PIPE_NULL;
-      cm.pipe[i].dstdev = CM_DEV_NULL;
-      cm.pipe[i].mark = 0;
-      cm.pipe[i].count = 0;
-      cm.pipe[i].first = NULL;
-      cm.pipe[i].pipelen = 0;
+   // Direct cmid to handle map, CM_MAX_OBJS is the empty object
+   memset(cm.obj_map, CM_MAX_OBJS, sizeof(cm.obj_map));
+
+   // Initialize the CM Pipe Subscriptions
+   pthread_mutex_init(&cm.pipe_mutex, NULL);
+   cm.pipe_free = NULL;
+   for (i=0;i<CM_PIPE_SUBS;i++) {
+      cm.pipe[i].cmid   = CM_ID_NULL;
+      cm.pipe[i].msgid  = CM_PIPE_NULL;
+      cm.pipe[i].notify = NULL;
+      cm.pipe[i].head   = 0;
+      cm.pipe[i].tail   = 0;
    }
 
-   // Initialize the CM Timers
+   // Initialize the CM Timer Service, deadlines on CLOCK_MONOTONIC
+   pthread_mutex_init(&cm.tmr.mutex, NULL);
+   pthread_condattr_init(&tmr_attr);
+   pthread_condattr_setclock(&tmr_attr, CLOCK_MONOTONIC);
+   pthread_cond_init(&cm.tmr.cv, &tmr_attr);
+   pthread_condattr_destroy(&tmr_attr);
+   cm.tmr.free = CM_TMR_IDLE;
    for (i=0;i<CM_MAX_TIMERS;i++) {
-      cm.tim[i].cmid   = CM_ID_NULL;
-      cm.tim[i].srvid  = CM_ID_NULL;
-      cm.tim[i].msgid  = 0;
-      cm.tim[i].count  = 0;
-      cm.tim[i].reload = 0;
+      cm.tmr.legacy[i] = CM_TMR_NULL;
+   }
+   if (cm_tmr_grow() != CM_OK) {
+      result = LIN_ERROR_CM;
    }
 
    // Initialize the CM Routing Table
@@ -250,32 +292,55 @@ uint32_t cm_init(void) {
    memset(&cmq, 0, sizeof(cmq));
    pthread_mutex_init(&cm.q_mutex, NULL);
    pthread_cond_init(&cm.q_cv, NULL);
-   cm.q_head    = 0;
-   cm.q_tail    = 0;
-   cm.q_msg_cnt = 0;
+   cm.q_in      = 0;
+   cm.q_out     = 0;
+   cm.q_wait    = FALSE;
+   memset(&cm.q_stats, 0, sizeof(cm.q_stats));
    for (i=0;i<CM_MSGQ_SLOTS;i++) {
       cmq[i].size  = CM_MSGQ_BUF_LEN;
       cmq[i].state = CM_Q_IDLE;
       // allow room for uint32_t length
       cmq[i].buf   = &cmq[i].raw[1];
+      // free list link
+      cmq[i].next  = (i == CM_MSGQ_SLOTS - 1) ? CM_Q_NULL : i + 1;
+      // delivery fifo, cell free for position i
+      cmq_fifo[i].seq  = i;
+      cmq_fifo[i].slot = CM_Q_NULL;
+   }
+   cm.q_free    = 0;
+
+   // Init Traffic Log Ring
+   cm.log_in   = 0;
+   cm.log_out  = 0;
+   cm.log_drop = 0;
+   for (i=0;i<CM_LOG_SLOTS;i++) {
+      cm_log_ring[i].seq = i;
    }
 
-   // open file for logging
+   // open binary file for logging, see utils/cm_log_dump.c
    if (gc.feature & LIN_FEATURE_LOG_TRAFFIC) {
-      if ((cm.log = fopen("cm_traffic.txt", "wt")) == NULL) {
+      if ((cm.log = fopen(CM_LOG_FILE, "wb")) == NULL) {
          printf("cm_init() Fatal Error : CM traffic log did not Open, %s",
-                  "cm_traffic.txt");
+                  CM_LOG_FILE);
          result |= LIN_ERROR_CM;
       }
-      time(&time_now);
-      c_tm = localtime(&time_now);
-      sprintf(build_date,"%02d.%s.%02d", c_tm->tm_mday, gc.month[c_tm->tm_mon],
-            (c_tm->tm_year+1900)-2000);
-      sprintf(build_time,"%02d:%02d:%02d", c_tm->tm_hour, c_tm->tm_min, c_tm->tm_sec);
-      sprintf(line, "%s %s \n\n", build_date, build_time);
-      fwrite(line, sizeof(char), strlen(line), cm.log);
-      sprintf(line, "< outbound, > inbound, * local, # timer, @ pipe\n\n");
-      fwrite(line, sizeof(char), strlen(line), cm.log);
+      else {
+         setvbuf(cm.log, NULL, _IOFBF, CM_LOG_BUF_LEN);
+         // file header and message string table
+         hdr.magic     = CM_LOG_MAGIC;
+         hdr.version   = CM_LOG_VERSION;
+         hdr.start     = (uint32_t)time(NULL);
+         hdr.tbl_len   = gc.msg_table_len;
+         hdr.entry_len = sizeof(msg_entry_t);
+         fwrite(&hdr, sizeof(cm_log_file_t), 1, cm.log);
+         fwrite(gc.msg_table, sizeof(msg_entry_t), gc.msg_table_len, cm.log);
+      }
+   }
+
+   // Start the Traffic Log Writer Thread
+   cm.log_run = TRUE;
+   if (pthread_create(&cm.log_tid, NULL, cm_log_thread, NULL)) {
+      result = LIN_ERROR_CM;
    }
 
    // Register this instance of the CM
@@ -286,8 +351,10 @@ uint32_t cm_init(void) {
       result = LIN_ERROR_CM;
    }
 
-   // Start CM's Periodic Timer, every 100 mS
-   cm_timer = timer_start(100, timer, TIMER_PERIODIC, NULL);
+   // Start the Timer Service Thread
+   if (pthread_create(&cm.tmr.tid, NULL, cm_tmr_thread, NULL)) {
+      result = LIN_ERROR_CM;
+   }
 
    // Display CM Instance ID
    if (gc.trace & LIN_TRACE_ID) {
@@ -345,6 +412,7 @@ uint8_t cm_register(uint8_t cmid, uint32_t (*msg)(pcm_msg_t msg),
       cm.obj[cm.num_objs].sub   = cmsub;
       // Store Handle and Next Object
       handle = cm.num_objs++;
+      cm.obj_map[cmid] = handle;
    }
 
    // Place Object in Routing Table
@@ -589,6 +657,10 @@ pcmq_t cm_alloc(void) {
    This routine will allocate a queue slot from the local CM queue.
    All allocated messages are the same length.
 
+   Free slots are kept on a lock-free stack, the head holds a tag in the
+   upper bits which is advanced on every update to prevent ABA. Only the
+   length word and the message header are cleared.
+
    7.5.2   Parameters:
 
    NONE
@@ -603,42 +675,40 @@ pcmq_t cm_alloc(void) {
 // 7.5.4   Data Structures
 
    pcmq_t      slot = NULL;
-   uint32_t    i;
+   uint32_t    head, next;
+   uint8_t     i;
    pcm_msg_t   msg = NULL;
 
 // 7.5.5   Code
 
-   // Lock the CM mutex
-   pthread_mutex_lock(&cm.q_mutex);
-
-   // Find next available slot
-   for (i=0;i<CM_MSGQ_SLOTS;i++) {
-      if (cmq[cm.q_head].state == CM_Q_IDLE) {
-         cmq[cm.q_head].state = CM_Q_ALLOC;
-         slot = &cmq[cm.q_head];
-         // clear the entire buffer
-         memset(slot->raw, 0, sizeof(uint32_t) * CM_MSGQ_BUF_LEN);
-         // account for uint32_t length at raw start
-         msg = (pcm_msg_t)slot->buf;
-         // used to retrieve slot from message
-         msg->h.slot = cm.q_head;
-         // in CM circular queue, so don't delete
-         msg->h.keep = 1;
-         if (++cm.q_head >= CM_MSGQ_SLOTS) cm.q_head = 0;
-         if (gc.trace & LIN_TRACE_CM) {
-            printf("cm_malloc(), slotid = %02X\n", msg->h.slot);
-         }
+   // Pop the free list
+   head = CM_LOAD(cm.q_free);
+   while ((i = CM_Q_IDX(head)) != CM_Q_NULL) {
+      next = (CM_Q_TAG(head) + CM_Q_TAG_INC) | __atomic_load_n(&cmq[i].next, __ATOMIC_RELAXED);
+      if (CM_CAS(cm.q_free, head, next)) {
+         slot = &cmq[i];
          break;
       }
-      if (++cm.q_head >= CM_MSGQ_SLOTS) cm.q_head = 0;
+      CM_COUNT(cm.q_stats.alloc_spin);
    }
 
-   // Unlock the CM mutex
-   pthread_mutex_unlock(&cm.q_mutex);
-
-   if (gc.trace & LIN_TRACE_ERROR) {
-      if (slot == NULL)
+   if (slot != NULL) {
+      slot->state = CM_Q_ALLOC;
+      // clear length and header only
+      memset(slot->raw, 0, sizeof(uint32_t) + sizeof(cm_msg_t));
+      // account for uint32_t length at raw start
+      msg = (pcm_msg_t)slot->buf;
+      // used to retrieve slot from message
+      msg->h.slot = i;
+      // in CM circular queue, so don't delete
+      msg->h.keep = 1;
+      CM_COUNT(cm.q_stats.alloc);
+   }
+   else {
+      CM_COUNT(cm.q_stats.empty);
+      if (gc.trace & LIN_TRACE_ERROR) {
          printf("cm_alloc() No Queue Slots Available\n");
+      }
    }
 
    // Trace Exit
@@ -675,26 +745,41 @@ void cm_free(pcm_msg_t msg) {
 
 // 7.6.4   Data Structures
 
-   pcmq_t   slot;
+   pcmq_t      slot;
+   uint32_t    head, next;
+   uint8_t     i;
 
 // 7.6.5   Code
 
-   // Lock the CM mutex
-   pthread_mutex_lock(&cm.q_mutex);
-
-   // Release the Slot
-   if (msg != NULL) {
-      slot = &cmq[msg->h.slot];
-      slot->state = CM_Q_IDLE;
-   }
-   else {
+   // Validate the Slot
+   if (msg == NULL || msg->h.slot >= CM_MSGQ_SLOTS) {
+      CM_COUNT(cm.q_stats.free_err);
       if (gc.trace & LIN_TRACE_ERROR) {
          printf("cm_free() Null Pointer\n");
       }
+      return;
+   }
+
+   i    = msg->h.slot;
+   slot = &cmq[i];
+
+   // Release the Slot, once only
+   if (__atomic_exchange_n(&slot->state, CM_Q_IDLE, __ATOMIC_ACQ_REL) == CM_Q_IDLE) {
+      CM_COUNT(cm.q_stats.free_err);
+      if (gc.trace & LIN_TRACE_ERROR) {
+         printf("cm_free() Error : slot %02X already free\n", i);
+      }
+      return;
    }
 
-   // Unlock the CM mutex
-   pthread_mutex_unlock(&cm.q_mutex);
+   // Push the free list
+   head = CM_LOAD(cm.q_free);
+   while (1) {
+      __atomic_store_n(&slot->next, CM_Q_IDX(head), __ATOMIC_RELAXED);
+      next = (CM_Q_TAG(head) + CM_Q_TAG_INC) | i;
+      if (CM_CAS(cm.q_free, head, next)) break;
+      CM_COUNT(cm.q_stats.free_spin);
+   }
 
 } // end cm_free()
 
@@ -995,7 +1080,8 @@ uint8_t cm_get_handle(uint8_t cmid) {
 
 /* 7.9.1   Functional Description
 
-   This routine will return the handle for a particular cmid.
+   This routine will return the handle for a particular cmid, by direct
+   lookup in the map filled by cm_register().
 
    7.9.2   Parameters:
 
@@ -1010,18 +1096,10 @@ uint8_t cm_get_handle(uint8_t cmid) {
 
 // 7.9.4   Data Structures
 
-   uint32_t   i;
-
 // 7.9.5   Code
 
-   // Search for cmid in active Objects
-   for (i=0;i<cm.num_objs;i++) {
-      if (cm.obj[i].id == cmid) {
-         return i;
-      }
-   }
-
-   return CM_MAX_OBJS;
+   // Direct lookup, unregistered IDs map to the empty object
+   return cm.obj_map[cmid];
 
 } // end cm_get_handle()
 
@@ -1175,8 +1253,10 @@ uint32_t cm_timer_set(uint8_t timerid, uint8_t msgid, uint32_t time_ms,
 
 /* 7.13.1   Functional Description
 
-   This routine will set the interval count of the timer associated
-   with timerid. Timer resolution is based on LIN_TICKS_PER_SECOND.
+   This routine will set the periodic timer associated with timerid,
+   the fixed timer IDs are kept for existing objects and map onto a
+   handle from cm_timer_start(). Setting an armed timerid replaces the
+   previous interval.
 
    7.13.2   Parameters:
 
@@ -1202,11 +1282,12 @@ uint32_t cm_timer_set(uint8_t timerid, uint8_t msgid, uint32_t time_ms,
 
    // Validate Timer
    if (k < CM_MAX_TIMERS) {
-      cm.tim[k].cmid   = cmid;
-      cm.tim[k].srvid  = srvid;
-      cm.tim[k].msgid  = msgid;
-      cm.tim[k].count  = time_ms / LIN_TICKS_MS;
-      cm.tim[k].reload = time_ms / LIN_TICKS_MS;
+      if (cm.tmr.legacy[k] != CM_TMR_NULL) {
+         cm_timer_cancel(cm.tmr.legacy[k]);
+      }
+      cm.tmr.legacy[k] = cm_timer_start(msgid, time_ms * 1000, cmid, srvid,
+                                        CM_TMR_PERIODIC, timerid);
+      if (cm.tmr.legacy[k] != CM_TMR_NULL) result = CM_OK;
    }
    // Timer ID Error
    else {
@@ -1248,11 +1329,8 @@ uint32_t cm_timer_kill(uint8_t timerid, uint8_t cmid) {
 
    // Validate Timer
    if (k < CM_MAX_TIMERS) {
-      cm.tim[k].cmid   = CM_MSG_NULL;
-      cm.tim[k].srvid  = 0;
-      cm.tim[k].msgid  = 0;
-      cm.tim[k].count  = 0;
-      cm.tim[k].reload = 0;
+      result = cm_timer_cancel(cm.tmr.legacy[k]);
+      cm.tmr.legacy[k] = CM_TMR_NULL;
    }
    // Timer ID Error
    else {
@@ -1272,13 +1350,10 @@ uint32_t cm_tick(void) {
 
 /* 7.15.1   Functional Description
 
-   This routine will look through the list of active timers and decrement
-   their counters, if they expire, a timer message will be generated and
-   sent to the associated CM object.
-
-   Since each call to this routine will decrement the active timers, the
-   resolution of each timer count is based on the frequency with which
-   this call is made.
+   This routine will send a timer message for every timer that has
+   reached its due time. Expiry is driven by cm_tmr_thread() at the
+   earliest deadline, so calls from the system tick only pick up
+   anything the service thread has not reached yet.
 
    7.15.2   Parameters:
 
@@ -1293,51 +1368,9 @@ uint32_t cm_tick(void) {
 
 // 7.15.4   Data Structures
 
-   uint32_t    result = CM_OK;
-   uint32_t    i;
-   cm_send_t   ps = {0};
-
 // 7.15.5   Code
 
-   //
-   // Search for any active timers
-   // and decrement their count, when they reach zero
-   // send a timer event to the associated object.
-   //
-   // All timers reload automatically
-   //
-   // Cycle over all active timers
-   for (i=0;i<CM_MAX_TIMERS;i++) {
-      // break if CM_ID_NULL
-      if (cm.tim[i].cmid == CM_ID_NULL) break;
-      // Check for non-zero count
-      if (cm.tim[i].count != 0) {
-         cm.tim[i].count--;
-         // Timer has expired
-         if (cm.tim[i].count == 0) {
-            // reload timer
-            cm.tim[i].count = cm.tim[i].reload;
-            memset(&ps, 0, sizeof(cm_send_t));
-            pcmq_t slot = cm_alloc();
-            if (slot != NULL) {
-               pcm_msg_t msg = (pcm_msg_t)slot->buf;
-               ps.msg = msg;
-               msg->p.srvid  = cm.tim[i].srvid;
-               msg->p.msgid  = cm.tim[i].msgid;
-               msg->p.flags  = CM_NO_FLAGS;
-               msg->p.status = CM_OK;
-               ps.src_cmid   = cm.tim[i].cmid;
-               ps.dst_cmid   = cm.tim[i].cmid;
-               ps.dst_devid  = cm.devid;
-               ps.msglen     = sizeof(cm_msg_t);
-               // Send the Timer Message
-               result = cm_send(CM_MSG_TIMER, &ps);
-            }
-         }
-      }
-   }
-
-   return result;
+   return cm_tmr_expire();
 
 } // end cm_tick()
 
@@ -1368,6 +1401,7 @@ uint32_t cm_route(pcm_msg_t msg) {
 
    uint32_t   result = CM_OK;
    uint8_t    cmid;
+   pcm_obj_t  obj;
 
 // 7.16.5   Code
 
@@ -1381,6 +1415,7 @@ uint32_t cm_route(pcm_msg_t msg) {
    }
 
    cmid  = msg->h.dst_cmid;
+   obj   = &cm.obj[cm_get_handle(cmid)];
 
    // Trace the Message before Routing
    if (gc.trace & LIN_TRACE_ROUTE) {
@@ -1425,14 +1460,14 @@ uint32_t cm_route(pcm_msg_t msg) {
    // forward the message
    switch (msg->h.event) {
       case CM_EVENT_MSG:
-         if (cm.obj[cm_get_handle(cmid)].msg != NULL)
-            cm.obj[cm_get_handle(cmid)].msg(msg);
+         if (obj->msg != NULL)
+            obj->msg(msg);
          else
             printf("cm_route() Error : CMID Invalid, CM_EVENT_MSG\n");
          break;
       case CM_EVENT_TIMER:
-         if (cm.obj[cm_get_handle(cmid)].timer != NULL)
-            cm.obj[cm_get_handle(cmid)].timer(msg);
+         if (obj->timer != NULL)
+            obj->timer(msg);
          else
             printf("cm_route() Error : CMID Invalid, CM_EVENT_TIMER\n");
          break;
@@ -1685,113 +1720,96 @@ uint32_t cm_send_req(uint8_t srvid, uint8_t msgid, uint8_t srcid, uint8_t flags)
 
 // 7.21
 
-uint32_t cm_pipe_reg(uint8_t cmid, uint8_t msgid, uint32_t mark, uint8_t dstdev) {
+uint8_t cm_pipe_sub(uint8_t cmid, uint8_t msgid, uint32_t depth, uint8_t policy,
+                    void (*notify)(uint8_t sub)) {
 
 /* 7.21.1   Functional Description
 
-   This routine will register the calling CM object with the associated PIPE
-   message. If the dstDev is CM_DEV_NULL and the pipe exists (based on cmid) then
-   the association will be deleted.
+   This routine will subscribe the calling CM object to the associated PIPE
+   message. Every subscriber has its own bounded queue, so several consumers
+   may take the same pipe message, each block is shared by reference.
+
+   When the queue holds depth blocks, CM_PIPE_DROP_NEW skips the new block
+   and CM_PIPE_DROP_OLD releases the oldest queued block in its place. The
+   subscriber is notified of a skipped block as well and reads the count
+   with cm_pipe_dropped(). The notify routine runs on the pipe source
+   thread and must not block.
 
    7.21.2   Parameters:
 
-   cmid     Destination CM ID for PIPE
+   cmid     Subscriber CM ID
    msgid    Associated Pipe msgid
-   mark     Water mark for accumulating messages
-   dstdev   Destination Device ID
+   depth    Queue depth, 1 to CM_PIPE_QUE
+   policy   CM_PIPE_DROP_NEW or CM_PIPE_DROP_OLD
+   notify   Called with the subscription for each queued block, or NULL
 
    7.21.3   Return Values:
 
-   result   CMAPI_OK for success
-            CMAPI_ERR_NUM_PIPE CM_MAX_PIPES exceeded
+   sub      Subscription handle
+            CM_PIPE_SUB_NULL when CM_PIPE_SUBS is exceeded
 
 -----------------------------------------------------------------------------
 */
 
 // 7.21.4   Data Structures
 
-   uint32_t   result = CM_OK;
+   uint8_t    sub = CM_PIPE_SUB_NULL;
    uint32_t   i;
 
 // 7.21.5   Code
 
-   //
-   // DELETE EXISTING PIPE CONNECTION
-   //
-   if (dstdev == CM_DEV_NULL) {
-      // Find existing pipe based on cmid
-      for (i=0;i<CM_MAX_PIPES;i++) {
-         if (cm.pipe[i].cmid == cmid) {
-            // Delete pipe
-            cm.pipe[i].cmid = CM_ID_NULL;
-            cm.pipe[i].msgid = CM_PIPE_NULL;
-            cm.pipe[i].dstdev = CM_DEV_NULL;
-            cm.pipe[i].mark = 0;
-            cm.pipe[i].count = 0;
-            cm.pipe[i].first = NULL;
-            cm.pipe[i].pipelen = 0;
-            cm.num_pipes--;
-         }
-      }
-   }
-   //
-   // ADD NEW PIPE CONNECTION
-   //
-   else if (cm.num_pipes != CM_MAX_PIPES && mark != 0) {
-      // Find first Available
-      for (i=0;i<CM_MAX_PIPES;i++) {
-         if (cm.pipe[i].cmid == CM_ID_NULL) {
-            // CM Identifier
-            cm.pipe[i].cmid  = cmid;
-            // Message Identifiers
-            cm.pipe[i].msgid = msgid;
-            // Destination Device ID
-            cm.pipe[i].dstdev = dstdev;
-            // Water Mark
-            cm.pipe[i].mark = mark;
-            // Counters
-            cm.pipe[i].count = 0;
-            cm.pipe[i].first = NULL;
-            cm.pipe[i].pipelen = 0;
-            // New Pipe Connection
-            cm.num_pipes++;
-            break;
-         }
+   if (depth == 0 || depth > CM_PIPE_QUE) depth = CM_PIPE_QUE;
+
+   pthread_mutex_lock(&cm.pipe_mutex);
+
+   // Find first Available
+   for (i=0;i<CM_PIPE_SUBS;i++) {
+      if (cm.pipe[i].cmid == CM_ID_NULL) {
+         cm.pipe[i].policy  = policy;
+         cm.pipe[i].depth   = depth;
+         cm.pipe[i].notify  = notify;
+         cm.pipe[i].head    = 0;
+         cm.pipe[i].tail    = 0;
+         cm.pipe[i].sent    = 0;
+         cm.pipe[i].dropped = 0;
+         cm.pipe[i].hiwater = 0;
+         cm.pipe[i].msgid   = msgid;
+         cm.pipe[i].cmid    = cmid;
+         // New Pipe Subscription
+         cm.num_pipes++;
+         sub = i;
+         break;
       }
-      // No available connections
-      if (i == CM_MAX_PIPES) result = CM_ERR_NUM_PIPE;
    }
-   else
-      result = CM_ERR_NUM_PIPE;
 
-   return result;
+   pthread_mutex_unlock(&cm.pipe_mutex);
 
-} // end cm_pipe_reg()
+   return sub;
+
+} // end cm_pipe_sub()
 
 
 // ===========================================================================
 
 // 7.22
 
-uint32_t cm_pipe_send(pcm_pipe_t pipe, uint32_t pipelen) {
+uint32_t cm_pipe_send(pcm_pipe_t pipe, uint32_t pipelen, uint32_t *refs) {
 
 /* 7.22.1   Functional Description
 
    This function delivers a pipe message directly, no routing.
 
-   The CMAPI_MSG_PIPE is sent based on the cmapi_PipeReg() call, which
-   associates the CM_ID_PIPE message ID with a particular cmid. The message
-   is posted directly from this function.
-
-   If the watermark feature is used for pipe messages, then they must
-   be contiguous in memory. For the case of no cmid registered for the
-   pipe message ID, it will be deleted if the CM_PIPE_FREE flag is set.
-
+   The pipe message is queued, in place, to every subscription made with
+   cm_pipe_sub() for its message ID, and the subscriber is notified. Each
+   queued block holds one reference, returned with cm_pipe_free(). A full
+   subscriber queue drops by its policy, so a slow consumer never holds up
+   the pipe source.
 
    7.22.2   Parameters:
 
    pipe        Pointer to CM_PIPE
    pipelen     Length in Bytes of this pipe Message
+   refs        Returns the number of references taken
 
    7.22.3   Return Values:
 
@@ -1802,58 +1820,73 @@ uint32_t cm_pipe_send(pcm_pipe_t pipe, uint32_t pipelen) {
 
 // 7.22.4   Data Structures
 
-   uint32_t    result = CM_OK;
-   uint32_t    i;
-   pcm_pipe_t  lead;
+   uint32_t       result = CM_OK;
+   uint32_t       i, tail, used;
+   pcm_pipe_con_t s;
+   pcm_pipe_t     old;
 
 // 7.22.5   Code
 
+   *refs = 0;
+
    // Validate Pipe Message
    if (pipe->dst_cmid == CM_ID_PIPE) {
 
-      // Find Pipe Message cmid Association
-      for (i=0;i<CM_MAX_PIPES;i++) {
-         // Bypass inactive connections
-         if (cm.pipe[i].cmid == CM_ID_NULL) continue;
-         // Registered Message?
-         if (cm.pipe[i].msgid == pipe->msgid) {
-            // Record First Message
-            if (cm.pipe[i].count == 0) {
-               cm.pipe[i].first = (uint8_t *)pipe;
-               cm.pipe[i].pipelen = 0;
-            }
-            // Count Message
-            cm.pipe[i].count++;
-            cm.pipe[i].pipelen += pipelen;
-            // Check the Water Mark
-            if (cm.pipe[i].mark == cm.pipe[i].count) {
-               lead = (pcm_pipe_t)cm.pipe[i].first;
-               // Trace the Message
-               if (gc.trace & LIN_TRACE_PIPE) {
-                  printf("cm_pipe_send() : \n");
-                  printf("  dst_cmid:  %02X\n", lead->dst_cmid);
-                  printf("  msgid:     %02X\n", lead->msgid);
-                  printf("  port:      %02X\n", lead->port);
-                  printf("  flags:     %02X\n", lead->flags);
-                  printf("  msglen:    %d\n",   lead->msglen);
-                  printf("  seqid:     %08X\n", lead->seqid);
-                  printf("  stamp:     %08X\n", lead->stamp);
-                  printf("  stamp_us:  %08X\n", lead->stamp_us);
-                  printf("  status:    %08X\n", lead->status);
-                  printf("  rate:      %08X\n", lead->rate);
-                  printf("  magic:     %08X\n", lead->magic);
-               }
-               // log message
-               cm_log((pcm_msg_t)pipe);
-               // Send the Pipe Message
-               if (cm.obj[cm_get_handle(cm.pipe[i].cmid)].msg != NULL)
-                  cm.obj[cm_get_handle(cm.pipe[i].cmid)].msg((pcm_msg_t)lead);
-               cm.pipe[i].count = 0;
-               cm.pipe[i].pipelen = 0;
-               cm.pipe[i].first = NULL;
+      // Trace the Message
+      if (gc.trace & LIN_TRACE_PIPE) {
+         printf("cm_pipe_send() : \n");
+         printf("  dst_cmid:  %02X\n", pipe->dst_cmid);
+         printf("  msgid:     %02X\n", pipe->msgid);
+         printf("  port:      %02X\n", pipe->port);
+         printf("  flags:     %02X\n", pipe->flags);
+         printf("  msglen:    %d\n",   pipe->msglen);
+         printf("  seqid:     %08X\n", pipe->seqid);
+         printf("  stamp:     %08X\n", pipe->stamp);
+         printf("  stamp_us:  %08X\n", pipe->stamp_us);
+         printf("  status:    %08X\n", pipe->status);
+         printf("  rate:      %08X\n", pipe->rate);
+         printf("  magic:     %08X\n", pipe->magic);
+      }
+
+      // log message
+      cm_log((pcm_msg_t)pipe);
+
+      // subscriptions only change under the mutex
+      pthread_mutex_lock(&cm.pipe_mutex);
+
+      for (i=0;i<CM_PIPE_SUBS;i++) {
+         s = &cm.pipe[i];
+         // Bypass inactive subscriptions
+         if (s->cmid == CM_ID_NULL || s->msgid != pipe->msgid) continue;
+         // make room, oldest first
+         tail = CM_LOAD(s->tail);
+         while (s->head - tail >= s->depth && s->policy == CM_PIPE_DROP_OLD) {
+            old = s->buf[tail % CM_PIPE_QUE];
+            if (CM_CAS(s->tail, tail, tail + 1)) {
+               cm_pipe_free(old);
+               CM_COUNT(s->dropped);
+               tail++;
             }
          }
+         // queue full, drop this block, the subscriber
+         // finds it in cm_pipe_dropped()
+         if (s->head - tail >= s->depth) {
+            CM_COUNT(s->dropped);
+            if (s->notify != NULL) s->notify(i);
+            continue;
+         }
+         // Queue the Block
+         s->buf[s->head % CM_PIPE_QUE] = pipe;
+         __atomic_store_n(&s->head, s->head + 1, __ATOMIC_RELEASE);
+         s->sent++;
+         (*refs)++;
+         used = s->head - tail;
+         if (used > s->hiwater) s->hiwater = used;
+         // Notify the Subscriber
+         if (s->notify != NULL) s->notify(i);
       }
+
+      pthread_mutex_unlock(&cm.pipe_mutex);
    }
    else {
       result = CM_ERR_PIPE;
@@ -1952,6 +1985,10 @@ void cm_qmsg(pcm_msg_t msg) {
 
    This routine will place the incoming message on the delivery queue.
 
+   Any thread may queue a message. A position is claimed with an atomic
+   increment, so messages are delivered in the order they were claimed.
+   Each slot is queued at most once, so the FIFO cannot overflow.
+
    7.24.2   Parameters:
 
    msg     CM Message to queue
@@ -1965,7 +2002,9 @@ void cm_qmsg(pcm_msg_t msg) {
 
 // 7.24.4   Data Structures
 
-   pcmq_t   slot;
+   pcmq_t      slot;
+   pcmq_cell_t cell;
+   uint32_t    pos, depth, mark;
 
 // 7.24.5   Code
 
@@ -1996,9 +2035,6 @@ void cm_qmsg(pcm_msg_t msg) {
          printf("  msglen:    %04X\n", msg->h.msglen);
       }
 
-      // Lock the CM mutex
-      pthread_mutex_lock(&cm.q_mutex);
-
       // log message
       cm_log(msg);
 
@@ -2006,15 +2042,29 @@ void cm_qmsg(pcm_msg_t msg) {
       slot = &cmq[msg->h.slot];
       slot->state = CM_Q_DELIVER;
 
-      // q_msg_cnt cannot exceed number of slots,
-      // so something has stalled otherwise
-      cm.q_msg_cnt = (cm.q_msg_cnt + 1) & (CM_MSGQ_SLOTS - 1);
+      // claim the next FIFO position
+      pos  = __atomic_fetch_add(&cm.q_in, 1, __ATOMIC_RELAXED);
+      cell = &cmq_fifo[pos & (CM_MSGQ_SLOTS - 1)];
 
-      // Unlock the CM mutex
-      pthread_mutex_unlock(&cm.q_mutex);
+      // wait for cm_thread to release the cell
+      while (CM_LOAD(cell->seq) != pos) sched_yield();
+
+      // publish the slot
+      cell->slot = msg->h.slot;
+      __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+      // queue depth high-water mark
+      depth = pos + 1 - CM_LOAD(cm.q_out);
+      mark  = CM_LOAD(cm.q_stats.hiwater);
+      while (depth > mark && !CM_CAS(cm.q_stats.hiwater, mark, depth));
 
-      // signal the CM thread
-      pthread_cond_signal(&cm.q_cv);
+      // signal the CM thread, only when waiting
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      if (CM_LOAD(cm.q_wait)) {
+         pthread_mutex_lock(&cm.q_mutex);
+         pthread_cond_signal(&cm.q_cv);
+         pthread_mutex_unlock(&cm.q_mutex);
+      }
 
    }
    else {
@@ -2035,6 +2085,7 @@ static void *cm_thread(void *data) {
 /* 7.25.1   Functional Description
 
    This thread will provide a delivery service for CM messages from the queue.
+   Every pending message is delivered on each wakeup.
 
    7.25.2   Parameters:
 
@@ -2050,7 +2101,7 @@ static void *cm_thread(void *data) {
 // 7.25.4   Data Structures
 
    pcmq_t      slot = NULL;
-   uint32_t    i;
+   uint32_t    i, batch;
    pcm_msg_t   msg = NULL;
 
    struct timespec ts;
@@ -2070,7 +2121,9 @@ static void *cm_thread(void *data) {
 
       // Wait on condition variable,
       // this unlocks the mutex while waiting
-      while (cm.q_msg_cnt == 0) {
+      __atomic_store_n(&cm.q_wait, TRUE, __ATOMIC_SEQ_CST);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      while (CM_LOAD(cmq_fifo[cm.q_out & (CM_MSGQ_SLOTS - 1)].seq) != cm.q_out + 1) {
          clock_gettime(CLOCK_REALTIME, &ts);
          ts.tv_sec += 1;
          pthread_cond_timedwait(&cm.q_cv, &cm.q_mutex, &ts);
@@ -2079,32 +2132,16 @@ static void *cm_thread(void *data) {
          pthread_testcancel();
          pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
       }
-
-      // clear previous message
-      slot = NULL;
-
-      // Find Available Message
-      if (cm.q_msg_cnt != 0) {
-         // Find next available message
-         for (i=0;i<CM_MSGQ_SLOTS;i++) {
-            if (cmq[cm.q_tail].state == CM_Q_DELIVER) {
-               cmq[cm.q_tail].state = CM_Q_BUSY;
-               msg = (pcm_msg_t)cmq[cm.q_tail].buf;
-               msg->h.slot = cm.q_tail;
-               slot = &cmq[cm.q_tail];
-               if (++cm.q_tail >= CM_MSGQ_SLOTS) cm.q_tail = 0;
-               cm.q_msg_cnt--;
-               break;
-            }
-            if (++cm.q_tail >= CM_MSGQ_SLOTS) cm.q_tail = 0;
-         }
-      }
+      __atomic_store_n(&cm.q_wait, FALSE, __ATOMIC_RELAXED);
 
       // Unlock the CM mutex
       pthread_mutex_unlock(&cm.q_mutex);
 
-      // Route Message
-      if (slot != NULL) {
+      cm.q_stats.wakeups++;
+
+      // Deliver every pending message, in order
+      for (batch=0;(slot = cm_dequeue()) != NULL;batch++) {
+         msg = (pcm_msg_t)slot->buf;
          // out bound traffic
          if (msg->h.dst_devid != cm.devid) {
             // transmit the message, based on port, use this thread
@@ -2128,6 +2165,8 @@ static void *cm_thread(void *data) {
             cm_route(msg);
          }
       }
+
+      if (batch > cm.q_stats.batch_max) cm.q_stats.batch_max = batch;
    }
 
    return (void *)0;
@@ -2143,11 +2182,14 @@ void cm_log(pcm_msg_t msg) {
 
 /* 7.26.1   Functional Description
 
-   This routine will write the message to the log file.
+   This routine will place a binary record of the message on the traffic
+   log ring. The record is written to disk, and traced to stdout, by
+   cm_log_thread(). When the ring is full the record is dropped, the
+   caller never waits.
 
    7.26.2   Parameters:
 
-   NONE
+   msg      CM or pipe message
 
    7.26.3   Return Values:
 
@@ -2158,154 +2200,67 @@ void cm_log(pcm_msg_t msg) {
 
 // 7.26.4   Data Structures
 
-   char    *dir;
-   char     line[512], cat[64];
-   uint16_t i,j;
-   uint16_t len = msg->h.msglen;
-   char    *msgid = "-", *cmid = "-";
-
-   uint32_t now;
-   double   delta;
-   uint32_t delta_secs, delta_us;
-
-   pcm_pipe_t  pipe = (pcm_pipe_t)msg;
+   pcm_log_rec_t  rec;
+   uint32_t       pos, seq;
+   int32_t        diff;
+   uint16_t       len;
+   uint8_t        dir;
 
    struct timespec ts;
 
-   #define BILLION 1000000000L
-
 // 7.26.5   Code
 
-   if  (((gc.feature & LIN_FEATURE_LOG_TRAFFIC) == 0 ) &&
+   if  (((gc.feature & LIN_FEATURE_LOG_TRAFFIC) == 0 || cm.log == NULL) &&
         ((gc.trace & LIN_TRACE_CM_LOG) == 0)) return;
 
-   if (((gc.feature & LIN_FEATURE_LOG_TRAFFIC) != 0) && cm.log == NULL) return;
-
-   // Lock the CM Log mutex
-   pthread_mutex_lock(&cm.log_mutex);
-
-   clock_gettime(CLOCK_REALTIME, &ts);
-
-   now = (uint32_t)(((ts.tv_sec * BILLION) + ts.tv_nsec) / 1000);
-
-   if (cm.last_us == 0) cm.last_us = now;
-   delta = (double)(now - cm.last_us);
-   if (delta != 0) delta = delta / 100E6;
-   delta_secs = (uint32_t)delta;
-   delta_us   = (uint32_t)((delta - delta_secs) * 1E4);
-
+   // Pipe Message, header and the first 48 bytes
+   if (msg->h.dst_cmid == CM_ID_PIPE) {
+      dir = '@';
+      len = CM_LOG_PIPE_LEN;
+   }
    // Control Message
-   if (msg->h.dst_cmid != CM_ID_PIPE) {
-      uint8_t *in_u8 = (uint8_t *)msg;
+   else {
       // traffic origin, local timer
-      if (msg->h.event == CM_EVENT_TIMER) dir = "#";
+      if (msg->h.event == CM_EVENT_TIMER) dir = '#';
       // traffic origin, local
-      else if (msg->h.dst_devid == msg->h.src_devid) dir = "*";
+      else if (msg->h.dst_devid == msg->h.src_devid) dir = '*';
       // inbound
-      else if (msg->h.dst_devid == cm.devid)    dir = ">";
+      else if (msg->h.dst_devid == cm.devid) dir = '>';
       // outbound
-      else  dir = "<";
-      // cm_hdr_t is 8 bytes
-      sprintf(line, "%s\t00 : ", dir);
-      for (i=0;i<8;i++) {
-         sprintf(cat, "%02X", in_u8[i]);
-         strcat(line, cat);
-      }
-      // find cmid and msgid strings
-      for (i=0;i<gc.msg_table_len; i++) {
-         if ((gc.msg_table[i].cmid  == msg->p.srvid) &&
-             (gc.msg_table[i].msgid == msg->p.msgid)) {
-            msgid = gc.msg_table[i].msg_str;
-            cmid  = gc.msg_table[i].cmid_str;
-         }
-      }
-      sprintf(cat, " %6d  %3d.%04d  %s:%s\n", msg->h.msglen, delta_secs, delta_us, cmid, msgid);
-      strcat(line, cat);
-      if (gc.trace & LIN_TRACE_CM_LOG)
-         fwrite(line, sizeof(char), strlen(line), stdout);
-      if (gc.feature & LIN_FEATURE_LOG_TRAFFIC)
-         fwrite(line, sizeof(char), strlen(line), cm.log);
-      // msg_parms_t is 4 bytes + body
-      if (msg->h.msglen < CM_MAX_MSG_INT8U &&
-          msg->h.msglen > sizeof(cm_hdr_t)) {
-         len -= 8;
-         for (i=0;i<len;i+=8) {
-            sprintf(line, "\t%02X : ", i+8);
-            for (j=0;j<8;j++) {
-               if ((i+j) >= (len))
-                  strcat(line, "  ");
-               else {
-                  sprintf(cat, "%02X", in_u8[i+j+8]);
-                  strcat(line, cat);
-               }
-            }
-            strcat(line, "\n");
-            if (gc.trace & LIN_TRACE_CM_LOG)
-               fwrite(line, sizeof(char), strlen(line), stdout);
-            if (gc.feature & LIN_FEATURE_LOG_TRAFFIC)
-               fwrite(line, sizeof(char), strlen(line), cm.log);
-         }
-         sprintf(line, "\n");
-         if (gc.trace & LIN_TRACE_CM_LOG)
-            fwrite(line, sizeof(char), strlen(line), stdout);
-         if (gc.feature & LIN_FEATURE_LOG_TRAFFIC)
-            fwrite(line, sizeof(char), strlen(line), cm.log);
-      }
+      else dir = '<';
+      len = sizeof(cm_msg_t);
+      if (msg->h.msglen < CM_MAX_MSG_INT8U && msg->h.msglen > len) len = msg->h.msglen;
    }
-   // Pipe Message
-   else {
-      uint8_t  *in_u8   = (uint8_t *)pipe;
-      uint8_t  *in_pipe = (uint8_t *)&pipe->msglen;
-      //  8 bytes of pipe header
-      sprintf(line, "%s\t000 : ", "@");
-      for (i=0;i<8;i++) {
-         sprintf(cat, "%02X", in_u8[i]);
-         strcat(line, cat);
+
+   // claim a ring cell
+   pos = __atomic_load_n(&cm.log_in, __ATOMIC_RELAXED);
+   while (1) {
+      rec  = &cm_log_ring[pos & (CM_LOG_SLOTS - 1)];
+      seq  = CM_LOAD(rec->seq);
+      diff = (int32_t)(seq - pos);
+      if (diff == 0) {
+         if (CM_CAS(cm.log_in, pos, pos + 1)) break;
       }
-      // find cmid and msgid strings
-      for (i=0;i<gc.msg_table_len;i++) {
-         if ((gc.msg_table[i].cmid  == pipe->dst_cmid) &&
-               (gc.msg_table[i].msgid == pipe->msgid)) {
-            msgid = gc.msg_table[i].msg_str;
-            cmid  = gc.msg_table[i].cmid_str;
-         }
+      // ring full, drop the record
+      else if (diff < 0) {
+         CM_COUNT(cm.log_drop);
+         return;
       }
-      sprintf(cat, " %6d  %3d.%04d  %s:%s\n", 1024, delta_secs, delta_us, cmid, msgid);
-      strcat(line, cat);
-      if (gc.trace & LIN_TRACE_CM_LOG)
-         fwrite(line, sizeof(char), strlen(line), stdout);
-      if (gc.feature & LIN_FEATURE_LOG_TRAFFIC)
-         fwrite(line, sizeof(char), strlen(line), cm.log);
-      // the next 48 bytes of pipe
-      len = 48;
-      for (i=0;i<len;i+=8) {
-         sprintf(line, "\t%03X : ", i+8);
-         for (j=0;j<8;j++) {
-            if ((i+j) >= (len))
-               strcat(line, "  ");
-            else {
-               sprintf(cat, "%02X", in_pipe[i+j+8]);
-               strcat(line, cat);
-            }
-         }
-         strcat(line, "\n");
-         printf("%s", line);
+      else {
+         pos = __atomic_load_n(&cm.log_in, __ATOMIC_RELAXED);
       }
-      if (gc.trace & LIN_TRACE_CM_LOG)
-         fwrite(line, sizeof(char), strlen(line), stdout);
-      if (gc.feature & LIN_FEATURE_LOG_TRAFFIC)
-         fwrite(line, sizeof(char), strlen(line), cm.log);
-      sprintf(line, "\n\n");
-      if (gc.trace & LIN_TRACE_CM_LOG)
-         fwrite(line, sizeof(char), strlen(line), stdout);
-      if (gc.feature & LIN_FEATURE_LOG_TRAFFIC)
-         fwrite(line, sizeof(char), strlen(line), cm.log);
    }
 
-   cm.last_us = now;
+   clock_gettime(CLOCK_REALTIME, &ts);
+
+   rec->h.stamp_us = (uint32_t)(((ts.tv_sec * 1000000000LL) + ts.tv_nsec) / 1000);
+   rec->h.len      = len;
+   rec->h.dir      = dir;
+   rec->h.reserved = 0;
+   memcpy(rec->data, msg, len);
 
-   // Unlock the CM Log mutex
-   pthread_mutex_unlock(&cm.log_mutex);
+   // publish to the writer
+   __atomic_store_n(&rec->seq, pos + 1, __ATOMIC_RELEASE);
 
 } // end cm_log()
 
@@ -2367,17 +2322,1168 @@ void cm_final(void) {
 
 // 7.28.4   Data Structures
 
+   uint32_t    i;
+   cmq_stats_t qs;
+
 // 7.28.5   Code
 
    // Cancel Interrupt Thread
    pthread_cancel(cm.tid);
    pthread_join(cm.tid, NULL);
 
-   // Stop CM's Periodic Timer
-   timer_stop(cm_timer);
+   // Stop the Timer Service Thread
+   pthread_cancel(cm.tmr.tid);
+   pthread_join(cm.tmr.tid, NULL);
+
+   // Drain and Stop the Traffic Log Writer
+   __atomic_store_n(&cm.log_run, FALSE, __ATOMIC_RELEASE);
+   pthread_join(cm.log_tid, NULL);
 
    // close traffic log
    if (cm.log != NULL) fclose(cm.log);
 
+   if (cm.log_drop != 0) {
+      printf("cm_final() Warning : traffic log ring full, %d records dropped\n", cm.log_drop);
+   }
+
+   // Report Message Queue Contention
+   if (gc.trace & LIN_TRACE_CM) {
+      cm_qstats(&qs);
+      printf("cm_final() msg queue : alloc %d, alloc_spin %d, free_spin %d, empty %d, free_err %d\n",
+            qs.alloc, qs.alloc_spin, qs.free_spin, qs.empty, qs.free_err);
+      printf("cm_final() delivery : hiwater %d/%d, batch_max %d, wakeups %d\n",
+            qs.hiwater, CM_MSGQ_SLOTS, qs.batch_max, qs.wakeups);
+      printf("cm_final() timers : started %d, fired %d, cancelled %d, dropped %d, peak %d/%d, late_max %d uS\n",
+            cm.tmr.started, cm.tmr.fired, cm.tmr.cancelled, cm.tmr.dropped,
+            cm.tmr.peak, cm.tmr.size, cm.tmr.late_max_us);
+   }
+
+   // Release the Timer Pool
+   free(cm.tmr.heap);
+   free(cm.tmr.pool);
+   cm.tmr.heap = NULL;
+   cm.tmr.pool = NULL;
+   cm.tmr.size = 0;
+   cm.tmr.count = 0;
+
+   // Report Pipe Subscriptions
+   for (i=0;i<CM_PIPE_SUBS;i++) {
+      if (cm.pipe[i].cmid == CM_ID_NULL) continue;
+      if (cm.pipe[i].dropped != 0) {
+         printf("cm_final() Warning : pipe subscriber %02X dropped %d blocks\n",
+               cm.pipe[i].cmid, cm.pipe[i].dropped);
+      }
+      if (gc.trace & LIN_TRACE_CM) {
+         printf("cm_final() pipe sub %d : cmid %02X, sent %d, dropped %d, hiwater %d/%d\n",
+               i, cm.pipe[i].cmid, cm.pipe[i].sent, cm.pipe[i].dropped,
+               cm.pipe[i].hiwater, cm.pipe[i].depth);
+      }
+   }
+
 } // end cm_final()
 
+
+// ===========================================================================
+
+// 7.29
+
+uint8_t cm_pipe_exists(uint8_t msgid) {
+
+/* 7.29.1   Functional Description
+
+   This routine will check for a CM object subscribed to the
+   associated PIPE message.
+
+   7.29.2   Parameters:
+
+   msgid    Associated Pipe msgid
+
+   7.29.3   Return Values:
+
+   result   TRUE if a pipe connection exists
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.29.4   Data Structures
+
+   uint8_t    result = FALSE;
+   uint32_t   i;
+
+// 7.29.5   Code
+
+   for (i=0;i<CM_PIPE_SUBS;i++) {
+      if (cm.pipe[i].cmid != CM_ID_NULL && cm.pipe[i].msgid == msgid) {
+         result = TRUE;
+         break;
+      }
+   }
+
+   return result;
+
+} // end cm_pipe_exists()
+
+
+// ===========================================================================
+
+// 7.30
+
+void cm_qstats(pcmq_stats_t stats) {
+
+/* 7.30.1   Functional Description
+
+   This routine will report the message queue allocation counters. The
+   spin counters record each failed compare-and-swap on the free list.
+
+   7.30.2   Parameters:
+
+   stats    Message queue statistics
+
+   7.30.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.30.4   Data Structures
+
+// 7.30.5   Code
+
+   stats->alloc      = __atomic_load_n(&cm.q_stats.alloc, __ATOMIC_RELAXED);
+   stats->alloc_spin = __atomic_load_n(&cm.q_stats.alloc_spin, __ATOMIC_RELAXED);
+   stats->free_spin  = __atomic_load_n(&cm.q_stats.free_spin, __ATOMIC_RELAXED);
+   stats->empty      = __atomic_load_n(&cm.q_stats.empty, __ATOMIC_RELAXED);
+   stats->free_err   = __atomic_load_n(&cm.q_stats.free_err, __ATOMIC_RELAXED);
+   stats->hiwater    = __atomic_load_n(&cm.q_stats.hiwater, __ATOMIC_RELAXED);
+   stats->batch_max  = __atomic_load_n(&cm.q_stats.batch_max, __ATOMIC_RELAXED);
+   stats->wakeups    = __atomic_load_n(&cm.q_stats.wakeups, __ATOMIC_RELAXED);
+
+} // end cm_qstats()
+
+
+// ===========================================================================
+
+// 7.31
+
+static pcmq_t cm_dequeue(void) {
+
+/* 7.31.1   Functional Description
+
+   This routine will remove the oldest message from the delivery FIFO.
+   Only cm_thread() may call this routine.
+
+   7.31.2   Parameters:
+
+   NONE
+
+   7.31.3   Return Values:
+
+   pcmq_t   Message queue slot or NULL when empty
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.31.4   Data Structures
+
+   pcmq_t      slot = NULL;
+   pcmq_cell_t cell = &cmq_fifo[cm.q_out & (CM_MSGQ_SLOTS - 1)];
+
+// 7.31.5   Code
+
+   // published?
+   if (CM_LOAD(cell->seq) == cm.q_out + 1) {
+      slot = &cmq[cell->slot];
+      slot->state = CM_Q_BUSY;
+      // used to retrieve slot from message
+      ((pcm_msg_t)slot->buf)->h.slot = cell->slot;
+      // release the cell for the next lap
+      __atomic_store_n(&cell->seq, cm.q_out + CM_MSGQ_SLOTS, __ATOMIC_RELEASE);
+      __atomic_store_n(&cm.q_out, cm.q_out + 1, __ATOMIC_RELEASE);
+   }
+
+   return slot;
+
+} // end cm_dequeue()
+
+
+// ===========================================================================
+
+// 7.32
+
+static void *cm_log_thread(void *data) {
+
+/* 7.32.1   Functional Description
+
+   This thread will drain the traffic log ring to the binary log file and
+   render the text trace to stdout. The ring is drained once more after
+   cm_final() clears log_run.
+
+   7.32.2   Parameters:
+
+   data     Thread parameters
+
+   7.32.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.32.4   Data Structures
+
+   pcm_log_rec_t  rec;
+   uint32_t       cnt;
+
+// 7.32.5   Code
+
+   if (gc.trace & LIN_TRACE_ID) {
+      printf("cm_log_thread() started, tid %lu\n", syscall(SYS_gettid));
+   }
+
+   while (1) {
+      cnt = 0;
+      // drain every published record, in order
+      while (1) {
+         rec = &cm_log_ring[cm.log_out & (CM_LOG_SLOTS - 1)];
+         if (CM_LOAD(rec->seq) != cm.log_out + 1) break;
+         if ((gc.feature & LIN_FEATURE_LOG_TRAFFIC) && cm.log != NULL) {
+            fwrite(&rec->h, sizeof(cm_log_hdr_t), 1, cm.log);
+            fwrite(rec->data, sizeof(uint8_t), rec->h.len, cm.log);
+         }
+         if (gc.trace & LIN_TRACE_CM_LOG) cm_log_text(stdout, &rec->h, rec->data);
+         // release the cell for the next lap
+         __atomic_store_n(&rec->seq, cm.log_out + CM_LOG_SLOTS, __ATOMIC_RELEASE);
+         cm.log_out++;
+         cnt++;
+      }
+      if (cnt == 0) {
+         if (CM_LOAD(cm.log_run) == FALSE) break;
+         usleep(CM_LOG_WAIT_US);
+      }
+   }
+
+   return (void *)0;
+
+} // end cm_log_thread()
+
+
+// ===========================================================================
+
+// 7.33
+
+static void cm_log_text(FILE *out, pcm_log_hdr_t h, uint8_t *data) {
+
+/* 7.33.1   Functional Description
+
+   This routine will render a binary log record in the text traffic
+   format. utils/cm_log_dump.c renders the log file the same way.
+
+   7.33.2   Parameters:
+
+   out      Output stream
+   h        Record header
+   data     Record message bytes
+
+   7.33.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.33.4   Data Structures
+
+   char        line[512], cat[128];
+   uint16_t    i,j;
+   uint16_t    len;
+   uint8_t     k;
+   char       *msgid = "-", *cmid = "-";
+   double      delta;
+   uint32_t    delta_secs, delta_us;
+
+   pcm_msg_t   msg  = (pcm_msg_t)data;
+   pcm_pipe_t  pipe = (pcm_pipe_t)data;
+
+// 7.33.5   Code
+
+   if (cm.last_us == 0) cm.last_us = h->stamp_us;
+   delta = (double)(h->stamp_us - cm.last_us);
+   if (delta != 0) delta = delta / 100E6;
+   delta_secs = (uint32_t)delta;
+   delta_us   = (uint32_t)((delta - delta_secs) * 1E4);
+
+   // Control Message
+   if (h->dir != '@') {
+      // cm_hdr_t is 8 bytes
+      sprintf(line, "%c\t00 : ", h->dir);
+      for (i=0;i<8;i++) {
+         sprintf(cat, "%02X", data[i]);
+         strcat(line, cat);
+      }
+      // find cmid and msgid strings
+      k = MSG_INDEX(gc.msg_index, msg->p.srvid, msg->p.msgid);
+      if (k != MSG_IDX_NONE) {
+         msgid = gc.msg_table[k].msg_str;
+         cmid  = gc.msg_table[k].cmid_str;
+      }
+      sprintf(cat, " %6d  %3d.%04d  %s:%s\n", msg->h.msglen, delta_secs, delta_us, cmid, msgid);
+      strcat(line, cat);
+      fputs(line, out);
+      // msg_parms_t is 4 bytes + body
+      if (msg->h.msglen < CM_MAX_MSG_INT8U &&
+          msg->h.msglen > sizeof(cm_hdr_t)) {
+         len = msg->h.msglen - 8;
+         for (i=0;i<len;i+=8) {
+            sprintf(line, "\t%02X : ", i+8);
+            for (j=0;j<8;j++) {
+               if ((i+j) >= (len))
+                  strcat(line, "  ");
+               else {
+                  sprintf(cat, "%02X", data[i+j+8]);
+                  strcat(line, cat);
+               }
+            }
+            strcat(line, "\n");
+            fputs(line, out);
+         }
+         fputs("\n", out);
+      }
+   }
+   // Pipe Message
+   else {
+      //  8 bytes of pipe header
+      sprintf(line, "%s\t000 : ", "@");
+      for (i=0;i<8;i++) {
+         sprintf(cat, "%02X", data[i]);
+         strcat(line, cat);
+      }
+      // find cmid and msgid strings
+      k = MSG_INDEX(gc.msg_index, pipe->dst_cmid, pipe->msgid);
+      if (k != MSG_IDX_NONE) {
+         msgid = gc.msg_table[k].msg_str;
+         cmid  = gc.msg_table[k].cmid_str;
+      }
+      sprintf(cat, " %6d  %3d.%04d  %s:%s\n", 1024, delta_secs, delta_us, cmid, msgid);
+      strcat(line, cat);
+      fputs(line, out);
+      // the next 48 bytes of pipe, after msglen
+      len = 48;
+      for (i=0;i<len;i+=8) {
+         sprintf(line, "\t%03X : ", i+8);
+         for (j=0;j<8;j++) {
+            sprintf(cat, "%02X", data[i+j+12]);
+            strcat(line, cat);
+         }
+         strcat(line, "\n");
+         fputs(line, out);
+      }
+      fputs("\n\n", out);
+   }
+
+   cm.last_us = h->stamp_us;
+
+} // end cm_log_text()
+
+
+// ===========================================================================
+
+// 7.34
+
+void cm_pipe_unsub(uint8_t sub) {
+
+/* 7.34.1   Functional Description
+
+   This routine will delete a pipe subscription and return any blocks
+   still in its queue. Only the subscriber may call this routine.
+
+   7.34.2   Parameters:
+
+   sub      Subscription handle from cm_pipe_sub()
+
+   7.34.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.34.4   Data Structures
+
+   pcm_pipe_t  pipe;
+
+// 7.34.5   Code
+
+   if (sub >= CM_PIPE_SUBS) return;
+
+   // no new blocks once deleted
+   pthread_mutex_lock(&cm.pipe_mutex);
+   if (cm.pipe[sub].cmid != CM_ID_NULL) cm.num_pipes--;
+   cm.pipe[sub].cmid  = CM_ID_NULL;
+   cm.pipe[sub].msgid = CM_PIPE_NULL;
+   pthread_mutex_unlock(&cm.pipe_mutex);
+
+   // release the queue
+   while ((pipe = cm_pipe_get(sub)) != NULL) cm_pipe_free(pipe);
+
+} // end cm_pipe_unsub()
+
+
+// ===========================================================================
+
+// 7.35
+
+pcm_pipe_t cm_pipe_get(uint8_t sub) {
+
+/* 7.35.1   Functional Description
+
+   This routine will remove the oldest block from a subscription queue.
+   The caller holds the reference until cm_pipe_free().
+
+   7.35.2   Parameters:
+
+   sub      Subscription handle from cm_pipe_sub()
+
+   7.35.3   Return Values:
+
+   pipe     Pipe block or NULL when empty
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.35.4   Data Structures
+
+   pcm_pipe_con_t s;
+   pcm_pipe_t     pipe;
+   uint32_t       tail;
+
+// 7.35.5   Code
+
+   if (sub >= CM_PIPE_SUBS) return NULL;
+
+   s    = &cm.pipe[sub];
+   tail = CM_LOAD(s->tail);
+
+   // the source may drop the oldest block at the same time
+   while (tail != CM_LOAD(s->head)) {
+      pipe = s->buf[tail % CM_PIPE_QUE];
+      if (CM_CAS(s->tail, tail, tail + 1)) return pipe;
+   }
+
+   return NULL;
+
+} // end cm_pipe_get()
+
+
+// ===========================================================================
+
+// 7.36
+
+void cm_pipe_free(pcm_pipe_t pipe) {
+
+/* 7.36.1   Functional Description
+
+   This routine will return one reference on a pipe block to the pipe
+   source. The block is reused once every subscriber has returned it.
+
+   7.36.2   Parameters:
+
+   pipe     Pipe block from cm_pipe_get()
+
+   7.36.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.36.4   Data Structures
+
+// 7.36.5   Code
+
+   if (cm.pipe_free != NULL) cm.pipe_free(pipe);
+
+} // end cm_pipe_free()
+
+
+// ===========================================================================
+
+// 7.37
+
+void cm_pipe_src(void (*release)(pcm_pipe_t pipe)) {
+
+/* 7.37.1   Functional Description
+
+   This routine will register the pipe source routine that takes back
+   a reference on a pipe block.
+
+   7.37.2   Parameters:
+
+   release  Pipe source release routine
+
+   7.37.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.37.4   Data Structures
+
+// 7.37.5   Code
+
+   cm.pipe_free = release;
+
+} // end cm_pipe_src()
+
+
+// ===========================================================================
+
+// 7.38
+
+uint32_t cm_timer_start(uint8_t msgid, uint32_t time_us, uint8_t cmid, uint8_t srvid,
+                        uint8_t flags, uint32_t user) {
+
+/* 7.38.1   Functional Description
+
+   This routine will arm a timer for the CM object cmid. When the timer
+   expires a cm_timer_msg_t carrying the handle and user tag is sent to
+   the object's timer callback. Periodic timers re-arm from their due
+   time, missed periods are skipped rather than delivered as a burst.
+
+   The timer pool grows on demand, so the number of armed timers is
+   limited only by CM_TMR_POOL_MAX. Arming and expiry are O(log n).
+
+   7.38.2   Parameters:
+
+   msgid       Timer message ID
+   time_us     Interval Time Out value in microseconds
+   cmid        CM ID
+   srvid       Server ID
+   flags       CM_TMR_ONESHOT or CM_TMR_PERIODIC
+   user        Tag returned in the timer message
+
+   7.38.3   Return Values:
+
+   handle   Timer handle, else CM_TMR_NULL
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.38.4   Data Structures
+
+   uint32_t      handle = CM_TMR_NULL;
+   uint32_t      idx;
+   pcm_timer_t   t;
+
+// 7.38.5   Code
+
+   if (time_us == 0) time_us = 1;
+
+   pthread_mutex_lock(&cm.tmr.mutex);
+
+   // Extend the pool when every node is armed
+   if (cm.tmr.free == CM_TMR_IDLE) cm_tmr_grow();
+
+   if (cm.tmr.free != CM_TMR_IDLE) {
+      idx = cm.tmr.free;
+      t = &cm.tmr.pool[idx];
+      cm.tmr.free = t->next;
+      t->cmid      = cmid;
+      t->srvid     = srvid;
+      t->msgid     = msgid;
+      t->flags     = flags;
+      t->user      = user;
+      t->due_us    = cm_tmr_now() + time_us;
+      t->period_us = (flags & CM_TMR_PERIODIC) ? time_us : 0;
+      // Insert at the heap tail and sift toward the root
+      cm.tmr.heap[cm.tmr.count] = idx;
+      t->pos = cm.tmr.count++;
+      cm_tmr_sift(t->pos);
+      if (cm.tmr.count > cm.tmr.peak) cm.tmr.peak = cm.tmr.count;
+      cm.tmr.started++;
+      handle = t->handle;
+      // New earliest deadline, wake the service thread
+      if (t->pos == 0) pthread_cond_signal(&cm.tmr.cv);
+   }
+   else if (gc.trace & LIN_TRACE_ERROR) {
+      printf("cm_timer_start() Error : timer pool exhausted, %d armed\n", cm.tmr.count);
+   }
+
+   pthread_mutex_unlock(&cm.tmr.mutex);
+
+   return handle;
+
+} // end cm_timer_start()
+
+
+// ===========================================================================
+
+// 7.39
+
+uint32_t cm_timer_cancel(uint32_t handle) {
+
+/* 7.39.1   Functional Description
+
+   This routine will cancel the timer associated with handle. A handle
+   from a one-shot timer that has already expired, or one cancelled
+   earlier, is stale and rejected.
+
+   7.39.2   Parameters:
+
+   handle      Timer handle from cm_timer_start()
+
+   7.39.3   Return Values:
+
+   result   CM_OK, else CM_ERR_TIMER_ID
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.39.4   Data Structures
+
+   uint32_t      result = CM_ERR_TIMER_ID;
+   uint32_t      idx = CM_TMR_INDEX(handle);
+
+// 7.39.5   Code
+
+   pthread_mutex_lock(&cm.tmr.mutex);
+
+   // Validate Handle and Generation
+   if ((handle != CM_TMR_NULL) && (idx < cm.tmr.size) &&
+       (cm.tmr.pool[idx].handle == handle) &&
+       (cm.tmr.pool[idx].pos != CM_TMR_IDLE)) {
+      cm_tmr_remove(idx);
+      cm.tmr.cancelled++;
+      result = CM_OK;
+   }
+
+   pthread_mutex_unlock(&cm.tmr.mutex);
+
+   return result;
+
+} // end cm_timer_cancel()
+
+
+// ===========================================================================
+
+// 7.40
+
+static void *cm_tmr_thread(void *data) {
+
+/* 7.40.1   Functional Description
+
+   This thread will sleep until the earliest timer deadline and then
+   send the expired timer messages. Arming an earlier timer wakes the
+   thread to shorten the wait, so resolution is not tied to the system
+   tick.
+
+   7.40.2   Parameters:
+
+   data     Thread parameters
+
+   7.40.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.40.4   Data Structures
+
+   uint64_t    due;
+
+   struct timespec ts;
+
+// 7.40.5   Code
+
+   pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+   if (gc.trace & LIN_TRACE_ID) {
+      printf("cm_tmr_thread() started, data:tid %08X:%lu\n", (uint32_t)(uintptr_t)data, syscall(SYS_gettid));
+   }
+
+   // Timer Service Loop
+   while (1) {
+
+      pthread_mutex_lock(&cm.tmr.mutex);
+
+      // Wait for the earliest deadline, or idle
+      if (cm.tmr.count != 0) {
+         due = cm.tmr.pool[cm.tmr.heap[0]].due_us;
+      }
+      else {
+         due = cm_tmr_now() + CM_TMR_IDLE_US;
+      }
+      if (due > cm_tmr_now()) {
+         ts.tv_sec  = due / 1000000;
+         ts.tv_nsec = (due % 1000000) * 1000;
+         pthread_cond_timedwait(&cm.tmr.cv, &cm.tmr.mutex, &ts);
+      }
+
+      pthread_mutex_unlock(&cm.tmr.mutex);
+
+      // Prevent arbitrary cancellation point
+      pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+      pthread_testcancel();
+      pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+      cm_tmr_expire();
+   }
+
+   return NULL;
+
+} // end cm_tmr_thread()
+
+
+// ===========================================================================
+
+// 7.41
+
+static uint32_t cm_tmr_expire(void) {
+
+/* 7.41.1   Functional Description
+
+   This routine will pop every timer that has reached its due time and
+   send a timer message to the associated CM object. Expired timers are
+   collected in batches under the mutex and sent after it is released,
+   so an object may re-arm or cancel from its timer callback.
+
+   7.41.2   Parameters:
+
+   NONE
+
+   7.41.3   Return Values:
+
+   result   CM_OK, else CM_ERR
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.41.4   Data Structures
+
+   uint32_t          result = CM_OK;
+   uint32_t          i, n;
+   uint64_t          now;
+   pcm_timer_t       t;
+   pcmq_t            slot;
+   pcm_timer_msg_t   msg;
+   cm_send_t         ps;
+   cm_timer_t        fire[CM_TMR_BATCH];
+
+// 7.41.5   Code
+
+   do {
+      n = 0;
+
+      pthread_mutex_lock(&cm.tmr.mutex);
+
+      now = cm_tmr_now();
+      while ((cm.tmr.count != 0) && (n < CM_TMR_BATCH)) {
+         t = &cm.tmr.pool[cm.tmr.heap[0]];
+         if (t->due_us > now) break;
+         if (now - t->due_us > cm.tmr.late_max_us) {
+            cm.tmr.late_max_us = (uint32_t)(now - t->due_us);
+         }
+         fire[n++] = *t;
+         // Periodic, re-arm on the next period boundary
+         if (t->flags & CM_TMR_PERIODIC) {
+            t->due_us += t->period_us * ((now - t->due_us) / t->period_us + 1);
+            cm_tmr_sift(0);
+         }
+         // One-shot, release the node
+         else {
+            cm_tmr_remove(cm.tmr.heap[0]);
+         }
+         cm.tmr.fired++;
+      }
+
+      pthread_mutex_unlock(&cm.tmr.mutex);
+
+      // Send the Timer Messages
+      for (i=0;i<n;i++) {
+         slot = cm_alloc();
+         if (slot == NULL) {
+            CM_COUNT(cm.tmr.dropped);
+            result = CM_ERR_MSGQ_EMPTY;
+            continue;
+         }
+         msg = (pcm_timer_msg_t)slot->buf;
+         memset(&ps, 0, sizeof(cm_send_t));
+         ps.msg = (pcm_msg_t)msg;
+         msg->p.srvid  = fire[i].srvid;
+         msg->p.msgid  = fire[i].msgid;
+         msg->p.flags  = CM_NO_FLAGS;
+         msg->p.status = CM_OK;
+         msg->b.handle = fire[i].handle;
+         msg->b.user   = fire[i].user;
+         ps.src_cmid   = fire[i].cmid;
+         ps.dst_cmid   = fire[i].cmid;
+         ps.dst_devid  = cm.devid;
+         ps.msglen     = sizeof(cm_timer_msg_t);
+         result = cm_send(CM_MSG_TIMER, &ps);
+      }
+
+   } while (n == CM_TMR_BATCH);
+
+   return result;
+
+} // end cm_tmr_expire()
+
+
+// ===========================================================================
+
+// 7.42
+
+static uint64_t cm_tmr_now(void) {
+
+/* 7.42.1   Functional Description
+
+   This routine will return the monotonic time in microseconds, the
+   time base of every timer deadline.
+
+   7.42.2   Parameters:
+
+   NONE
+
+   7.42.3   Return Values:
+
+   now      Monotonic time in microseconds
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.42.4   Data Structures
+
+   struct timespec ts;
+
+// 7.42.5   Code
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+} // end cm_tmr_now()
+
+
+// ===========================================================================
+
+// 7.43
+
+static uint32_t cm_tmr_grow(void) {
+
+/* 7.43.1   Functional Description
+
+   This routine will double the timer pool and heap, and chain the new
+   nodes onto the free list. Nodes are addressed by index so handles
+   remain valid across the move. Called with the timer mutex held, or
+   from cm_init() before the service thread starts.
+
+   7.43.2   Parameters:
+
+   NONE
+
+   7.43.3   Return Values:
+
+   result   CM_OK, else CM_ERR_TIMER_ID
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.43.4   Data Structures
+
+   uint32_t      size;
+   uint32_t      i;
+   pcm_timer_t   pool;
+   uint32_t      *heap;
+
+// 7.43.5   Code
+
+   size = (cm.tmr.size == 0) ? CM_TMR_POOL_INIT : cm.tmr.size << 1;
+   if (size > CM_TMR_POOL_MAX) return CM_ERR_TIMER_ID;
+
+   pool = realloc(cm.tmr.pool, size * sizeof(cm_timer_t));
+   if (pool == NULL) return CM_ERR_TIMER_ID;
+   cm.tmr.pool = pool;
+
+   heap = realloc(cm.tmr.heap, size * sizeof(uint32_t));
+   if (heap == NULL) return CM_ERR_TIMER_ID;
+   cm.tmr.heap = heap;
+
+   // Chain the new nodes, lowest index first
+   for (i=size;i>cm.tmr.size;i--) {
+      memset(&pool[i - 1], 0, sizeof(cm_timer_t));
+      pool[i - 1].handle = CM_TMR_GEN | (i - 1);
+      pool[i - 1].cmid   = CM_ID_NULL;
+      pool[i - 1].pos    = CM_TMR_IDLE;
+      pool[i - 1].next   = cm.tmr.free;
+      cm.tmr.free = i - 1;
+   }
+   cm.tmr.size = size;
+
+   return CM_OK;
+
+} // end cm_tmr_grow()
+
+
+// ===========================================================================
+
+// 7.44
+
+static void cm_tmr_sift(uint32_t pos) {
+
+/* 7.44.1   Functional Description
+
+   This routine will restore the heap order for the entry at pos after
+   its due time changed, moving it toward the root or the leaves.
+
+   7.44.2   Parameters:
+
+   pos      Heap position
+
+   7.44.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.44.4   Data Structures
+
+   uint32_t    idx = cm.tmr.heap[pos];
+   uint64_t    due = cm.tmr.pool[idx].due_us;
+   uint32_t    up, down;
+
+// 7.44.5   Code
+
+   // Toward the root while earlier than the parent
+   while (pos > 0) {
+      up = (pos - 1) >> 1;
+      if (cm.tmr.pool[cm.tmr.heap[up]].due_us <= due) break;
+      cm.tmr.heap[pos] = cm.tmr.heap[up];
+      cm.tmr.pool[cm.tmr.heap[pos]].pos = pos;
+      pos = up;
+   }
+
+   // Toward the leaves while later than the earlier child
+   while ((down = (pos << 1) + 1) < cm.tmr.count) {
+      if ((down + 1 < cm.tmr.count) &&
+          (cm.tmr.pool[cm.tmr.heap[down + 1]].due_us < cm.tmr.pool[cm.tmr.heap[down]].due_us)) {
+         down++;
+      }
+      if (cm.tmr.pool[cm.tmr.heap[down]].due_us >= due) break;
+      cm.tmr.heap[pos] = cm.tmr.heap[down];
+      cm.tmr.pool[cm.tmr.heap[pos]].pos = pos;
+      pos = down;
+   }
+
+   cm.tmr.heap[pos] = idx;
+   cm.tmr.pool[idx].pos = pos;
+
+} // end cm_tmr_sift()
+
+
+// ===========================================================================
+
+// 7.45
+
+static void cm_tmr_remove(uint32_t idx) {
+
+/* 7.45.1   Functional Description
+
+   This routine will unlink an armed timer from the heap and return its
+   node to the free list. The handle generation is advanced so any copy
+   of the old handle is rejected by cm_timer_cancel().
+
+   7.45.2   Parameters:
+
+   idx      Pool index
+
+   7.45.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.45.4   Data Structures
+
+   pcm_timer_t   t = &cm.tmr.pool[idx];
+   uint32_t      pos = t->pos;
+
+// 7.45.5   Code
+
+   // Move the heap tail into the hole
+   cm.tmr.count--;
+   if (pos != cm.tmr.count) {
+      cm.tmr.heap[pos] = cm.tmr.heap[cm.tmr.count];
+      cm.tmr.pool[cm.tmr.heap[pos]].pos = pos;
+      cm_tmr_sift(pos);
+   }
+
+   // Release the node, new generation
+   t->pos    = CM_TMR_IDLE;
+   t->cmid   = CM_ID_NULL;
+   t->handle += CM_TMR_GEN;
+   if ((t->handle & ~0x0000FFFF) == 0) t->handle += CM_TMR_GEN;
+   t->next   = cm.tmr.free;
+   cm.tmr.free = idx;
+
+} // end cm_tmr_remove()
+
+
+// ===========================================================================
+
+// 7.46
+
+uint32_t cm_pipe_dropped(uint8_t sub) {
+
+/* 7.46.1   Functional Description
+
+   This routine will return the blocks a subscription has dropped by its
+   policy since cm_pipe_sub(), those never reach cm_pipe_get().
+
+   7.46.2   Parameters:
+
+   sub      Subscription handle from cm_pipe_sub()
+
+   7.46.3   Return Values:
+
+   dropped  Pipe blocks
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.46.4   Data Structures
+
+// 7.46.5   Code
+
+   if (sub >= CM_PIPE_SUBS) return 0;
+
+   return CM_LOAD(cm.pipe[sub].dropped);
+
+} // end cm_pipe_dropped()
+
+
+// ===========================================================================
+
+// 7.47
+
+void cm_bench(void) {
+
+/* 7.47.1   Functional Description
+
+   This routine will measure the message queue free list, cm_alloc() and
+   cm_free() pairs are run from 1, 2 and 4 threads at once and the rate
+   and compare-and-swap retries are reported for each. Only the queue is
+   initialized, cm_init() must not have been called.
+
+   7.47.2   Parameters:
+
+   NONE
+
+   7.47.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.47.4   Data Structures
+
+   pthread_t         tid[CM_BENCH_THREADS];
+   cmq_stats_t       qs;
+   uint32_t          i, n, num, cnt, idx;
+   double            t;
+
+   struct timespec   t0, t1;
+
+// 7.47.5   Code
+
+   printf("cm_bench() %d alloc/free pairs per thread, %d slots\n",
+         CM_BENCH_OPS, CM_MSGQ_SLOTS);
+
+   for (num=1;num<=CM_BENCH_THREADS;num<<=1) {
+
+      // Init Queue, free list only
+      memset(&cm.q_stats, 0, sizeof(cm.q_stats));
+      for (i=0;i<CM_MSGQ_SLOTS;i++) {
+         cmq[i].size  = CM_MSGQ_BUF_LEN;
+         cmq[i].state = CM_Q_IDLE;
+         cmq[i].buf   = &cmq[i].raw[1];
+         cmq[i].next  = (i == CM_MSGQ_SLOTS - 1) ? CM_Q_NULL : i + 1;
+      }
+      cm.q_free = 0;
+
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      for (n=0;n<num;n++) {
+         if (pthread_create(&tid[n], NULL, cm_bench_thread, NULL)) {
+            printf("cm_bench() Error : thread %d did not start\n", n);
+            break;
+         }
+      }
+      for (i=0;i<n;i++) {
+         pthread_join(tid[i], NULL);
+      }
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      t = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1E9;
+
+      // every slot must be back on the free list
+      cnt = 0;
+      idx = CM_Q_IDX(cm.q_free);
+      while (idx != CM_Q_NULL && cnt <= CM_MSGQ_SLOTS) {
+         idx = cmq[idx].next;
+         cnt++;
+      }
+
+      cm_qstats(&qs);
+      printf("  threads %d : %8.3f s  %8.2f Mops/s  alloc_spin %d, free_spin %d, empty %d, free %d/%d\n",
+            n, t, (double)n * CM_BENCH_OPS / t / 1E6, qs.alloc_spin, qs.free_spin,
+            qs.empty, cnt, CM_MSGQ_SLOTS);
+   }
+
+} // end cm_bench()
+
+
+// ===========================================================================
+
+// 7.48
+
+static void *cm_bench_thread(void *data) {
+
+/* 7.48.1   Functional Description
+
+   This routine will run one cm_bench() thread, slots are taken and
+   returned in small batches so each thread holds several at a time.
+
+   7.48.2   Parameters:
+
+   data     NULL
+
+   7.48.3   Return Values:
+
+   NULL
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.48.4   Data Structures
+
+   pcmq_t      slot[CM_BENCH_BATCH];
+   uint32_t    i, j;
+
+// 7.48.5   Code
+
+   for (i=0;i<CM_BENCH_OPS;i+=CM_BENCH_BATCH) {
+      for (j=0;j<CM_BENCH_BATCH;j++) {
+         slot[j] = cm_alloc();
+      }
+      for (j=0;j<CM_BENCH_BATCH;j++) {
+         if (slot[j] != NULL) cm_free((pcm_msg_t)slot[j]->buf);
+      }
+   }
+
+   return NULL;
+
+} // end cm_bench_thread()
+
@@ -10,6 +10,11 @@
 #define CM_MSGQ_SLOTS         128
 #define CM_MSGQ_BUF_LEN       256
 
+// Message Q Free List Benchmark, see cm_bench()
+#define CM_BENCH_OPS          2000000
+#define CM_BENCH_BATCH        4
+#define CM_BENCH_THREADS      4
+
 #define CM_OK                 0x00000000
 #define CM_ERROR              0x80000001
 #define CM_ERR_THREAD         0x80000002
@@ -37,12 +42,64 @@
 #define CM_Q_DELIVER          0x02
 #define CM_Q_BUSY             0x03
 
+// Message Q Free List, tag:index
+#define CM_Q_NULL             0xFF
+#define CM_Q_IDX(x)           ((x) & 0x000000FF)
+#define CM_Q_TAG(x)           ((x) & 0xFFFFFF00)
+#define CM_Q_TAG_INC          0x00000100
+
+#if CM_MSGQ_SLOTS >= CM_Q_NULL
+#error CM_MSGQ_SLOTS must fit the free list index
+#endif
+#if (CM_MSGQ_SLOTS & (CM_MSGQ_SLOTS - 1)) != 0
+#error CM_MSGQ_SLOTS must be a power of two
+#endif
+
+// Binary Traffic Log
+#define CM_LOG_FILE           "cm_traffic.bin"
+#define CM_LOG_MAGIC          0x474C4D43
+#define CM_LOG_VERSION        1
+#define CM_LOG_SLOTS          256
+#define CM_LOG_DATA_LEN       CM_MAX_MSG_INT8U
+#define CM_LOG_PIPE_LEN       60
+#define CM_LOG_BUF_LEN        65536
+#define CM_LOG_WAIT_US        5000
+
+// Pipe Subscriptions
+#ifndef CM_PIPE_SUBS
+#define CM_PIPE_SUBS          8
+#endif
+#define CM_PIPE_QUE           32
+#define CM_PIPE_SUB_NULL      0xFF
+
+// Pipe Subscription Drop Policy
+#define CM_PIPE_DROP_NEW      0x00
+#define CM_PIPE_DROP_OLD      0x01
+
+#if (CM_PIPE_QUE & (CM_PIPE_QUE - 1)) != 0
+#error CM_PIPE_QUE must be a power of two
+#endif
+
 // Timers
 #define CM_TMR_ID0            0x00
 #define CM_TMR_ID1            0x01
 #define CM_TMR_ID2            0x02
 #define CM_TMR_ID3            0x03
 
+// CM Timer Handles, pool index in the low 16 bits, generation above
+#define CM_TMR_NULL           0x00000000
+#define CM_TMR_IDLE           0xFFFFFFFF
+#define CM_TMR_GEN            0x00010000
+#define CM_TMR_INDEX(h)       ((h) & 0x0000FFFF)
+#define CM_TMR_POOL_INIT      64
+#define CM_TMR_POOL_MAX       0x00010000
+#define CM_TMR_BATCH          32
+#define CM_TMR_IDLE_US        100000
+
+// CM Timer Flags
+#define CM_TMR_ONESHOT        0x00
+#define CM_TMR_PERIODIC       0x01
+
 // CM Port Callback Type Definition
 typedef  void (*cmio_t)(uint8_t op_code, pcm_msg_t msg);
 
@@ -65,28 +122,77 @@ typedef struct _cm_send_t {
 typedef struct _cmq_t {
    uint8_t     state;
    uint8_t     flags;
-   uint8_t     reserved[2];
+   uint8_t     next;
+   uint8_t     reserved;
    uint16_t    size;
    uint16_t    msglen;
    uint32_t    raw[CM_MSGQ_BUF_LEN+4];
    uint32_t   *buf;
 } cmq_t, *pcmq_t;
 
+// CM Message Queue Statistics
+typedef struct _cmq_stats_t {
+   uint32_t    alloc;
+   uint32_t    alloc_spin;
+   uint32_t    free_spin;
+   uint32_t    empty;
+   uint32_t    free_err;
+   uint32_t    hiwater;
+   uint32_t    batch_max;
+   uint32_t    wakeups;
+} cmq_stats_t, *pcmq_stats_t;
+
+// CM Delivery FIFO Cell
+typedef struct _cmq_cell_t {
+   uint32_t    seq;
+   uint8_t     slot;
+} cmq_cell_t, *pcmq_cell_t;
+
+// Binary Traffic Log File Header,
+// followed by tbl_len msg_entry_t records
+typedef struct _cm_log_file_t {
+   uint32_t    magic;
+   uint32_t    version;
+   uint32_t    start;
+   uint16_t    tbl_len;
+   uint16_t    entry_len;
+} cm_log_file_t, *pcm_log_file_t;
+
+// Binary Traffic Log Record Header,
+// followed by len bytes of message
+typedef struct _cm_log_hdr_t {
+   uint32_t    stamp_us;
+   uint16_t    len;
+   uint8_t     dir;
+   uint8_t     reserved;
+} cm_log_hdr_t, *pcm_log_hdr_t;
+
+// Binary Traffic Log Ring Cell
+typedef struct _cm_log_rec_t {
+   uint32_t       seq;
+   cm_log_hdr_t   h;
+   uint8_t        data[CM_LOG_DATA_LEN];
+} cm_log_rec_t, *pcm_log_rec_t;
+
 // CM Port Connection
 typedef struct _cm_port_t {
    uint8_t     media;
    cmio_t      io;
 } cm_port_t, *pcm_port_t;
 
-// CM Pipe Connection
+// CM Pipe Subscription, one bounded queue per consumer
 typedef struct _cm_pipe_con_t {
    uint8_t       cmid;
    uint8_t       msgid;
-   uint8_t       dstdev;
-   uint32_t      mark;
-   uint32_t      count;
-   uint8_t      *first;
-   uint32_t      pipelen;
+   uint8_t       policy;
+   uint32_t      depth;
+   void          (*notify)(uint8_t sub);
+   pcm_pipe_t    buf[CM_PIPE_QUE];
+   uint32_t      head;
+   uint32_t      tail;
+   uint32_t      sent;
+   uint32_t      dropped;
+   uint32_t      hiwater;
 } cm_pipe_con_t, *pcm_pipe_con_t;
 
 // CM Object Subscriptions
@@ -96,15 +202,39 @@ typedef struct _cm_sub_t {
    uint8_t       cmid;
 } cm_sub_t, *pcm_sub_t;
 
-// CM Timers
+// CM Timers, one pool node per armed timer
 typedef struct _cm_timer_t {
+   uint32_t      handle;
    uint8_t       cmid;
    uint8_t       srvid;
    uint8_t       msgid;
-   uint32_t      count;
-   uint32_t      reload;
+   uint8_t       flags;
+   uint32_t      user;
+   uint32_t      pos;
+   uint32_t      next;
+   uint64_t      due_us;
+   uint64_t      period_us;
 } cm_timer_t, *pcm_timer_t;
 
+// CM Timer Service, min-heap of pool indices ordered by due time
+typedef struct _cm_tmr_t {
+   pthread_t         tid;
+   pthread_mutex_t   mutex;
+   pthread_cond_t    cv;
+   pcm_timer_t       pool;
+   uint32_t          *heap;
+   uint32_t          size;
+   uint32_t          count;
+   uint32_t          free;
+   uint32_t          legacy[CM_MAX_TIMERS];
+   uint32_t          peak;
+   uint32_t          started;
+   uint32_t          fired;
+   uint32_t          cancelled;
+   uint32_t          dropped;
+   uint32_t          late_max_us;
+} cm_tmr_t, *pcm_tmr_t;
+
 // CM Object
 typedef struct _cm_obj_t {
    uint8_t       id;
@@ -127,16 +257,25 @@ typedef struct _cm_t {
    pthread_t         tid;
    pthread_mutex_t   q_mutex;
    pthread_cond_t    q_cv;
-   uint8_t           q_head;
-   uint8_t           q_tail;
-   uint8_t           q_msg_cnt;
+   uint32_t          q_free;
+   cmq_stats_t       q_stats;
+   uint32_t          q_in;
+   uint32_t          q_out;
+   uint32_t          q_wait;
    uint32_t          last_us;
    FILE              *log;
-   pthread_mutex_t   log_mutex;
-   cm_timer_t        tim[CM_MAX_TIMERS];
-   cm_pipe_con_t     pipe[CM_MAX_PIPES];
+   pthread_t         log_tid;
+   uint32_t          log_in;
+   uint32_t          log_out;
+   uint32_t          log_run;
+   uint32_t          log_drop;
+   cm_tmr_t          tmr;
+   pthread_mutex_t   pipe_mutex;
+   void              (*pipe_free)(pcm_pipe_t pipe);
+   cm_pipe_con_t     pipe[CM_PIPE_SUBS];
    cm_port_t         port[CM_MAX_PORTS + 1];
    cm_obj_t          obj[CM_MAX_OBJS + 1];
+   uint8_t           obj_map[256];
    cm_rt_rec_t       rt[CM_MAX_ROUTES + 1];
 } cm_t, *pcm_t;
 
@@ -157,6 +296,9 @@ uint8_t    cm_get_sub(uint8_t h, uint8_t srvID, uint8_t msgid);
 uint32_t   cm_timer_set(uint8_t timerid, uint8_t msgid, uint32_t time_ms,
                         uint8_t cmid, uint8_t srvid);
 uint32_t   cm_timer_kill(uint8_t timerid, uint8_t cmid);
+uint32_t   cm_timer_start(uint8_t msgid, uint32_t time_us, uint8_t cmid, uint8_t srvid,
+                          uint8_t flags, uint32_t user);
+uint32_t   cm_timer_cancel(uint32_t handle);
 uint32_t   cm_tick(void);
 void       cm_tx_drop(uint8_t op_code, pcm_msg_t msg);
 uint32_t   cm_send_msg(uint8_t msg_type, pcm_msg_t msg, pcm_msg_t preq,
@@ -164,8 +306,17 @@ uint32_t   cm_send_msg(uint8_t msg_type, pcm_msg_t msg, pcm_msg_t preq,
 uint32_t   cm_send_reg_req(uint8_t devid, uint8_t port, uint8_t flags, uint8_t *device);
 void       cm_local(uint8_t srvid, uint8_t msgid, uint8_t flags, uint8_t status);
 uint32_t   cm_send_req(uint8_t srvid, uint8_t msgid, uint8_t srcid, uint8_t flags);
-uint32_t   cm_pipe_reg(uint8_t cmid, uint8_t msgid, uint32_t mark, uint8_t dstdev);
-uint32_t   cm_pipe_send(pcm_pipe_t pipe, uint32_t pipelen);
+uint8_t    cm_pipe_sub(uint8_t cmid, uint8_t msgid, uint32_t depth, uint8_t policy,
+                       void (*notify)(uint8_t sub));
+uint32_t   cm_pipe_send(pcm_pipe_t pipe, uint32_t pipelen, uint32_t *refs);
+uint8_t    cm_pipe_exists(uint8_t msgid);
+void       cm_pipe_unsub(uint8_t sub);
+pcm_pipe_t cm_pipe_get(uint8_t sub);
+void       cm_pipe_free(pcm_pipe_t pipe);
+uint32_t   cm_pipe_dropped(uint8_t sub);
+void       cm_bench(void);
+void       cm_pipe_src(void (*release)(pcm_pipe_t pipe));
+void       cm_qstats(pcmq_stats_t stats);
 void       cm_qmsg(pcm_msg_t msg);
 void       cm_log(pcm_msg_t msg);
 void       cm_timer_callback(size_t timer_id, void * user_data);
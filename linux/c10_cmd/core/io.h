@@ -3,5 +3,7 @@
 #include "ftd2xx.h"
 #include "timer.h"
 #include "fifo.h"
+#include "udp.h"
+#include "sim.h"
 
 
@@ -61,6 +61,7 @@
         7.3  user_control_c()
         7.4  usage()
         7.5  cc_parse()
+        7.6  user_status()
 
 -----------------------------------------------------------------------------*/
 
@@ -174,6 +175,7 @@ int main(int argc, char *argv[]) {
    gc.month       = month_table;
    gc.msg_table   = msg_table;
    gc.msg_table_len = DIM(msg_table);
+   gc.msg_index   = msg_index;
 
    sprintf(gc.dev_str,"DE0-I LIN, %s", BUILD_STR);
 
@@ -186,6 +188,14 @@ int main(int argc, char *argv[]) {
          gc.cmd_file = argv[i+1];
       else if (strcmp(argv[i], "-q") == 0)
          gc.quiet = TRUE;
+      else if (strcmp(argv[i], "-s") == 0) {
+         opc_stat_bench();
+         exit(0);
+      }
+      else if (strcmp(argv[i], "-b") == 0) {
+         cm_bench();
+         exit(0);
+      }
    }
 
    printf("%s ", argv[0]);
@@ -210,8 +220,11 @@ int main(int argc, char *argv[]) {
    // CM Init
    gc.error |= cm_init();
 
-   // FIFO Init
-   gc.error |= fifo_init(LIN_BAUD_RATE, CM_PORT_COM0, cc.opc_comport);
+   // FIFO or LAN Init
+   if (cc.opc_media == CM_MEDIA_LAN)
+      gc.error |= udp_init(CM_PORT_COM0, cc.opc_ip_addr, cc.opc_cm_udp_port);
+   else
+      gc.error |= fifo_init(LIN_BAUD_RATE, CM_PORT_COM0, cc.opc_comport);
 
    // Check for fatal Errors
    if (gc.error != LIN_ERROR_OK) {
@@ -252,13 +265,17 @@ int main(int argc, char *argv[]) {
    // set the control_c signal handler
    signal(SIGINT, user_control_c);
 
-   printf("\n *** hit any key to exit main() ***\n\n");
+   printf("\n *** hit 'i' for pipe status and integrity, any other key to exit main() ***\n\n");
 
    // Main Thread
    while (1) {
       usleep(100*1000);
       if (kbhit()) {
-         getchar();
+         // pipe status and integrity
+         if (getchar() == 'i') {
+            user_status();
+            continue;
+         }
          break;
       }
       // halt the application
@@ -340,10 +357,20 @@ void user_control_c(int signum) {
 
 // 7.3.4   Data Structures
 
+   timer_stats_t  ts;
+
 // 7.2.5   Code
 
    printf("%s exit() ... ", program);
 
+   // Report main()'s Tick Timing
+   if (gc.trace & LIN_TRACE_TIMER) {
+      timer_stats(main_timer, &ts);
+      printf("\nmain_timer : %d mS, fires %d, overruns %d, latency %d/%d/%d uS, drift %d uS\n",
+            ts.interval_ms, ts.fires, ts.overruns, ts.lat_min_us, ts.lat_mean_us,
+            ts.lat_max_us, ts.drift_us);
+   }
+
    // Stop main()'s Periodic Timer
    timer_stop(main_timer);
 
@@ -351,7 +378,8 @@ void user_control_c(int signum) {
    cm_final();
    cp_final();
    opc_final();
-   fifo_final();
+   if (cc.opc_media == CM_MEDIA_LAN) udp_final();
+   else fifo_final();
 
    // Cancel main()'s Timer Thread
    timer_final();
@@ -389,11 +417,13 @@ void usage(void) {
 // 7.4.5   Code
 
    printf("\n");
-   printf("usage: cmd [-h][-f filename][-q]\n\n");
+   printf("usage: cmd [-h][-f filename][-q][-s][-b]\n\n");
    printf("  This utility will execute the operation code and parameters in the command file.\n");
    printf("  -h       ... usage\n");
    printf("  -f       ... specifies the command input filename\n");
    printf("  -q       ... disable stdio output\n");
+   printf("  -s       ... benchmark the DAQ statistics engine and exit\n");
+   printf("  -b       ... benchmark the CM message queue free list and exit\n");
    printf("\n");
 
    exit(0);
@@ -529,3 +559,68 @@ uint32_t cc_parse(char *cmd_file) {
 
 } // end cc_parse()
 
+
+// ===========================================================================
+
+// 7.6
+
+void user_status(void) {
+
+/* 7.6.1   Functional Description
+
+   This routine will print the pipe ring counters of the FIFO or LAN
+   driver, the FIFO TX engine or LAN datagram counters, the CM message
+   queue counters and the pipe integrity to the console, on the 'i' key.
+
+   7.6.2   Parameters:
+
+   NONE
+
+   7.6.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.6.4   Data Structures
+
+   fifo_stats_t      stats;
+   fifo_tx_stats_t   tx;
+   udp_stats_t       dg;
+   cmq_stats_t       qs;
+
+// 7.6.5   Code
+
+   if (cc.opc_media == CM_MEDIA_LAN) udp_stats(&stats);
+   else fifo_stats(&stats);
+
+   printf("\npipe ring : blocks %d, overruns %d, dropped %d, hiwater %d/%d, used %d, free_err %d\n",
+         stats.blocks, stats.overruns, stats.dropped, stats.hiwater, FIFO_PIPE_SLOTS,
+         stats.used, stats.free_err);
+
+   // TX engine, fifo_tx() to write completion
+   if (cc.opc_media != CM_MEDIA_LAN) {
+      fifo_tx_stats(&tx);
+      printf("fifo tx : frames %d, writes %d, batch max %d, retries %d, short %d, hiwater %d\n",
+            tx.frames, tx.writes, tx.batch_max, tx.retries, tx.short_wr, tx.hiwater);
+      printf("fifo tx latency min:mean:max = %d:%d:%d uS\n",
+            tx.lat_min_us, tx.lat_mean_us, tx.lat_max_us);
+   }
+   // datagrams and recvmmsg() batches
+   else {
+      udp_dgram_stats(&dg);
+      printf("udp rx : datagrams %d, batches %d, ctl %d, pipe %d, bad_len %d, truncated %d, sock_drops %d, tx_err %d\n",
+            dg.datagrams, dg.batches, dg.ctl, dg.pipe, dg.bad_len, dg.truncated,
+            dg.sock_drops, dg.tx_err);
+   }
+
+   // message slot pool and delivery
+   cm_qstats(&qs);
+   printf("cm msg queue : alloc %d, alloc_spin %d, free_spin %d, empty %d, free_err %d, hiwater %d/%d\n",
+         qs.alloc, qs.alloc_spin, qs.free_spin, qs.empty, qs.free_err, qs.hiwater, CM_MSGQ_SLOTS);
+
+   pmon_print();
+
+} // end user_status()
+
@@ -9,6 +9,7 @@
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <sys/syscall.h>
 #include <sys/syslog.h>
 #include <termios.h>
@@ -41,6 +42,7 @@
 // from f/w share
 #include "fw_cfg.h"
 #include "cm_const.h"
+#include "msg_def.h"
 #include "daq_msg.h"
 #include "cp_msg.h"
 #include "fpga_build.h"
@@ -52,10 +54,13 @@
 #include "ci.h"
 #include "cm.h"
 #include "lib.h"
+#include "pmon.h"
 
 #include "opc_msg.h"
 
 #include "opc_srv.h"
+#include "opc_map.h"
+#include "opc_stat.h"
 #include "cp_cli.h"
 
 #include "build.h"
@@ -115,6 +120,7 @@ typedef struct _cac_t {
    uint32_t    opc_mac_addr_lo;
    uint32_t    opc_ip_addr;
    uint32_t    opc_cm_udp_port;
+   uint32_t    opc_media;
    char        daq_file[CM_MAX_FILE_LEN];
    uint32_t    daq_opcmd;
    uint32_t    daq_packets;
@@ -123,6 +129,34 @@ typedef struct _cac_t {
    uint32_t    daq_file_stamp;
    uint32_t    daq_real;
    uint32_t    daq_ramp;
+   uint32_t    daq_mmap;
+   uint32_t    daq_mmap_mb;
+   uint32_t    daq_stats;
+   uint32_t    daq_stats_ms;
+   uint32_t    daq_rate;
+   uint32_t    daq_sched;
+   uint32_t    daq_prof;
+   uint32_t    cp_window;
+   uint32_t    cp_timeout;
+   uint32_t    mem_addr;
+   uint32_t    mem_len;
+   uint32_t    mem_width;
+   char        mem_file[CM_MAX_FILE_LEN];
+   uint32_t    mem_stream;
+   char        xlt_file[CM_MAX_FILE_LEN];
+   uint32_t    xlt_stream;
+   uint32_t    xlt_time_ms;
+   uint32_t    xlt_poll_ms;
+   uint32_t    prof_time_ms;
+   uint32_t    prof_clear;
+   uint32_t    sim_enable;
+   uint32_t    sim_rate;
+   uint32_t    sim_pace;
+   uint32_t    sim_wave;
+   uint32_t    sim_loss;
+   uint32_t    sim_reorder;
+   uint32_t    sim_latency_us;
+   char        sim_fw[CM_MAX_FILE_LEN];
 } cac_t, *pcac_t;
 
 //
@@ -143,6 +177,9 @@ typedef struct _gc_t {
    uint32_t    fpga_ver;
    uint32_t    fpga_time;
    uint32_t    fpga_date;
+   uint32_t    fw_ver;
+   uint32_t    fpga_epoch;
+   uint8_t     vhdl[8];
    uint8_t     buf[CM_MAX_MSG_INT8U];
    time_t      ping_time;
    uint8_t     ping_cnt;
@@ -153,6 +190,7 @@ typedef struct _gc_t {
    char      **month;
    pmsg_entry_t msg_table;
    uint16_t     msg_table_len;
+   const uint8_t (*msg_index)[MSG_IDS];
 } gc_t, *pgc_t;
 
 // Global Access
@@ -164,5 +202,6 @@ void     timer(size_t timer_id, void * user_data);
 void     user_control_c(int signum);
 void     usage(void);
 uint32_t cc_parse(char *cmd_file);
+void     user_status(void);
 
 
@@ -0,0 +1,420 @@
+/*-----------------------------------------------------------------------------
+
+   1  ABSTRACT
+
+   1.1 Module Type
+
+      Pipe Integrity Monitor
+
+   1.2 Functional Description
+
+      This code checks the header of every DAQ pipe message as the block
+      is received, counting sequence gaps, duplicates, reordering, bad
+      magic numbers and FPGA stamp interval jitter, with a bounded log of
+      the most recent events.
+
+   1.3 Specification/Design Reference
+
+      See fw_cfg.h under the share directory.
+
+   1.4 Module Test Specification Reference
+
+      None
+
+   1.5 Compilation Information
+
+      See fw_cfg.h under the share directory.
+
+   1.6 Notes
+
+      pmon_block() runs on fifo_thread only, and reads a few header words
+      per 1K message. Readers take a consistent copy with pmon_get(), the
+      writer brackets each block with a generation count.
+
+      The stamp interval of one message is DAQ_MAX_SAM rows of rate clocks.
+      The rate comes from the pipe header when the FPGA fills it in, then
+      daq.rate, otherwise the interval is learned from the first
+      PMON_LEARN messages.
+
+   2  CONTENTS
+
+      1 ABSTRACT
+        1.1 Module Type
+        1.2 Functional Description
+        1.3 Specification/Design Reference
+        1.4 Module Test Specification Reference
+        1.5 Compilation Information
+        1.6 Notes
+
+      2 CONTENTS
+
+      3 VOCABULARY
+
+      4 EXTERNAL RESOURCES
+        4.1  Include Files
+        4.2  External Data Structures
+        4.3  External Function Prototypes
+
+      5 LOCAL CONSTANTS AND MACROS
+
+      6 MODULE DATA STRUCTURES
+        6.1  Local Function Prototypes
+        6.2  Local Data Structures
+
+      7 MODULE CODE
+        7.1  pmon_init()
+        7.2  pmon_block()
+        7.3  pmon_stamp()
+        7.4  pmon_event()
+        7.5  pmon_get()
+        7.6  pmon_print()
+
+-----------------------------------------------------------------------------*/
+
+// 3 VOCABULARY
+
+// 4 EXTERNAL RESOURCES
+
+// 4.1  Include Files
+
+#include "main.h"
+
+// 4.2   External Data Structures
+
+// 4.3   External Function Prototypes
+
+// 5 LOCAL CONSTANTS AND MACROS
+
+// 6 MODULE DATA STRUCTURES
+
+// 6.1  Local Function Prototypes
+
+   static   void  pmon_stamp(pcm_pipe_daq_t pipe);
+   static   void  pmon_event(uint32_t type, pcm_pipe_daq_t pipe, uint32_t value);
+
+// 6.2  Local Data Structures
+
+   static   pmon_t   pmon = {0};
+
+   static   char    *pmon_str[] = {
+               "NONE", "GAP", "DUP", "REORDER", "MAGIC", "JITTER", "HDR"
+            };
+
+// 7 MODULE CODE
+
+// ===========================================================================
+
+// 7.1
+
+void pmon_init(uint32_t rate) {
+
+/* 7.1.1   Functional Description
+
+   This routine will restart the monitor for a new run. The counters are
+   cleared by fifo_thread ahead of the next block.
+
+   7.1.2   Parameters:
+
+   rate     FPGA clocks per sample row, 0 to learn the stamp interval
+
+   7.1.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.1.4   Data Structures
+
+// 7.1.5   Code
+
+   __atomic_store_n(&pmon.rate, rate, __ATOMIC_RELAXED);
+   __atomic_store_n(&pmon.reset, TRUE, __ATOMIC_RELEASE);
+
+} // end pmon_init()
+
+
+// ===========================================================================
+
+// 7.2
+
+void pmon_block(uint8_t *blk, uint32_t len) {
+
+/* 7.2.1   Functional Description
+
+   This routine will check the header of each pipe message in the block.
+
+   7.2.2   Parameters:
+
+   blk      Pipe block
+   len      Block length in bytes
+
+   7.2.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.2.4   Data Structures
+
+   uint32_t       off;
+   int32_t        d;
+   pcm_pipe_daq_t pipe;
+
+// 7.2.5   Code
+
+   // odd while the block is applied
+   __atomic_add_fetch(&pmon.gen, 1, __ATOMIC_ACQ_REL);
+
+   // new run
+   if (__atomic_exchange_n(&pmon.reset, FALSE, __ATOMIC_ACQ_REL)) {
+      memset(&pmon.s, 0, sizeof(pmon_stats_t));
+      pmon.started    = FALSE;
+      pmon.learn_cnt  = 0;
+      pmon.learn_sum  = 0;
+      pmon.jitter_sum = 0;
+      pmon.jitter_cnt = 0;
+   }
+
+   for (off=0;off+sizeof(cm_pipe_daq_t)<=len;off+=sizeof(cm_pipe_daq_t)) {
+      pipe = (pcm_pipe_daq_t)(blk + off);
+      // memory stream, not a sampled run
+      if (pipe->msgid == CM_PIPE_STREAM_DATA) continue;
+      // not a DAQ pipe message
+      if (pipe->msgid != CM_PIPE_DAQ_DATA || pipe->msglen != (sizeof(cm_pipe_daq_t) >> 2)) {
+         pmon.s.hdr++;
+         pmon_event(PMON_EVT_HDR, pipe, pipe->msglen);
+         continue;
+      }
+      if (pipe->magic != PMON_MAGIC) {
+         pmon.s.magic++;
+         pmon_event(PMON_EVT_MAGIC, pipe, pipe->magic);
+      }
+      pmon.s.msgs++;
+      // first message of the run
+      if (pmon.started == FALSE) {
+         pmon.started     = TRUE;
+         pmon.s.first_seq = pipe->seqid;
+         pmon.s.last_seq  = pipe->seqid;
+         pmon.last_stamp  = pipe->stamp;
+         continue;
+      }
+      d = (int32_t)(pipe->seqid - (pmon.s.last_seq + 1));
+      // in order
+      if (d == 0) {
+         pmon_stamp(pipe);
+         pmon.s.last_seq = pipe->seqid;
+         pmon.last_stamp = pipe->stamp;
+      }
+      // messages lost, the stamp interval spans the gap
+      else if (d > 0) {
+         pmon.s.gaps++;
+         pmon.s.lost += d;
+         pmon_event(PMON_EVT_GAP, pipe, d);
+         pmon.s.last_seq = pipe->seqid;
+         pmon.last_stamp = pipe->stamp;
+      }
+      else if (pipe->seqid == pmon.s.last_seq) {
+         pmon.s.dups++;
+         pmon_event(PMON_EVT_DUP, pipe, pmon.s.last_seq);
+      }
+      // late arrival, the sequence does not move back
+      else {
+         pmon.s.reorder++;
+         pmon_event(PMON_EVT_REORDER, pipe, pmon.s.last_seq);
+      }
+   }
+
+   if (pmon.jitter_cnt != 0) pmon.s.jitter_mean = (uint32_t)(pmon.jitter_sum / pmon.jitter_cnt);
+
+   __atomic_add_fetch(&pmon.gen, 1, __ATOMIC_ACQ_REL);
+
+} // end pmon_block()
+
+
+// ===========================================================================
+
+// 7.3
+
+static void pmon_stamp(pcm_pipe_daq_t pipe) {
+
+/* 7.3.1   Functional Description
+
+   This routine will compare the FPGA stamp interval from the previous
+   in-order message with the nominal interval.
+
+   7.3.2   Parameters:
+
+   pipe     Pipe message
+
+   7.3.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.3.4   Data Structures
+
+   uint32_t    delta = pipe->stamp - pmon.last_stamp;
+   uint32_t    jit;
+
+// 7.3.5   Code
+
+   // nominal interval, header rate then daq.rate then learned
+   if (pmon.s.nominal == 0) {
+      if (pipe->rate != 0)
+         pmon.s.nominal = pipe->rate * DAQ_MAX_SAM;
+      else if (pmon.rate != 0)
+         pmon.s.nominal = pmon.rate * DAQ_MAX_SAM;
+      else {
+         pmon.learn_sum += delta;
+         if (++pmon.learn_cnt == PMON_LEARN)
+            pmon.s.nominal = (uint32_t)(pmon.learn_sum / PMON_LEARN);
+         return;
+      }
+   }
+
+   jit = (delta > pmon.s.nominal) ? delta - pmon.s.nominal : pmon.s.nominal - delta;
+   pmon.jitter_sum += jit;
+   pmon.jitter_cnt++;
+   if (jit > pmon.s.jitter_max) pmon.s.jitter_max = jit;
+   if (jit > (pmon.s.nominal >> PMON_JITTER_SHIFT)) {
+      pmon.s.jitter++;
+      pmon_event(PMON_EVT_JITTER, pipe, delta);
+   }
+
+} // end pmon_stamp()
+
+
+// ===========================================================================
+
+// 7.4
+
+static void pmon_event(uint32_t type, pcm_pipe_daq_t pipe, uint32_t value) {
+
+/* 7.4.1   Functional Description
+
+   This routine will record the event, the oldest is overwritten.
+
+   7.4.2   Parameters:
+
+   type     PMON_EVT_*
+   pipe     Pipe message
+   value    Event value, lost count, expected seqid, magic or interval
+
+   7.4.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.4.4   Data Structures
+
+   ppmon_evt_t evt = &pmon.s.evt[pmon.s.events % PMON_EVENTS];
+
+// 7.4.5   Code
+
+   evt->type     = type;
+   evt->seqid    = pipe->seqid;
+   evt->value    = value;
+   evt->stamp    = pipe->stamp;
+   evt->stamp_us = pipe->stamp_us;
+   pmon.s.events++;
+
+   if (gc.trace & LIN_TRACE_PIPE) {
+      printf("pmon_event() %s, seqid %08X, value %08X\n", pmon_str[type], pipe->seqid, value);
+   }
+
+} // end pmon_event()
+
+
+// ===========================================================================
+
+// 7.5
+
+void pmon_get(ppmon_stats_t stats) {
+
+/* 7.5.1   Functional Description
+
+   This routine will copy the counters and event log, retrying while
+   fifo_thread is part way through a block.
+
+   7.5.2   Parameters:
+
+   stats    Integrity counters and event log
+
+   7.5.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.5.4   Data Structures
+
+   uint32_t    gen;
+
+// 7.5.5   Code
+
+   while (1) {
+      gen = __atomic_load_n(&pmon.gen, __ATOMIC_ACQUIRE);
+      if (gen & 1) continue;
+      memcpy(stats, &pmon.s, sizeof(pmon_stats_t));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&pmon.gen, __ATOMIC_RELAXED) == gen) break;
+   }
+
+} // end pmon_get()
+
+
+// ===========================================================================
+
+// 7.6
+
+void pmon_print(void) {
+
+/* 7.6.1   Functional Description
+
+   This routine will print the counters and the event log to the console.
+
+   7.6.2   Parameters:
+
+   NONE
+
+   7.6.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.6.4   Data Structures
+
+   pmon_stats_t   s;
+   ppmon_evt_t    evt;
+   uint32_t       i, cnt;
+
+// 7.6.5   Code
+
+   pmon_get(&s);
+
+   printf("\npipe integrity : msgs %d, seqid %08X..%08X\n", s.msgs, s.first_seq, s.last_seq);
+   printf("   gaps %d (%d lost), dups %d, reorder %d, magic %d, hdr %d\n",
+         s.gaps, s.lost, s.dups, s.reorder, s.magic, s.hdr);
+   printf("   stamp nominal %d clocks, jitter max %d, mean %d, over tolerance %d\n",
+         s.nominal, s.jitter_max, s.jitter_mean, s.jitter);
+
+   // oldest event first
+   cnt = (s.events < PMON_EVENTS) ? s.events : PMON_EVENTS;
+   if (cnt != 0) printf("   last %d of %d events\n", cnt, s.events);
+   for (i=s.events-cnt;i<s.events;i++) {
+      evt = &s.evt[i % PMON_EVENTS];
+      printf("   %-8s seqid %08X, value %08X, stamp %08X, stamp_us %u\n",
+            pmon_str[evt->type], evt->seqid, evt->value, evt->stamp, evt->stamp_us);
+   }
+   printf("\n");
+
+} // end pmon_print()
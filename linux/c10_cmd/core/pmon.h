@@ -0,0 +1,63 @@
+#pragma once
+
+// Pipe Integrity Monitor, DAQ pipe headers from adc_ctl.vhd
+#define  PMON_MAGIC           0x123455AA
+#define  PMON_EVENTS          32
+#define  PMON_LEARN           16
+#define  PMON_JITTER_SHIFT    3
+
+// Event Types
+#define  PMON_EVT_NONE        0
+#define  PMON_EVT_GAP         1
+#define  PMON_EVT_DUP         2
+#define  PMON_EVT_REORDER     3
+#define  PMON_EVT_MAGIC       4
+#define  PMON_EVT_JITTER      5
+#define  PMON_EVT_HDR         6
+
+// Integrity Event
+typedef struct _pmon_evt_t {
+   uint32_t    type;
+   uint32_t    seqid;
+   uint32_t    value;
+   uint32_t    stamp;
+   uint32_t    stamp_us;
+} pmon_evt_t, *ppmon_evt_t;
+
+// Integrity Counters and Event Log
+typedef struct _pmon_stats_t {
+   uint32_t    msgs;
+   uint32_t    first_seq;
+   uint32_t    last_seq;
+   uint32_t    gaps;
+   uint32_t    lost;
+   uint32_t    dups;
+   uint32_t    reorder;
+   uint32_t    magic;
+   uint32_t    hdr;
+   uint32_t    nominal;
+   uint32_t    jitter;
+   uint32_t    jitter_max;
+   uint32_t    jitter_mean;
+   uint32_t    events;
+   pmon_evt_t  evt[PMON_EVENTS];
+} pmon_stats_t, *ppmon_stats_t;
+
+// Pipe Integrity Monitor
+typedef struct _pmon_t {
+   uint32_t       gen;
+   uint32_t       reset;
+   uint32_t       rate;
+   uint32_t       started;
+   uint32_t       last_stamp;
+   uint32_t       learn_cnt;
+   uint64_t       learn_sum;
+   uint64_t       jitter_sum;
+   uint32_t       jitter_cnt;
+   pmon_stats_t   s;
+} pmon_t, *ppmon_t;
+
+void     pmon_init(uint32_t rate);
+void     pmon_block(uint8_t *blk, uint32_t len);
+void     pmon_get(ppmon_stats_t stats);
+void     pmon_print(void);
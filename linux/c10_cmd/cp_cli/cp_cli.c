@@ -10,6 +10,25 @@
 
       This code implements the Service Provider functionality.
 
+      Bulk device memory access, cp_mem_read() and cp_mem_write(), keeps
+      a window of cp.window CP_BLOCK_REQ requests in flight and matches
+      each response to its block by the index echoed by the server.
+
+      cp_stream_read() takes a whole region of device SDRAM through the
+      pipe instead, CP_STREAM_REQ starts the stream and the packets of
+      CM_PIPE_STREAM_DATA are placed by their offset into a buffer, a
+      file, or both.
+
+      cp_xlt_req() reads and frees the firmware trace ring, CP_XLT_REQ.
+      cp_sched_req() reads the firmware background task accounting,
+      CP_SCHED_REQ, and cp_prof_req() one firmware cycle profile point,
+      CP_PROF_REQ.
+
+      All three are made through cp_sync_req(), one synchronous request at
+      a time. The request body leads with a tag the server echoes, a
+      response that is not for the waiting request, late after a timeout,
+      is dropped by its tag.
+
    1.3 Specification/Design Reference
 
       See fw_cfg.h under the share directory.
@@ -59,7 +78,20 @@
         7.5  cp_qmsg()
         7.6  cp_thread()
         7.7  cp_final
-
+        7.8  cp_mem_read()
+        7.9  cp_mem_write()
+        7.10 cp_mem_xfer()
+        7.11 cp_mem_send()
+        7.12 cp_mem_resp()
+        7.13 cp_stream_read()
+        7.14 cp_stream_run()
+        7.15 cp_stream_notify()
+        7.16 cp_stream_resp()
+        7.17 cp_xlt_req()
+        7.18 cp_sched_req()
+        7.19 cp_prof_req()
+        7.20 cp_sync_req()
+        7.21 cp_sync_resp()
 
 -----------------------------------------------------------------------------*/
 
@@ -82,11 +114,25 @@
 // 6.1  Local Function Prototypes
 
    static   void *cp_thread(void *data);
+   static   uint32_t cp_mem_xfer(uint32_t flags, uint32_t address, uint8_t *buf,
+                                 uint32_t len, uint32_t type);
+   static   uint32_t cp_mem_send(uint32_t block);
+   static   void  cp_mem_resp(pcp_block_msg_t rsp);
+   static   uint32_t cp_stream_run(uint8_t sub, uint32_t address, uint32_t len,
+                                  uint32_t first, uint32_t last, void *buf, int fd,
+                                  uint8_t *map);
+   static   void  cp_stream_notify(uint8_t sub);
+   static   void  cp_stream_resp(pcp_stream_msg_t rsp);
+   static   uint32_t cp_sync_req(uint8_t msgid, uint8_t flags, void *body, uint32_t len);
+   static   void  cp_sync_resp(pcm_msg_t rsp);
 
 // 6.2  Local Data Structures
 
    static   cp_t     cp  = {0};
    static   cp_rxq_t rxq = {{0}};
+   static   cp_xfer_t xfer = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+   static   cp_stream_t strm = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+   static   cp_sync_t sreq = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
 
 // 7 MODULE CODE
 
@@ -177,7 +223,6 @@ uint32_t cp_msg(pcm_msg_t msg) {
 // 7.2.4   Data Structures
 
    uint32_t    result = CP_OK;
-   uint16_t    cm_msg  = MSG(msg->p.srvid, msg->p.msgid);
 
 // 7.2.5   Code
 
@@ -187,48 +232,97 @@ uint32_t cp_msg(pcm_msg_t msg) {
          msg->p.srvid, msg->p.msgid, msg->h.port);
    }
 
-   //
-   //    VERSION RESPONSE
-   //
-   if (cm_msg == MSG(CM_ID_CP_SRV, CP_VER_RESP)) {
-      pcp_ver_msg_t rsp = (pcp_ver_msg_t)msg;
-      if (gc.trace & LIN_TRACE_ID) {
-         printf("\n");
-         printf("f/w ver     : %08X\n", rsp->b.fw_ver);
-         printf("sysid       : %08X\n", rsp->b.sysid);
-         printf("stamp_epoch : %08X\n", rsp->b.stamp_epoch);
-         printf("stamp_date  : %08X\n", rsp->b.stamp_date);
-         printf("stamp_time  : %08X\n", rsp->b.stamp_time);
-         printf("fifo        : %02X\n", rsp->b.vhdl[0]);
-         printf("adc         : %02X\n", rsp->b.vhdl[1]);
-         printf("fpga        : %02X\n\n", rsp->b.vhdl[2]);
+   switch (MSG_INDEX(gc.msg_index, msg->p.srvid, msg->p.msgid)) {
+      //
+      //    VERSION RESPONSE
+      //
+      case MSG_IDX_CP_VER_RESP: {
+         pcp_ver_msg_t rsp = (pcp_ver_msg_t)msg;
+         if (gc.trace & LIN_TRACE_ID) {
+            printf("\n");
+            printf("f/w ver     : %08X\n", rsp->b.fw_ver);
+            printf("sysid       : %08X\n", rsp->b.sysid);
+            printf("stamp_epoch : %08X\n", rsp->b.stamp_epoch);
+            printf("stamp_date  : %08X\n", rsp->b.stamp_date);
+            printf("stamp_time  : %08X\n", rsp->b.stamp_time);
+            printf("fifo        : %02X\n", rsp->b.vhdl[0]);
+            printf("adc         : %02X\n", rsp->b.vhdl[1]);
+            printf("fpga        : %02X\n\n", rsp->b.vhdl[2]);
+         }
+         // record versions for the DAQ capture header
+         gc.fw_ver     = rsp->b.fw_ver;
+         gc.sysid      = rsp->b.sysid;
+         gc.fpga_epoch = rsp->b.stamp_epoch;
+         gc.fpga_date  = rsp->b.stamp_date;
+         gc.fpga_time  = rsp->b.stamp_time;
+         memcpy(gc.vhdl, rsp->b.vhdl, sizeof(gc.vhdl));
+         // send OPC run request
+         cm_send_req(CM_ID_OPC_SRV, OPC_RUN_REQ, CM_ID_CP_CLI, OPC_RUN_START);
+         break;
+      }
+      //
+      //    PING RESPONSE
+      //
+      case MSG_IDX_CP_PING_RESP: {
+         // restart ping request timer
+         cm_timer_set(CM_TMR_ID0, CP_TMR_PING, 15000, CM_ID_CP_CLI, CM_ID_CP_CLI);
+         // restart ping timeout timer
+         cm_timer_set(CM_TMR_ID1, CP_TMR_PING_TIMEOUT, 60000, CM_ID_CP_CLI, CM_ID_CP_CLI);
+         break;
+      }
+      //
+      //    OPC RUN RESPONSE
+      //
+      case MSG_IDX_OPC_RUN_RESP: {
+         // drop response
+         break;
+      }
+      //
+      //    BLOCK MEMORY RESPONSE
+      //
+      case MSG_IDX_CP_BLOCK_RESP: {
+         cp_mem_resp((pcp_block_msg_t)msg);
+         break;
+      }
+      //
+      //    MEMORY STREAM RESPONSE
+      //
+      case MSG_IDX_CP_STREAM_RESP: {
+         cp_stream_resp((pcp_stream_msg_t)msg);
+         break;
+      }
+      //
+      //    TRACE RING RESPONSE
+      //
+      case MSG_IDX_CP_XLT_RESP: {
+         cp_sync_resp(msg);
+         break;
+      }
+      //
+      //    SCHEDULER ACCOUNTING RESPONSE
+      //
+      case MSG_IDX_CP_SCHED_RESP: {
+         cp_sync_resp(msg);
+         break;
+      }
+      //
+      //    CYCLE PROFILE RESPONSE
+      //
+      case MSG_IDX_CP_PROF_RESP: {
+         cp_sync_resp(msg);
+         break;
       }
-      // send OPC run request
-      cm_send_req(CM_ID_OPC_SRV, OPC_RUN_REQ, CM_ID_CP_CLI, OPC_RUN_START);
-   }
-   //
-   //    PING RESPONSE
-   //
-   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_PING_RESP)) {
-      // restart ping request timer
-      cm_timer_set(CM_TMR_ID0, CP_TMR_PING, 15000, CM_ID_CP_CLI, CM_ID_CP_CLI);
-      // restart ping timeout timer
-      cm_timer_set(CM_TMR_ID1, CP_TMR_PING_TIMEOUT, 60000, CM_ID_CP_CLI, CM_ID_CP_CLI);
-   }
-   //
-   //    OPC RUN RESPONSE
-   //
-   else if (cm_msg == MSG(CM_ID_OPC_SRV, OPC_RUN_RESP)) {
-      // drop response
-   }
-   //
-   //    UNKNOWN MESSAGE
-   //
-   else if (gc.trace & LIN_TRACE_ERROR) {
-      // Unknown Message
-      printf("cp_msg() Warning : Unknown Message, srvid:msgid = %02X:%02X\n",
-            msg->p.srvid, msg->p.msgid);
-      dump((uint8_t*)msg, 12, 0, 0);
+      //
+      //    UNKNOWN MESSAGE
+      //
+      default:
+         if (gc.trace & LIN_TRACE_ERROR) {
+            // Unknown Message
+            printf("cp_msg() Warning : Unknown Message, srvid:msgid = %02X:%02X\n",
+                  msg->p.srvid, msg->p.msgid);
+            dump((uint8_t*)msg, 12, 0, 0);
+         }
+         break;
    }
 
    // Release the Slot
@@ -263,7 +357,6 @@ uint32_t cp_timer(pcm_msg_t msg) {
 // 7.3.4   Data Structures
 
    uint32_t    result = CP_OK;
-   uint16_t    cm_msg  = MSG(msg->p.srvid, msg->p.msgid);
 
 // 7.3.5   Code
 
@@ -273,29 +366,35 @@ uint32_t cp_timer(pcm_msg_t msg) {
          msg->p.srvid, msg->p.msgid, msg->h.port);
    }
 
-   //
-   //    PING TIMER
-   //
-   if (cm_msg == MSG(CM_ID_CP_CLI, CP_TMR_PING)) {
-      cm_send_req(CM_ID_CP_SRV, CP_PING_REQ, CM_ID_CP_CLI, 0);
-   }
-   //
-   //    PING TIMEOUT TIMER
-   //
-   else if (cm_msg == MSG(CM_ID_CP_CLI, CP_TMR_PING_TIMEOUT)) {
-      printf("cp_timer() Warning : Ping Timeout, Forced Application Exit\n");
-      // halt the application
-      gc.error |= LIN_ERROR_PING_TIMEOUT;
-      gc.halt   = TRUE;
-   }
-   //
-   //    UNKNOWN TIMER
-   //
-   else if (gc.trace & LIN_TRACE_ERROR) {
-      // Unknown Timer Message
-      printf("cp_timer() Warning : Unknown Timer Message, srvid:msgid = %02X:%02X\n",
-            msg->p.srvid, msg->p.msgid);
-      dump((uint8_t*)msg, 12, 0, 0);
+   switch (MSG_INDEX(gc.msg_index, msg->p.srvid, msg->p.msgid)) {
+      //
+      //    PING TIMER
+      //
+      case MSG_IDX_CP_TMR_PING: {
+         cm_send_req(CM_ID_CP_SRV, CP_PING_REQ, CM_ID_CP_CLI, 0);
+         break;
+      }
+      //
+      //    PING TIMEOUT TIMER
+      //
+      case MSG_IDX_CP_TMR_PING_TIMEOUT: {
+         printf("cp_timer() Warning : Ping Timeout, Forced Application Exit\n");
+         // halt the application
+         gc.error |= LIN_ERROR_PING_TIMEOUT;
+         gc.halt   = TRUE;
+         break;
+      }
+      //
+      //    UNKNOWN TIMER
+      //
+      default:
+         if (gc.trace & LIN_TRACE_ERROR) {
+            // Unknown Timer Message
+            printf("cp_timer() Warning : Unknown Timer Message, srvid:msgid = %02X:%02X\n",
+                  msg->p.srvid, msg->p.msgid);
+            dump((uint8_t*)msg, 12, 0, 0);
+         }
+         break;
    }
 
    // Release the Slot
@@ -514,5 +613,956 @@ void cp_final(void) {
 } // end cp_final()
 
 
+// ===========================================================================
+
+// 7.8
+
+uint32_t cp_mem_read(uint32_t address, void *buf, uint32_t len, uint32_t type) {
+
+/* 7.8.1   Functional Description
+
+   This routine will read a region of device memory. The call blocks
+   until every block has been answered, it must not be made from the
+   CP thread.
+
+   7.8.2   Parameters:
+
+   address  Device address
+   buf      Destination
+   len      Length in bytes, a multiple of the type width
+   type     Access type, CFG_INT8U, CFG_INT16U or CFG_INT32U
+
+   7.8.3   Return Values:
+
+   result   CP_OK, CP_ERR_* status or CP_ERR_TIMEOUT
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.8.4   Data Structures
+
+// 7.8.5   Code
+
+   return cp_mem_xfer(CP_MEM_RD, address, (uint8_t *)buf, len, type);
+
+} // end cp_mem_read()
+
+
+// ===========================================================================
+
+// 7.9
+
+uint32_t cp_mem_write(uint32_t address, void *buf, uint32_t len, uint32_t type) {
+
+/* 7.9.1   Functional Description
+
+   This routine will write a region of device memory. The call blocks
+   until every block has been acknowledged, it must not be made from
+   the CP thread.
+
+   7.9.2   Parameters:
+
+   address  Device address
+   buf      Source
+   len      Length in bytes, a multiple of the type width
+   type     Access type, CFG_INT8U, CFG_INT16U or CFG_INT32U
+
+   7.9.3   Return Values:
+
+   result   CP_OK, CP_ERR_* status or CP_ERR_TIMEOUT
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.9.4   Data Structures
+
+// 7.9.5   Code
+
+   return cp_mem_xfer(CP_MEM_WR, address, (uint8_t *)buf, len, type);
+
+} // end cp_mem_write()
+
+
+// ===========================================================================
+
+// 7.10
+
+static uint32_t cp_mem_xfer(uint32_t flags, uint32_t address, uint8_t *buf,
+                            uint32_t len, uint32_t type) {
+
+/* 7.10.1   Functional Description
+
+   This routine will run one windowed transfer. The region is split into
+   blocks of CP_BLOCK_MAX bytes and up to cp.window block requests are
+   kept outstanding, a new request is issued as each response arrives.
+   Responses may arrive in any order, each is placed by its block.
+
+   The transfer fails on the first error status or when no response
+   arrives for cp.timeout mS. Responses to a failed transfer that arrive
+   later are dropped by their tag.
+
+   7.10.2   Parameters:
+
+   flags    CP_MEM_RD or CP_MEM_WR
+   address  Device address
+   buf      Source or destination
+   len      Length in bytes
+   type     Access type
+
+   7.10.3   Return Values:
+
+   result   CP_OK, CP_ERR_* status or CP_ERR_TIMEOUT
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.10.4   Data Structures
+
+   uint32_t    result, window, width, done;
+   uint64_t    start_ns;
+
+   struct timespec ts;
+
+// 7.10.5   Code
+
+   width  = CP_TYPE_WIDTH(type);
+   window = cc.cp_window;
+   if (window == 0) window = 1;
+   if (window > CP_WIN_MAX) window = CP_WIN_MAX;
+
+   if (buf == NULL || len == 0 || (len % width) != 0 || (address % width) != 0) {
+      if (gc.trace & LIN_TRACE_ERROR) {
+         printf("cp_mem_xfer() Error : address:len:type = %08X:%d:%d\n", address, len, type);
+      }
+      return CP_ERR_PARMS_RANGE;
+   }
+
+   pthread_mutex_lock(&xfer.mutex);
+
+   // one transfer at a time
+   while (xfer.active) pthread_cond_wait(&xfer.cv, &xfer.mutex);
+
+   xfer.active  = TRUE;
+   xfer.buf     = buf;
+   xfer.flags   = flags;
+   xfer.type    = type;
+   xfer.address = address;
+   xfer.len     = len;
+   xfer.blk     = CP_BLOCK_MAX - (CP_BLOCK_MAX % width);
+   xfer.blocks  = (len + xfer.blk - 1) / xfer.blk;
+   xfer.next    = 0;
+   xfer.done    = 0;
+   xfer.status  = CP_OK;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   start_ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+   while (xfer.done < xfer.blocks && xfer.status == CP_OK) {
+
+      // fill the window
+      while (xfer.next < xfer.blocks && xfer.next - xfer.done < window) {
+         xfer.status = cp_mem_send(xfer.next);
+         if (xfer.status != CP_OK) break;
+         xfer.next++;
+      }
+
+      // wait for the next response
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_sec  += cc.cp_timeout / 1000;
+      ts.tv_nsec += (cc.cp_timeout % 1000) * 1000000;
+      if (ts.tv_nsec >= 1000000000) {
+         ts.tv_sec++;
+         ts.tv_nsec -= 1000000000;
+      }
+      done = xfer.done;
+      while (xfer.done == done && xfer.status == CP_OK && xfer.next != xfer.done) {
+         if (pthread_cond_timedwait(&xfer.cv, &xfer.mutex, &ts) == ETIMEDOUT) {
+            xfer.status = CP_ERR_TIMEOUT;
+         }
+      }
+   }
+
+   result = xfer.status;
+
+   if (gc.trace & LIN_TRACE_CLIENT) {
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      printf("cp_mem_xfer() %s %08X:%d, %d of %d blocks, window %d, %d uS, status %X\n",
+            (flags & CP_MEM_WR) ? "wr" : "rd", address, len, xfer.done, xfer.blocks, window,
+            (uint32_t)(((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec - start_ns) / 1000),
+            result);
+   }
+
+   if (result != CP_OK && (gc.trace & LIN_TRACE_ERROR)) {
+      printf("cp_mem_xfer() Error : block %d of %d, status %X\n", xfer.done, xfer.blocks, result);
+   }
+
+   // retire the tags, late responses are dropped
+   xfer.tag   += xfer.blocks;
+   xfer.active = FALSE;
+   xfer.buf    = NULL;
+   pthread_cond_broadcast(&xfer.cv);
+
+   pthread_mutex_unlock(&xfer.mutex);
+
+   return result;
+
+} // end cp_mem_xfer()
+
+
+// ===========================================================================
+
+// 7.11
+
+static uint32_t cp_mem_send(uint32_t block) {
+
+/* 7.11.1   Functional Description
+
+   This routine will send the block request for one block of the current
+   transfer. Write requests carry the block data, read requests carry
+   none. Called with the transfer mutex held.
+
+   7.11.2   Parameters:
+
+   block    Block number
+
+   7.11.3   Return Values:
+
+   result   CP_OK or CP_ERR_MSG_NULL
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.11.4   Data Structures
+
+   pcmq_t      slot;
+   uint32_t    off, len;
+   cm_send_t   ps = {0};
+
+   pcp_block_msg_t req;
+
+// 7.11.5   Code
+
+   slot = cm_alloc();
+   if (slot == NULL) return CP_ERR_MSG_NULL;
+
+   off = block * xfer.blk;
+   len = (xfer.len - off < xfer.blk) ? xfer.len - off : xfer.blk;
+
+   req = (pcp_block_msg_t)slot->buf;
+   req->p.srvid   = CM_ID_CP_SRV;
+   req->p.msgid   = CP_BLOCK_REQ;
+   req->p.flags   = xfer.flags;
+   req->p.status  = CP_OK;
+   req->b.index   = xfer.tag + block;
+   req->b.type    = xfer.type;
+   req->b.address = xfer.address + off;
+   req->b.length  = len / CP_TYPE_WIDTH(xfer.type);
+
+   ps.msg      = (pcm_msg_t)req;
+   ps.dst_cmid = CM_ID_CP_SRV;
+   ps.src_cmid = CM_ID_CP_CLI;
+   ps.msglen   = sizeof(cp_block_msg_t) - CP_BLOCK_MAX;
+
+   if (xfer.flags & CP_MEM_WR) {
+      memcpy(req->b.data, &xfer.buf[off], len);
+      ps.msglen += len;
+   }
+
+   // Send the Request
+   cm_send(CM_MSG_REQ, &ps);
+
+   return CP_OK;
+
+} // end cp_mem_send()
+
+
+// ===========================================================================
+
+// 7.12
+
+static void cp_mem_resp(pcp_block_msg_t rsp) {
+
+/* 7.12.1   Functional Description
+
+   This routine will retire one block of the current transfer, read data
+   is copied to its place in the destination. A response whose tag is not
+   in the current transfer is dropped. Runs in the CP thread.
+
+   7.12.2   Parameters:
+
+   rsp      Block response
+
+   7.12.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.12.4   Data Structures
+
+   uint32_t    block, off, len;
+
+// 7.12.5   Code
+
+   pthread_mutex_lock(&xfer.mutex);
+
+   block = rsp->b.index - xfer.tag;
+
+   if (!xfer.active || block >= xfer.next) {
+      xfer.stale++;
+   }
+   else if (rsp->p.status != CP_OK) {
+      xfer.status = rsp->p.status;
+   }
+   else {
+      off = block * xfer.blk;
+      len = (xfer.len - off < xfer.blk) ? xfer.len - off : xfer.blk;
+      if (xfer.flags & CP_MEM_RD) {
+         if (rsp->h.msglen < sizeof(cp_block_msg_t) - CP_BLOCK_MAX + len) {
+            xfer.status = CP_ERR_NO_DATA;
+         }
+         else memcpy(&xfer.buf[off], rsp->b.data, len);
+      }
+      xfer.done++;
+   }
+
+   pthread_cond_broadcast(&xfer.cv);
+
+   pthread_mutex_unlock(&xfer.mutex);
+
+} // end cp_mem_resp()
+
+
+// ===========================================================================
+
+// 7.13
+
+uint32_t cp_stream_read(uint32_t address, uint32_t len, void *buf, int fd) {
+
+/* 7.13.1   Functional Description
+
+   This routine will stream a region of device SDRAM through the pipe.
+   Each packet is copied to buf and written to fd at its offset in the
+   region, either may be left out. The call blocks until the region is
+   complete, it must not be made from the CP thread.
+
+   Pipe blocks are dropped, not held, when the host falls behind, so
+   every packet is marked as it is placed. After each stream the span
+   from the first to the last missing packet is streamed again, up to
+   CP_STREAM_RETRIES times.
+
+   7.13.2   Parameters:
+
+   address  Device SDRAM address
+   len      Length in bytes
+   buf      Destination, or NULL
+   fd       Destination file, or -1
+
+   7.13.3   Return Values:
+
+   result   CP_OK, CP_ERR_* status or CP_ERR_TIMEOUT
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.13.4   Data Structures
+
+   uint32_t    result = CP_OK;
+   uint32_t    packets, first, last, pass, i;
+   uint8_t     sub;
+   uint8_t    *map;
+   uint64_t    start_ns;
+
+   struct timespec ts;
+
+// 7.13.5   Code
+
+   if (len == 0 || (buf == NULL && fd < 0)) return CP_ERR_PARMS_RANGE;
+
+   packets = (len + CP_STREAM_DATA - 1) / CP_STREAM_DATA;
+   map     = (uint8_t *)calloc(packets, 1);
+   if (map == NULL) return CP_ERR_NULL_PTR;
+
+   pthread_mutex_lock(&strm.mutex);
+
+   // one stream at a time
+   while (strm.active) pthread_cond_wait(&strm.cv, &strm.mutex);
+   strm.active = TRUE;
+
+   pthread_mutex_unlock(&strm.mutex);
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   start_ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+   // subscribe before the request, the first packets may beat the response
+   sub = cm_pipe_sub(CM_ID_CP_CLI, CM_PIPE_STREAM_DATA, CM_PIPE_QUE, CM_PIPE_DROP_NEW,
+                     cp_stream_notify);
+   if (sub == CM_PIPE_SUB_NULL) result = CP_ERR_MSG_NULL;
+
+   first = 0;
+   last  = packets;
+
+   for (pass=0;result == CP_OK;pass++) {
+
+      result = cp_stream_run(sub, address, len, first, last, buf, fd, map);
+      if (result != CP_OK) break;
+
+      // span still missing
+      for (i=first;i<last && map[i];i++);
+      if (i == last) break;
+      first = i;
+      for (i=last;i>first && map[i-1];i--);
+      last  = i;
+
+      if (pass == CP_STREAM_RETRIES) {
+         result = CP_ERR_NO_DATA;
+         break;
+      }
+   }
+
+   if (sub != CM_PIPE_SUB_NULL) cm_pipe_unsub(sub);
+
+   if (gc.trace & LIN_TRACE_CLIENT) {
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      printf("cp_stream_read() %08X:%d, %d packets, %d passes, %d uS, status %X\n",
+            address, len, packets, pass + 1,
+            (uint32_t)(((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec - start_ns) / 1000),
+            result);
+   }
+
+   if (result != CP_OK && (gc.trace & LIN_TRACE_ERROR)) {
+      printf("cp_stream_read() Error : packets %d to %d of %d, status %X\n",
+            first, last, packets, result);
+   }
+
+   free(map);
+
+   pthread_mutex_lock(&strm.mutex);
+   strm.active = FALSE;
+   pthread_cond_broadcast(&strm.cv);
+   pthread_mutex_unlock(&strm.mutex);
+
+   return result;
+
+} // end cp_stream_read()
+
+
+// ===========================================================================
+
+// 7.14
+
+static uint32_t cp_stream_run(uint8_t sub, uint32_t address, uint32_t len, uint32_t first,
+                              uint32_t last, void *buf, int fd, uint8_t *map) {
+
+/* 7.14.1   Functional Description
+
+   This routine will run one CP_STREAM_REQ for packets first to last of
+   the region and place what arrives. Blocks of an earlier stream still
+   queued are dropped by their tag, packets already placed are skipped. The stream is over when its last
+   packet has been seen, every packet is in, or nothing has arrived for
+   cp.timeout mS after the response.
+
+   7.14.2   Parameters:
+
+   sub      Pipe subscription
+   address  Device SDRAM address of the region
+   len      Region length in bytes
+   first    First packet
+   last     Packet after the last
+   buf      Destination, or NULL
+   fd       Destination file, or -1
+   map      Packets placed
+
+   7.14.3   Return Values:
+
+   result   CP_OK, CP_ERR_* status or CP_ERR_TIMEOUT
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.14.4   Data Structures
+
+   uint32_t          result, err = CP_OK, have = 0, skip = 0, blocks, i, idx, off, total;
+   uint8_t           end = FALSE;
+   pcmq_t            slot;
+   pcm_pipe_t        pipe;
+   pcp_stream_pipe_t pkt;
+   pcp_stream_msg_t  req;
+   cm_send_t         ps = {0};
+
+   struct timespec ts;
+
+// 7.14.5   Code
+
+   slot = cm_alloc();
+   if (slot == NULL) return CP_ERR_MSG_NULL;
+
+   pthread_mutex_lock(&strm.mutex);
+   strm.resp    = FALSE;
+   strm.status  = CP_OK;
+   strm.tag++;
+   blocks       = strm.blocks;
+   pthread_mutex_unlock(&strm.mutex);
+
+   // the span starts on a packet boundary of the region
+   off = first * CP_STREAM_DATA;
+
+   req = (pcp_stream_msg_t)slot->buf;
+   req->p.srvid     = CM_ID_CP_SRV;
+   req->p.msgid     = CP_STREAM_REQ;
+   req->p.flags     = CP_NO_FLAGS;
+   req->p.status    = CP_OK;
+   req->b.tag       = strm.tag;
+   req->b.address   = address + off;
+   req->b.length    = ((last * CP_STREAM_DATA < len) ? last * CP_STREAM_DATA : len) - off;
+   req->b.packets   = 0;
+
+   // packets in the stream, as the server pads it
+   total = (req->b.length + CP_STREAM_DATA - 1) / CP_STREAM_DATA;
+   total = (total + CP_STREAM_ALIGN - 1) & ~(CP_STREAM_ALIGN - 1);
+
+   ps.msg      = (pcm_msg_t)req;
+   ps.dst_cmid = CM_ID_CP_SRV;
+   ps.src_cmid = CM_ID_CP_CLI;
+   ps.msglen   = sizeof(cp_stream_msg_t);
+
+   // Send the Request
+   cm_send(CM_MSG_REQ, &ps);
+
+   pthread_mutex_lock(&strm.mutex);
+
+   while (strm.status == CP_OK) {
+
+      // place the queued blocks, the pipe source is never held up
+      pthread_mutex_unlock(&strm.mutex);
+      while ((pipe = cm_pipe_get(sub)) != NULL) {
+         for (i=0;i<FIFO_BLOCK_LEN;i+=sizeof(cp_stream_pipe_t)) {
+            pkt = (pcp_stream_pipe_t)((uint8_t *)pipe + i);
+            if (pkt->msgid != CM_PIPE_STREAM_DATA || pkt->magic != CP_STREAM_MAGIC ||
+                pkt->tag != strm.tag) {
+               skip++;
+               continue;
+            }
+            // blocks arrive in order, nothing follows the last packet
+            if (pkt->seqid + 1 == total) end = TRUE;
+            // padding
+            if (pkt->length == 0) continue;
+            idx = first + (pkt->offset / CP_STREAM_DATA);
+            if ((pkt->offset % CP_STREAM_DATA) != 0 || idx >= last || map[idx] ||
+                pkt->length > len - idx * CP_STREAM_DATA) {
+               skip++;
+               continue;
+            }
+            if (buf != NULL) {
+               memcpy((uint8_t *)buf + idx * CP_STREAM_DATA, pkt->data, pkt->length);
+            }
+            if (fd >= 0 && pwrite(fd, pkt->data, pkt->length, idx * CP_STREAM_DATA) != pkt->length) {
+               err = CP_ERR_FILE_ERROR;
+            }
+            map[idx] = TRUE;
+            have++;
+         }
+         cm_pipe_free(pipe);
+      }
+      pthread_mutex_lock(&strm.mutex);
+
+      if (err != CP_OK) {
+         strm.status = err;
+         break;
+      }
+
+      // stream over
+      if (strm.resp && (end || have == last - first)) break;
+
+      // wait for the next block, or the response
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_sec  += cc.cp_timeout / 1000;
+      ts.tv_nsec += (cc.cp_timeout % 1000) * 1000000;
+      if (ts.tv_nsec >= 1000000000) {
+         ts.tv_sec++;
+         ts.tv_nsec -= 1000000000;
+      }
+      while (strm.blocks == blocks && strm.status == CP_OK) {
+         if (pthread_cond_timedwait(&strm.cv, &strm.mutex, &ts) == ETIMEDOUT) break;
+      }
+      // nothing more is coming, the missing packets are streamed again
+      if (strm.blocks == blocks && strm.status == CP_OK) {
+         if (!strm.resp) strm.status = CP_ERR_TIMEOUT;
+         break;
+      }
+      blocks = strm.blocks;
+   }
+
+   result = strm.status;
+
+   pthread_mutex_unlock(&strm.mutex);
+
+   if (gc.trace & LIN_TRACE_CLIENT) {
+      printf("cp_stream_run() packets %d to %d, %d placed, %d skipped, status %X\n",
+            first, last, have, skip, result);
+   }
+
+   return result;
+
+} // end cp_stream_run()
+
+
+// ===========================================================================
+
+// 7.15
+
+static void cp_stream_notify(uint8_t sub) {
+
+/* 7.15.1   Functional Description
+
+   This routine will wake cp_stream_read() for a queued stream block.
+   Runs on the pipe source thread.
+
+   7.15.2   Parameters:
+
+   sub      Subscription handle
+
+   7.15.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.15.4   Data Structures
+
+// 7.15.5   Code
+
+   pthread_mutex_lock(&strm.mutex);
+   strm.blocks++;
+   pthread_cond_broadcast(&strm.cv);
+   pthread_mutex_unlock(&strm.mutex);
+
+} // end cp_stream_notify()
+
+
+// ===========================================================================
+
+// 7.16
+
+static void cp_stream_resp(pcp_stream_msg_t rsp) {
+
+/* 7.16.1   Functional Description
+
+   This routine will record the stream response, the number of packets
+   to expect or the error that refused the stream. A response whose tag
+   is not the current stream is dropped. Runs in the CP thread.
+
+   7.16.2   Parameters:
+
+   rsp      Stream response
+
+   7.16.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.16.4   Data Structures
+
+// 7.16.5   Code
+
+   pthread_mutex_lock(&strm.mutex);
+
+   if (strm.active && rsp->b.tag == strm.tag && !strm.resp) {
+      strm.resp = TRUE;
+      if (rsp->p.status != CP_OK) strm.status = rsp->p.status;
+      pthread_cond_broadcast(&strm.cv);
+   }
+
+   pthread_mutex_unlock(&strm.mutex);
+
+} // end cp_stream_resp()
+
+
+// ===========================================================================
+
+// 7.17
+
+uint32_t cp_xlt_req(uint8_t flags, uint32_t tail, pcp_xlt_body_t body) {
+
+/* 7.17.1   Functional Description
+
+   This routine will send CP_XLT_REQ and wait for the ring state. With
+   CP_XLT_FREE the records before tail are released. The call blocks for
+   up to cp.timeout mS, it must not be made from the CP thread.
+
+   7.17.2   Parameters:
+
+   flags    CP_XLT_GET, CP_XLT_HOST, CP_XLT_UART, CP_XLT_FREE
+   tail     First record kept, CP_XLT_FREE
+   body     Ring state returned, CP_OK only
+
+   7.17.3   Return Values:
+
+   result   CP_OK, CP_ERR_* status or CP_ERR_TIMEOUT
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.17.4   Data Structures
+
+   uint32_t       result;
+   cp_xlt_body_t  b = {0};
+
+// 7.17.5   Code
+
+   b.tail = tail;
+
+   result = cp_sync_req(CP_XLT_REQ, flags, &b, sizeof(cp_xlt_body_t));
+   if (result == CP_OK) memcpy(body, &b, sizeof(cp_xlt_body_t));
+
+   if (gc.trace & LIN_TRACE_CLIENT) {
+      if (result == CP_OK) {
+         printf("cp_xlt_req() flags:head:tail:drops = %02X:%d:%d:%d\n",
+               flags, b.head, b.tail, b.drops);
+      }
+      else printf("cp_xlt_req() flags %02X, status %X\n", flags, result);
+   }
+
+   return result;
+
+} // end cp_xlt_req()
+
+
+// ===========================================================================
+
+// 7.18
+
+uint32_t cp_sched_req(uint8_t flags, pcp_sched_body_t body) {
+
+/* 7.18.1   Functional Description
+
+   This routine will send CP_SCHED_REQ and wait for the firmware background
+   task accounting, CP_SCHED_CLR starts it again. The call blocks for up
+   to cp.timeout mS, it must not be made from the CP thread.
+
+   7.18.2   Parameters:
+
+   flags    CP_SCHED_GET, CP_SCHED_CLR
+   body     Accounting returned
+
+   7.18.3   Return Values:
+
+   result   CP_OK, CP_ERR_* status or CP_ERR_TIMEOUT
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.18.4   Data Structures
+
+// 7.18.5   Code
+
+   memset(body, 0, sizeof(cp_sched_body_t));
+
+   return cp_sync_req(CP_SCHED_REQ, flags, body, sizeof(cp_sched_body_t));
+
+} // end cp_sched_req()
+
+
+// ===========================================================================
+
+// 7.19
+
+uint32_t cp_prof_req(uint8_t flags, uint32_t point, pcp_prof_body_t body) {
+
+/* 7.19.1   Functional Description
+
+   This routine will send CP_PROF_REQ and wait for one firmware cycle
+   profile point, CP_PROF_CLR clears it once read. The call blocks for up
+   to cp.timeout mS, it must not be made from the CP thread.
+
+   7.19.2   Parameters:
+
+   flags    CP_PROF_GET, CP_PROF_CLR
+   point    CP_PROF_* point
+   body     Profile point returned
+
+   7.19.3   Return Values:
+
+   result   CP_OK, CP_ERR_* status or CP_ERR_TIMEOUT
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.19.4   Data Structures
+
+// 7.19.5   Code
+
+   memset(body, 0, sizeof(cp_prof_body_t));
+   body->point = point;
+
+   return cp_sync_req(CP_PROF_REQ, flags, body, sizeof(cp_prof_body_t));
+
+} // end cp_prof_req()
+
+
+// ===========================================================================
+
+// 7.20
+
+static uint32_t cp_sync_req(uint8_t msgid, uint8_t flags, void *body, uint32_t len) {
+
+/* 7.20.1   Functional Description
+
+   This routine will send one synchronous CP request and wait for its
+   response, message ID msgid + 1. The first word of the body, b.tag, is
+   set to a new tag and the server echoes it, the response body is
+   returned in place. Responses with any other tag, late after a timeout,
+   are dropped by cp_sync_resp(). The call blocks for up to cp.timeout
+   mS, it must not be made from the CP thread.
+
+   7.20.2   Parameters:
+
+   msgid    CP request message ID
+   flags    Request flags
+   body     Request body, returned as the response body
+   len      Body length in bytes
+
+   7.20.3   Return Values:
+
+   result   CP_OK, CP_ERR_* status or CP_ERR_TIMEOUT
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.20.4   Data Structures
+
+   uint32_t    result, tag;
+   pcmq_t      slot;
+   pcm_msg_t   req;
+   uint32_t   *b;
+   cm_send_t   ps = {0};
+
+   struct timespec ts;
+
+// 7.20.5   Code
+
+   if (len < sizeof(uint32_t) || len > CM_MAX_MSG_INT8U - sizeof(cm_msg_t)) {
+      return CP_ERR_MSG_LEN_MAX;
+   }
+
+   slot = cm_alloc();
+   if (slot == NULL) return CP_ERR_MSG_NULL;
+
+   pthread_mutex_lock(&sreq.mutex);
+
+   // one request at a time
+   while (sreq.active) pthread_cond_wait(&sreq.cv, &sreq.mutex);
+   sreq.active = TRUE;
+   sreq.resp   = FALSE;
+   sreq.msgid  = msgid + 1;
+   sreq.len    = len;
+   sreq.status = CP_OK;
+   tag = ++sreq.tag;
+
+   pthread_mutex_unlock(&sreq.mutex);
+
+   req = (pcm_msg_t)slot->buf;
+   req->p.srvid     = CM_ID_CP_SRV;
+   req->p.msgid     = msgid;
+   req->p.flags     = flags;
+   req->p.status    = CP_OK;
+   b = &slot->buf[sizeof(cm_msg_t) >> 2];
+   memcpy(b, body, len);
+   b[0] = tag;
+
+   ps.msg      = req;
+   ps.dst_cmid = CM_ID_CP_SRV;
+   ps.src_cmid = CM_ID_CP_CLI;
+   ps.msglen   = sizeof(cm_msg_t) + len;
+
+   // Send the Request
+   cm_send(CM_MSG_REQ, &ps);
+
+   clock_gettime(CLOCK_REALTIME, &ts);
+   ts.tv_sec  += cc.cp_timeout / 1000;
+   ts.tv_nsec += (cc.cp_timeout % 1000) * 1000000;
+   if (ts.tv_nsec >= 1000000000) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000;
+   }
+
+   pthread_mutex_lock(&sreq.mutex);
+
+   while (!sreq.resp) {
+      if (pthread_cond_timedwait(&sreq.cv, &sreq.mutex, &ts) == ETIMEDOUT) break;
+   }
+
+   if (!sreq.resp) result = CP_ERR_TIMEOUT;
+   else {
+      result = sreq.status;
+      memcpy(body, sreq.body, len);
+   }
+
+   // retire the tag, a late response is dropped
+   sreq.active = FALSE;
+   pthread_cond_broadcast(&sreq.cv);
+
+   pthread_mutex_unlock(&sreq.mutex);
+
+   if (gc.trace & LIN_TRACE_CLIENT) {
+      printf("cp_sync_req() msgid:flags:tag = %02X:%02X:%d, status %X\n", msgid, flags, tag, result);
+   }
+
+   return result;
+
+} // end cp_sync_req()
+
+
+// ===========================================================================
+
+// 7.21
+
+static void cp_sync_resp(pcm_msg_t rsp) {
+
+/* 7.21.1   Functional Description
+
+   This routine will record the response for cp_sync_req(). A response
+   that is not the expected message ID or not tagged for the waiting
+   request is dropped. Runs in the CP thread.
+
+   7.21.2   Parameters:
+
+   rsp      CP response
+
+   7.21.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.21.4   Data Structures
+
+   uint32_t   *b = (uint32_t *)rsp + (sizeof(cm_msg_t) >> 2);
+
+// 7.21.5   Code
+
+   pthread_mutex_lock(&sreq.mutex);
+
+   if (!sreq.active || sreq.resp || rsp->p.msgid != sreq.msgid || b[0] != sreq.tag) {
+      sreq.stale++;
+   }
+   else {
+      sreq.resp   = TRUE;
+      sreq.status = rsp->p.status;
+      // short response, no body to return
+      if (rsp->h.msglen < sizeof(cm_msg_t) + sreq.len) {
+         if (sreq.status == CP_OK) sreq.status = CP_ERR_NO_DATA;
+         memset(sreq.body, 0, sreq.len);
+      }
+      else memcpy(sreq.body, b, sreq.len);
+      pthread_cond_broadcast(&sreq.cv);
+   }
 
+   pthread_mutex_unlock(&sreq.mutex);
 
+} // end cp_sync_resp()
@@ -1,7 +1,14 @@
 #pragma once
 
 #define  CP_OK                   0
-#define  CP_RX_QUE               8
+#define  CP_RX_QUE               32
+
+// Windowed Memory Access, requests in flight are bounded by the RX queue
+#define  CP_WIN_MAX              (CP_RX_QUE / 2)
+#define  CP_ERR_TIMEOUT          0x100
+#define  CP_STREAM_RETRIES       8
+#define  CP_TYPE_WIDTH(t)        (((t) == CFG_INT8U  || (t) == CFG_INT8S)  ? 1 : \
+                                  ((t) == CFG_INT16U || (t) == CFG_INT16S) ? 2 : 4)
 
 #define  CP_TMR_PING             0x60
 #define  CP_TMR_PING_TIMEOUT     0x61
@@ -23,9 +30,61 @@ typedef struct _cp_rxq_t {
    uint8_t           slots;
 } cp_rxq_t, *pcp_rxq_t;
 
+// Windowed Memory Transfer, one transfer at a time, split into blocks
+// of CP_BLOCK_MAX bytes tagged tag + block number in b.index
+typedef struct _cp_xfer_t {
+   pthread_mutex_t   mutex;
+   pthread_cond_t    cv;
+   uint8_t           active;
+   uint8_t          *buf;
+   uint32_t          flags;
+   uint32_t          type;
+   uint32_t          address;
+   uint32_t          len;
+   uint32_t          blk;
+   uint32_t          blocks;
+   uint32_t          tag;
+   uint32_t          next;
+   uint32_t          done;
+   uint32_t          status;
+   uint32_t          stale;
+} cp_xfer_t, *pcp_xfer_t;
+
+// Memory Stream, one stream at a time, pipe packets are placed by offset
+typedef struct _cp_stream_t {
+   pthread_mutex_t   mutex;
+   pthread_cond_t    cv;
+   uint8_t           active;
+   uint8_t           resp;
+   uint32_t          tag;
+   uint32_t          status;
+   uint32_t          blocks;
+} cp_stream_t, *pcp_stream_t;
+
+// Synchronous Request, one at a time, the response is matched by its
+// message ID and the tag echoed in the first word of its body, b.tag
+typedef struct _cp_sync_t {
+   pthread_mutex_t   mutex;
+   pthread_cond_t    cv;
+   uint8_t           active;
+   uint8_t           resp;
+   uint8_t           msgid;
+   uint32_t          tag;
+   uint32_t          len;
+   uint32_t          status;
+   uint32_t          stale;
+   uint32_t          body[CM_MAX_MSG_INT32U];
+} cp_sync_t, *pcp_sync_t;
+
 uint32_t cp_init(void);
 uint32_t cp_msg(pcm_msg_t msg);
 uint32_t cp_timer(pcm_msg_t msg);
 uint32_t cp_tick(void);
 uint32_t cp_qmsg(pcm_msg_t msg);
 void     cp_final(void);
+uint32_t cp_mem_read(uint32_t address, void *buf, uint32_t len, uint32_t type);
+uint32_t cp_mem_write(uint32_t address, void *buf, uint32_t len, uint32_t type);
+uint32_t cp_stream_read(uint32_t address, uint32_t len, void *buf, int fd);
+uint32_t cp_xlt_req(uint8_t flags, uint32_t tail, pcp_xlt_body_t body);
+uint32_t cp_sched_req(uint8_t flags, pcp_sched_body_t body);
+uint32_t cp_prof_req(uint8_t flags, uint32_t point, pcp_prof_body_t body);
@@ -24,7 +24,16 @@
 
    1.6 Notes
 
-      NONE
+      With sim.enable = 1 the simulated device of sim.c takes the place of
+      the D2XX driver, every FTDI access goes through 7.11 - 7.14.
+
+      Transmit is asynchronous, fifo_tx() only queues the message and
+      fifo_tx_thread() owns the device for writing. Frames waiting in the
+      queue are coalesced into a single write of up to FIFO_TX_BATCH
+      frames.
+
+      The pipe ring routines 7.18 - 7.25 are shared with udp.c, each
+      driver owns a fifo_ring_t and passes it to them.
 
    2  CONTENTS
 
@@ -58,6 +67,25 @@
          7.4   fifo_cmio()
          7.5   fifo_head()
          7.6   fifo_final()
+         7.7   fifo_rxmsg()
+         7.8   fifo_blk_next()
+         7.9   fifo_pipe_free()
+         7.10  fifo_stats()
+         7.11  fifo_read()
+         7.12  fifo_write()
+         7.13  fifo_queue()
+         7.14  fifo_purge()
+         7.15  fifo_tx_thread()
+         7.16  fifo_tx_now()
+         7.17  fifo_tx_stats()
+         7.18  fifo_ring_open()
+         7.19  fifo_ring_close()
+         7.20  fifo_ring_reset()
+         7.21  fifo_ring_next()
+         7.22  fifo_ring_block()
+         7.23  fifo_ring_head()
+         7.24  fifo_ring_free()
+         7.25  fifo_ring_stats()
 
 -----------------------------------------------------------------------------*/
 
@@ -78,11 +106,25 @@
 
    #define FIFO_RETRIES       4
 
+   // pipe ring index access, single producer and single consumer
+   #define FIFO_LOAD(x)       __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+   #define FIFO_STORE(x, v)   __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+
+   #define FIFO_TXQ_MASK      (FIFO_TXQ_SLOTS - 1)
+
 // 6 MODULE DATA STRUCTURES
 
 // 6.1  Local Function Prototypes
 
    static   void *fifo_thread(void *data);
+   static   void  fifo_rxmsg(uint8_t *frame);
+   static   void  fifo_blk_next(void);
+   static   FT_STATUS fifo_read(uint8_t *buf, DWORD len, DWORD *recv);
+   static   FT_STATUS fifo_write(uint8_t *buf, DWORD len, DWORD *sent);
+   static   FT_STATUS fifo_queue(DWORD *rx_bytes);
+   static   void  fifo_purge(ULONG mask);
+   static   void *fifo_tx_thread(void *data);
+   static   uint64_t fifo_tx_now(void);
 
 // 6.2  Local Data Structures
 
@@ -90,22 +132,32 @@
    static   uint8_t           m_com_port = 0;
 
    static   pthread_t         m_thread_id;
-   static   uint8_t          *m_pool = NULL;
+   static   fifo_ring_t       m_ring = {0};
    static   uint8_t          *m_nxt_pipe = NULL;
    static   uint8_t          *m_blk_pipe = NULL;
-   static   uint32_t          m_blkcnt = 0;
-   static   uint32_t          m_head = 0;
+   static   uint32_t          m_rx_part = 0;
+   static   uint32_t          m_pipe_left = 0;
 
-   static   uint8_t           m_txbuf[FIFO_MSGLEN_UINT8] = {0};
+   static   uint8_t           m_txbuf[FIFO_TX_BATCH * FIFO_MSGLEN_UINT8] = {0};
    static   uint8_t           m_rxbuf[FIFO_MSGLEN_UINT8] = {0};
 
+   // TX queue, multiple producers and the TX thread
+   static   pthread_t         m_tx_thread_id;
+   static   fifo_tx_cell_t    m_txq[FIFO_TXQ_SLOTS] = {{0}};
+   static   uint32_t          m_tx_in   = 0;
+   static   uint32_t          m_tx_out  = 0;
+   static   uint32_t          m_tx_wait = FALSE;
+   static   uint32_t          m_tx_run  = FALSE;
    static   pthread_mutex_t   m_tx_mutex;
+   static   pthread_cond_t    m_tx_cv;
+   static   fifo_tx_stats_t   m_tx_stats = {0};
 
    static   uint32_t          m_sysid, m_stamp, m_cmdat;
    static   uint8_t           m_devid, m_numobjs, m_numcons;
    static   uint32_t          m_librev, m_sysrev;
 
    static   FT_HANDLE         m_fifo = NULL;
+   static   uint8_t           m_sim  = FALSE;
 
    static   UCHAR             m_query[] = {0x83, 0x83, 0x10, 0x10, 0x00, 0x00,
                                            0x0C, 0x20, 0x83, 0x09, 0x00, 0x00};
@@ -141,7 +193,8 @@ uint32_t fifo_init(uint32_t baudrate, uint8_t cm_port, uint8_t com_port) {
    FT_STATUS   status;
    DWORD       dev_cnt, sent, recv;
    uint8_t     retry = 0;
-   UINT        i;
+   UINT        i = 0;
+   uint32_t    j;
 
    FT_DEVICE_LIST_INFO_NODE dev_info[FIFO_MAX_DEVICES];
 
@@ -154,10 +207,18 @@ uint32_t fifo_init(uint32_t baudrate, uint8_t cm_port, uint8_t com_port) {
    // Update FTDI COM Port
    m_com_port = com_port;
 
+   //
+   // Simulated device in place of the FTDI device
+   //
+   m_sim = (cc.sim_enable == 1);
+   if (m_sim) {
+      result = sim_open();
+      status = FT_OK;
+   }
    //
    // Open the Available Selected FTDI device
    //
-   if (FT_CreateDeviceInfoList(&dev_cnt) == FT_OK) {
+   else if (FT_CreateDeviceInfoList(&dev_cnt) == FT_OK) {
       if (dev_cnt <= FIFO_MAX_DEVICES) {
          // fill-out device info
          if (FT_GetDeviceInfoList(dev_info, &dev_cnt) != FT_OK) {
@@ -173,7 +234,7 @@ uint32_t fifo_init(uint32_t baudrate, uint8_t cm_port, uint8_t com_port) {
    }
 
    // Okay to Go
-   if (result == FIFO_OK) {
+   if (result == FIFO_OK && !m_sim) {
       if (gc.trace & LIN_TRACE_UART)
          printf("\nfifo_init() selected port = %d\n", m_com_port);
       // check for valid FIFO interface
@@ -197,7 +258,7 @@ uint32_t fifo_init(uint32_t baudrate, uint8_t cm_port, uint8_t com_port) {
                   status |= FT_ResetDevice(m_fifo);
                   status |= FT_Purge(m_fifo, FT_PURGE_RX | FT_PURGE_TX);
                   status |= FT_ResetDevice(m_fifo);
-                  status |= FT_SetUSBParameters(m_fifo, 32768, 32768);
+                  status |= FT_SetUSBParameters(m_fifo, FIFO_USB_XFER_LEN, FIFO_USB_XFER_LEN);
                   status |= FT_SetChars(m_fifo, FALSE, 0, FALSE, 0);
                   status |= FT_SetLatencyTimer(m_fifo, 5);
                   status |= FT_SetTimeouts(m_fifo, 100, 100);
@@ -217,13 +278,13 @@ uint32_t fifo_init(uint32_t baudrate, uint8_t cm_port, uint8_t com_port) {
    }
 
    // Device Opened
-   if (result == FIFO_OK && m_fifo != NULL) {
+   if (result == FIFO_OK && (m_fifo != NULL || m_sim)) {
 
       // Empty the TX and RX Queues
-      status |= FT_Purge(m_fifo, FT_PURGE_RX | FT_PURGE_TX);
-      status |= FT_Read(m_fifo, m_rxbuf, FIFO_MSGLEN_UINT8, &recv);
-      status |= FT_Read(m_fifo, m_rxbuf, FIFO_MSGLEN_UINT8, &recv);
-      status |= FT_Read(m_fifo, m_rxbuf, FIFO_MSGLEN_UINT8, &recv);
+      fifo_purge(FT_PURGE_RX | FT_PURGE_TX);
+      status |= fifo_read(m_rxbuf, FIFO_MSGLEN_UINT8, &recv);
+      status |= fifo_read(m_rxbuf, FIFO_MSGLEN_UINT8, &recv);
+      status |= fifo_read(m_rxbuf, FIFO_MSGLEN_UINT8, &recv);
 
       // Clear the TX & RX buffers
       memset(m_txbuf, 0, FIFO_MSGLEN_UINT8);
@@ -237,7 +298,7 @@ uint32_t fifo_init(uint32_t baudrate, uint8_t cm_port, uint8_t com_port) {
          // Send CM_QUERY_REQ to validate connection
          cm_crc((pcm_msg_t)&m_query[1], CM_CALC_CRC);
          memcpy(m_txbuf, m_query, sizeof(m_query));
-         status |= FT_Write(m_fifo, m_txbuf, FIFO_MSGLEN_UINT8, &sent);
+         status |= fifo_write(m_txbuf, FIFO_MSGLEN_UINT8, &sent);
 
          // report message content
          if (gc.trace & LIN_TRACE_UART) {
@@ -250,7 +311,7 @@ uint32_t fifo_init(uint32_t baudrate, uint8_t cm_port, uint8_t com_port) {
             // Allow time for Response
             usleep(50*1000);
             // Read the Port
-            status = FT_Read(m_fifo, m_rxbuf, FIFO_MSGLEN_UINT8, &recv);
+            status = fifo_read(m_rxbuf, FIFO_MSGLEN_UINT8, &recv);
             // report message content
             if (gc.trace & LIN_TRACE_UART) {
                printf("fifo_init() rx msglen = %d\n", recv);
@@ -262,7 +323,7 @@ uint32_t fifo_init(uint32_t baudrate, uint8_t cm_port, uint8_t com_port) {
                if (m_rxbuf[12] == 0x34 && m_rxbuf[13] == 0x12 &&
                    m_rxbuf[14] == 0xAA && m_rxbuf[15] == 0x55) {
                   // Purge Queues
-                  FT_Purge(m_fifo, FT_PURGE_RX | FT_PURGE_TX);
+                  fifo_purge(FT_PURGE_RX | FT_PURGE_TX);
                   // Record SysID
                   m_sysid = (m_rxbuf[19] << 24) | (m_rxbuf[18] << 16) |
                             (m_rxbuf[17] << 8) | m_rxbuf[16];
@@ -284,32 +345,49 @@ uint32_t fifo_init(uint32_t baudrate, uint8_t cm_port, uint8_t com_port) {
    }
 
    // OK to Continue
-   if (result == FIFO_OK && m_fifo != NULL) {
+   if (result == FIFO_OK && (m_fifo != NULL || m_sim)) {
 
-      FT_GetLibraryVersion(&m_librev);
-      FT_GetDriverVersion(m_fifo, &m_sysrev);
+      if (!m_sim) {
+         FT_GetLibraryVersion(&m_librev);
+         FT_GetDriverVersion(m_fifo, &m_sysrev);
+      }
 
-      // Init the Mutex
+      // Init the TX Queue, each cell free for the first lap
       pthread_mutex_init(&m_tx_mutex, NULL);
+      pthread_cond_init(&m_tx_cv, NULL);
+      for (j=0;j<FIFO_TXQ_SLOTS;j++) m_txq[j].seq = j;
+      m_tx_in  = 0;
+      m_tx_out = 0;
+      m_tx_run = TRUE;
+      memset(&m_tx_stats, 0, sizeof(m_tx_stats));
+      m_tx_stats.lat_min_us = 0xFFFFFFFF;
 
       // Update CM Port
       m_cm_port = cm_port;
 
       // Register the I/O Interface callback for CM
-      cm_ioreg(fifo_cmio, m_cm_port, CM_MEDIA_FIFO);
+      cm_ioreg(fifo_cmio, m_cm_port, m_sim ? CM_MEDIA_SIM : CM_MEDIA_FIFO);
 
-      // Allocate Pipe Message Pool
-      m_pool  = (uint8_t *)malloc(FIFO_PIPE_POOL);
-      if (m_pool == NULL) result = FIFO_ERR_POOL;
+      // Pipe blocks are returned here
+      cm_pipe_src(fifo_pipe_free);
+
+      // Allocate Pipe Message Pool, plus the overrun spill block
+      if (fifo_ring_open(&m_ring) != FIFO_OK) result = FIFO_ERR_POOL;
 
       // Start the H/W Receive Thread
       if (pthread_create(&m_thread_id, NULL, fifo_thread, NULL)) {
          result = LIN_ERROR_FIFO;
       }
 
+      // Start the Transmit Thread
+      if (pthread_create(&m_tx_thread_id, NULL, fifo_tx_thread, NULL)) {
+         result = LIN_ERROR_FIFO;
+      }
+
        // Print Hardware Version to Serial Port
       if (gc.trace & LIN_TRACE_ID) {
-         printf("Opened FIFO.%d (%s) for Messaging\n", m_com_port, dev_info[i].SerialNumber);
+         printf("Opened FIFO.%d (%s) for Messaging\n", m_com_port,
+               m_sim ? SIM_DEV_STR : dev_info[i].SerialNumber);
          printf("FIFO.%d : ftd2xx.lib:ftd2xx.sys = %08X:%08X\n", m_com_port, m_librev, m_sysrev);
          printf("FIFO.%d : sysid:stamp:cm = %d:%d:%08X\n\n", m_com_port, m_sysid, m_stamp, m_cmdat);
       }
@@ -333,8 +411,20 @@ static void *fifo_thread(void *data) {
 
 /* 7.2.1   Functional Description
 
-   This thread will service the incoming characters from the FIFO serial
-   interface.
+   This thread will service the incoming frames from the FIFO interface.
+
+   All whole 512-byte frames queued by the driver are read with a single
+   FT_Read() directly into the current block of the pipe ring, bounded by
+   the room left in that block. The frames are then parsed in place, pipe
+   frames stay where they landed and control frames are handed to CM and
+   compacted out of the ring. A partial frame is carried over to the next
+   read, nothing is purged.
+
+   The pipe ring is single producer, single consumer, see 7.18 - 7.25. A
+   block is published by advancing head and is owned by the pipe consumer
+   until it is returned with fifo_pipe_free(). When every block is still
+   owned by the consumer the incoming block is received into a spill block
+   and dropped, this thread never waits on the consumer.
 
    7.2.2   Parameters:
 
@@ -349,17 +439,14 @@ static void *fifo_thread(void *data) {
 
 // 7.2.4   Data Structures
 
-   DWORD       rx_bytes, j;
-   DWORD       bytes_left;
-   uint8_t     slotid;
-   uint32_t   *buf;
-   uint16_t    msglen;
-   pcmq_t      slot;
-   pcm_msg_t   msg;
+   DWORD       rx_bytes, recv;
+   uint32_t    room, len, total;
+   uint8_t    *frame, *keep, *end;
 
    EVENT_HANDLE eh;
 
    struct timespec ts;
+   uint32_t    now_us;
 
    pcm_pipe_daq_t  pipe;
 
@@ -372,100 +459,87 @@ static void *fifo_thread(void *data) {
    pthread_mutex_init(&eh.eMutex, NULL);
    pthread_cond_init(&eh.eCondVar, NULL);
 
-   FT_Purge(m_fifo, FT_PURGE_RX | FT_PURGE_TX);
-   FT_SetEventNotification(m_fifo, FT_EVENT_RXCHAR, (PVOID)&eh);
+   fifo_purge(FT_PURGE_RX | FT_PURGE_TX);
+   if (m_sim) sim_notify(&eh.eMutex, &eh.eCondVar);
+   else FT_SetEventNotification(m_fifo, FT_EVENT_RXCHAR, (PVOID)&eh);
 
    // beginning of PIPE message circular buffer
-   m_nxt_pipe  = m_pool;
-   m_blk_pipe  = m_pool;
-   m_head      = 0;
-   m_blkcnt    = 0;
+   fifo_ring_reset(&m_ring);
+   m_rx_part   = 0;
+   m_pipe_left = 0;
+   fifo_blk_next();
 
    while (1) {
-      FT_GetQueueStatus(m_fifo, &rx_bytes);
-      printf("* %d\n", rx_bytes);
+      fifo_queue(&rx_bytes);
+      // whole frames only, bounded by the room left in this block
+      room = FIFO_BLOCK_LEN - (uint32_t)(m_nxt_pipe - m_blk_pipe);
+      len  = rx_bytes + m_rx_part;
+      len -= len % FIFO_MSGLEN_UINT8;
+      if (len > room) len = room;
       // Wait on condition variable,
       // this unlocks the mutex while waiting
-      while (rx_bytes != FIFO_MSGLEN_UINT8) {
+      if (len == 0) {
          pthread_mutex_lock(&eh.eMutex);
          clock_gettime(CLOCK_REALTIME, &ts);
          ts.tv_nsec += FIFO_CV_WAIT;
+         if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+         }
          pthread_cond_timedwait(&eh.eCondVar, &eh.eMutex, &ts);
          pthread_mutex_unlock(&eh.eMutex);
-         FT_GetQueueStatus(m_fifo, &rx_bytes);
-         if (rx_bytes != FIFO_MSGLEN_UINT8)
-            FT_Purge(m_fifo, FT_PURGE_RX);
-         else
-            FT_Read(m_fifo, m_rxbuf, FIFO_MSGLEN_UINT8, &rx_bytes);
+         continue;
       }
-      if (m_rxbuf[0] == 0x81) printf("+\n");
-      if (m_rxbuf[0] == 0x84) printf("-\n");
-      //
-      // PIPE MESSAGE
-      //
-      if (m_rxbuf[0] == CM_ID_PIPE) {
-         printf("$ %d\n", rx_bytes);
-         memcpy(m_nxt_pipe, m_rxbuf, FIFO_MSGLEN_UINT8);
-         pipe = (pcm_pipe_daq_t)m_nxt_pipe;
-         // packet arrival
-         pipe->stamp_us = 0;
-         m_nxt_pipe += FIFO_MSGLEN_UINT8;
-         // last packet in block?
-         if (++m_blkcnt == 16) {
-            m_blkcnt = 0;
-            // next slot in circular buffer
-            if (++m_head == FIFO_PIPE_SLOTS) m_head = 0;
-            m_nxt_pipe = m_pool + (m_head * FIFO_BLOCK_LEN);
-            // report partial pipe content
-            if (gc.trace & LIN_TRACE_PIPE) {
-               printf("fifo_thread() pipelen = %d\n", FIFO_BLOCK_LEN);
-               dump(m_blk_pipe, 32, LIB_ASCII, 0);
-            }
-            // send pipe message
-            cm_pipe_send((pcm_pipe_t)m_blk_pipe, FIFO_BLOCK_LEN);
-            // record next start of block
-            m_blk_pipe = m_nxt_pipe;
+      // bulk read straight into the pipe ring, after any partial frame
+      recv = 0;
+      if (fifo_read(m_nxt_pipe + m_rx_part, len - m_rx_part, &recv) != FT_OK) {
+         if (gc.trace & LIN_TRACE_ERROR) {
+            printf("fifo_thread() Error : FT_Read() failed\n");
          }
+         continue;
       }
-      //
-      // CONTROL MESSAGE
-      //
-      else {
-         printf("# %d\n", rx_bytes);
-         msglen = ((m_rxbuf[7] & 0x0F) << 8) | m_rxbuf[6];
-         if (msglen <= FIFO_MSGLEN_UINT8 && msglen >= 12) {
-            slot = cm_alloc();
-            if (slot != NULL) {
-               msg = (pcm_msg_t)slot->buf;
-               // preserve slotid
-               slotid = msg->h.slot;
-               // uint32_t boundary, copy multiple of 32-bits
-               // always read CM header + parms in order
-               // to determine message length
-               buf = (uint32_t *)m_rxbuf;
-               for (j=0;j<sizeof(cm_msg_t) >> 2;j++) {
-                  slot->buf[j] = buf[j];
-               }
-               slot->msglen = msg->h.msglen;
-               // read rest of CM message body, uint32_t per cycle
-               if (slot->msglen > sizeof(cm_msg_t) && (slot->msglen <= FIFO_MSGLEN_UINT8)) {
-                  for (j=0;j<(slot->msglen + 3 - sizeof(cm_msg_t)) >> 2;j++) {
-                     slot->buf[j + (sizeof(cm_msg_t) >> 2)] =
-                           buf[j + (sizeof(cm_msg_t) >> 2)];
-                  }
-               }
-               // restore slotid
-               msg->h.slot = slotid;
-               // report message content
-               if ((gc.trace & LIN_TRACE_UART) && (slot != NULL)) {
-                  printf("fifo_thread() msglen = %d\n", msg->h.msglen);
-                  dump((uint8_t *)slot->buf, slot->msglen, LIB_ASCII, 0);
-               }
-               // queue the message
-               cm_qmsg((pcm_msg_t)slot->buf);
+      // packet arrival
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      now_us      = (uint32_t)((ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000));
+      total       = m_rx_part + recv;
+      m_rx_part   = total % FIFO_MSGLEN_UINT8;
+      end         = m_nxt_pipe + (total - m_rx_part);
+      keep        = m_nxt_pipe;
+      // parse the frames in place
+      for (frame=m_nxt_pipe;frame<end;frame+=FIFO_MSGLEN_UINT8) {
+         //
+         // PIPE MESSAGE
+         //
+         if (m_pipe_left != 0 || frame[0] == CM_ID_PIPE) {
+            // first frame of a pipe transfer
+            if (m_pipe_left == 0) m_pipe_left = FIFO_PIPELEN_UINT8;
+            // close the gap left by a control frame
+            if (keep != frame) memmove(keep, frame, FIFO_MSGLEN_UINT8);
+            // first frame of each 1K DAQ message, packet arrival
+            if ((m_pipe_left % sizeof(cm_pipe_daq_t)) == 0) {
+               pipe = (pcm_pipe_daq_t)keep;
+               pipe->stamp_us = now_us;
             }
+            keep += FIFO_MSGLEN_UINT8;
+            m_pipe_left -= FIFO_MSGLEN_UINT8;
+         }
+         //
+         // CONTROL MESSAGE
+         //
+         else {
+            fifo_rxmsg(frame);
          }
       }
+      // carry the partial frame down to the new end of data
+      if (m_rx_part != 0 && keep != end) memmove(keep, end, m_rx_part);
+      m_nxt_pipe = keep;
+      // last packet in block?
+      if (m_nxt_pipe - m_blk_pipe == FIFO_BLOCK_LEN) {
+         // publish the block, or drop it when spilled
+         fifo_ring_block(&m_ring, m_blk_pipe);
+         // next slot in circular buffer
+         fifo_blk_next();
+      }
    }
 
    return 0;
@@ -481,8 +555,15 @@ void fifo_tx(pcm_msg_t msg) {
 
 /* 7.3.1   Functional Description
 
-   This routine will transmit the message. The tx_mutex is used to prevent
-   mulitple threads from interferring with a single message transfer.
+   This routine will queue the message for fifo_tx_thread(), the caller
+   never waits on the USB device. The message is released by the TX
+   thread once its frame is written.
+
+   The TX queue is a bounded multi-producer ring with one cell per CM
+   message slot, a position is claimed by fetch-add and the cell is
+   published by its sequence number, as in cm_qmsg(). The ring can not
+   hold more messages than the CM pool, a producer only spins if the TX
+   thread has not yet released the cell of the previous lap.
 
    7.3.2   Parameters:
 
@@ -497,8 +578,8 @@ void fifo_tx(pcm_msg_t msg) {
 
 // 7.3.4   Data Structures
 
-   DWORD       bytes_left, bytes_sent;
-   uint8_t     retry = 0;
+   pfifo_tx_cell_t cell;
+   uint32_t    pos, depth;
 
 // 7.3.5   Code
 
@@ -509,28 +590,29 @@ void fifo_tx(pcm_msg_t msg) {
       dump((uint8_t *)msg, msg->h.msglen, LIB_ASCII, 0);
    }
 
-   // Lock the CM mutex
-   pthread_mutex_lock(&m_tx_mutex);
+   // claim the next TX queue position
+   pos  = __atomic_fetch_add(&m_tx_in, 1, __ATOMIC_RELAXED);
+   cell = &m_txq[pos & FIFO_TXQ_MASK];
 
-   // copy message to txbuf
-   memset(m_txbuf, 0, sizeof(m_txbuf));
-   memcpy(m_txbuf, msg, msg->h.msglen);
-   bytes_left = FIFO_MSGLEN_UINT8;
-   FT_Write(m_fifo, m_txbuf, bytes_left, &bytes_sent);
-   bytes_left -= bytes_sent;
-   //retry
-   while (bytes_left != 0 && retry < FIFO_RETRIES) {
-      usleep(2000);
-      FT_Write(m_fifo, &m_txbuf[FIFO_MSGLEN_UINT8 - bytes_left], bytes_left, &bytes_sent);
-      bytes_left -= bytes_sent;
-      retry++;
-   }
+   // wait for fifo_tx_thread to release the cell
+   while (FIFO_LOAD(cell->seq) != pos) sched_yield();
 
-   // release message
-   cm_free(msg);
+   // publish the message
+   cell->msg      = msg;
+   cell->stamp_us = fifo_tx_now();
+   FIFO_STORE(cell->seq, pos + 1);
 
-   // Unlock the CM mutex
-   pthread_mutex_unlock(&m_tx_mutex);
+   // queue depth high-water mark, advisory
+   depth = pos + 1 - FIFO_LOAD(m_tx_out);
+   if (depth > m_tx_stats.hiwater) m_tx_stats.hiwater = depth;
+
+   // signal the TX thread, only when waiting
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   if (FIFO_LOAD(m_tx_wait)) {
+      pthread_mutex_lock(&m_tx_mutex);
+      pthread_cond_signal(&m_tx_cv);
+      pthread_mutex_unlock(&m_tx_mutex);
+   }
 
 } // end fifo_tx()
 
@@ -582,8 +664,8 @@ void fifo_head(void) {
 
 /* 7.5.1   Functional Description
 
-   This routine will reset the pipe circular buffer pointers and
-   associated counters.
+   This routine will advance the pipe ring tail over every block that has
+   no references left, see fifo_ring_head().
 
    7.5.2   Parameters:
 
@@ -600,11 +682,7 @@ void fifo_head(void) {
 
 // 7.5.5   Code
 
-   // reset pipe circular buffer
-   m_nxt_pipe  = m_pool;
-   m_blk_pipe  = m_pool;
-   m_head      = 0;
-   m_blkcnt    = 0;
+   fifo_ring_head(&m_ring);
 
 } // end fifo_head()
 
@@ -634,14 +712,892 @@ void fifo_final(void) {
 
 // 7.6.5   Code
 
+   // Stop the TX Thread, queued frames are written first
+   __atomic_store_n(&m_tx_run, FALSE, __ATOMIC_SEQ_CST);
+   pthread_mutex_lock(&m_tx_mutex);
+   pthread_cond_signal(&m_tx_cv);
+   pthread_mutex_unlock(&m_tx_mutex);
+   pthread_join(m_tx_thread_id, NULL);
+
    // Cancel Thread
    pthread_cancel(m_thread_id);
    pthread_join(m_thread_id, NULL);
 
    // Close FIFO
-   FT_Close(m_fifo);
+   if (m_sim) sim_close();
+   else FT_Close(m_fifo);
+
+   // Report Pipe Ring Overruns
+   if (m_ring.overruns != 0) {
+      printf("fifo_final() Warning : pipe ring overrun, %d blocks, %d bytes dropped\n",
+            m_ring.overruns, m_ring.dropped);
+   }
+
+   // Report the TX Engine
+   if (m_tx_stats.short_wr != 0) {
+      printf("fifo_final() Warning : %d short writes after retries\n", m_tx_stats.short_wr);
+   }
+   if ((gc.trace & LIN_TRACE_UART) && m_tx_stats.frames != 0) {
+      printf("fifo_final() tx frames %d in %d writes, batch max %d, retries %d, hiwater %d\n",
+            m_tx_stats.frames, m_tx_stats.writes, m_tx_stats.batch_max,
+            m_tx_stats.retries, m_tx_stats.hiwater);
+      printf("fifo_final() tx latency min:mean:max = %d:%d:%d uS\n", m_tx_stats.lat_min_us,
+            (uint32_t)(m_tx_stats.lat_sum_us / m_tx_stats.frames), m_tx_stats.lat_max_us);
+   }
 
    // Release Memory
-   free(m_pool);
+   fifo_ring_close(&m_ring);
 
 } // end fifo_final()
+
+
+// ===========================================================================
+
+// 7.7
+
+static void fifo_rxmsg(uint8_t *frame) {
+
+/* 7.7.1   Functional Description
+
+   This routine will copy a received control frame into a CM queue slot
+   and queue it for delivery. The frame is left in the pipe ring and is
+   overwritten by the caller.
+
+   7.7.2   Parameters:
+
+   frame    512-byte control frame
+
+   7.7.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.7.4   Data Structures
+
+   uint32_t    j;
+   uint8_t     slotid;
+   uint16_t    msglen;
+   uint32_t   *buf = (uint32_t *)frame;
+   pcmq_t      slot;
+   pcm_msg_t   msg;
+
+// 7.7.5   Code
+
+   msglen = ((frame[7] & 0x0F) << 8) | frame[6];
+   if (msglen <= FIFO_MSGLEN_UINT8 && msglen >= 12) {
+      slot = cm_alloc();
+      if (slot != NULL) {
+         msg = (pcm_msg_t)slot->buf;
+         // preserve slotid
+         slotid = msg->h.slot;
+         // uint32_t boundary, copy multiple of 32-bits
+         // always read CM header + parms in order
+         // to determine message length
+         for (j=0;j<sizeof(cm_msg_t) >> 2;j++) {
+            slot->buf[j] = buf[j];
+         }
+         slot->msglen = msg->h.msglen;
+         // read rest of CM message body, uint32_t per cycle
+         if (slot->msglen > sizeof(cm_msg_t) && (slot->msglen <= FIFO_MSGLEN_UINT8)) {
+            for (j=0;j<(slot->msglen + 3 - sizeof(cm_msg_t)) >> 2;j++) {
+               slot->buf[j + (sizeof(cm_msg_t) >> 2)] =
+                     buf[j + (sizeof(cm_msg_t) >> 2)];
+            }
+         }
+         // restore slotid
+         msg->h.slot = slotid;
+         // report message content
+         if (gc.trace & LIN_TRACE_UART) {
+            printf("fifo_rxmsg() msglen = %d\n", msg->h.msglen);
+            dump((uint8_t *)slot->buf, slot->msglen, LIB_ASCII, 0);
+         }
+         // queue the message
+         cm_qmsg((pcm_msg_t)slot->buf);
+      }
+   }
+
+} // end fifo_rxmsg()
+
+
+// ===========================================================================
+
+// 7.8
+
+static void fifo_blk_next(void) {
+
+/* 7.8.1   Functional Description
+
+   This routine will select the block for the next pipe transfer, see
+   fifo_ring_next(), and carry any partial frame over to it.
+
+   7.8.2   Parameters:
+
+   NONE
+
+   7.8.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.8.4   Data Structures
+
+// 7.8.5   Code
+
+   m_blk_pipe = fifo_ring_next(&m_ring);
+
+   // carry any partial frame to the new block
+   if (m_rx_part != 0 && m_nxt_pipe != NULL) memmove(m_blk_pipe, m_nxt_pipe, m_rx_part);
+
+   m_nxt_pipe = m_blk_pipe;
+
+} // end fifo_blk_next()
+
+
+// ===========================================================================
+
+// 7.9
+
+void fifo_pipe_free(pcm_pipe_t pipe) {
+
+/* 7.9.1   Functional Description
+
+   This routine will drop one reference on a pipe block, see
+   fifo_ring_free(). It is the pipe source release routine, called
+   through cm_pipe_free().
+
+   7.9.2   Parameters:
+
+   pipe     Pipe block received from cm_pipe_get()
+
+   7.9.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.9.4   Data Structures
+
+// 7.9.5   Code
+
+   fifo_ring_free(&m_ring, pipe);
+
+} // end fifo_pipe_free()
+
+
+// ===========================================================================
+
+// 7.10
+
+void fifo_stats(pfifo_stats_t stats) {
+
+/* 7.10.1   Functional Description
+
+   This routine will report the pipe ring counters.
+
+   7.10.2   Parameters:
+
+   stats    Pipe ring statistics
+
+   7.10.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.10.4   Data Structures
+
+// 7.10.5   Code
+
+   fifo_ring_stats(&m_ring, stats);
+
+} // end fifo_stats()
+
+
+// ===========================================================================
+
+// 7.11
+
+static FT_STATUS fifo_read(uint8_t *buf, DWORD len, DWORD *recv) {
+
+/* 7.11.1   Functional Description
+
+   This routine will read from the FTDI device or the simulated device.
+
+   7.11.2   Parameters:
+
+   buf      Destination
+   len      Bytes wanted
+   recv     Bytes read
+
+   7.11.3   Return Values:
+
+   status   FT_OK or the D2XX status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.11.4   Data Structures
+
+// 7.11.5   Code
+
+   if (m_sim) {
+      *recv = sim_read(buf, len);
+      return FT_OK;
+   }
+
+   return FT_Read(m_fifo, buf, len, recv);
+
+} // end fifo_read()
+
+
+// ===========================================================================
+
+// 7.12
+
+static FT_STATUS fifo_write(uint8_t *buf, DWORD len, DWORD *sent) {
+
+/* 7.12.1   Functional Description
+
+   This routine will write to the FTDI device or the simulated device.
+   The simulated device takes one frame at a time, a coalesced write is
+   handed over frame by frame until the device stops taking them.
+
+   7.12.2   Parameters:
+
+   buf      Frames
+   len      Length, whole frames
+   sent     Bytes written
+
+   7.12.3   Return Values:
+
+   status   FT_OK or the D2XX status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.12.4   Data Structures
+
+   uint32_t    took;
+
+// 7.12.5   Code
+
+   if (m_sim) {
+      for (*sent=0;*sent < len;*sent += took) {
+         took = sim_write(&buf[*sent], FIFO_MSGLEN_UINT8);
+         if (took == 0) break;
+      }
+      return FT_OK;
+   }
+
+   return FT_Write(m_fifo, buf, len, sent);
+
+} // end fifo_write()
+
+
+// ===========================================================================
+
+// 7.13
+
+static FT_STATUS fifo_queue(DWORD *rx_bytes) {
+
+/* 7.13.1   Functional Description
+
+   This routine will return the bytes waiting to be read.
+
+   7.13.2   Parameters:
+
+   rx_bytes Bytes waiting
+
+   7.13.3   Return Values:
+
+   status   FT_OK or the D2XX status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.13.4   Data Structures
+
+// 7.13.5   Code
+
+   if (m_sim) {
+      *rx_bytes = sim_queue();
+      return FT_OK;
+   }
+
+   return FT_GetQueueStatus(m_fifo, rx_bytes);
+
+} // end fifo_queue()
+
+
+// ===========================================================================
+
+// 7.14
+
+static void fifo_purge(ULONG mask) {
+
+/* 7.14.1   Functional Description
+
+   This routine will purge the FTDI device queues, the simulated device
+   has nothing stale to purge.
+
+   7.14.2   Parameters:
+
+   mask     FT_PURGE_RX, FT_PURGE_TX
+
+   7.14.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.14.4   Data Structures
+
+// 7.14.5   Code
+
+   if (!m_sim) FT_Purge(m_fifo, mask);
+
+} // end fifo_purge()
+
+
+// ===========================================================================
+
+// 7.15
+
+static void *fifo_tx_thread(void *data) {
+
+/* 7.15.1   Functional Description
+
+   This thread will drain the TX queue to the FIFO interface. Every frame
+   published when the thread wakes, up to FIFO_TX_BATCH, is copied into
+   the coalescing buffer as a zero padded 512-byte frame and the batch is
+   written with a single FT_Write(). A short write is retried for the
+   remainder FIFO_RETRIES times.
+
+   The messages of the batch are released once the write completes and
+   the latency from fifo_tx() is recorded per frame. The thread exits
+   when fifo_final() clears m_tx_run and the queue is empty.
+
+   7.15.2   Parameters:
+
+   data     Thread parameters
+
+   7.15.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.15.4   Data Structures
+
+   pfifo_tx_cell_t cell;
+   pcm_msg_t   msg[FIFO_TX_BATCH];
+   uint64_t    stamp[FIFO_TX_BATCH];
+   uint64_t    now;
+   uint32_t    i, n, len, lat;
+   DWORD       bytes_left, bytes_sent;
+   uint8_t     retry;
+   uint8_t    *frame;
+
+   struct timespec ts;
+
+// 7.15.5   Code
+
+   if (gc.trace & LIN_TRACE_ID) {
+      printf("fifo_tx_thread() started, tid %lu\n", syscall(SYS_gettid));
+   }
+
+   while (1) {
+
+      // Wait for a published cell, or the stop request
+      pthread_mutex_lock(&m_tx_mutex);
+      __atomic_store_n(&m_tx_wait, TRUE, __ATOMIC_SEQ_CST);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      while (FIFO_LOAD(m_txq[m_tx_out & FIFO_TXQ_MASK].seq) != m_tx_out + 1 &&
+             FIFO_LOAD(m_tx_run)) {
+         clock_gettime(CLOCK_REALTIME, &ts);
+         ts.tv_sec += 1;
+         pthread_cond_timedwait(&m_tx_cv, &m_tx_mutex, &ts);
+      }
+      __atomic_store_n(&m_tx_wait, FALSE, __ATOMIC_RELAXED);
+      pthread_mutex_unlock(&m_tx_mutex);
+
+      // Coalesce the published frames
+      for (n=0;n<FIFO_TX_BATCH;n++) {
+         cell = &m_txq[m_tx_out & FIFO_TXQ_MASK];
+         if (FIFO_LOAD(cell->seq) != m_tx_out + 1) break;
+         msg[n]   = cell->msg;
+         stamp[n] = cell->stamp_us;
+         // release the cell for the next lap
+         FIFO_STORE(cell->seq, m_tx_out + FIFO_TXQ_SLOTS);
+         FIFO_STORE(m_tx_out, m_tx_out + 1);
+         // copy the message, zero pad the frame
+         frame = &m_txbuf[n * FIFO_MSGLEN_UINT8];
+         len   = (msg[n]->h.msglen > FIFO_MSGLEN_UINT8) ? FIFO_MSGLEN_UINT8 : msg[n]->h.msglen;
+         memcpy(frame, msg[n], len);
+         memset(&frame[len], 0, FIFO_MSGLEN_UINT8 - len);
+      }
+
+      // Queue drained and stopped
+      if (n == 0) {
+         if (!FIFO_LOAD(m_tx_run)) break;
+         continue;
+      }
+
+      // One write for the batch, retry the remainder
+      bytes_left = n * FIFO_MSGLEN_UINT8;
+      bytes_sent = 0;
+      fifo_write(m_txbuf, bytes_left, &bytes_sent);
+      bytes_left -= bytes_sent;
+      for (retry=0;bytes_left != 0 && retry < FIFO_RETRIES;retry++) {
+         usleep(FIFO_TX_RETRY_US);
+         bytes_sent = 0;
+         fifo_write(&m_txbuf[n * FIFO_MSGLEN_UINT8 - bytes_left], bytes_left, &bytes_sent);
+         bytes_left -= bytes_sent;
+      }
+
+      if (bytes_left != 0) {
+         m_tx_stats.short_wr++;
+         if (gc.trace & LIN_TRACE_ERROR) {
+            printf("fifo_tx_thread() Error : %d of %d bytes not written\n",
+                  bytes_left, n * FIFO_MSGLEN_UINT8);
+         }
+      }
+
+      // Release the messages, record the latency
+      now = fifo_tx_now();
+      for (i=0;i<n;i++) {
+         lat = (uint32_t)(now - stamp[i]);
+         if (lat < m_tx_stats.lat_min_us) m_tx_stats.lat_min_us = lat;
+         if (lat > m_tx_stats.lat_max_us) m_tx_stats.lat_max_us = lat;
+         m_tx_stats.lat_sum_us += lat;
+         cm_free(msg[i]);
+      }
+
+      m_tx_stats.frames  += n;
+      m_tx_stats.writes++;
+      m_tx_stats.retries += retry;
+      if (n > m_tx_stats.batch_max) m_tx_stats.batch_max = n;
+   }
+
+   return 0;
+
+} // end fifo_tx_thread()
+
+
+// ===========================================================================
+
+// 7.16
+
+static uint64_t fifo_tx_now(void) {
+
+/* 7.16.1   Functional Description
+
+   This routine will return the monotonic time in microseconds.
+
+   7.16.2   Parameters:
+
+   NONE
+
+   7.16.3   Return Values:
+
+   now      Microseconds
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.16.4   Data Structures
+
+   struct timespec ts;
+
+// 7.16.5   Code
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+} // end fifo_tx_now()
+
+
+// ===========================================================================
+
+// 7.17
+
+void fifo_tx_stats(pfifo_tx_stats_t stats) {
+
+/* 7.17.1   Functional Description
+
+   This routine will report the TX engine counters.
+
+   7.17.2   Parameters:
+
+   stats    TX engine statistics
+
+   7.17.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.17.4   Data Structures
+
+// 7.17.5   Code
+
+   *stats = m_tx_stats;
+   if (stats->frames == 0) stats->lat_min_us = 0;
+   else stats->lat_mean_us = (uint32_t)(stats->lat_sum_us / stats->frames);
+
+} // end fifo_tx_stats()
+
+
+// ===========================================================================
+
+// 7.18
+
+uint32_t fifo_ring_open(pfifo_ring_t ring) {
+
+/* 7.18.1   Functional Description
+
+   This routine will allocate a pipe ring, FIFO_PIPE_SLOTS blocks plus the
+   overrun spill block. The FIFO and LAN drivers each own a ring and call
+   7.18 - 7.25 with it.
+
+   7.18.2   Parameters:
+
+   ring     Pipe ring
+
+   7.18.3   Return Values:
+
+   result   FIFO_OK or FIFO_ERR_POOL
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.18.4   Data Structures
+
+// 7.18.5   Code
+
+   memset(ring, 0, sizeof(fifo_ring_t));
+
+   ring->pool = (uint8_t *)malloc(FIFO_PIPE_POOL + FIFO_BLOCK_LEN);
+   if (ring->pool == NULL) return FIFO_ERR_POOL;
+   ring->spill = ring->pool + FIFO_PIPE_POOL;
+
+   return FIFO_OK;
+
+} // end fifo_ring_open()
+
+
+// ===========================================================================
+
+// 7.19
+
+void fifo_ring_close(pfifo_ring_t ring) {
+
+/* 7.19.1   Functional Description
+
+   This routine will release the pipe ring pool.
+
+   7.19.2   Parameters:
+
+   ring     Pipe ring
+
+   7.19.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.19.4   Data Structures
+
+// 7.19.5   Code
+
+   free(ring->pool);
+   ring->pool  = NULL;
+   ring->spill = NULL;
+
+} // end fifo_ring_close()
+
+
+// ===========================================================================
+
+// 7.20
+
+void fifo_ring_reset(pfifo_ring_t ring) {
+
+/* 7.20.1   Functional Description
+
+   This routine will empty the pipe ring, called by the receive thread
+   before the first block.
+
+   7.20.2   Parameters:
+
+   ring     Pipe ring
+
+   7.20.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.20.4   Data Structures
+
+// 7.20.5   Code
+
+   ring->head = 0;
+   memset(ring->ref, 0, sizeof(ring->ref));
+   FIFO_STORE(ring->tail, 0);
+
+} // end fifo_ring_reset()
+
+
+// ===========================================================================
+
+// 7.21
+
+uint8_t *fifo_ring_next(pfifo_ring_t ring) {
+
+/* 7.21.1   Functional Description
+
+   This routine will select the block for the next pipe transfer. The block
+   at head is used when every subscriber has returned it, otherwise the spill
+   block is used and its contents are dropped when complete.
+
+   7.21.2   Parameters:
+
+   ring     Pipe ring
+
+   7.21.3   Return Values:
+
+   blk      Block to receive into
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.21.4   Data Structures
+
+   uint32_t    used = ring->head - FIFO_LOAD(ring->tail);
+
+// 7.21.5   Code
+
+   if (used < FIFO_PIPE_SLOTS) {
+      ring->spill_on = FALSE;
+      return ring->pool + ((ring->head % FIFO_PIPE_SLOTS) * FIFO_BLOCK_LEN);
+   }
+
+   ring->spill_on = TRUE;
+   return ring->spill;
+
+} // end fifo_ring_next()
+
+
+// ===========================================================================
+
+// 7.22
+
+void fifo_ring_block(pfifo_ring_t ring, uint8_t *blk) {
+
+/* 7.22.1   Functional Description
+
+   This routine will publish a completed block to the pipe subscribers, or
+   drop it when it was received into the spill block. The block is held
+   with FIFO_REF_HOLD while cm_pipe_send() hands it out, so a subscriber
+   returning it early can't release the slot.
+
+   7.22.2   Parameters:
+
+   ring     Pipe ring
+   blk      Block from fifo_ring_next(), FIFO_BLOCK_LEN bytes
+
+   7.22.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.22.4   Data Structures
+
+   uint32_t    idx, refs;
+
+// 7.22.5   Code
+
+   // check the pipe headers, a spilled block is counted as an overrun
+   if (!ring->spill_on) pmon_block(blk, FIFO_BLOCK_LEN);
+
+   // ring was full, drop the spilled block
+   if (ring->spill_on) {
+      ring->overruns++;
+      ring->dropped += FIFO_BLOCK_LEN;
+      if (gc.trace & LIN_TRACE_ERROR) {
+         printf("fifo_ring_block() Error : pipe ring overrun, %d blocks\n", ring->overruns);
+      }
+   }
+   // publish the block when a consumer is registered,
+   // otherwise the slot is simply reused
+   else if (cm_pipe_exists(((pcm_pipe_t)blk)->msgid)) {
+      // hold the block while it is handed out
+      idx = ring->head % FIFO_PIPE_SLOTS;
+      FIFO_STORE(ring->ref[idx], FIFO_REF_HOLD);
+      FIFO_STORE(ring->head, ring->head + 1);
+      ring->blocks++;
+      if (ring->head - FIFO_LOAD(ring->tail) > ring->hiwater)
+         ring->hiwater = ring->head - FIFO_LOAD(ring->tail);
+      // report partial pipe content
+      if (gc.trace & LIN_TRACE_PIPE) {
+         printf("fifo_ring_block() pipelen = %d\n", FIFO_BLOCK_LEN);
+         dump(blk, 32, LIB_ASCII, 0);
+      }
+      // send pipe message, in place, one reference per subscriber
+      cm_pipe_send((pcm_pipe_t)blk, FIFO_BLOCK_LEN, &refs);
+      // drop the hold, no subscriber took the block
+      if (__atomic_sub_fetch(&ring->ref[idx], FIFO_REF_HOLD - refs, __ATOMIC_ACQ_REL) == 0)
+         fifo_ring_head(ring);
+   }
+
+} // end fifo_ring_block()
+
+
+// ===========================================================================
+
+// 7.23
+
+void fifo_ring_head(pfifo_ring_t ring) {
+
+/* 7.23.1   Functional Description
+
+   This routine will advance the ring tail over every block that has no
+   references left. Blocks may be returned out of order by different
+   subscribers, so any thread that drops the last reference calls this
+   routine and the tail only moves with compare-and-swap.
+
+   7.23.2   Parameters:
+
+   ring     Pipe ring
+
+   7.23.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.23.4   Data Structures
+
+   uint32_t    tail = FIFO_LOAD(ring->tail);
+
+// 7.23.5   Code
+
+   // release returned blocks to the producer, in ring order
+   while (tail != FIFO_LOAD(ring->head) && FIFO_LOAD(ring->ref[tail % FIFO_PIPE_SLOTS]) == 0) {
+      // on failure tail is reloaded, another thread moved it
+      if (__atomic_compare_exchange_n(&ring->tail, &tail, tail + 1, FALSE,
+            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) tail++;
+   }
+
+} // end fifo_ring_head()
+
+
+// ===========================================================================
+
+// 7.24
+
+void fifo_ring_free(pfifo_ring_t ring, pcm_pipe_t pipe) {
+
+/* 7.24.1   Functional Description
+
+   This routine will drop one reference on a pipe block. The block is
+   returned to the ring when its last reference is dropped.
+
+   7.24.2   Parameters:
+
+   ring     Pipe ring
+   pipe     Pipe block received from cm_pipe_get()
+
+   7.24.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.24.4   Data Structures
+
+   uint8_t    *blk  = (uint8_t *)pipe;
+   uint32_t    idx, ref;
+
+// 7.24.5   Code
+
+   // validate block
+   if (blk < ring->pool || blk >= ring->pool + FIFO_PIPE_POOL) {
+      ring->free_err++;
+      if (gc.trace & LIN_TRACE_ERROR) {
+         printf("fifo_ring_free() Error : block not in pipe ring\n");
+      }
+      return;
+   }
+
+   // drop one reference, never below zero
+   idx = (blk - ring->pool) / FIFO_BLOCK_LEN;
+   ref = FIFO_LOAD(ring->ref[idx]);
+   do {
+      if (ref == 0) {
+         ring->free_err++;
+         if (gc.trace & LIN_TRACE_ERROR) {
+            printf("fifo_ring_free() Error : block not outstanding\n");
+         }
+         return;
+      }
+   } while (!__atomic_compare_exchange_n(&ring->ref[idx], &ref, ref - 1, TRUE,
+               __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+   // last reference, release to the producer
+   if (ref == 1) fifo_ring_head(ring);
+
+} // end fifo_ring_free()
+
+
+// ===========================================================================
+
+// 7.25
+
+void fifo_ring_stats(pfifo_ring_t ring, pfifo_stats_t stats) {
+
+/* 7.25.1   Functional Description
+
+   This routine will report the pipe ring counters.
+
+   7.25.2   Parameters:
+
+   ring     Pipe ring
+   stats    Pipe ring statistics
+
+   7.25.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.25.4   Data Structures
+
+// 7.25.5   Code
+
+   stats->blocks   = ring->blocks;
+   stats->overruns = ring->overruns;
+   stats->dropped  = ring->dropped;
+   stats->hiwater  = ring->hiwater;
+   stats->used     = FIFO_LOAD(ring->head) - FIFO_LOAD(ring->tail);
+   stats->free_err = ring->free_err;
+
+} // end fifo_ring_stats()
@@ -29,6 +29,9 @@
 #define  FIFO_BLOCK_LEN        (FIFO_PIPELEN_UINT8 * 4)
 #define  FIFO_PIPE_BLKS        (FIFO_BLOCK_LEN / FIFO_PIPELEN_UINT8)
 #define  FIFO_PIPE_POOL        (FIFO_PIPE_SLOTS * FIFO_BLOCK_LEN)
+#define  FIFO_REF_HOLD         0x00010000
+
+#define  FIFO_USB_XFER_LEN     65536
 
 #define  FIFO_MAX_DEVICES      16
 #define  FIFO_RX_TIMEOUT       100
@@ -37,15 +40,77 @@
 #define  FIFO_LATENCY          1
 #define  FIFO_CV_WAIT          50000000
 
+// TX queue, one cell per CM message slot, and frames per USB write
+#define  FIFO_TXQ_SLOTS        CM_MSGQ_SLOTS
+#define  FIFO_TX_BATCH         16
+#define  FIFO_TX_RETRY_US      2000
+
 #define  FIFO_EPID_NONE        0x00
 #define  FIFO_EPID_NEXT        0x20
 #define  FIFO_EPID_CTL         0x40
 #define  FIFO_EPID_PIPE        0x80
 #define  FIFO_PIPE             0x84
 
+// Pipe Ring, fifo_thread or udp_thread to pipe subscribers
+typedef struct _fifo_ring_t {
+   uint8_t     *pool;
+   uint8_t     *spill;
+   uint8_t      spill_on;
+   uint32_t     head;
+   uint32_t     tail;
+   uint32_t     ref[FIFO_PIPE_SLOTS];
+   uint32_t     blocks;
+   uint32_t     overruns;
+   uint32_t     dropped;
+   uint32_t     hiwater;
+   uint32_t     free_err;
+} fifo_ring_t, *pfifo_ring_t;
+
+// Pipe Ring Statistics
+typedef struct _fifo_stats_t {
+   uint32_t     blocks;
+   uint32_t     overruns;
+   uint32_t     dropped;
+   uint32_t     hiwater;
+   uint32_t     used;
+   uint32_t     free_err;
+} fifo_stats_t, *pfifo_stats_t;
+
+// TX Queue Cell, fifo_tx() to fifo_tx_thread()
+typedef struct _fifo_tx_cell_t {
+   uint32_t     seq;
+   pcm_msg_t    msg;
+   uint64_t     stamp_us;
+} fifo_tx_cell_t, *pfifo_tx_cell_t;
+
+// TX Engine Statistics, latency from fifo_tx() to write completion
+typedef struct _fifo_tx_stats_t {
+   uint32_t     frames;
+   uint32_t     writes;
+   uint32_t     batch_max;
+   uint32_t     retries;
+   uint32_t     short_wr;
+   uint32_t     hiwater;
+   uint32_t     lat_min_us;
+   uint32_t     lat_max_us;
+   uint32_t     lat_mean_us;
+   uint64_t     lat_sum_us;
+} fifo_tx_stats_t, *pfifo_tx_stats_t;
+
 uint32_t  fifo_init(uint32_t baudrate, uint8_t cm_port, uint8_t com_port);
 void      fifo_tx(pcm_msg_t msg);
 void      fifo_cmio(uint8_t op_code, pcm_msg_t msg);
 void      fifo_head(void);
+void      fifo_pipe_free(pcm_pipe_t pipe);
+void      fifo_stats(pfifo_stats_t stats);
+void      fifo_tx_stats(pfifo_tx_stats_t stats);
 void      fifo_final(void);
+uint32_t  fifo_ring_open(pfifo_ring_t ring);
+void      fifo_ring_close(pfifo_ring_t ring);
+void      fifo_ring_reset(pfifo_ring_t ring);
+uint8_t  *fifo_ring_next(pfifo_ring_t ring);
+void      fifo_ring_block(pfifo_ring_t ring, uint8_t *blk);
+void      fifo_ring_head(pfifo_ring_t ring);
+void      fifo_ring_free(pfifo_ring_t ring, pcm_pipe_t pipe);
+void      fifo_ring_stats(pfifo_ring_t ring, pfifo_stats_t stats);
 
@@ -0,0 +1,1698 @@
+/*-----------------------------------------------------------------------------
+
+   1  ABSTRACT
+
+   1.1 Module Type
+
+      Simulated C10 Device
+
+   1.2 Functional Description
+
+      This module stands in for the CYC1000 board and its FT245 FIFO. Frames
+      written by the FIFO driver are answered the way nios/c10_fw does, and
+      DAQ runs stream CM_PIPE_DAQ_DATA transfers back through the same
+      512-byte frame path the FTDI D2XX driver feeds, as do memory streams
+      of CM_PIPE_STREAM_DATA. It can also serve the LAN datagrams of udp.c
+      on the loopback interface.
+
+   1.3 Specification/Design Reference
+
+      See fw_cfg.h under the share directory.
+
+   1.4 Module Test Specification Reference
+
+      None
+
+   1.5 Compilation Information
+
+      See fw_cfg.h under the share directory.
+
+   1.6 Notes
+
+      Selected with sim.enable = 1. fifo.c reads and writes through this
+      module in place of FT_Read() and FT_Write() and registers the port
+      with CM as CM_MEDIA_SIM, so everything above the FTDI calls runs
+      unchanged.
+
+      The device byte stream is a single producer, single consumer ring,
+      this thread is the producer and fifo_thread is the consumer. A pipe
+      transfer is pushed whole, control responses only fall between
+      transfers just as on the FIFO.
+
+      sim.pace = 0 streams as fast as the host reads, sim.pace = 1 holds
+      the stream to sim.rate clocks per sample row at SIM_CLOCK_HZ.
+      sim.loss drops one pipe message in every N, sim.reorder swaps a pair
+      of messages in every N transfers, sim.latency_us delays every
+      response.
+
+      With opc.media = 1 the device is a UDP socket on 127.0.0.1 at
+      opc.cm_udp_port instead of the byte stream. Requests are taken with
+      recvmmsg() by sim_lan_thread(), responses go out as 518-byte
+      datagrams and each pipe transfer as one sendmmsg() of SIM_PIPE_MSGS
+      1030-byte datagrams. Nothing holds the stream back on the LAN, an
+      unpaced run finds the limits of the host receive path.
+
+      With sim.fw set the device is the firmware itself, the host build of
+      nios/c10_fw/host started by sim_fw_open() on one end of a socket
+      pair. Frames go to it from sim_write() and sim_fw_thread() pushes
+      what it sends into the device stream, the other sim settings don't
+      apply. Device SDRAM is at 0x08000000 in this mode.
+
+   2  CONTENTS
+
+      1 ABSTRACT
+        1.1 Module Type
+        1.2 Functional Description
+        1.3 Specification/Design Reference
+        1.4 Module Test Specification Reference
+        1.5 Compilation Information
+        1.6 Notes
+
+      2 CONTENTS
+
+      3 VOCABULARY
+
+      4 EXTERNAL RESOURCES
+        4.1  Include Files
+        4.2  External Data Structures
+        4.3  External Function Prototypes
+
+      5 LOCAL CONSTANTS AND MACROS
+
+      6 MODULE DATA STRUCTURES
+        6.1  Local Function Prototypes
+        6.2  Local Data Structures
+
+      7 MODULE CODE
+        7.1   sim_open()
+        7.2   sim_notify()
+        7.3   sim_queue()
+        7.4   sim_read()
+        7.5   sim_write()
+        7.6   sim_close()
+        7.7   sim_thread()
+        7.8   sim_msg()
+        7.9   sim_resp()
+        7.10  sim_out()
+        7.11  sim_push()
+        7.12  sim_stream()
+        7.13  sim_pipe()
+        7.14  sim_samples()
+        7.15  sim_time()
+        7.16  sim_lan_open()
+        7.17  sim_lan_thread()
+        7.18  sim_lan_out()
+        7.19  sim_mem_stream()
+        7.20  sim_fw_open()
+        7.21  sim_fw_thread()
+
+-----------------------------------------------------------------------------*/
+
+// 3 VOCABULARY
+
+// 4 EXTERNAL RESOURCES
+
+// 4.1  Include Files
+
+#define _GNU_SOURCE
+#include "main.h"
+
+// 4.2   External Data Structures
+
+// 4.3   External Function Prototypes
+
+// 5 LOCAL CONSTANTS AND MACROS
+
+   // width of a CP memory type
+   #define SIM_WIDTH(t)    (((t) == CFG_INT8U || (t) == CFG_INT8S) ? 1 : \
+                            ((t) == CFG_INT16U || (t) == CFG_INT16S) ? 2 : 4)
+
+// 6 MODULE DATA STRUCTURES
+
+// 6.1  Local Function Prototypes
+
+   static   void     *sim_thread(void *data);
+   static   void      sim_msg(pcm_msg_t msg, uint64_t now);
+   static   void      sim_resp(pcm_msg_t rsp, pcm_msg_t req, uint16_t msglen);
+   static   void      sim_out(pcm_msg_t msg, uint16_t msglen);
+   static   uint32_t  sim_push(void *buf, uint32_t len);
+   static   uint32_t  sim_stream(uint64_t now);
+   static   void      sim_pipe(void);
+   static   void      sim_samples(uint16_t *sam);
+   static   uint64_t  sim_time(void);
+   static   void     *sim_lan_thread(void *data);
+   static   uint32_t  sim_fw_open(void);
+   static   void     *sim_fw_thread(void *data);
+   static   void      sim_lan_out(void *buf, uint32_t len, uint32_t cnt);
+   static   uint32_t  sim_mem_stream(void);
+
+// 6.2  Local Data Structures
+
+   static   sim_t     sim = {0};
+
+   static   struct mmsghdr    sim_msgs[SIM_REQ_QUE];
+   static   struct iovec      sim_iov[SIM_REQ_QUE][2];
+   static   uint8_t           sim_pad[SIM_REQ_QUE][UDP_PAD_LEN];
+
+// 7 MODULE CODE
+
+// ===========================================================================
+
+// 7.1
+
+uint32_t sim_open(void) {
+
+/* 7.1.1   Functional Description
+
+   This routine will power up the simulated device and start its thread.
+
+   7.1.2   Parameters:
+
+   NONE
+
+   7.1.3   Return Values:
+
+   result   FIFO_OK
+            FIFO_ERR_POOL when the byte stream can't be allocated
+            FIFO_ERR_THREAD when the device thread doesn't start
+            FIFO_ERR_OPEN when the firmware doesn't start
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.1.4   Data Structures
+
+   uint32_t    result = FIFO_OK;
+   uint32_t    i;
+
+// 7.1.5   Code
+
+   memset(&sim, 0, sizeof(sim_t));
+   sim.sock    = -1;
+   sim.fw_sock = -1;
+
+   sim.rx = (uint8_t *)malloc(SIM_RX_LEN);
+   if (sim.rx == NULL) return FIFO_ERR_POOL;
+
+   pthread_mutex_init(&sim.mutex, NULL);
+   pthread_cond_init(&sim.cv, NULL);
+
+   // firmware in the loop
+   if (cc.sim_fw[0] != '\0') {
+      result = sim_fw_open();
+      if (result != FIFO_OK) {
+         free(sim.rx);
+         sim.rx = NULL;
+      }
+      return result;
+   }
+
+   // 12-bit sine, one cycle
+   for (i=0;i<SIM_SINE_LEN;i++) {
+      sim.sine[i] = (uint16_t)(2048 + (int32_t)(1800.0 * sin((2.0 * M_PI * i) / SIM_SINE_LEN)));
+   }
+
+   // FPGA clocks per pipe message, the FPGA clamps the ADC rate
+   sim.interval = ((cc.sim_rate < SIM_RATE_MIN) ? SIM_RATE_MIN : cc.sim_rate) * DAQ_MAX_SAM;
+   sim.noise    = 0x2545F491;
+   sim.trace    = gc.trace;
+
+   // Start the Device Thread
+   if (pthread_create(&sim.tid, NULL, sim_thread, NULL)) {
+      free(sim.rx);
+      sim.rx = NULL;
+      result = FIFO_ERR_THREAD;
+   }
+
+   if (gc.trace & LIN_TRACE_ID) {
+      printf("sim_open() %s : rate %d, pace %d, wave %d, loss 1/%d, reorder 1/%d, latency %d uS\n",
+            SIM_DEV_STR, sim.interval / DAQ_MAX_SAM, cc.sim_pace, cc.sim_wave,
+            cc.sim_loss, cc.sim_reorder, cc.sim_latency_us);
+   }
+
+   return result;
+
+} // end sim_open()
+
+
+// ===========================================================================
+
+// 7.2
+
+void sim_notify(pthread_mutex_t *mutex, pthread_cond_t *cv) {
+
+/* 7.2.1   Functional Description
+
+   This routine will register the condition signalled when bytes are
+   added to the device stream, as FT_SetEventNotification() does.
+
+   7.2.2   Parameters:
+
+   mutex    Event mutex
+   cv       Event condition variable
+
+   7.2.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.2.4   Data Structures
+
+// 7.2.5   Code
+
+   pthread_mutex_lock(&sim.mutex);
+   sim.ev_mutex = mutex;
+   sim.ev_cv    = cv;
+   pthread_mutex_unlock(&sim.mutex);
+
+} // end sim_notify()
+
+
+// ===========================================================================
+
+// 7.3
+
+uint32_t sim_queue(void) {
+
+/* 7.3.1   Functional Description
+
+   This routine will return the bytes waiting in the device stream.
+
+   7.3.2   Parameters:
+
+   NONE
+
+   7.3.3   Return Values:
+
+   bytes    Bytes waiting
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.3.4   Data Structures
+
+// 7.3.5   Code
+
+   return __atomic_load_n(&sim.rx_head, __ATOMIC_ACQUIRE) - sim.rx_tail;
+
+} // end sim_queue()
+
+
+// ===========================================================================
+
+// 7.4
+
+uint32_t sim_read(uint8_t *buf, uint32_t len) {
+
+/* 7.4.1   Functional Description
+
+   This routine will copy bytes out of the device stream and wake the
+   device thread, which may be waiting for room.
+
+   7.4.2   Parameters:
+
+   buf      Destination
+   len      Bytes wanted
+
+   7.4.3   Return Values:
+
+   recv     Bytes copied
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.4.4   Data Structures
+
+   uint32_t    tail  = sim.rx_tail;
+   uint32_t    avail = __atomic_load_n(&sim.rx_head, __ATOMIC_ACQUIRE) - tail;
+   uint32_t    off, cnt;
+
+// 7.4.5   Code
+
+   if (len > avail) len = avail;
+   if (len == 0) return 0;
+
+   // two copies across the end of the ring
+   off = tail % SIM_RX_LEN;
+   cnt = SIM_RX_LEN - off;
+   if (cnt > len) cnt = len;
+   memcpy(buf, sim.rx + off, cnt);
+   if (cnt < len) memcpy(buf + cnt, sim.rx, len - cnt);
+
+   __atomic_store_n(&sim.rx_tail, tail + len, __ATOMIC_RELEASE);
+
+   pthread_mutex_lock(&sim.mutex);
+   pthread_cond_signal(&sim.cv);
+   pthread_mutex_unlock(&sim.mutex);
+
+   return len;
+
+} // end sim_read()
+
+
+// ===========================================================================
+
+// 7.5
+
+uint32_t sim_write(uint8_t *buf, uint32_t len) {
+
+/* 7.5.1   Functional Description
+
+   This routine will hand one frame to the device. The frame is answered
+   by the device thread once sim.latency_us has passed.
+
+   7.5.2   Parameters:
+
+   buf      Frame
+   len      Frame length
+
+   7.5.3   Return Values:
+
+   sent     Bytes taken, 0 when the request queue is full
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.5.4   Data Structures
+
+   psim_req_t  req;
+
+// 7.5.5   Code
+
+   // firmware in the loop, one whole frame
+   if (sim.fw_sock >= 0) {
+      memset(sim.fw_tx, 0, FIFO_MSGLEN_UINT8);
+      memcpy(sim.fw_tx, buf, (len > FIFO_MSGLEN_UINT8) ? FIFO_MSGLEN_UINT8 : len);
+      if (send(sim.fw_sock, sim.fw_tx, FIFO_MSGLEN_UINT8, MSG_NOSIGNAL) != FIFO_MSGLEN_UINT8) {
+         sim.req_full++;
+         return 0;
+      }
+      sim.reqs++;
+      return len;
+   }
+
+   pthread_mutex_lock(&sim.mutex);
+
+   if (sim.req_head - sim.req_tail == SIM_REQ_QUE) {
+      sim.req_full++;
+      len = 0;
+   }
+   else {
+      req = &sim.req[sim.req_head % SIM_REQ_QUE];
+      memset(req->frame, 0, FIFO_MSGLEN_UINT8);
+      memcpy(req->frame, buf, (len > FIFO_MSGLEN_UINT8) ? FIFO_MSGLEN_UINT8 : len);
+      req->due_us = sim_time() + cc.sim_latency_us;
+      sim.req_head++;
+      pthread_cond_signal(&sim.cv);
+   }
+
+   pthread_mutex_unlock(&sim.mutex);
+
+   return len;
+
+} // end sim_write()
+
+
+// ===========================================================================
+
+// 7.6
+
+void sim_close(void) {
+
+/* 7.6.1   Functional Description
+
+   This routine will stop the device thread and release the stream.
+
+   7.6.2   Parameters:
+
+   NONE
+
+   7.6.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.6.4   Data Structures
+
+// 7.6.5   Code
+
+   if (sim.rx == NULL) return;
+
+   // firmware in the loop, closing the link ends the firmware
+   if (sim.fw_sock >= 0) {
+      sim.fw_stop = TRUE;
+      shutdown(sim.fw_sock, SHUT_RDWR);
+      waitpid(sim.fw_pid, NULL, 0);
+      pthread_join(sim.tid, NULL);
+      close(sim.fw_sock);
+      sim.fw_sock = -1;
+      if (sim.rx_full != 0 || sim.req_full != 0) {
+         printf("sim_close() Warning : %d responses dropped, %d requests refused\n",
+               sim.rx_full, sim.req_full);
+      }
+      free(sim.rx);
+      sim.rx = NULL;
+      return;
+   }
+
+   // Cancel Threads
+   pthread_cancel(sim.tid);
+   pthread_join(sim.tid, NULL);
+   if (sim.lan) {
+      pthread_cancel(sim.lan_tid);
+      pthread_join(sim.lan_tid, NULL);
+      close(sim.sock);
+      sim.sock = -1;
+      sim.lan  = FALSE;
+   }
+
+   if (sim.rx_full != 0 || sim.req_full != 0) {
+      printf("sim_close() Warning : %d responses dropped, %d requests refused\n",
+            sim.rx_full, sim.req_full);
+   }
+   if (sim.tx_err != 0) {
+      printf("sim_close() Warning : %d datagrams not sent\n", sim.tx_err);
+   }
+   if (gc.trace & LIN_TRACE_DRIVER) {
+      printf("sim_close() requests %d, pipe transfers %d, lost %d, reordered %d\n",
+            sim.reqs, sim.pipes, sim.lost, sim.swapped);
+   }
+
+   free(sim.rx);
+   sim.rx = NULL;
+
+} // end sim_close()
+
+
+// ===========================================================================
+
+// 7.7
+
+static void *sim_thread(void *data) {
+
+/* 7.7.1   Functional Description
+
+   This thread is the device main loop. Requests are served once due and
+   the pipe stream is advanced while a DAQ run or memory stream is active.
+
+   7.7.2   Parameters:
+
+   data     Thread parameters
+
+   7.7.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.7.4   Data Structures
+
+   uint32_t          head, busy = FALSE;
+   uint64_t          now;
+   psim_req_t        req;
+   struct timespec   ts;
+
+// 7.7.5   Code
+
+   if (gc.trace & LIN_TRACE_ID) {
+      printf("sim_thread() started, tid %lu\n", syscall(SYS_gettid));
+   }
+
+   pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+   while (1) {
+
+      // Lock the Device mutex
+      pthread_mutex_lock(&sim.mutex);
+
+      // Wait on condition variable unless streaming,
+      // this unlocks the mutex while waiting
+      if (busy == FALSE) {
+         clock_gettime(CLOCK_REALTIME, &ts);
+         ts.tv_nsec += SIM_WAIT_US * 1000L;
+         if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+         }
+         pthread_cond_timedwait(&sim.cv, &sim.mutex, &ts);
+      }
+      head = sim.req_head;
+
+      // Unlock the Device mutex
+      pthread_mutex_unlock(&sim.mutex);
+
+      // Prevent arbitrary cancellation point
+      pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+      pthread_testcancel();
+      pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+      now = sim_time();
+
+      // serve the requests that are due, in order
+      while (sim.req_tail != head) {
+         req = &sim.req[sim.req_tail % SIM_REQ_QUE];
+         if (req->due_us > now) break;
+         sim_msg((pcm_msg_t)req->frame, now);
+         pthread_mutex_lock(&sim.mutex);
+         sim.req_tail++;
+         pthread_mutex_unlock(&sim.mutex);
+      }
+
+      // pipe stream
+      busy = (sim.run == TRUE) ? sim_stream(now) : FALSE;
+      if (sim.strm_run == TRUE) busy |= sim_mem_stream();
+   }
+
+   return (void *)0;
+
+} // end sim_thread()
+
+
+// ===========================================================================
+
+// 7.8
+
+static void sim_msg(pcm_msg_t msg, uint64_t now) {
+
+/* 7.8.1   Functional Description
+
+   This routine will serve one request as the CM, CP and DAQ servers
+   of nios/c10_fw do.
+
+   7.8.2   Parameters:
+
+   msg      Request frame
+   now      Device time in microseconds
+
+   7.8.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.8.4   Data Structures
+
+   uint32_t    out[FIFO_MSGLEN_UINT32];
+   uint16_t    cm_msg = MSG(msg->p.srvid, msg->p.msgid);
+   uint32_t    off, len, width;
+
+// 7.8.5   Code
+
+   sim.reqs++;
+   memset(out, 0, sizeof(out));
+
+   if (sim.trace & LIN_TRACE_DRIVER) {
+      printf("sim_msg() srvid:msgid:msglen = %02X:%02X:%04X\n",
+            msg->p.srvid, msg->p.msgid, msg->h.msglen);
+   }
+
+   //
+   //    CM QUERY REQUEST
+   //
+   if (cm_msg == MSG(CM_ID_INSTANCE, CM_QUERY_REQ)) {
+      pcm_query_msg_t rsp = (pcm_query_msg_t)out;
+      rsp->p.srvid      = CM_ID_INSTANCE;
+      rsp->p.msgid      = CM_QUERY_RESP;
+      rsp->p.flags      = CM_NO_FLAGS;
+      rsp->b.magic      = 0x55AA1234;
+      rsp->b.sysid      = SIM_SYSID;
+      rsp->b.stamp      = (uint32_t)(now / 1000);
+      rsp->b.devid      = 0;
+      rsp->b.num_objs   = 4;
+      rsp->b.num_cons   = 2;
+      sim_resp((pcm_msg_t)rsp, msg, sizeof(cm_query_msg_t));
+   }
+   //
+   //    CM REGISTRATION REQUEST
+   //
+   else if (cm_msg == MSG(CM_ID_INSTANCE, CM_REG_REQ)) {
+      if (msg->p.flags & CM_REG_OPEN) {
+         pcm_reg_msg_t rsp = (pcm_reg_msg_t)out;
+         rsp->p.srvid          = CM_ID_INSTANCE;
+         rsp->p.msgid          = CM_REG_RESP;
+         rsp->p.flags          = CM_NO_FLAGS;
+         rsp->p.status         = CM_OK;
+         // local CM objects
+         rsp->b.rec[0].cmid    = CM_ID_INSTANCE;
+         rsp->b.rec[1].cmid    = CM_ID_CP_SRV;
+         rsp->b.rec[2].cmid    = CM_ID_DAQ_SRV;
+         rsp->b.rec[0].devid   = CM_DEV_C10;
+         rsp->b.rec[1].devid   = CM_DEV_C10;
+         rsp->b.rec[2].devid   = CM_DEV_C10;
+         rsp->b.rec_cnt        = 3;
+         strncpy(rsp->b.device, SIM_DEV_STR, CM_MAX_DEV_STR_LEN - 1);
+         // device response, new sequence
+         rsp->h.seqid          = sim.seqid++;
+         rsp->h.dst_cmid       = CM_ID_INSTANCE;
+         rsp->h.dst_devid      = msg->h.src_devid;
+         rsp->h.src_cmid       = CM_ID_INSTANCE;
+         rsp->h.src_devid      = CM_DEV_C10;
+         rsp->h.port           = msg->h.port;
+         sim_out((pcm_msg_t)rsp, sizeof(cm_reg_msg_t));
+         sim.connected = TRUE;
+      }
+      // no response
+      else if (msg->p.flags & CM_REG_CLOSE) {
+         sim.connected = FALSE;
+      }
+   }
+   //
+   //    CP VERSION REQUEST
+   //
+   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_VER_REQ)) {
+      pcp_ver_msg_t rsp = (pcp_ver_msg_t)out;
+      rsp->p.srvid       = CM_ID_CP_SRV;
+      rsp->p.msgid       = CP_VER_RESP;
+      rsp->p.flags       = CP_NO_FLAGS;
+      rsp->p.status      = CP_OK;
+      rsp->b.fw_ver      = (BUILD_MAJOR << 24) | (BUILD_MINOR << 16) |
+                           (BUILD_NUM   <<  8) |  BUILD_INC;
+      rsp->b.sysid       = SIM_SYSID;
+      rsp->b.stamp_epoch = (uint32_t)time(NULL);
+      rsp->b.stamp_date  = FPGA_MAP_DATE;
+      rsp->b.stamp_time  = 0;
+      memcpy(rsp->b.vhdl, "SIM", 3);
+      rsp->b.trace       = sim.trace;
+      rsp->b.feature     = 0;
+      rsp->b.debug       = sim.debug;
+      sim_resp((pcm_msg_t)rsp, msg, sizeof(cp_ver_msg_t));
+   }
+   //
+   //    CP SET/GET TRACE REQUEST
+   //
+   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_TRACE_REQ)) {
+      pcp_trace_msg_t req = (pcp_trace_msg_t)msg;
+      pcp_trace_msg_t rsp = (pcp_trace_msg_t)out;
+      rsp->p.srvid  = CM_ID_CP_SRV;
+      rsp->p.msgid  = CP_TRACE_RESP;
+      rsp->p.flags  = req->p.flags;
+      rsp->p.status = CP_OK;
+      if (req->p.flags == CP_TRACE_SET) {
+         sim.debug  = req->b.debug;
+         sim.trace  = req->b.trace;
+      }
+      rsp->b.debug  = sim.debug;
+      rsp->b.trace  = sim.trace;
+      sim_resp((pcm_msg_t)rsp, msg, sizeof(cp_trace_msg_t));
+   }
+   //
+   //    CP READ/WRITE MEMORY REQUEST, device memory is SIM_MEM_LEN bytes
+   //
+   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_MEM_REQ)) {
+      pcp_mem_msg_t req = (pcp_mem_msg_t)msg;
+      pcp_mem_msg_t rsp = (pcp_mem_msg_t)out;
+      rsp->p.srvid   = CM_ID_CP_SRV;
+      rsp->p.msgid   = CP_MEM_RESP;
+      rsp->p.flags   = req->p.flags;
+      rsp->p.status  = CP_OK;
+      rsp->b.address = req->b.address;
+      rsp->b.value   = req->b.value;
+      rsp->b.type    = req->b.type;
+      width = SIM_WIDTH(req->b.type);
+      off   = req->b.address & (SIM_MEM_LEN - 1) & ~(width - 1);
+      if (req->p.flags & CP_MEM_WR) memcpy(&sim.mem[off], &req->b.value, width);
+      if (req->p.flags & CP_MEM_RD) {
+         rsp->b.value = 0;
+         memcpy(&rsp->b.value, &sim.mem[off], width);
+      }
+      sim_resp((pcm_msg_t)rsp, msg, sizeof(cp_mem_msg_t));
+   }
+   //
+   //    CP READ/WRITE BLOCK REQUEST
+   //
+   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_BLOCK_REQ)) {
+      pcp_block_msg_t req = (pcp_block_msg_t)msg;
+      pcp_block_msg_t rsp = (pcp_block_msg_t)out;
+      rsp->p.srvid   = CM_ID_CP_SRV;
+      rsp->p.msgid   = CP_BLOCK_RESP;
+      rsp->p.flags   = req->p.flags;
+      rsp->p.status  = CP_OK;
+      rsp->b.index   = req->b.index;
+      rsp->b.type    = req->b.type;
+      rsp->b.address = req->b.address;
+      rsp->b.length  = req->b.length;
+      len = req->b.length * SIM_WIDTH(req->b.type);
+      // the block is bounded by CP_BLOCK_MAX bytes, as on the device
+      if (len > CP_BLOCK_MAX) {
+         rsp->p.status = CP_ERR_MSG_LEN_MAX;
+         len = 0;
+      }
+      off = req->b.address & (SIM_MEM_LEN - 1);
+      if (off + len > SIM_MEM_LEN) off = SIM_MEM_LEN - len;
+      if (req->p.flags & CP_MEM_WR) memcpy(&sim.mem[off], req->b.data, len);
+      if (req->p.flags & CP_MEM_RD) memcpy(rsp->b.data, &sim.mem[off], len);
+      // only include the data read
+      if (!(req->p.flags & CP_MEM_RD)) len = 0;
+      sim_resp((pcm_msg_t)rsp, msg, sizeof(cp_block_msg_t) - CP_BLOCK_MAX + len);
+   }
+   //
+   //    CP MEMORY STREAM REQUEST, SDRAM reads the device memory repeated
+   //
+   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_STREAM_REQ)) {
+      pcp_stream_msg_t req = (pcp_stream_msg_t)msg;
+      pcp_stream_msg_t rsp = (pcp_stream_msg_t)out;
+      rsp->p.srvid     = CM_ID_CP_SRV;
+      rsp->p.msgid     = CP_STREAM_RESP;
+      rsp->p.flags     = req->p.flags;
+      rsp->p.status    = CP_OK;
+      rsp->b.tag       = req->b.tag;
+      rsp->b.address   = req->b.address;
+      rsp->b.length    = req->b.length;
+      rsp->b.packets   = 0;
+      // the pipe is shared with the DAQ, as on the device
+      if (sim.run == TRUE || sim.strm_run == TRUE) {
+         rsp->p.status = CP_ERR_BUSY;
+      }
+      else if (req->b.length == 0 || req->b.address > SIM_SDRAM_SPAN ||
+               req->b.length > SIM_SDRAM_SPAN - req->b.address) {
+         rsp->p.status = CP_ERR_ADDR_RANGE;
+      }
+      else {
+         len = (req->b.length + CP_STREAM_DATA - 1) / CP_STREAM_DATA;
+         rsp->b.packets = (len + CP_STREAM_ALIGN - 1) & ~(CP_STREAM_ALIGN - 1);
+      }
+      sim_resp((pcm_msg_t)rsp, msg, sizeof(cp_stream_msg_t));
+      if (rsp->p.status == CP_OK) {
+         sim.strm_tag  = req->b.tag;
+         sim.strm_addr = req->b.address;
+         sim.strm_len  = req->b.length;
+         sim.strm_pkts = rsp->b.packets;
+         sim.strm_seq  = 0;
+         sim.strm_run  = TRUE;
+      }
+   }
+   //
+   //    CP TRACE RING REQUEST, the simulated device keeps no trace ring
+   //
+   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_XLT_REQ)) {
+      pcp_xlt_msg_t rsp = (pcp_xlt_msg_t)out;
+      rsp->p.srvid  = CM_ID_CP_SRV;
+      rsp->p.msgid  = CP_XLT_RESP;
+      rsp->p.flags  = msg->p.flags;
+      rsp->p.status = CP_ERR_NO_DATA;
+      memset(&rsp->b, 0, sizeof(cp_xlt_body_t));
+      rsp->b.tag    = ((pcp_xlt_msg_t)msg)->b.tag;
+      sim_resp((pcm_msg_t)rsp, msg, sizeof(cp_xlt_msg_t));
+   }
+   //
+   //    CP SCHEDULER REQUEST, the simulated device keeps no accounting
+   //
+   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_SCHED_REQ)) {
+      pcp_sched_msg_t rsp = (pcp_sched_msg_t)out;
+      rsp->p.srvid  = CM_ID_CP_SRV;
+      rsp->p.msgid  = CP_SCHED_RESP;
+      rsp->p.flags  = msg->p.flags;
+      rsp->p.status = CP_ERR_NO_DATA;
+      memset(&rsp->b, 0, sizeof(cp_sched_body_t));
+      rsp->b.tag    = ((pcp_sched_msg_t)msg)->b.tag;
+      sim_resp((pcm_msg_t)rsp, msg, sizeof(cp_sched_msg_t));
+   }
+   //
+   //    CP PROFILE REQUEST, the simulated device keeps no profile
+   //
+   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_PROF_REQ)) {
+      pcp_prof_msg_t rsp = (pcp_prof_msg_t)out;
+      rsp->p.srvid  = CM_ID_CP_SRV;
+      rsp->p.msgid  = CP_PROF_RESP;
+      rsp->p.flags  = msg->p.flags;
+      rsp->p.status = CP_ERR_NO_DATA;
+      memset(&rsp->b, 0, sizeof(cp_prof_body_t));
+      rsp->b.tag    = ((pcp_prof_msg_t)msg)->b.tag;
+      sim_resp((pcm_msg_t)rsp, msg, sizeof(cp_prof_msg_t));
+   }
+   //
+   //    CP PING REQUEST
+   //
+   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_PING_REQ)) {
+      pcp_ping_msg_t rsp = (pcp_ping_msg_t)out;
+      rsp->p.srvid  = CM_ID_CP_SRV;
+      rsp->p.msgid  = CP_PING_RESP;
+      rsp->p.flags  = msg->p.flags;
+      rsp->p.status = CP_OK;
+      if (sim.connected == TRUE) sim_resp((pcm_msg_t)rsp, msg, sizeof(cp_ping_msg_t));
+   }
+   //
+   //    CP RESET REQUEST, NO RESPONSE
+   //
+   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_RESET_REQ)) {
+      // NOT USED
+   }
+   //
+   //    DAQ RUN REQUEST
+   //
+   else if (cm_msg == MSG(CM_ID_DAQ_SRV, DAQ_RUN_REQ)) {
+      pdaq_run_msg_t req = (pdaq_run_msg_t)msg;
+      pdaq_run_msg_t rsp = (pdaq_run_msg_t)out;
+      rsp->p.srvid   = CM_ID_DAQ_SRV;
+      rsp->p.msgid   = DAQ_RUN_RESP;
+      rsp->p.flags   = req->p.flags;
+      rsp->p.status  = DAQ_OK;
+      rsp->b.opcode  = req->b.opcode;
+      rsp->b.packets = req->b.packets;
+      // the pipe is held by a memory stream
+      if (sim.strm_run == TRUE) {
+         rsp->p.status = DAQ_ERR_BUSY;
+      }
+      // start the stream, sequence and ramp restart
+      else if (req->b.opcode & DAQ_CMD_RUN) {
+         sim.opcode   = req->b.opcode;
+         sim.packets  = req->b.packets;
+         sim.sent     = 0;
+         sim.pipe_seq = 0;
+         sim.ramp     = 0;
+         sim.phase    = 0;
+         sim.start_us = now;
+         sim.run      = TRUE;
+      }
+      else if (req->b.opcode & DAQ_CMD_STOP) {
+         sim.run      = FALSE;
+      }
+      sim_resp((pcm_msg_t)rsp, msg, sizeof(daq_run_msg_t));
+   }
+   //
+   //    UNKNOWN MESSAGE
+   //
+   else {
+      if (sim.trace & LIN_TRACE_ERROR) {
+         printf("sim_msg() Unknown Message, srvid:msgid = %02X:%02X\n",
+               msg->p.srvid, msg->p.msgid);
+      }
+   }
+
+} // end sim_msg()
+
+
+// ===========================================================================
+
+// 7.9
+
+static void sim_resp(pcm_msg_t rsp, pcm_msg_t req, uint16_t msglen) {
+
+/* 7.9.1   Functional Description
+
+   This routine will address a response from its request, as cm_send()
+   does for CM_MSG_RESP, and send it.
+
+   7.9.2   Parameters:
+
+   rsp      Response
+   req      Request
+   msglen   Response length in bytes
+
+   7.9.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.9.4   Data Structures
+
+// 7.9.5   Code
+
+   rsp->h.seqid     = req->h.seqid;
+   rsp->h.dst_cmid  = req->h.src_cmid;
+   rsp->h.dst_devid = req->h.src_devid;
+   rsp->h.src_cmid  = req->h.dst_cmid;
+   rsp->h.src_devid = req->h.dst_devid;
+   rsp->h.port      = req->h.port;
+
+   sim_out(rsp, msglen);
+
+} // end sim_resp()
+
+
+// ===========================================================================
+
+// 7.10
+
+static void sim_out(pcm_msg_t msg, uint16_t msglen) {
+
+/* 7.10.1   Functional Description
+
+   This routine will complete the header and send the message as one
+   512-byte frame.
+
+   7.10.2   Parameters:
+
+   msg      Message in a FIFO_MSGLEN_UINT8 buffer
+   msglen   Message length in bytes
+
+   7.10.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.10.4   Data Structures
+
+// 7.10.5   Code
+
+   msg->h.proto  = CM_PROTO;
+   msg->h.event  = CM_EVENT_MSG;
+   msg->h.endian = CM_ENDIAN;
+   msg->h.msglen = msglen;
+
+   cm_crc(msg, CM_CALC_CRC);
+
+   if (sim.lan) {
+      sim_lan_out(msg, FIFO_MSGLEN_UINT8, 1);
+   }
+   else if (sim_push(msg, FIFO_MSGLEN_UINT8) == FALSE) {
+      sim.rx_full++;
+      if (sim.trace & LIN_TRACE_ERROR) {
+         printf("sim_out() Error : device stream full, response dropped\n");
+      }
+   }
+
+} // end sim_out()
+
+
+// ===========================================================================
+
+// 7.11
+
+static uint32_t sim_push(void *buf, uint32_t len) {
+
+/* 7.11.1   Functional Description
+
+   This routine will add bytes to the device stream and signal the reader.
+
+   7.11.2   Parameters:
+
+   buf      Bytes
+   len      Length, whole frames
+
+   7.11.3   Return Values:
+
+   result   TRUE, FALSE when there is no room
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.11.4   Data Structures
+
+   uint32_t    head = sim.rx_head;
+   uint32_t    off, cnt;
+
+// 7.11.5   Code
+
+   if (SIM_RX_LEN - (head - __atomic_load_n(&sim.rx_tail, __ATOMIC_ACQUIRE)) < len) return FALSE;
+
+   // two copies across the end of the ring
+   off = head % SIM_RX_LEN;
+   cnt = SIM_RX_LEN - off;
+   if (cnt > len) cnt = len;
+   memcpy(sim.rx + off, buf, cnt);
+   if (cnt < len) memcpy(sim.rx, (uint8_t *)buf + cnt, len - cnt);
+
+   __atomic_store_n(&sim.rx_head, head + len, __ATOMIC_RELEASE);
+
+   // wake the reader
+   if (sim.ev_mutex != NULL) {
+      pthread_mutex_lock(sim.ev_mutex);
+      pthread_cond_signal(sim.ev_cv);
+      pthread_mutex_unlock(sim.ev_mutex);
+   }
+
+   return TRUE;
+
+} // end sim_push()
+
+
+// ===========================================================================
+
+// 7.12
+
+static uint32_t sim_stream(uint64_t now) {
+
+/* 7.12.1   Functional Description
+
+   This routine will send the pipe transfers that are due. Unpaced, the
+   stream runs while there is room, keeping SIM_RX_RESERVE for responses.
+   The run ends after the requested packets, 0 runs until DAQ_CMD_STOP.
+
+   7.12.2   Parameters:
+
+   now      Device time in microseconds
+
+   7.12.3   Return Values:
+
+   busy     TRUE when a transfer was sent
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.12.4   Data Structures
+
+   uint32_t    cnt = 0;
+   uint64_t    due;
+   uint32_t    out[FIFO_MSGLEN_UINT32];
+
+// 7.12.5   Code
+
+   // bounded, so requests are served during a run
+   while (cnt < SIM_BURST) {
+      // all packets sent, DAQ done indication as for DAQ_INT_FLAG_PIPE
+      if (sim.packets != 0 && sim.sent >= sim.packets) {
+         pdaq_done_ind_msg_t ind = (pdaq_done_ind_msg_t)out;
+         memset(out, 0, sizeof(out));
+         ind->p.srvid     = CM_ID_DAQ_SRV;
+         ind->p.msgid     = DAQ_DONE_IND;
+         ind->p.flags     = DAQ_NO_FLAGS;
+         ind->p.status    = DAQ_OK;
+         ind->b.opcode    = sim.opcode;
+         ind->b.stamp     = (uint32_t)(now / 1000);
+         ind->h.seqid     = sim.seqid++;
+         ind->h.dst_cmid  = CM_ID_BCAST;
+         ind->h.dst_devid = CM_DEV_WIN;
+         ind->h.src_cmid  = CM_ID_DAQ_SRV;
+         ind->h.src_devid = CM_DEV_C10;
+         ind->h.port      = CM_PORT_COM0;
+         sim_out((pcm_msg_t)ind, sizeof(daq_done_ind_msg_t));
+         sim.run = FALSE;
+         break;
+      }
+      // held to the ADC rate
+      if (cc.sim_pace != 0) {
+         due = ((now - sim.start_us) * (SIM_CLOCK_HZ / 1000000)) / sim.interval;
+         if (sim.sent + SIM_PIPE_MSGS > due) break;
+      }
+      // room for the transfer and any responses
+      if (!sim.lan && SIM_RX_LEN - (sim.rx_head - __atomic_load_n(&sim.rx_tail, __ATOMIC_ACQUIRE)) <
+          FIFO_PIPELEN_UINT8 + SIM_RX_RESERVE) break;
+      sim_pipe();
+      cnt++;
+   }
+
+   return (cnt != 0);
+
+} // end sim_stream()
+
+
+// ===========================================================================
+
+// 7.13
+
+static void sim_pipe(void) {
+
+/* 7.13.1   Functional Description
+
+   This routine will build and send one pipe transfer of SIM_PIPE_MSGS
+   DAQ messages, with the headers written by adc_ctl.vhd. The rate field
+   carries the simulated ADC rate, the FPGA leaves it 0.
+
+   7.13.2   Parameters:
+
+   NONE
+
+   7.13.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.13.4   Data Structures
+
+   uint32_t          i;
+   pcm_pipe_daq_t    msg;
+   cm_pipe_daq_t     tmp;
+
+// 7.13.5   Code
+
+   for (i=0;i<SIM_PIPE_MSGS;i++) {
+      msg = (pcm_pipe_daq_t)(sim.pipe + (i * sizeof(cm_pipe_daq_t)));
+      // injected loss, the message is never sent
+      if (cc.sim_loss != 0 && ((sim.pipe_seq + 1) % cc.sim_loss) == 0) {
+         sim.pipe_seq++;
+         sim.stamp += sim.interval;
+         sim.lost++;
+      }
+      msg->dst_cmid  = CM_ID_PIPE;
+      msg->msgid     = CM_PIPE_DAQ_DATA;
+      msg->port      = 0;
+      msg->flags     = 0;
+      msg->msglen    = sizeof(cm_pipe_daq_t) >> 2;
+      msg->seqid     = sim.pipe_seq++;
+      msg->stamp     = (sim.stamp += sim.interval);
+      msg->stamp_us  = 0;
+      msg->status    = 0;
+      msg->rate      = sim.interval / DAQ_MAX_SAM;
+      msg->magic     = SIM_PIPE_MAGIC;
+      sim_samples(msg->samples);
+   }
+
+   // injected reordering, swap a neighbouring pair
+   if (cc.sim_reorder != 0 && (sim.pipes % cc.sim_reorder) == cc.sim_reorder - 1) {
+      msg = (pcm_pipe_daq_t)sim.pipe;
+      memcpy(&tmp, &msg[0], sizeof(cm_pipe_daq_t));
+      memcpy(&msg[0], &msg[1], sizeof(cm_pipe_daq_t));
+      memcpy(&msg[1], &tmp, sizeof(cm_pipe_daq_t));
+      sim.swapped++;
+   }
+
+   if (sim.lan) sim_lan_out(sim.pipe, sizeof(cm_pipe_daq_t), SIM_PIPE_MSGS);
+   else sim_push(sim.pipe, FIFO_PIPELEN_UINT8);
+
+   sim.pipes++;
+   sim.sent += SIM_PIPE_MSGS;
+
+} // end sim_pipe()
+
+
+// ===========================================================================
+
+// 7.14
+
+static void sim_samples(uint16_t *sam) {
+
+/* 7.14.1   Functional Description
+
+   This routine will fill the samples of one pipe message. DAQ_CMD_RAMP
+   gives the 16-bit running count of adc_ctl.vhd, otherwise each channel
+   carries sim.wave at its own frequency, as 12-bit codes.
+
+   7.14.2   Parameters:
+
+   sam      DAQ_MAX_LEN samples, packed in channel order
+
+   7.14.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.14.4   Data Structures
+
+   uint32_t    j, m, idx;
+   int32_t     val;
+
+// 7.14.5   Code
+
+   if (sim.opcode & DAQ_CMD_RAMP) {
+      for (j=0;j<DAQ_MAX_LEN;j++) *sam++ = sim.ramp++;
+      return;
+   }
+
+   for (j=0;j<DAQ_MAX_SAM;j++,sim.phase++) {
+      for (m=0;m<DAQ_MAX_CH;m++) {
+         sim.noise = (sim.noise * 1664525) + 1013904223;
+         idx = (sim.phase * (m + 1)) & (SIM_SINE_LEN - 1);
+         switch (cc.sim_wave) {
+            case SIM_WAVE_SQUARE :
+               val = (idx < (SIM_SINE_LEN / 2)) ? 3600 : 500;
+               break;
+            case SIM_WAVE_NOISE :
+               val = sim.noise >> 20;
+               break;
+            default :
+               val = sim.sine[idx] + (int32_t)(sim.noise >> 28) - 8;
+               break;
+         }
+         *sam++ = (uint16_t)((val < 0) ? 0 : (val > 0x0FFF) ? 0x0FFF : val);
+      }
+   }
+
+} // end sim_samples()
+
+
+// ===========================================================================
+
+// 7.15
+
+static uint64_t sim_time(void) {
+
+/* 7.15.1   Functional Description
+
+   This routine will return the device time.
+
+   7.15.2   Parameters:
+
+   NONE
+
+   7.15.3   Return Values:
+
+   now      CLOCK_MONOTONIC in microseconds
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.15.4   Data Structures
+
+   struct timespec ts;
+
+// 7.15.5   Code
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+
+} // end sim_time()
+
+
+// ===========================================================================
+
+// 7.16
+
+uint32_t sim_lan_open(uint16_t port) {
+
+/* 7.16.1   Functional Description
+
+   This routine will power up the simulated device as a LAN device bound
+   to the loopback interface.
+
+   7.16.2   Parameters:
+
+   port     Device UDP port
+
+   7.16.3   Return Values:
+
+   result   UDP_OK
+            UDP_ERR_POOL, UDP_ERR_THREAD when the device doesn't start
+            UDP_ERR_SOCKET when the port can't be bound
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.16.4   Data Structures
+
+   struct sockaddr_in addr = {0};
+   struct timeval     tv;
+   int                opt;
+   uint32_t           i;
+
+// 7.16.5   Code
+
+   if (sim_open() != FIFO_OK) return UDP_ERR_THREAD;
+
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   addr.sin_port        = htons(port);
+
+   if ((sim.sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0 ||
+        bind(sim.sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+      if (gc.trace & LIN_TRACE_ERROR) {
+         printf("sim_lan_open() Error : port %d, %s\n", port, strerror(errno));
+      }
+      if (sim.sock >= 0) close(sim.sock);
+      sim.sock = -1;
+      sim_close();
+      return UDP_ERR_SOCKET;
+   }
+
+   // a whole burst of transfers in flight
+   opt = SIM_BURST * FIFO_PIPELEN_UINT8 * 2;
+   setsockopt(sim.sock, SOL_SOCKET, SO_SNDBUF, &opt, sizeof(opt));
+   // recv() timeout, bounds the thread cancellation latency
+   tv.tv_sec  = 0;
+   tv.tv_usec = UDP_RECV_TIMEOUT * 1000;
+   setsockopt(sim.sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+   // pad of every datagram to the host
+   sim.lan_pad[2] = 0xAA;
+   sim.lan_pad[3] = 0x55;
+
+   // request batch, pad to scratch and the frame to a request slot
+   memset(sim_msgs, 0, sizeof(sim_msgs));
+   for (i=0;i<SIM_REQ_QUE;i++) {
+      sim_iov[i][0].iov_base = sim_pad[i];
+      sim_iov[i][0].iov_len  = UDP_PAD_LEN;
+      sim_iov[i][1].iov_base = sim.lan_rx[i];
+      sim_iov[i][1].iov_len  = FIFO_MSGLEN_UINT8;
+      sim_msgs[i].msg_hdr.msg_iov    = sim_iov[i];
+      sim_msgs[i].msg_hdr.msg_iovlen = 2;
+   }
+
+   sim.lan = TRUE;
+
+   // Start the LAN Thread
+   if (pthread_create(&sim.lan_tid, NULL, sim_lan_thread, NULL)) {
+      sim.lan = FALSE;
+      close(sim.sock);
+      sim.sock = -1;
+      sim_close();
+      return UDP_ERR_THREAD;
+   }
+
+   if (gc.trace & LIN_TRACE_ID) {
+      printf("sim_lan_open() %s : 127.0.0.1:%d\n", SIM_DEV_STR, port);
+   }
+
+   return UDP_OK;
+
+} // end sim_lan_open()
+
+
+// ===========================================================================
+
+// 7.17
+
+static void *sim_lan_thread(void *data) {
+
+/* 7.17.1   Functional Description
+
+   This thread will take request datagrams from the host and queue them
+   with sim_write(). The host address is learned from each request.
+
+   7.17.2   Parameters:
+
+   data     Thread parameters
+
+   7.17.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.17.4   Data Structures
+
+   int32_t     cnt, i;
+
+// 7.17.5   Code
+
+   if (gc.trace & LIN_TRACE_ID) {
+      printf("sim_lan_thread() started, tid %lu\n", syscall(SYS_gettid));
+   }
+
+   pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+   while (1) {
+
+      // Prevent arbitrary cancellation point
+      pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+      pthread_testcancel();
+      pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+      for (i=0;i<SIM_REQ_QUE;i++) {
+         sim_msgs[i].msg_hdr.msg_name    = &sim.lan_from[i];
+         sim_msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+      }
+
+      cnt = recvmmsg(sim.sock, sim_msgs, SIM_REQ_QUE, MSG_WAITFORONE, NULL);
+      // timeout ?
+      if (cnt <= 0) continue;
+
+      for (i=0;i<cnt;i++) {
+         // control datagrams only
+         if (sim_msgs[i].msg_len != UDP_CTL_MSG_LEN) continue;
+         // reply to the latest requester
+         pthread_mutex_lock(&sim.mutex);
+         memcpy(&sim.peer, &sim.lan_from[i], sizeof(struct sockaddr_in));
+         pthread_mutex_unlock(&sim.mutex);
+         sim_write(sim.lan_rx[i], FIFO_MSGLEN_UINT8);
+      }
+   }
+
+   return (void *)0;
+
+} // end sim_lan_thread()
+
+
+// ===========================================================================
+
+// 7.18
+
+static void sim_lan_out(void *buf, uint32_t len, uint32_t cnt) {
+
+/* 7.18.1   Functional Description
+
+   This routine will send cnt consecutive messages of len bytes to the
+   host as datagrams with a single sendmmsg(), each behind the 6-byte pad.
+
+   7.18.2   Parameters:
+
+   buf      Messages
+   len      Message length in bytes
+   cnt      Message count, at most SIM_PIPE_MSGS
+
+   7.18.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.18.4   Data Structures
+
+   struct mmsghdr       msgs[SIM_PIPE_MSGS];
+   struct iovec         iov[SIM_PIPE_MSGS][2];
+   struct sockaddr_in   peer;
+   uint32_t             i;
+   int32_t              sent = 0, ret;
+
+// 7.18.5   Code
+
+   pthread_mutex_lock(&sim.mutex);
+   memcpy(&peer, &sim.peer, sizeof(peer));
+   pthread_mutex_unlock(&sim.mutex);
+
+   // no host yet
+   if (peer.sin_port == 0) return;
+
+   memset(msgs, 0, sizeof(msgs));
+   for (i=0;i<cnt;i++) {
+      iov[i][0].iov_base = sim.lan_pad;
+      iov[i][0].iov_len  = UDP_PAD_LEN;
+      iov[i][1].iov_base = (uint8_t *)buf + (i * len);
+      iov[i][1].iov_len  = len;
+      msgs[i].msg_hdr.msg_iov     = iov[i];
+      msgs[i].msg_hdr.msg_iovlen  = 2;
+      msgs[i].msg_hdr.msg_name    = &peer;
+      msgs[i].msg_hdr.msg_namelen = sizeof(peer);
+   }
+
+   // a short count leaves the rest to send
+   while (sent < (int32_t)cnt) {
+      ret = sendmmsg(sim.sock, &msgs[sent], cnt - sent, 0);
+      if (ret <= 0) {
+         sim.tx_err += cnt - sent;
+         if (sim.trace & LIN_TRACE_ERROR) {
+            printf("sim_lan_out() Error : sendmmsg() failed, %s\n", strerror(errno));
+         }
+         break;
+      }
+      sent += ret;
+   }
+
+} // end sim_lan_out()
+
+
+// ===========================================================================
+
+// 7.19
+
+static uint32_t sim_mem_stream(void) {
+
+/* 7.19.1   Functional Description
+
+   This routine will send the next transfers of a memory stream, staged as
+   cp_srv.c does, CP_STREAM_XFER packets to a transfer with the region
+   offset in each packet. The device memory repeats across the SDRAM span.
+
+   7.19.2   Parameters:
+
+   NONE
+
+   7.19.3   Return Values:
+
+   busy     TRUE when a transfer was sent
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.19.4   Data Structures
+
+   uint32_t          cnt = 0, i, j, offset, len;
+   pcp_stream_pipe_t pkt;
+
+// 7.19.5   Code
+
+   // bounded, so requests are served during a stream
+   while (cnt < SIM_BURST && sim.strm_seq < sim.strm_pkts) {
+      // room for the transfer and any responses
+      if (!sim.lan && SIM_RX_LEN - (sim.rx_head - __atomic_load_n(&sim.rx_tail, __ATOMIC_ACQUIRE)) <
+          FIFO_PIPELEN_UINT8 + SIM_RX_RESERVE) break;
+      for (i=0;i<CP_STREAM_XFER;i++) {
+         pkt    = (pcp_stream_pipe_t)(sim.pipe + (i * sizeof(cp_stream_pipe_t)));
+         offset = sim.strm_seq * CP_STREAM_DATA;
+         len    = 0;
+         if (offset < sim.strm_len) {
+            len = sim.strm_len - offset;
+            if (len > CP_STREAM_DATA) len = CP_STREAM_DATA;
+            for (j=0;j<len;j++) {
+               pkt->data[j] = sim.mem[(sim.strm_addr + offset + j) & (SIM_MEM_LEN - 1)];
+            }
+         }
+         else offset = sim.strm_len;
+         pkt->dst_cmid = CM_ID_PIPE;
+         pkt->msgid    = CM_PIPE_STREAM_DATA;
+         pkt->port     = 0;
+         pkt->flags    = 0;
+         pkt->msglen   = sizeof(cp_stream_pipe_t) >> 2;
+         pkt->seqid    = sim.strm_seq++;
+         pkt->offset   = offset;
+         pkt->stamp_us = 0;
+         pkt->tag      = sim.strm_tag;
+         pkt->length   = len;
+         pkt->magic    = CP_STREAM_MAGIC;
+      }
+      if (sim.lan) sim_lan_out(sim.pipe, sizeof(cp_stream_pipe_t), CP_STREAM_XFER);
+      else sim_push(sim.pipe, FIFO_PIPELEN_UINT8);
+      sim.pipes++;
+      cnt++;
+   }
+
+   if (sim.strm_seq >= sim.strm_pkts) sim.strm_run = FALSE;
+
+   return (cnt != 0);
+
+} // end sim_mem_stream()
+
+
+// ===========================================================================
+
+// 7.20
+
+static uint32_t sim_fw_open(void) {
+
+/* 7.20.1   Functional Description
+
+   This routine will start the host build of the firmware, sim.fw, on one
+   end of a socket pair and the thread reading its end. The firmware
+   console goes to stdout with LIN_TRACE_DRIVER, otherwise it is dropped,
+   its link report on stderr is kept.
+
+   7.20.2   Parameters:
+
+   NONE
+
+   7.20.3   Return Values:
+
+   result   FIFO_OK
+            FIFO_ERR_OPEN when the firmware doesn't start
+            FIFO_ERR_THREAD when the reader doesn't start
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.20.4   Data Structures
+
+   int         sv[2];
+   int         null;
+   char        fd_str[16];
+
+// 7.20.5   Code
+
+   if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) {
+      printf("sim_fw_open() Error : socketpair(), %s\n", strerror(errno));
+      return FIFO_ERR_OPEN;
+   }
+
+   sim.fw_pid = fork();
+   if (sim.fw_pid < 0) {
+      printf("sim_fw_open() Error : fork(), %s\n", strerror(errno));
+      close(sv[0]);
+      close(sv[1]);
+      return FIFO_ERR_OPEN;
+   }
+
+   // firmware, the link socket is kept across exec
+   if (sim.fw_pid == 0) {
+      null = open("/dev/null", O_RDWR);
+      dup2(null, STDIN_FILENO);
+      if (!(gc.trace & LIN_TRACE_DRIVER)) dup2(null, STDOUT_FILENO);
+      fcntl(sv[1], F_SETFD, 0);
+      snprintf(fd_str, sizeof(fd_str), "%d", sv[1]);
+      execl(cc.sim_fw, cc.sim_fw, "-s", fd_str, (char *)NULL);
+      fprintf(stderr, "sim_fw_open() Error : %s, %s\n", cc.sim_fw, strerror(errno));
+      _exit(127);
+   }
+
+   close(sv[1]);
+   sim.fw_sock = sv[0];
+
+   if (pthread_create(&sim.tid, NULL, sim_fw_thread, NULL)) {
+      close(sim.fw_sock);
+      sim.fw_sock = -1;
+      kill(sim.fw_pid, SIGTERM);
+      waitpid(sim.fw_pid, NULL, 0);
+      return FIFO_ERR_THREAD;
+   }
+
+   if (gc.trace & LIN_TRACE_ID) {
+      printf("sim_open() %s : firmware %s, pid %d\n", SIM_DEV_STR, cc.sim_fw, sim.fw_pid);
+   }
+
+   return FIFO_OK;
+
+} // end sim_fw_open()
+
+
+// ===========================================================================
+
+// 7.21
+
+static void *sim_fw_thread(void *data) {
+
+/* 7.21.1   Functional Description
+
+   This thread will push the bytes sent by the firmware into the device
+   stream as they arrive, as the FT245 hands them to the D2XX driver,
+   waiting for room when the reader falls behind.
+
+   7.21.2   Parameters:
+
+   data     Thread parameters
+
+   7.21.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.21.4   Data Structures
+
+   ssize_t           len;
+   struct timespec   ts;
+
+// 7.21.5   Code
+
+   if (gc.trace & LIN_TRACE_ID) {
+      printf("sim_fw_thread() started, tid %lu\n", syscall(SYS_gettid));
+   }
+
+   while ((len = recv(sim.fw_sock, sim.fw_rx, FIFO_PIPELEN_UINT8, 0)) > 0) {
+      while (sim_push(sim.fw_rx, (uint32_t)len) == FALSE && !sim.fw_stop) {
+         pthread_mutex_lock(&sim.mutex);
+         clock_gettime(CLOCK_REALTIME, &ts);
+         ts.tv_nsec += SIM_WAIT_US * 1000L;
+         if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+         }
+         pthread_cond_timedwait(&sim.cv, &sim.mutex, &ts);
+         pthread_mutex_unlock(&sim.mutex);
+      }
+      if (sim.fw_stop) break;
+      sim.sent += (uint32_t)len;
+   }
+
+   if (!sim.fw_stop) {
+      printf("sim_fw_thread() Error : firmware link closed\n");
+   }
+
+   return (void *)0;
+
+} // end sim_fw_thread()
+
@@ -0,0 +1,94 @@
+#pragma once
+
+// Simulated C10 Device, sim.enable
+#define  SIM_RX_LEN           (4 << 20)
+#define  SIM_RX_RESERVE       (64 * FIFO_MSGLEN_UINT8)
+#define  SIM_REQ_QUE          32
+#define  SIM_MEM_LEN          0x00010000
+#define  SIM_SDRAM_SPAN       0x00800000
+#define  SIM_SINE_LEN         4096
+#define  SIM_CLOCK_HZ         100000000
+#define  SIM_RATE_MIN         0x01F4
+#define  SIM_PIPE_MAGIC       0x123455AA
+#define  SIM_PIPE_MSGS        (FIFO_PIPELEN_UINT8 / sizeof(cm_pipe_daq_t))
+#define  SIM_WAIT_US          1000
+#define  SIM_BURST            32
+#define  SIM_SYSID            0x00C10514
+#define  SIM_DEV_STR          "C10 SIM"
+
+// Synthetic Waveforms, sim.wave
+#define  SIM_WAVE_SINE        0
+#define  SIM_WAVE_SQUARE      1
+#define  SIM_WAVE_NOISE       2
+
+// Pending Request
+typedef struct _sim_req_t {
+   uint8_t     frame[FIFO_MSGLEN_UINT8];
+   uint64_t    due_us;
+} sim_req_t, *psim_req_t;
+
+// Simulated Device
+typedef struct _sim_t {
+   uint8_t           *rx;
+   uint32_t           rx_head;
+   uint32_t           rx_tail;
+   pthread_mutex_t   *ev_mutex;
+   pthread_cond_t    *ev_cv;
+   pthread_t          tid;
+   pthread_mutex_t    mutex;
+   pthread_cond_t     cv;
+   sim_req_t          req[SIM_REQ_QUE];
+   uint32_t           req_head;
+   uint32_t           req_tail;
+   uint8_t            seqid;
+   uint8_t            connected;
+   uint32_t           trace;
+   uint32_t           debug;
+   uint32_t           run;
+   uint32_t           opcode;
+   uint32_t           packets;
+   uint32_t           sent;
+   uint32_t           pipe_seq;
+   uint32_t           stamp;
+   uint32_t           interval;
+   uint16_t           ramp;
+   uint32_t           phase;
+   uint32_t           noise;
+   uint64_t           start_us;
+   uint32_t           strm_run;
+   uint32_t           strm_tag;
+   uint32_t           strm_addr;
+   uint32_t           strm_len;
+   uint32_t           strm_pkts;
+   uint32_t           strm_seq;
+   uint8_t            pipe[FIFO_PIPELEN_UINT8];
+   uint8_t            mem[SIM_MEM_LEN];
+   uint16_t           sine[SIM_SINE_LEN];
+   uint32_t           reqs;
+   uint32_t           pipes;
+   uint32_t           lost;
+   uint32_t           swapped;
+   uint32_t           rx_full;
+   uint32_t           req_full;
+   uint32_t           lan;
+   int                sock;
+   pthread_t          lan_tid;
+   struct sockaddr_in peer;
+   struct sockaddr_in lan_from[SIM_REQ_QUE];
+   uint8_t            lan_rx[SIM_REQ_QUE][FIFO_MSGLEN_UINT8];
+   uint8_t            lan_pad[UDP_PAD_LEN];
+   uint32_t           tx_err;
+   int                fw_sock;
+   pid_t              fw_pid;
+   volatile uint32_t  fw_stop;
+   uint8_t            fw_tx[FIFO_MSGLEN_UINT8];
+   uint8_t            fw_rx[FIFO_PIPELEN_UINT8];
+} sim_t, *psim_t;
+
+uint32_t sim_open(void);
+void     sim_notify(pthread_mutex_t *mutex, pthread_cond_t *cv);
+uint32_t sim_queue(void);
+uint32_t sim_read(uint8_t *buf, uint32_t len);
+uint32_t sim_write(uint8_t *buf, uint32_t len);
+void     sim_close(void);
+uint32_t sim_lan_open(uint16_t port);
@@ -2,122 +2,349 @@
 #include <string.h>
 #include <sys/timerfd.h>
 #include <pthread.h>
+#include <sched.h>
 #include <poll.h>
 #include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "timer.h"
 
-#define MAX_TIMER_COUNT 10
+// Hierarchical timing wheel, one tick per mS. Level 0 holds the next
+// 256 ticks, each higher level 64 slots of the level below, timers are
+// cascaded down as level 0 wraps. One CLOCK_MONOTONIC timerfd is armed
+// for the next occupied level 0 slot or the next cascade.
+
+#define TIMER_TICK_NS      1000000
+#define TIMER_L0_BITS      8
+#define TIMER_LN_BITS      6
+#define TIMER_L0_SIZE      (1 << TIMER_L0_BITS)
+#define TIMER_LN_SIZE      (1 << TIMER_LN_BITS)
+#define TIMER_L0_MASK      (TIMER_L0_SIZE - 1)
+#define TIMER_LN_MASK      (TIMER_LN_SIZE - 1)
+#define TIMER_LEVELS       4
+#define TIMER_MAX_TICKS    ((1ULL << (TIMER_L0_BITS + (TIMER_LEVELS - 1) * TIMER_LN_BITS)) - 1)
+#define TIMER_POLL_MS      100
+#define TIMER_RT_PRIO      20
 
 struct timer_node {
-    int                 fd;
-    time_handler        callback;
-    void *              user_data;
-    unsigned int        interval;
-    t_timer             type;
-    struct timer_node * next;
+   struct timer_node  *next;
+   struct timer_node  *prev;
+   time_handler        callback;
+   void *              user_data;
+   unsigned int        interval;
+   t_timer             type;
+   uint64_t            due;
+   uint64_t            first_us;
+   uint64_t            last_us;
+   timer_stats_t       stats;
+};
+
+struct timer_list {
+   struct timer_node  *next;
+   struct timer_node  *prev;
 };
 
 static void *_timer_thread(void *data);
+static void  _timer_setup(void);
+static void  _timer_add(struct timer_node *tn);
+static void  _timer_unlink(struct timer_node *tn);
+static int   _timer_cascade(struct timer_list *tv, int index);
+static void  _timer_arm(void);
+static uint64_t _timer_now_ns(void);
+
+static pthread_t         g_thread_id;
+static pthread_mutex_t   g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t    g_once  = PTHREAD_ONCE_INIT;
+static int               g_fd = -1;
+static uint64_t          g_base_ns;
+static uint64_t          g_clk;
+static uint64_t          g_armed = UINT64_MAX;
+static unsigned int      g_count;
+
+static struct timer_list g_tv0[TIMER_L0_SIZE];
+static struct timer_list g_tvn[TIMER_LEVELS - 1][TIMER_LN_SIZE];
+static uint64_t          g_map0[TIMER_L0_SIZE / 64];
+
+static void _list_init(struct timer_list *l) {
+   l->next = (struct timer_node *)l;
+   l->prev = (struct timer_node *)l;
+}
+
+static void _list_add(struct timer_list *l, struct timer_node *tn) {
+   tn->next = (struct timer_node *)l;
+   tn->prev = l->prev;
+   l->prev->next = tn;
+   l->prev = tn;
+}
 
-static pthread_t g_thread_id;
-static struct timer_node *g_head = NULL;
+static int _list_empty(struct timer_list *l) {
+   return l->next == (struct timer_node *)l;
+}
+
+static void _timer_setup(void) {
+   int i, j;
+
+   for (i=0;i<TIMER_L0_SIZE;i++) _list_init(&g_tv0[i]);
+   for (i=0;i<TIMER_LEVELS-1;i++)
+      for (j=0;j<TIMER_LN_SIZE;j++) _list_init(&g_tvn[i][j]);
+
+   g_fd      = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+   g_base_ns = _timer_now_ns();
+   g_clk     = 0;
+}
 
 int timer_init() {
-   if (pthread_create(&g_thread_id, NULL, _timer_thread, NULL)) {
-      return 0;
+   pthread_attr_t attr;
+   struct sched_param sp;
+
+   pthread_once(&g_once, _timer_setup);
+   if (g_fd == -1) return 0;
+
+   // real-time when permitted, keeps the tick on time while the
+   // capture threads saturate a core
+   pthread_attr_init(&attr);
+   pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+   pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+   sp.sched_priority = TIMER_RT_PRIO;
+   pthread_attr_setschedparam(&attr, &sp);
+
+   if (pthread_create(&g_thread_id, &attr, _timer_thread, NULL)) {
+      pthread_attr_destroy(&attr);
+      // no privilege, ordinary thread
+      if (pthread_create(&g_thread_id, NULL, _timer_thread, NULL)) {
+         return 0;
+      }
+   }
+   else {
+      pthread_attr_destroy(&attr);
    }
+
    return 1;
 }
 
 size_t timer_start(unsigned int interval, time_handler handler, t_timer type, void *user_data) {
    struct timer_node *new_node = NULL;
-   struct itimerspec new_value;
+   uint64_t now;
 
-   new_node = (struct timer_node*)malloc(sizeof(struct timer_node));
+   pthread_once(&g_once, _timer_setup);
+   if (g_fd == -1) return 0;
+
+   new_node = (struct timer_node*)calloc(1, sizeof(struct timer_node));
 
    if (new_node == NULL) return 0;
 
    new_node->callback  = handler;
    new_node->user_data = user_data;
-   new_node->interval  = interval;
+   new_node->interval  = (interval == 0) ? 1 : interval;
    new_node->type      = type;
+   new_node->stats.interval_ms = new_node->interval;
+   new_node->stats.lat_min_us  = UINT32_MAX;
 
-   new_node->fd = timerfd_create(CLOCK_REALTIME, 0);
+   pthread_mutex_lock(&g_mutex);
 
-   if (new_node->fd == -1) {
-      free(new_node);
-      return 0;
-   }
+   // due a whole interval from now, on the tick grid
+   now = (_timer_now_ns() - g_base_ns) / TIMER_TICK_NS;
+   if (now < g_clk) now = g_clk;
+   new_node->due = now + new_node->interval;
+   _timer_add(new_node);
+   g_count++;
+   _timer_arm();
 
-   new_value.it_value.tv_sec = interval / 1000;
-   new_value.it_value.tv_nsec = (interval % 1000)* 1000000;
+   pthread_mutex_unlock(&g_mutex);
 
-   if (type == TIMER_PERIODIC) {
-      new_value.it_interval.tv_sec= interval / 1000;
-      new_value.it_interval.tv_nsec = (interval %1000) * 1000000;
-   }
-   else {
-      new_value.it_interval.tv_sec= 0;
-      new_value.it_interval.tv_nsec = 0;
-   }
+   return (size_t)new_node;
+}
 
-   timerfd_settime(new_node->fd, 0, &new_value, NULL);
+void timer_stop(size_t timer_id) {
+   struct timer_node * node = (struct timer_node *)timer_id;
 
-   /*Insert the timer node into the list*/
-   new_node->next = g_head;
-   g_head = new_node;
+   if (node == NULL) return;
 
-   return (size_t)new_node;
+   pthread_mutex_lock(&g_mutex);
+   _timer_unlink(node);
+   g_count--;
+   pthread_mutex_unlock(&g_mutex);
+
+   free(node);
 }
 
-void timer_stop(size_t timer_id) {
-   struct timer_node * tn = NULL;
+void timer_stats(size_t timer_id, ptimer_stats_t stats) {
    struct timer_node * node = (struct timer_node *)timer_id;
 
    if (node == NULL) return;
 
-   if (node == g_head) {
-      g_head = g_head->next;
-   }
-   else {
-      tn = g_head;
-      while(tn && tn->next != node) tn = tn->next;
-      if (tn) {
-          tn->next = tn->next->next;
-          close(node->fd);
-          free(node);
-      }
-   }
+   pthread_mutex_lock(&g_mutex);
+   memcpy(stats, &node->stats, sizeof(timer_stats_t));
+   if (stats->fires == 0) stats->lat_min_us = 0;
+   pthread_mutex_unlock(&g_mutex);
 }
 
 void timer_final() {
+   int i, j;
 
-   while(g_head) timer_stop((size_t)g_head);
    pthread_cancel(g_thread_id);
    pthread_join(g_thread_id, NULL);
 
+   // release what is left on the wheel
+   pthread_mutex_lock(&g_mutex);
+   for (i=0;i<TIMER_L0_SIZE;i++)
+      while (!_list_empty(&g_tv0[i])) {
+         struct timer_node *tn = g_tv0[i].next;
+         _timer_unlink(tn);
+         free(tn);
+      }
+   for (i=0;i<TIMER_LEVELS-1;i++)
+      for (j=0;j<TIMER_LN_SIZE;j++)
+         while (!_list_empty(&g_tvn[i][j])) {
+            struct timer_node *tn = g_tvn[i][j].next;
+            _timer_unlink(tn);
+            free(tn);
+         }
+   g_count = 0;
+   pthread_mutex_unlock(&g_mutex);
 }
 
-struct timer_node *_get_timer_from_fd(int fd) {
+static uint64_t _timer_now_ns(void) {
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
 
-   struct timer_node *tn = g_head;
+   return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
 
-   while (tn) {
-      if (tn->fd == fd) return tn;
-      tn = tn->next;
+// place the timer by how far away it is, g_mutex held
+static void _timer_add(struct timer_node *tn) {
+   uint64_t due = tn->due;
+   uint64_t idx;
+   int      slot;
+
+   // already due, next tick to run
+   if (due < g_clk) due = g_clk;
+   idx = due - g_clk;
+   if (idx > TIMER_MAX_TICKS) {
+      idx = TIMER_MAX_TICKS;
+      due = g_clk + idx;
    }
-   return NULL;
+
+   if (idx < TIMER_L0_SIZE) {
+      slot = due & TIMER_L0_MASK;
+      _list_add(&g_tv0[slot], tn);
+      g_map0[slot >> 6] |= 1ULL << (slot & 63);
+   }
+   else if (idx < 1ULL << (TIMER_L0_BITS + TIMER_LN_BITS)) {
+      _list_add(&g_tvn[0][(due >> TIMER_L0_BITS) & TIMER_LN_MASK], tn);
+   }
+   else if (idx < 1ULL << (TIMER_L0_BITS + 2 * TIMER_LN_BITS)) {
+      _list_add(&g_tvn[1][(due >> (TIMER_L0_BITS + TIMER_LN_BITS)) & TIMER_LN_MASK], tn);
+   }
+   else {
+      _list_add(&g_tvn[2][(due >> (TIMER_L0_BITS + 2 * TIMER_LN_BITS)) & TIMER_LN_MASK], tn);
+   }
+}
+
+// O(1) removal from whichever list holds the timer, g_mutex held
+static void _timer_unlink(struct timer_node *tn) {
+   int slot;
+
+   if (tn->next == NULL) return;
+
+   tn->prev->next = tn->next;
+   tn->next->prev = tn->prev;
+
+   // last timer of a level 0 slot
+   if (tn->next == tn->prev && tn->next >= (struct timer_node *)&g_tv0[0] &&
+       tn->next <  (struct timer_node *)&g_tv0[TIMER_L0_SIZE]) {
+      slot = (struct timer_list *)tn->next - g_tv0;
+      g_map0[slot >> 6] &= ~(1ULL << (slot & 63));
+   }
+
+   tn->next = NULL;
+   tn->prev = NULL;
+}
+
+// move one higher level slot down the wheel, g_mutex held
+static int _timer_cascade(struct timer_list *tv, int index) {
+   struct timer_list work;
+   struct timer_node *tn;
+
+   if (_list_empty(&tv[index])) return index;
+
+   // detach the slot, then re-add each timer
+   work.next = tv[index].next;
+   work.prev = tv[index].prev;
+   work.next->prev = (struct timer_node *)&work;
+   work.prev->next = (struct timer_node *)&work;
+   _list_init(&tv[index]);
+
+   while (!_list_empty(&work)) {
+      tn = work.next;
+      _timer_unlink(tn);
+      _timer_add(tn);
+   }
+
+   return index;
+}
+
+// arm the timerfd for the next occupied level 0 slot or cascade, g_mutex held
+static void _timer_arm(void) {
+   struct itimerspec new_value;
+   uint64_t next, ns;
+   int      slot, i, w, b;
+
+   // next cascade
+   next = (g_clk | TIMER_L0_MASK) + 1;
+
+   // next occupied level 0 slot, walking forward from g_clk
+   slot = g_clk & TIMER_L0_MASK;
+   for (i=0;i<=TIMER_L0_SIZE/64;i++) {
+      w = ((slot >> 6) + i) % (TIMER_L0_SIZE / 64);
+      uint64_t bits = g_map0[w];
+      // first word, only from slot on
+      if (i == 0) bits &= ~0ULL << (slot & 63);
+      // wrapped to the first word, only ahead of slot
+      else if (i == TIMER_L0_SIZE / 64) bits &= (slot & 63) ? ~(~0ULL << (slot & 63)) : 0;
+      if (bits) {
+         b = (w << 6) + __builtin_ctzll(bits);
+         uint64_t t = g_clk + ((b - slot) & TIMER_L0_MASK);
+         if (t < next) next = t;
+         break;
+      }
+   }
+
+   if (g_count == 0) next = g_clk + TIMER_L0_SIZE;
+
+   // already armed for this tick
+   if (next == g_armed) return;
+   g_armed = next;
+
+   ns = g_base_ns + next * TIMER_TICK_NS;
+   memset(&new_value, 0, sizeof(new_value));
+   new_value.it_value.tv_sec  = ns / 1000000000ULL;
+   new_value.it_value.tv_nsec = ns % 1000000000ULL;
+   timerfd_settime(g_fd, TFD_TIMER_ABSTIME, &new_value, NULL);
 }
 
 void *_timer_thread(void * data) {
 
-    struct pollfd ufds[MAX_TIMER_COUNT] = {{0}};
-    int max_count = 0;
-    struct timer_node *tn = NULL;
-    int read_fds = 0, i, s;
-    uint64_t exp;
+   struct pollfd ufd = {0};
+   struct timer_list work;
+   struct timer_node *tn;
+   time_handler callback;
+   void *user_data;
+   uint64_t exp, now, now_ns, fire_us, due_us, missed;
+   uint32_t lat;
+   int index, s;
+
+   pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+   ufd.fd     = g_fd;
+   ufd.events = POLLIN;
+
+   pthread_mutex_lock(&g_mutex);
+   g_armed = UINT64_MAX;
+   _timer_arm();
+   pthread_mutex_unlock(&g_mutex);
 
    while (1) {
 
@@ -126,30 +353,90 @@ void *_timer_thread(void * data) {
       pthread_testcancel();
       pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
 
-      max_count = 0;
-      tn = g_head;
+      if (poll(&ufd, 1, TIMER_POLL_MS) <= 0) continue;
 
-      memset(ufds, 0, sizeof(struct pollfd)*MAX_TIMER_COUNT);
+      s = read(g_fd, &exp, sizeof(uint64_t));
+      if (s != sizeof(uint64_t)) continue;
 
-      while (tn) {
-         ufds[max_count].fd = tn->fd;
-         ufds[max_count].events = POLLIN;
-         max_count++;
-         tn = tn->next;
-      }
+      pthread_mutex_lock(&g_mutex);
 
-      read_fds = poll(ufds, max_count, 100);
+      now_ns = _timer_now_ns();
+      now    = (now_ns - g_base_ns) / TIMER_TICK_NS;
 
-      if (read_fds <= 0) continue;
+      // every tick up to now, a late wake-up catches up in one pass
+      while (g_clk <= now) {
+         index = g_clk & TIMER_L0_MASK;
 
-      for (i=0;i<max_count;i++) {
-         if (ufds[i].revents & POLLIN) {
-            s = read(ufds[i].fd, &exp, sizeof(uint64_t));
-            if (s != sizeof(uint64_t)) continue;
-            tn = _get_timer_from_fd(ufds[i].fd);
-            if (tn && tn->callback) tn->callback((size_t)tn, tn->user_data);
+         // level 0 wrapped, cascade the higher levels
+         if (index == 0 &&
+             _timer_cascade(g_tvn[0], (g_clk >> TIMER_L0_BITS) & TIMER_LN_MASK) == 0 &&
+             _timer_cascade(g_tvn[1], (g_clk >> (TIMER_L0_BITS + TIMER_LN_BITS)) & TIMER_LN_MASK) == 0)
+            _timer_cascade(g_tvn[2], (g_clk >> (TIMER_L0_BITS + 2 * TIMER_LN_BITS)) & TIMER_LN_MASK);
+
+         // detach the expired slot
+         if (_list_empty(&g_tv0[index])) {
+            g_clk++;
+            continue;
+         }
+         work.next = g_tv0[index].next;
+         work.prev = g_tv0[index].prev;
+         work.next->prev = (struct timer_node *)&work;
+         work.prev->next = (struct timer_node *)&work;
+         _list_init(&g_tv0[index]);
+         g_map0[index >> 6] &= ~(1ULL << (index & 63));
+         g_clk++;
+
+         while (!_list_empty(&work)) {
+            tn = work.next;
+            _timer_unlink(tn);
+
+            // latency behind the due time
+            fire_us = (now_ns - g_base_ns) / 1000;
+            due_us  = tn->due * (TIMER_TICK_NS / 1000);
+            lat     = (fire_us > due_us) ? (uint32_t)(fire_us - due_us) : 0;
+            tn->stats.fires++;
+            tn->stats.lat_last_us = lat;
+            tn->stats.lat_sum_us += lat;
+            if (lat > tn->stats.lat_max_us) tn->stats.lat_max_us = lat;
+            if (lat < tn->stats.lat_min_us) tn->stats.lat_min_us = lat;
+            tn->stats.lat_mean_us = (uint32_t)(tn->stats.lat_sum_us / tn->stats.fires);
+
+            // drift, mean period against the interval
+            if (tn->first_us == 0) tn->first_us = fire_us;
+            tn->last_us = fire_us;
+
+            callback  = tn->callback;
+            user_data = tn->user_data;
+
+            if (tn->type == TIMER_PERIODIC) {
+               // next due on the original grid, missed periods
+               // coalesce into this one callback
+               tn->due += tn->interval;
+               if (tn->due <= now) {
+                  missed = (now - tn->due) / tn->interval + 1;
+                  tn->due += missed * tn->interval;
+                  tn->stats.overruns += missed;
+               }
+               if (tn->stats.fires > 1) {
+                  tn->stats.drift_us = (int32_t)((int64_t)(tn->last_us - tn->first_us) /
+                        (int64_t)(tn->stats.fires - 1 + tn->stats.overruns) -
+                        (int64_t)tn->interval * 1000);
+               }
+               _timer_add(tn);
+            }
+
+            // callbacks may start and stop timers, or stop this one
+            pthread_mutex_unlock(&g_mutex);
+            if (callback) callback((size_t)tn, user_data);
+            pthread_mutex_lock(&g_mutex);
          }
       }
+
+      // single-shot timers stay off the wheel until stopped
+      g_armed = UINT64_MAX;
+      _timer_arm();
+
+      pthread_mutex_unlock(&g_mutex);
    }
 
    return NULL;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdlib.h>
+#include <stdint.h>
 
 typedef enum {
    TIMER_SINGLE_SHOT = 0,
@@ -9,7 +10,22 @@ typedef enum {
 
 typedef void (*time_handler)(size_t timer_id, void * user_data);
 
+// Per Timer Statistics, latency behind the due time and
+// drift of the mean period from the interval
+typedef struct _timer_stats_t {
+   uint32_t    interval_ms;
+   uint32_t    fires;
+   uint32_t    overruns;
+   uint32_t    lat_last_us;
+   uint32_t    lat_min_us;
+   uint32_t    lat_max_us;
+   uint32_t    lat_mean_us;
+   int32_t     drift_us;
+   uint64_t    lat_sum_us;
+} timer_stats_t, *ptimer_stats_t;
+
 int    timer_init(void);
 size_t timer_start(unsigned int interval, time_handler handler, t_timer type, void *user_data);
 void   timer_stop(size_t timer_id);
+void   timer_stats(size_t timer_id, ptimer_stats_t stats);
 void   timer_final();
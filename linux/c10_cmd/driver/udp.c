@@ -0,0 +1,933 @@
+/*-----------------------------------------------------------------------------
+
+   1  ABSTRACT
+
+   1.1 Module Type
+
+      UDP LAN Interface
+
+   1.2 Functional Description
+
+      This module provides the CM_MEDIA_LAN transport to the C10 over UDP,
+      the Linux counterpart of win/jack/udpapi/udp.cpp. Control messages
+      are 518-byte datagrams and DAQ pipe messages are 1030-byte datagrams,
+      both carry a 6-byte reserved pad ahead of the CM message.
+
+   1.3 Specification/Design Reference
+
+      UDPAPI_DLL.docx
+
+   1.4 Module Test Specification Reference
+
+      None
+
+   1.5 Compilation Information
+
+      See fw_cfg.h under the share directory.
+
+   1.6 Notes
+
+      Selected with opc.media = 1, the device is opc.ip_addr at port
+      opc.cm_udp_port. With sim.enable = 1 the simulated device of sim.c
+      is started on the loopback interface and stands in for the board.
+
+      Datagrams are taken with recvmmsg(), up to a full pipe ring block per
+      call. The 6-byte pad of each datagram is scattered into a scratch
+      buffer and the 1K body straight into the next slot of the pipe ring,
+      so pipe messages are never copied. A control datagram in the batch is
+      handed to CM and compacted out of the ring, as fifo_thread does.
+      The pipe ring itself is the fifo_ring of fifo.c, shared by both
+      drivers.
+
+      The socket receive buffer is set to UDP_SOCK_BUF, the kernel clamps
+      it to net.core.rmem_max. Datagrams the kernel drops on a full
+      receive queue are counted through SO_RXQ_OVFL.
+
+   2  CONTENTS
+
+      1 ABSTRACT
+        1.1 Module Type
+        1.2 Functional Description
+        1.3 Specification/Design Reference
+        1.4 Module Test Specification Reference
+        1.5 Compilation Information
+        1.6 Notes
+
+      2 CONTENTS
+
+      3 VOCABULARY
+
+      4 EXTERNAL RESOURCES
+        4.1  Include Files
+        4.2  External Data Structures
+        4.3  External Function Prototypes
+
+      5 LOCAL CONSTANTS AND MACROS
+
+      6 MODULE DATA STRUCTURES
+        6.1  Local Function Prototypes
+        6.2  Local Data Structures
+
+      7 MODULE CODE
+         7.1   udp_init()
+         7.2   udp_thread()
+         7.3   udp_tx()
+         7.4   udp_cmio()
+         7.5   udp_head()
+         7.6   udp_final()
+         7.7   udp_rxmsg()
+         7.8   udp_block()
+         7.9   udp_ring_next()
+         7.10  udp_pipe_free()
+         7.11  udp_stats()
+         7.12  udp_dgram_stats()
+         7.13  udp_ovfl()
+
+-----------------------------------------------------------------------------*/
+
+// 3 VOCABULARY
+
+// 4 EXTERNAL RESOURCES
+
+// 4.1  Include Files
+
+#define _GNU_SOURCE
+#include "main.h"
+
+// 4.2   External Data Structures
+
+// 4.3   External Function Prototypes
+
+// 5 LOCAL CONSTANTS AND MACROS
+
+   #define UDP_CTL_SPACE      CMSG_SPACE(sizeof(uint32_t))
+
+// 6 MODULE DATA STRUCTURES
+
+// 6.1  Local Function Prototypes
+
+   static   void *udp_thread(void *data);
+   static   void  udp_rxmsg(uint8_t *body);
+   static   void  udp_block(void);
+   static   void  udp_ring_next(void);
+   static   void  udp_ovfl(struct msghdr *hdr);
+
+// 6.2  Local Data Structures
+
+   static   uint8_t           m_cm_port  = CM_PORT_NONE;
+   static   uint8_t           m_sim      = FALSE;
+
+   static   int               m_sock = -1;
+   static   struct sockaddr_in m_dst = {0};
+
+   static   pthread_t         m_thread_id;
+   static   fifo_ring_t       m_ring = {0};
+   static   uint8_t          *m_nxt_pipe = NULL;
+   static   uint8_t          *m_blk_pipe = NULL;
+   static   udp_stats_t       m_udp = {0};
+
+   static   struct mmsghdr    m_rx_msgs[UDP_BATCH];
+   static   struct iovec      m_rx_iov[UDP_BATCH][2];
+   static   uint8_t           m_rx_pad[UDP_BATCH][UDP_PAD_LEN];
+   static   uint8_t           m_rx_ctl[UDP_BATCH][UDP_CTL_SPACE];
+
+   static   uint8_t           m_txbuf[UDP_CTL_MSG_LEN] = {0};
+   static   uint8_t           m_rxbuf[UDP_PIPE_MSG_LEN] = {0};
+   static   uint8_t           m_tx_pad[UDP_PAD_LEN] = {0x00, 0x00, 0xAA, 0x55, 0x00, 0x00};
+   static   uint8_t           m_zero[UDP_MSGLEN_UINT8] = {0};
+
+   static   uint32_t          m_sysid, m_stamp, m_cmdat;
+   static   uint8_t           m_devid, m_numobjs, m_numcons;
+
+   static   uint8_t           m_query[] = {0x83, 0x83, 0x10, 0x10, 0x00, 0x00,
+                                           0x0C, 0x20, 0x83, 0x09, 0x00, 0x00};
+
+// 7 MODULE CODE
+
+// ===========================================================================
+
+// 7.1
+
+uint32_t udp_init(uint8_t cm_port, uint32_t ip_addr, uint16_t udp_port) {
+
+/* 7.1.1   Functional Description
+
+   This routine will open the UDP socket to the device, validate the
+   connection with CM_QUERY_REQ and start the receive thread.
+
+   NOTE: Only a single device is currently supported.
+
+   7.1.2   Parameters:
+
+   cm_port     CM Port Identifier
+   ip_addr     Device IPv4 address, host order
+   udp_port    Device UDP port
+
+   7.1.3   Return Values:
+
+   result   LIN_ERROR_OK, LIN_ERROR_UDP
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.1.4   Data Structures
+
+   uint32_t       result = UDP_OK;
+   uint8_t        retry = 0;
+   int32_t        rxbytes, txbytes;
+   int            opt;
+   socklen_t      optlen = sizeof(opt);
+   uint32_t       i;
+   struct timeval tv;
+
+// 7.1.5   Code
+
+   // close the socket if opened
+   if (m_sock >= 0) close(m_sock);
+   m_sock = -1;
+
+   //
+   // Simulated device on the loopback interface
+   //
+   m_sim = (cc.sim_enable == 1);
+   if (m_sim) {
+      result  = sim_lan_open(udp_port);
+      ip_addr = INADDR_LOOPBACK;
+   }
+
+   // setup remote socket address
+   memset((char *)&m_dst, 0, sizeof(m_dst));
+   m_dst.sin_family      = AF_INET;
+   m_dst.sin_addr.s_addr = htonl(ip_addr);
+   m_dst.sin_port        = htons(udp_port);
+
+   // create socket, client side
+   if (result == UDP_OK) {
+      if ((m_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+         result |= UDP_ERR_SOCKET;
+      }
+      else {
+         // large receive buffer, rides out scheduling stalls at line rate
+         opt = UDP_SOCK_BUF;
+         if (setsockopt(m_sock, SOL_SOCKET, SO_RCVBUFFORCE, &opt, sizeof(opt)) != 0)
+            setsockopt(m_sock, SOL_SOCKET, SO_RCVBUF, &opt, sizeof(opt));
+         // report kernel drops on a full receive queue
+         opt = 1;
+         setsockopt(m_sock, SOL_SOCKET, SO_RXQ_OVFL, &opt, sizeof(opt));
+         // recv() timeout, bounds the thread cancellation latency
+         tv.tv_sec  = 0;
+         tv.tv_usec = UDP_RECV_TIMEOUT * 1000;
+         setsockopt(m_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+         // only datagrams from the device are received
+         if (connect(m_sock, (struct sockaddr *)&m_dst, sizeof(m_dst)) != 0) {
+            result |= UDP_ERR_OPEN;
+         }
+         // the kernel clamps the buffer to net.core.rmem_max
+         getsockopt(m_sock, SOL_SOCKET, SO_RCVBUF, &opt, &optlen);
+         if ((gc.trace & LIN_TRACE_ERROR) && (opt >> 1) < UDP_SOCK_BUF) {
+            printf("udp_init() Warning : receive buffer %d bytes, raise net.core.rmem_max\n", opt >> 1);
+         }
+      }
+   }
+
+   // OK TO GO
+   if (result == UDP_OK) {
+
+      // Clear the TX & RX buffers
+      memset(m_txbuf, 0, sizeof(m_txbuf));
+      memset(m_rxbuf, 0, sizeof(m_rxbuf));
+
+      // Issue CM_QUERY_REQ multiple tries
+      while (retry < UDP_RETRIES) {
+
+         result |= UDP_ERR_RESP;
+
+         // Send CM_QUERY_REQ to validate connection
+         memcpy(m_txbuf, m_tx_pad, UDP_PAD_LEN);
+         memcpy(&m_txbuf[UDP_PAD_LEN], m_query, sizeof(m_query));
+         txbytes = send(m_sock, m_txbuf, UDP_CTL_MSG_LEN, 0);
+
+         // report message content
+         if (gc.trace & LIN_TRACE_LAN) {
+            printf("udp_init() tx msglen = %d\n", (int)sizeof(m_query));
+            dump((uint8_t *)m_query, sizeof(m_query), 0, 0);
+         }
+
+         // If sent OK then check response
+         if (txbytes == UDP_CTL_MSG_LEN) {
+            // Allow time for Response
+            usleep(UDP_RESP_WAIT*1000);
+            // Read the Port
+            rxbytes = recv(m_sock, m_rxbuf, sizeof(m_rxbuf), 0);
+            // report message content
+            if (gc.trace & LIN_TRACE_LAN) {
+               printf("udp_init() rx msglen = %d\n", rxbytes);
+               if (rxbytes > 0) dump((uint8_t *)m_rxbuf, 34, 0, 0);
+            }
+            // Check Response
+            if (rxbytes == UDP_CTL_MSG_LEN) {
+               // Verify Magic Number
+               if (m_rxbuf[18] == 0x34 && m_rxbuf[19] == 0x12 &&
+                   m_rxbuf[20] == 0xAA && m_rxbuf[21] == 0x55) {
+                  // Record SysID
+                  m_sysid = (m_rxbuf[25] << 24) | (m_rxbuf[24] << 16) |
+                            (m_rxbuf[23] << 8)  | m_rxbuf[22];
+                  // Record Timestamp
+                  m_stamp = (m_rxbuf[29] << 24) | (m_rxbuf[28] << 16) |
+                            (m_rxbuf[27] << 8)  | m_rxbuf[26];
+                  // Record Device ID, etc.
+                  m_devid   = m_rxbuf[30];
+                  m_numobjs = m_rxbuf[31];
+                  m_numcons = m_rxbuf[32];
+                  m_cmdat   = (m_devid << 24) | (m_numobjs << 16) | (m_numcons << 8);
+                  result    = UDP_OK;
+                  break;
+               }
+            }
+         }
+         retry++;
+      }
+   }
+
+   // OK to Continue
+   if (result == UDP_OK) {
+
+      // Update CM Port
+      m_cm_port = cm_port;
+
+      // Register the I/O Interface callback for CM
+      cm_ioreg(udp_cmio, m_cm_port, m_sim ? CM_MEDIA_SIM : CM_MEDIA_LAN);
+
+      // Pipe blocks are returned here
+      cm_pipe_src(udp_pipe_free);
+
+      // Allocate Pipe Message Pool, plus the overrun spill block
+      if (fifo_ring_open(&m_ring) != FIFO_OK) result = UDP_ERR_POOL;
+
+      // Receive batch, pad to scratch and body to the pipe ring
+      memset(m_rx_msgs, 0, sizeof(m_rx_msgs));
+      for (i=0;i<UDP_BATCH;i++) {
+         m_rx_iov[i][0].iov_base = m_rx_pad[i];
+         m_rx_iov[i][0].iov_len  = UDP_PAD_LEN;
+         m_rx_iov[i][1].iov_len  = sizeof(cm_pipe_daq_t);
+         m_rx_msgs[i].msg_hdr.msg_iov    = m_rx_iov[i];
+         m_rx_msgs[i].msg_hdr.msg_iovlen = 2;
+      }
+
+      // Start the Receive Thread
+      if (result == UDP_OK && pthread_create(&m_thread_id, NULL, udp_thread, NULL)) {
+         result = UDP_ERR_THREAD;
+      }
+
+      // Print Device Identity
+      if (gc.trace & LIN_TRACE_ID) {
+         printf("Opened UDP %s:%d (%s) for Messaging\n", inet_ntoa(m_dst.sin_addr),
+               udp_port, m_sim ? SIM_DEV_STR : "LAN");
+         printf("UDP : receive buffer %d bytes, batch %d\n", opt >> 1, (int)UDP_BATCH);
+         printf("UDP : sysid:stamp:cm = %d:%d:%08X\n\n", m_sysid, m_stamp, m_cmdat);
+      }
+   }
+   // close the port
+   else if (m_sock >= 0) {
+      close(m_sock);
+      m_sock = -1;
+   }
+
+   if ((gc.trace & LIN_TRACE_ERROR) && result != UDP_OK) {
+      printf("udp_init() Error : %08X\n", result);
+   }
+
+   return (result == UDP_OK) ? LIN_ERROR_OK : LIN_ERROR_UDP;
+
+}  // end udp_init()
+
+
+// ===========================================================================
+
+// 7.2
+
+static void *udp_thread(void *data) {
+
+
+/* 7.2.1   Functional Description
+
+   This thread will service the incoming datagrams.
+
+   Each recvmmsg() is offered one 1K ring slot per datagram up to the end
+   of the current block, and returns once at least one has arrived. Pipe
+   messages stay where they landed, control messages are handed to CM and
+   later pipe messages of the batch are moved down over them.
+
+   The pipe ring is handled exactly as in fifo_thread(), blocks are
+   published by advancing head and this thread never waits on the consumer.
+
+   7.2.2   Parameters:
+
+   data     Thread parameters
+
+   7.2.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.2.4   Data Structures
+
+   int32_t     cnt, i;
+   uint32_t    room, len;
+   uint8_t    *slot, *keep;
+
+   struct timespec ts;
+   uint32_t    now_us;
+
+   pcm_pipe_daq_t  pipe;
+
+// 7.2.5   Code
+
+   if (gc.trace & LIN_TRACE_ID) {
+      printf("udp_thread() started, tid %lu\n", syscall(SYS_gettid));
+   }
+
+   pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+   // beginning of PIPE message circular buffer
+   fifo_ring_reset(&m_ring);
+   udp_ring_next();
+
+   while (1) {
+
+      // Prevent arbitrary cancellation point
+      pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+      pthread_testcancel();
+      pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+      // one slot per datagram, up to the end of this block
+      room = (FIFO_BLOCK_LEN - (uint32_t)(m_nxt_pipe - m_blk_pipe)) / sizeof(cm_pipe_daq_t);
+      for (i=0;i<(int32_t)room;i++) {
+         m_rx_iov[i][1].iov_base = m_nxt_pipe + (i * sizeof(cm_pipe_daq_t));
+         m_rx_msgs[i].msg_hdr.msg_control    = m_rx_ctl[i];
+         m_rx_msgs[i].msg_hdr.msg_controllen = UDP_CTL_SPACE;
+         m_rx_msgs[i].msg_hdr.msg_flags      = 0;
+      }
+
+      // wait for the first datagram, then take what is queued
+      cnt = recvmmsg(m_sock, m_rx_msgs, room, MSG_WAITFORONE, NULL);
+      // timeout ?
+      if (cnt <= 0) continue;
+
+      // packet arrival
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      now_us = (uint32_t)((ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000));
+
+      m_udp.batches++;
+      m_udp.datagrams += cnt;
+      keep = m_nxt_pipe;
+
+      for (i=0;i<cnt;i++) {
+         slot = m_rx_iov[i][1].iov_base;
+         len  = m_rx_msgs[i].msg_len;
+         udp_ovfl(&m_rx_msgs[i].msg_hdr);
+         // longer than a pipe message
+         if (m_rx_msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            m_udp.truncated++;
+         }
+         //
+         //  PIPE MESSAGE, ADC HARDWARE SPECIFIC
+         //
+         else if (len == UDP_PIPE_MSG_LEN && slot[0] == CM_ID_PIPE) {
+            // close the gap left by a control message
+            if (keep != slot) memmove(keep, slot, sizeof(cm_pipe_daq_t));
+            pipe = (pcm_pipe_daq_t)keep;
+            pipe->stamp_us = now_us;
+            keep += sizeof(cm_pipe_daq_t);
+            m_udp.pipe++;
+         }
+         //
+         //  CONTROL MESSAGE
+         //
+         else if (len == UDP_CTL_MSG_LEN) {
+            m_udp.ctl++;
+            udp_rxmsg(slot);
+         }
+         else {
+            m_udp.bad_len++;
+            if (gc.trace & LIN_TRACE_ERROR) {
+               printf("udp_thread() Error : datagram length %d\n", len);
+            }
+         }
+      }
+      m_nxt_pipe = keep;
+
+      // last message in block?
+      if (m_nxt_pipe - m_blk_pipe == FIFO_BLOCK_LEN) udp_block();
+   }
+
+   return 0;
+
+} // end udp_thread()
+
+
+// ===========================================================================
+
+// 7.3
+
+void udp_tx(pcm_msg_t msg) {
+
+/* 7.3.1   Functional Description
+
+   This routine will transmit the message as one control datagram. The
+   pad, message and zero fill are gathered by sendmsg(), a datagram is
+   sent whole so no lock is needed between threads.
+
+   7.3.2   Parameters:
+
+   msg     CM message to send.
+
+   7.3.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.3.4   Data Structures
+
+   uint16_t       msglen = msg->h.msglen;
+   struct iovec   iov[3];
+   struct msghdr  hdr = {0};
+
+// 7.3.5   Code
+
+   // Trace Entry
+   if (gc.trace & LIN_TRACE_LAN) {
+      printf("udp_tx() srvid:msgid:msglen = %02X:%02X:%04X\n",
+               msg->p.srvid, msg->p.msgid, msg->h.msglen);
+      dump((uint8_t *)msg, msg->h.msglen, LIB_ASCII, 0);
+   }
+
+   if (msglen > UDP_MSGLEN_UINT8) msglen = UDP_MSGLEN_UINT8;
+
+   // 6-byte pad, CM message, zero padding
+   iov[0].iov_base = m_tx_pad;
+   iov[0].iov_len  = UDP_PAD_LEN;
+   iov[1].iov_base = msg;
+   iov[1].iov_len  = msglen;
+   iov[2].iov_base = m_zero;
+   iov[2].iov_len  = UDP_MSGLEN_UINT8 - msglen;
+   hdr.msg_iov     = iov;
+   hdr.msg_iovlen  = 3;
+
+   // send the packet
+   if (sendmsg(m_sock, &hdr, 0) != UDP_CTL_MSG_LEN) {
+      __atomic_add_fetch(&m_udp.tx_err, 1, __ATOMIC_RELAXED);
+      if (gc.trace & LIN_TRACE_ERROR) {
+         printf("udp_tx() Error : sendmsg() failed, %s\n", strerror(errno));
+      }
+   }
+
+   // release message
+   cm_free(msg);
+
+} // end udp_tx()
+
+
+// ===========================================================================
+
+// 7.4
+
+void udp_cmio(uint8_t op_code, pcm_msg_t msg) {
+
+/* 7.4.1   Functional Description
+
+   OPCODES
+
+   CM_IO_TX : Transmit the message.
+
+   7.4.2   Parameters:
+
+   msg     Message Pointer
+   opCode  CM_IO_TX
+
+   7.4.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.4.4   Data Structures
+
+// 7.4.5   Code
+
+   if (gc.trace & LIN_TRACE_LAN) {
+      printf("udp_cmio() op_code = %02X\n", op_code);
+   }
+
+   // transmit message
+   udp_tx(msg);
+
+} // end udp_cmio()
+
+
+// ===========================================================================
+
+// 7.5
+
+void udp_head(void) {
+
+/* 7.5.1   Functional Description
+
+   This routine will advance the ring tail over every block that has no
+   references left, see fifo_ring_head().
+
+   7.5.2   Parameters:
+
+   NONE
+
+   7.5.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.5.4   Data Structures
+
+// 7.5.5   Code
+
+   fifo_ring_head(&m_ring);
+
+} // end udp_head()
+
+
+// ===========================================================================
+
+// 7.6
+
+void udp_final(void) {
+
+/* 7.6.1   Functional Description
+
+   This routine will clean-up any allocated resources.
+
+   7.6.2   Parameters:
+
+   NONE
+
+   7.6.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.6.4   Data Structures
+
+// 7.6.5   Code
+
+   if (m_sock < 0) return;
+
+   // Cancel Thread
+   pthread_cancel(m_thread_id);
+   pthread_join(m_thread_id, NULL);
+
+   // close socket
+   close(m_sock);
+   m_sock = -1;
+
+   // Stop the simulated device
+   if (m_sim) sim_close();
+
+   // Report Pipe Ring Overruns and Lost Datagrams
+   if (m_ring.overruns != 0) {
+      printf("udp_final() Warning : pipe ring overrun, %d blocks, %d bytes dropped\n",
+            m_ring.overruns, m_ring.dropped);
+   }
+   if (m_udp.sock_drops != 0 || m_udp.truncated != 0 || m_udp.bad_len != 0) {
+      printf("udp_final() Warning : %d datagrams dropped by the socket, %d truncated, %d bad length\n",
+            m_udp.sock_drops, m_udp.truncated, m_udp.bad_len);
+   }
+   if (gc.trace & LIN_TRACE_LAN) {
+      printf("udp_final() datagrams %d in %d batches, ctl %d, pipe %d, tx_err %d\n",
+            m_udp.datagrams, m_udp.batches, m_udp.ctl, m_udp.pipe, m_udp.tx_err);
+   }
+
+   // Release Memory
+   fifo_ring_close(&m_ring);
+
+} // end udp_final()
+
+
+// ===========================================================================
+
+// 7.7
+
+static void udp_rxmsg(uint8_t *body) {
+
+/* 7.7.1   Functional Description
+
+   This routine will copy a received control message into a CM queue slot
+   and queue it for delivery. The message is left in the pipe ring and is
+   overwritten by the caller.
+
+   7.7.2   Parameters:
+
+   body     Control datagram body, pad removed
+
+   7.7.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.7.4   Data Structures
+
+   uint32_t    j;
+   uint8_t     slotid;
+   uint16_t    msglen;
+   uint32_t   *buf = (uint32_t *)body;
+   pcmq_t      slot;
+   pcm_msg_t   msg = (pcm_msg_t)body;
+
+// 7.7.5   Code
+
+   msglen = msg->h.msglen;
+   // validate CM message length
+   if ((msglen <= UDP_MSGLEN_UINT8) && (msglen >= sizeof(cm_msg_t))) {
+      slot = cm_alloc();
+      if (slot != NULL) {
+         msg = (pcm_msg_t)slot->buf;
+         // preserve slotid
+         slotid = msg->h.slot;
+         // uint32_t boundary, copy multiple of 32-bits
+         // always read CM header + parms in order
+         // to determine message length
+         for (j=0;j<sizeof(cm_msg_t) >> 2;j++) {
+            slot->buf[j] = buf[j];
+         }
+         slot->msglen = msg->h.msglen;
+         // read rest of CM message body, uint32_t per cycle
+         if (slot->msglen > sizeof(cm_msg_t) && (slot->msglen <= UDP_MSGLEN_UINT8)) {
+            for (j=0;j<(slot->msglen + 3 - sizeof(cm_msg_t)) >> 2;j++) {
+               slot->buf[j + (sizeof(cm_msg_t) >> 2)] =
+                     buf[j + (sizeof(cm_msg_t) >> 2)];
+            }
+         }
+         // restore slotid
+         msg->h.slot = slotid;
+         // report message content
+         if (gc.trace & LIN_TRACE_LAN) {
+            printf("udp_rxmsg() msglen = %d\n", msg->h.msglen);
+            dump((uint8_t *)slot->buf, slot->msglen, LIB_ASCII, 0);
+         }
+         // queue the message
+         cm_qmsg((pcm_msg_t)slot->buf);
+      }
+   }
+
+} // end udp_rxmsg()
+
+
+// ===========================================================================
+
+// 7.8
+
+static void udp_block(void) {
+
+/* 7.8.1   Functional Description
+
+   This routine will publish the completed block to the pipe subscribers,
+   or drop it when it was received into the spill block, see
+   fifo_ring_block().
+
+   7.8.2   Parameters:
+
+   NONE
+
+   7.8.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.8.4   Data Structures
+
+// 7.8.5   Code
+
+   fifo_ring_block(&m_ring, m_blk_pipe);
+
+   // next slot in circular buffer
+   udp_ring_next();
+
+} // end udp_block()
+
+
+// ===========================================================================
+
+// 7.9
+
+static void udp_ring_next(void) {
+
+/* 7.9.1   Functional Description
+
+   This routine will select the block for the next datagrams, see
+   fifo_ring_next().
+
+   7.9.2   Parameters:
+
+   NONE
+
+   7.9.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.9.4   Data Structures
+
+// 7.9.5   Code
+
+   m_blk_pipe = fifo_ring_next(&m_ring);
+   m_nxt_pipe = m_blk_pipe;
+
+} // end udp_ring_next()
+
+
+// ===========================================================================
+
+// 7.10
+
+void udp_pipe_free(pcm_pipe_t pipe) {
+
+/* 7.10.1   Functional Description
+
+   This routine will drop one reference on a pipe block, see
+   fifo_ring_free(). It is the pipe source release routine for the LAN.
+
+   7.10.2   Parameters:
+
+   pipe     Pipe block received from cm_pipe_get()
+
+   7.10.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.10.4   Data Structures
+
+// 7.10.5   Code
+
+   fifo_ring_free(&m_ring, pipe);
+
+} // end udp_pipe_free()
+
+
+// ===========================================================================
+
+// 7.11
+
+void udp_stats(pfifo_stats_t stats) {
+
+/* 7.11.1   Functional Description
+
+   This routine will report the pipe ring counters.
+
+   7.11.2   Parameters:
+
+   stats    Pipe ring statistics
+
+   7.11.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.11.4   Data Structures
+
+// 7.11.5   Code
+
+   fifo_ring_stats(&m_ring, stats);
+
+} // end udp_stats()
+
+
+// ===========================================================================
+
+// 7.12
+
+void udp_dgram_stats(pudp_stats_t stats) {
+
+/* 7.12.1   Functional Description
+
+   This routine will report the datagram counters.
+
+   7.12.2   Parameters:
+
+   stats    Datagram statistics
+
+   7.12.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.12.4   Data Structures
+
+// 7.12.5   Code
+
+   memcpy(stats, &m_udp, sizeof(udp_stats_t));
+
+} // end udp_dgram_stats()
+
+
+// ===========================================================================
+
+// 7.13
+
+static void udp_ovfl(struct msghdr *hdr) {
+
+/* 7.13.1   Functional Description
+
+   This routine will record the socket drop count carried with the
+   datagram, the kernel reports a running total.
+
+   7.13.2   Parameters:
+
+   hdr      Received message header
+
+   7.13.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.13.4   Data Structures
+
+   struct cmsghdr *cmsg;
+   uint32_t        drops;
+
+// 7.13.5   Code
+
+   for (cmsg=CMSG_FIRSTHDR(hdr);cmsg!=NULL;cmsg=CMSG_NXTHDR(hdr, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+         memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+         if (drops > m_udp.sock_drops) {
+            if (gc.trace & LIN_TRACE_ERROR) {
+               printf("udp_ovfl() Error : receive queue overflow, %d datagrams dropped\n",
+                     drops - m_udp.sock_drops);
+            }
+            m_udp.sock_drops = drops;
+         }
+      }
+   }
+
+} // end udp_ovfl()
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "cm.h"
+
+#define  UDP_OK               0x00000000
+#define  UDP_ERROR            0x80000001
+#define  UDP_ERR_MSG_NULL     0x80000002
+#define  UDP_ERR_LEN_NULL     0x80000004
+#define  UDP_ERR_LEN_MAX      0x80000008
+#define  UDP_ERR_FRAMING      0x80000010
+#define  UDP_ERR_OVERRUN      0x80000020
+#define  UDP_ERR_PARITY       0x80000040
+#define  UDP_ERR_TX_DROP      0x80000080
+#define  UDP_ERR_RX_DROP      0x80000100
+#define  UDP_ERR_CRC          0x80000200
+#define  UDP_ERR_OPEN         0x80000400
+#define  UDP_ERR_RESP         0x80000800
+#define  UDP_ERR_THREAD       0x80001000
+#define  UDP_ERR_INFO         0x80002000
+#define  UDP_ERR_DEV          0x80004000
+#define  UDP_ERR_DEV_CNT      0x80008000
+#define  UDP_ERR_POOL         0x80010000
+#define  UDP_ERR_SOCKET       0x80020000
+
+#define  UDP_MSGLEN_UINT8     512
+#define  UDP_MSGLEN_UINT32    (UDP_MSGLEN_UINT8 >> 2)
+
+// Datagrams, 6-byte reserved pad ahead of the CM message
+#define  UDP_PAD_LEN          6
+#define  UDP_CTL_MSG_LEN      (UDP_PAD_LEN + UDP_MSGLEN_UINT8)
+#define  UDP_PIPE_MSG_LEN     (UDP_PAD_LEN + sizeof(cm_pipe_daq_t))
+
+// one recvmmsg() fills at most the rest of a pipe ring block
+#define  UDP_BATCH            (FIFO_BLOCK_LEN / sizeof(cm_pipe_daq_t))
+
+#define  UDP_SOCK_BUF         (16 << 20)
+#define  UDP_RECV_TIMEOUT     100
+#define  UDP_RESP_WAIT        50
+#define  UDP_RETRIES          4
+
+// Datagram Statistics
+typedef struct _udp_stats_t {
+   uint32_t     datagrams;
+   uint32_t     batches;
+   uint32_t     ctl;
+   uint32_t     pipe;
+   uint32_t     bad_len;
+   uint32_t     truncated;
+   uint32_t     sock_drops;
+   uint32_t     tx_err;
+} udp_stats_t, *pudp_stats_t;
+
+uint32_t  udp_init(uint8_t cm_port, uint32_t ip_addr, uint16_t udp_port);
+void      udp_tx(pcm_msg_t msg);
+void      udp_cmio(uint8_t op_code, pcm_msg_t msg);
+void      udp_head(void);
+void      udp_pipe_free(pcm_pipe_t pipe);
+void      udp_stats(pfifo_stats_t stats);
+void      udp_dgram_stats(pudp_stats_t stats);
+void      udp_final(void);
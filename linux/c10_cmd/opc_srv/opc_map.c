@@ -0,0 +1,419 @@
+/*-----------------------------------------------------------------------------
+
+   1  ABSTRACT
+
+   1.1 Module Type
+
+      Memory-Mapped Capture Sink
+
+   1.2 Functional Description
+
+      This code implements a capture file sink that copies DAQ output into
+      fixed-size mapped windows of a preallocated file, in place of stdio.
+
+   1.3 Specification/Design Reference
+
+      See fw_cfg.h under the share directory.
+
+   1.4 Module Test Specification Reference
+
+      None
+
+   1.5 Compilation Information
+
+      See fw_cfg.h under the share directory.
+
+   1.6 Notes
+
+      The file is extended with posix_fallocate() ahead of the windows. The writer
+      copies into the current window only, a background thread retires full
+      windows with msync() and maps the next, so the writer never waits on
+      the disk unless every window is still being retired.
+
+   2  CONTENTS
+
+      1 ABSTRACT
+        1.1 Module Type
+        1.2 Functional Description
+        1.3 Specification/Design Reference
+        1.4 Module Test Specification Reference
+        1.5 Compilation Information
+        1.6 Notes
+
+      2 CONTENTS
+
+      3 VOCABULARY
+
+      4 EXTERNAL RESOURCES
+        4.1  Include Files
+        4.2  External Data Structures
+        4.3  External Function Prototypes
+
+      5 LOCAL CONSTANTS AND MACROS
+
+      6 MODULE DATA STRUCTURES
+        6.1  Local Function Prototypes
+        6.2  Local Data Structures
+
+      7 MODULE CODE
+        7.1  opc_map_open()
+        7.2  opc_map_write()
+        7.3  opc_map_close()
+        7.4  opc_map_thread()
+        7.5  opc_map_window()
+
+-----------------------------------------------------------------------------*/
+
+// 3 VOCABULARY
+
+// 4 EXTERNAL RESOURCES
+
+// 4.1  Include Files
+
+#include "main.h"
+
+// 4.2   External Data Structures
+
+// 4.3   External Function Prototypes
+
+// 5 LOCAL CONSTANTS AND MACROS
+
+// 6 MODULE DATA STRUCTURES
+
+// 6.1  Local Function Prototypes
+
+   static   void *opc_map_thread(void *data);
+   static   uint32_t opc_map_window(popc_map_win_t win);
+
+// 6.2  Local Data Structures
+
+   static   opc_map_t      map = {0};
+
+// 7 MODULE CODE
+
+// ===========================================================================
+
+// 7.1
+
+uint32_t opc_map_open(int fd, off_t start, uint32_t win_mb) {
+
+/* 7.1.1   Functional Description
+
+   This routine will map the first windows of the file and start the
+   background thread. Anything before start was written with stdio and
+   must be flushed by the caller.
+
+   7.1.2   Parameters:
+
+   fd       Open file descriptor
+   start    File offset of the first byte to write
+   win_mb   Window length in MB, 0 for OPC_MAP_WIN_MB
+
+   7.1.3   Return Values:
+
+   result   OPC_OK
+            CFG_ERROR_OPC when the file can't be mapped
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.1.4   Data Structures
+
+   uint32_t    result = OPC_OK;
+   uint32_t    i;
+   off_t       page = sysconf(_SC_PAGESIZE);
+
+// 7.1.5   Code
+
+   memset(&map, 0, sizeof(opc_map_t));
+   map.fd        = fd;
+   map.win_len   = ((win_mb == 0) ? OPC_MAP_WIN_MB : win_mb) << 20;
+   map.pos       = start;
+   // windows are page aligned
+   map.next_off  = start - (start % page);
+   map.alloc_end = start;
+   map.cur       = 0;
+   map.retire    = 0;
+   map.run       = TRUE;
+
+   pthread_mutex_init(&map.mutex, NULL);
+   pthread_cond_init(&map.cv, NULL);
+   pthread_cond_init(&map.cv_ready, NULL);
+
+   // first windows
+   for (i=0;i<OPC_MAP_WINDOWS;i++) {
+      if ((result = opc_map_window(&map.win[i])) != OPC_OK) break;
+   }
+
+   // Start the Window Thread
+   if (result == OPC_OK && pthread_create(&map.tid, NULL, opc_map_thread, NULL)) {
+      result = CFG_ERROR_OPC;
+   }
+
+   // release any windows
+   if (result != OPC_OK) {
+      for (i=0;i<OPC_MAP_WINDOWS;i++) {
+         if (map.win[i].base != NULL) munmap(map.win[i].base, map.win_len);
+      }
+      ftruncate(fd, start);
+      printf("opc_map_open() Error : capture file did not map, %s\n", strerror(errno));
+   }
+
+   return result;
+
+} // end opc_map_open()
+
+
+// ===========================================================================
+
+// 7.2
+
+void opc_map_write(void *buf, uint32_t len) {
+
+/* 7.2.1   Functional Description
+
+   This routine will copy the buffer into the mapped windows. A full window
+   is handed to the background thread. When the next window is not yet
+   mapped this routine waits, and the wait is counted.
+
+   7.2.2   Parameters:
+
+   buf      Output bytes
+   len      Output length
+
+   7.2.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.2.4   Data Structures
+
+   uint8_t          *src = (uint8_t *)buf;
+   popc_map_win_t    win;
+   uint32_t          off, cnt;
+
+// 7.2.5   Code
+
+   while (len != 0) {
+      win = &map.win[map.cur];
+      // wait for the window
+      if (__atomic_load_n(&win->state, __ATOMIC_ACQUIRE) != OPC_MAP_READY) {
+         pthread_mutex_lock(&map.mutex);
+         map.stalls++;
+         while (win->state != OPC_MAP_READY && map.err == 0) {
+            pthread_cond_wait(&map.cv_ready, &map.mutex);
+         }
+         pthread_mutex_unlock(&map.mutex);
+         // output is lost once a window fails
+         if (win->state != OPC_MAP_READY) return;
+      }
+      off = (uint32_t)(map.pos - win->off);
+      cnt = map.win_len - off;
+      if (cnt > len) cnt = len;
+      memcpy(win->base + off, src, cnt);
+      map.pos += cnt;
+      src     += cnt;
+      len     -= cnt;
+      // window full
+      if (off + cnt == map.win_len) {
+         pthread_mutex_lock(&map.mutex);
+         win->state = OPC_MAP_FULL;
+         pthread_cond_signal(&map.cv);
+         pthread_mutex_unlock(&map.mutex);
+         if (++map.cur == OPC_MAP_WINDOWS) map.cur = 0;
+      }
+   }
+
+} // end opc_map_write()
+
+
+// ===========================================================================
+
+// 7.3
+
+off_t opc_map_close(void) {
+
+/* 7.3.1   Functional Description
+
+   This routine will retire every window, stop the background thread and
+   trim the preallocated file to the bytes written.
+
+   7.3.2   Parameters:
+
+   NONE
+
+   7.3.3   Return Values:
+
+   pos      File offset after the last byte written
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.3.4   Data Structures
+
+   uint32_t    i;
+
+// 7.3.5   Code
+
+   // Stop the Window Thread, full windows are retired first
+   pthread_mutex_lock(&map.mutex);
+   map.run = FALSE;
+   pthread_cond_signal(&map.cv);
+   pthread_mutex_unlock(&map.mutex);
+   pthread_join(map.tid, NULL);
+
+   // release the remaining windows
+   for (i=0;i<OPC_MAP_WINDOWS;i++) {
+      if (map.win[i].base != NULL) {
+         msync(map.win[i].base, map.win_len, MS_SYNC);
+         munmap(map.win[i].base, map.win_len);
+         map.win[i].base  = NULL;
+         map.win[i].state = OPC_MAP_IDLE;
+      }
+   }
+
+   // trim the preallocation
+   ftruncate(map.fd, map.pos);
+
+   if (map.stalls != 0 || map.err != 0) {
+      printf("opc_map_close() Warning : capture window stalls %d, errors %d\n",
+            map.stalls, map.err);
+   }
+
+   return map.pos;
+
+} // end opc_map_close()
+
+
+// ===========================================================================
+
+// 7.4
+
+static void *opc_map_thread(void *data) {
+
+/* 7.4.1   Functional Description
+
+   This thread will retire full windows, in order, then map the next
+   window of the file into the same slot.
+
+   7.4.2   Parameters:
+
+   data     Thread parameters
+
+   7.4.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.4.4   Data Structures
+
+   popc_map_win_t    win;
+
+// 7.4.5   Code
+
+   if (gc.trace & CFG_TRACE_ID) {
+      printf("opc_map_thread() started, data:tid %08X:%lu\n", (uint32_t)(uintptr_t)data, syscall(SYS_gettid));
+   }
+
+   while (1) {
+
+      win = &map.win[map.retire];
+
+      pthread_mutex_lock(&map.mutex);
+      while (win->state != OPC_MAP_FULL && map.run) {
+         pthread_cond_wait(&map.cv, &map.mutex);
+      }
+      pthread_mutex_unlock(&map.mutex);
+
+      // nothing left to retire
+      if (win->state != OPC_MAP_FULL) break;
+
+      // write back and drop the pages
+      msync(win->base, map.win_len, MS_SYNC);
+      madvise(win->base, map.win_len, MADV_DONTNEED);
+      munmap(win->base, map.win_len);
+      win->base = NULL;
+
+      // next window of the file
+      if (opc_map_window(win) != OPC_OK) {
+         pthread_mutex_lock(&map.mutex);
+         win->state = OPC_MAP_IDLE;
+         map.err++;
+         pthread_cond_signal(&map.cv_ready);
+         pthread_mutex_unlock(&map.mutex);
+         break;
+      }
+
+      if (++map.retire == OPC_MAP_WINDOWS) map.retire = 0;
+   }
+
+   return (void *)0;
+
+} // end opc_map_thread()
+
+
+// ===========================================================================
+
+// 7.5
+
+static uint32_t opc_map_window(popc_map_win_t win) {
+
+/* 7.5.1   Functional Description
+
+   This routine will map the next window of the file, extending the
+   preallocated extent when needed.
+
+   7.5.2   Parameters:
+
+   win      Window slot
+
+   7.5.3   Return Values:
+
+   result   OPC_OK
+            CFG_ERROR_OPC on allocation or mapping failure
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.5.4   Data Structures
+
+   uint32_t    result = OPC_OK;
+   off_t       end = map.next_off + map.win_len;
+   off_t       ext;
+
+// 7.5.5   Code
+
+   // preallocate ahead of the window
+   if (end > map.alloc_end) {
+      ext = (off_t)map.win_len * OPC_MAP_EXTENT_WINS;
+      if (posix_fallocate(map.fd, map.alloc_end, end + ext - map.alloc_end) != 0) {
+         // file system without fallocate support
+         if (ftruncate(map.fd, end + ext) != 0) return CFG_ERROR_OPC;
+      }
+      map.alloc_end = end + ext;
+   }
+
+   win->base = (uint8_t *)mmap(NULL, map.win_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+                               map.fd, map.next_off);
+   if (win->base == MAP_FAILED) {
+      win->base = NULL;
+      result = CFG_ERROR_OPC;
+   }
+   else {
+      madvise(win->base, map.win_len, MADV_SEQUENTIAL);
+      win->off = map.next_off;
+      map.next_off += map.win_len;
+      // hand to the writer
+      pthread_mutex_lock(&map.mutex);
+      win->state = OPC_MAP_READY;
+      pthread_cond_signal(&map.cv_ready);
+      pthread_mutex_unlock(&map.mutex);
+   }
+
+   return result;
+
+} // end opc_map_window()
@@ -0,0 +1,40 @@
+#pragma once
+
+#define  OPC_MAP_WINDOWS      4
+#define  OPC_MAP_WIN_MB       16
+#define  OPC_MAP_EXTENT_WINS  8
+
+// Window State
+#define  OPC_MAP_IDLE         0
+#define  OPC_MAP_READY        1
+#define  OPC_MAP_FULL         2
+
+// Mapped Window
+typedef struct _opc_map_win_t {
+   uint8_t          *base;
+   off_t             off;
+   uint32_t          state;
+} opc_map_win_t, *popc_map_win_t;
+
+// Memory-Mapped Capture Sink
+typedef struct _opc_map_t {
+   int               fd;
+   uint32_t          win_len;
+   off_t             pos;
+   off_t             next_off;
+   off_t             alloc_end;
+   uint32_t          cur;
+   uint32_t          retire;
+   uint32_t          run;
+   uint32_t          stalls;
+   uint32_t          err;
+   opc_map_win_t     win[OPC_MAP_WINDOWS];
+   pthread_t         tid;
+   pthread_mutex_t   mutex;
+   pthread_cond_t    cv;
+   pthread_cond_t    cv_ready;
+} opc_map_t, *popc_map_t;
+
+uint32_t opc_map_open(int fd, off_t start, uint32_t win_mb);
+void     opc_map_write(void *buf, uint32_t len);
+off_t    opc_map_close(void);
@@ -39,6 +39,7 @@ typedef struct _opc_error_table_t {
 #define OPC_INT_IND         0x40
 #define OPC_RUN_IND         0x41
 #define OPC_STEP_IND        0x42
+#define OPC_STAT_IND        0x43
 
 // OPC SERVER FLAGS
 #define OPC_NO_FLAGS        0x00
@@ -49,6 +50,9 @@ typedef struct _opc_error_table_t {
 
 // OPERATION CODES
 #define OPC_CMD_DAQ         1
+#define OPC_CMD_MEM         2
+#define OPC_CMD_XLT         3
+#define OPC_CMD_PROF        4
 
 // ===========================================================================
 //
@@ -73,3 +77,23 @@ typedef struct {
    msg_parms_t     p;
    daq_done_body_t b;
 } opc_done_ind_msg_t, *popc_done_ind_msg_t;
+
+// DAQ STATISTICS INDICATION MESSAGE BODY
+// MEAN AND RMS ARE IN 1/OPC_STAT_FRAC CODES
+typedef struct {
+   uint32_t        blocks;
+   uint32_t        samples;
+   uint32_t        period_ms;
+   uint16_t        min[DAQ_MAX_CH];
+   uint16_t        max[DAQ_MAX_CH];
+   uint32_t        mean[DAQ_MAX_CH];
+   uint32_t        rms[DAQ_MAX_CH];
+   uint32_t        clip[DAQ_MAX_CH];
+} opc_stat_body_t, *popc_stat_body_t;
+
+// DAQ STATISTICS INDICATION MESSAGE COMPLETE
+typedef struct {
+   cm_hdr_t        h;
+   msg_parms_t     p;
+   opc_stat_body_t b;
+} opc_stat_ind_msg_t, *popc_stat_ind_msg_t;
@@ -61,6 +61,24 @@
         7.7  opc_daq_state()
         7.8  opc_write_file()
         7.9  opc_final()
+        7.10 opc_pipe_get()
+        7.11 opc_write_thread()
+        7.12 opc_write_put()
+        7.13 opc_write_init()
+        7.14 opc_fmt_uint()
+        7.15 opc_cap_open()
+        7.16 opc_cap_write()
+        7.17 opc_cap_close()
+        7.18 opc_file_out()
+        7.19 opc_pipe_notify()
+        7.20 opc_mem_state()
+        7.21 opc_xlt_state()
+        7.22 opc_xlt_read()
+        7.23 opc_sched_print()
+        7.24 opc_prof_state()
+        7.25 opc_prof_clear()
+        7.26 opc_prof_print()
+        7.27 opc_pipe_lost()
 
 -----------------------------------------------------------------------------*/
 
@@ -83,6 +101,21 @@
 // 6.1  Local Function Prototypes
 
    static   void *opc_thread(void *data);
+   static   pcm_pipe_daq_t opc_pipe_get(void);
+   static   void *opc_write_thread(void *data);
+   static   void  opc_write_put(pcm_pipe_daq_t pipe, uint32_t pkt_cnt, uint8_t write);
+   static   uint32_t opc_write_init(void);
+   static   char *opc_fmt_uint(char *p, uint32_t val, uint32_t width);
+   static   uint32_t opc_cap_open(void);
+   static   void  opc_cap_write(pcm_pipe_daq_t pipe, uint32_t pkt_cnt);
+   static   void  opc_cap_close(void);
+   static   void  opc_file_out(void *buf, uint32_t len);
+   static   void  opc_pipe_notify(uint8_t sub);
+   static   uint32_t opc_xlt_read(uint32_t address, void *buf, uint32_t len);
+   static   void  opc_sched_print(void);
+   static   void  opc_prof_clear(void);
+   static   void  opc_prof_print(uint8_t flags);
+   static   uint32_t opc_pipe_lost(void);
 
 // 6.2  Local Data Structures
 
@@ -93,14 +126,24 @@
 
    // available operations
    static   opc_table_t    opc_table[] = {
-               {OPC_CMD_DAQ,     opc_daq_state, OPC_DAQ_STATE_INIT}
+               {OPC_CMD_DAQ,     opc_daq_state, OPC_DAQ_STATE_INIT},
+               {OPC_CMD_MEM,     opc_mem_state, OPC_MEM_STATE_INIT},
+               {OPC_CMD_XLT,     opc_xlt_state, OPC_XLT_STATE_INIT},
+               {OPC_CMD_PROF,    opc_prof_state, OPC_PROF_STATE_INIT}
    };
 
    static   opc_rxq_t      rxq = {{0}};
 
+   // DAQ file writer
+   static   opc_wrq_t      wrq = {{{0}}};
+
+   // DAQ capture container
+   static   opc_cap_t      cap = {{0}};
+
    // cm subscriptions
    static cm_sub_t subs[] = {
       {CM_ID_DAQ_SRV, DAQ_DONE_IND, CM_ID_DAQ_SRV},
+      {CM_ID_OPC_SRV, OPC_STAT_IND, CM_ID_OPC_SRV},
       {CM_ID_NULL, 0, 0}
    };
 
@@ -139,6 +182,7 @@ uint32_t opc_init(void) {
    memset(&opc, 0, sizeof(opc));
    memset(&opc_daq,  0, sizeof(opc_daq));
    opc.srvid   = CM_ID_OPC_SRV;
+   opc.pipe_sub = CM_PIPE_SUB_NULL;
 
    // Initialize the RX Queue
    memset(&rxq, 0, sizeof(opc_rxq_t));
@@ -151,17 +195,31 @@ uint32_t opc_init(void) {
    rxq.tail  = 0;
    rxq.slots = OPC_RX_QUE;
 
-   // Allocate space for ADC Samples
-   opc_daq.adc = (int32_t *)malloc(DAQ_MAX_PIPE_RUN * DAQ_MAX_SAM * DAQ_MAX_CH * sizeof(int32_t));
+   // Initialize the DAQ File Writer
+   memset(&wrq, 0, sizeof(opc_wrq_t));
+   pthread_mutex_init(&wrq.mutex, NULL);
+   pthread_cond_init(&wrq.cv, NULL);
+   pthread_cond_init(&wrq.idle, NULL);
+   wrq.sam_str = (char *)malloc(OPC_WR_SAM_CODES * OPC_WR_SAM_STR);
+   wrq.out     = (char *)malloc(OPC_WR_BUF_LEN);
+   if (wrq.sam_str == NULL || wrq.out == NULL) result = CFG_ERROR_OPC;
 
    // Start the Message Delivery Thread
    if (pthread_create(&opc.tid, NULL, opc_thread, NULL)) {
       result = CFG_ERROR_OPC;
    }
 
+   // Start the DAQ File Writer Thread
+   if (pthread_create(&wrq.tid, NULL, opc_write_thread, NULL)) {
+      result = CFG_ERROR_OPC;
+   }
+
    // Register this Service
    opc.handle = cm_register(opc.srvid, opc_qmsg, opc_timer, subs);
 
+   // Start the DAQ Statistics Engine
+   result |= opc_stat_init();
+
    // Display Server ID
    if (gc.trace & CFG_TRACE_ID) {
       printf("%-13s srvid:handle %02X:%02X\n", "/dev/opc", opc.srvid, opc.handle);
@@ -198,9 +256,6 @@ uint32_t opc_msg(pcm_msg_t msg) {
 
    uint32_t    result = OPC_OK;
    uint32_t    i;
-   uint16_t    cm_msg = MSG(msg->p.srvid, msg->p.msgid);
-
-   pcm_pipe_daq_t pipe = (pcm_pipe_daq_t)msg;
 
 // 7.4.5   Code
 
@@ -213,98 +268,116 @@ uint32_t opc_msg(pcm_msg_t msg) {
          printf("opc_msg(), srvid:msgid:flags:port = %02X:%02X:%02X:%02X\n",
                  msg->p.srvid, msg->p.msgid, msg->p.flags, msg->h.port);
       }
-      //
-      //    RUN REQUEST
-      //
-      if (cm_msg == MSG(CM_ID_OPC_SRV, OPC_RUN_REQ)) {
-         // start application timeout timer, opcode dependant
-         cm_timer_set(CM_TMR_ID2, OPC_TMR_APP_TIMEOUT, cc.opc_timeout,
-               CM_ID_OPC_SRV, CM_ID_OPC_SRV);
-         pcmq_t slot = cm_alloc();
-         if (slot != NULL) {
-            popc_run_msg_t rsp = (popc_run_msg_t)slot->buf;
-            rsp->p.srvid    = opc.srvid;
-            rsp->p.msgid    = OPC_RUN_RESP;
-            rsp->p.flags    = OPC_NO_FLAGS;
-            rsp->p.status   = OPC_OK;
-            // start the OPC state machine
-            if (msg->p.flags & OPC_RUN_START) {
-               // set associated state machine for operation
-               for (i=0;i<DIM(opc_table);i++) {
-                  if (cc.opc_opcode == opc_table[i].opcode) {
-                     opc.sv.step  = opc_table[i].step;
-                     opc.sv.state = opc_table[i].state;
-                     // first step of state machine
-                     opc.sv.step();
-                     break;
+      switch (MSG_INDEX(gc.msg_index, msg->p.srvid, msg->p.msgid)) {
+         //
+         //    RUN REQUEST
+         //
+         case MSG_IDX_OPC_RUN_REQ: {
+            // start application timeout timer, opcode dependant
+            cm_timer_set(CM_TMR_ID2, OPC_TMR_APP_TIMEOUT, cc.opc_timeout,
+                  CM_ID_OPC_SRV, CM_ID_OPC_SRV);
+            pcmq_t slot = cm_alloc();
+            if (slot != NULL) {
+               popc_run_msg_t rsp = (popc_run_msg_t)slot->buf;
+               rsp->p.srvid    = opc.srvid;
+               rsp->p.msgid    = OPC_RUN_RESP;
+               rsp->p.flags    = OPC_NO_FLAGS;
+               rsp->p.status   = OPC_OK;
+               // start the OPC state machine
+               if (msg->p.flags & OPC_RUN_START) {
+                  // set associated state machine for operation
+                  for (i=0;i<DIM(opc_table);i++) {
+                     if (cc.opc_opcode == opc_table[i].opcode) {
+                        opc.sv.step  = opc_table[i].step;
+                        opc.sv.state = opc_table[i].state;
+                        // first step of state machine
+                        opc.sv.step();
+                        break;
+                     }
+                  }
+                  // exit if no valid operation code is defined
+                  if (i == DIM(opc_table)) {
+                     printf("opc_msg() Fatal Error : Invalid Operation Code %d\n", cc.opc_opcode);
+                     gc.error |= LIN_ERROR_OP_CODE;
+                     gc.halt   = TRUE;
                   }
                }
-               // exit if no valid operation code is defined
-               if (i == DIM(opc_table)) {
-                  printf("opc_msg() Fatal Error : Invalid Operation Code %d\n", cc.opc_opcode);
-                  gc.error |= LIN_ERROR_OP_CODE;
+               // halt the OPC operation and shutdown the application
+               else if (msg->p.flags & OPC_RUN_HALT) {
+                  // un-subscribe from DAQ pipe messages
+                  cm_pipe_unsub(opc.pipe_sub);
+                  opc.pipe_sub = CM_PIPE_SUB_NULL;
+                  gc.error |= LIN_ERROR_HALT;
                   gc.halt   = TRUE;
                }
+               // Send the Response
+               cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(opc_run_msg_t), 0, 0);
             }
-            // halt the OPC operation and shutdown the application
-            else if (msg->p.flags & OPC_RUN_HALT) {
-               // un-register for DAQ pipe messages
-               cm_pipe_reg(CM_ID_OPC_SRV, 0, 0, CM_DEV_NULL);
-               gc.error |= LIN_ERROR_HALT;
-               gc.halt   = TRUE;
+            break;
+         }
+         //
+         //    DAQ RUN RESPONSE
+         //
+         case MSG_IDX_DAQ_RUN_RESP: {
+            pdaq_run_msg_t rsp = (pdaq_run_msg_t)msg;
+            // issue step for state machine when stopping
+            if (rsp->b.opcode & DAQ_CMD_STOP) {
+               opc_daq.acq_done = TRUE;
+               // issue step indication
+               cm_local(CM_ID_OPC_SRV, OPC_STEP_IND, OPC_STEP_DONE, OPC_OK);
             }
-            // Send the Response
-            cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(opc_run_msg_t), 0, 0);
+            break;
          }
-      }
-      //
-      //    DAQ RUN RESPONSE
-      //
-      else if (cm_msg == MSG(CM_ID_DAQ_SRV, DAQ_RUN_RESP)) {
-         pdaq_run_msg_t rsp = (pdaq_run_msg_t)msg;
-         // issue step for state machine when stopping
-         if (rsp->b.opcode & DAQ_CMD_STOP) {
-            opc_daq.acq_done = TRUE;
-            // issue step indication
-            cm_local(CM_ID_OPC_SRV, OPC_STEP_IND, OPC_STEP_DONE, OPC_OK);
+         //
+         //    DAQ DONE INDICATION
+         //
+         case MSG_IDX_DAQ_DONE_IND: {
+            // every packet is sent, step the run for blocks lost at the tail
+            if (opc.sv.state == OPC_DAQ_STATE_RUN) {
+               cm_local(CM_ID_OPC_SRV, OPC_STEP_IND, OPC_STEP_PIPE, OPC_OK);
+            }
+            break;
          }
-      }
-      //
-      //    DAQ DONE INDICATION
-      //
-      else if (cm_msg == MSG(CM_ID_DAQ_SRV, DAQ_DONE_IND)) {
-         // nop
-      }
-      //
-      //    OPC STEP INDICATION
-      //
-      else if (cm_msg == MSG(CM_ID_OPC_SRV, OPC_STEP_IND)) {
-         if (opc.sv.step != NULL) opc.sv.step();
-      }
-      //
-      // UNKNOWN MESSAGE
-      //
-      else if (gc.trace & CFG_TRACE_ERROR) {
-         // Unknown Message
-         printf("opc_msg() Unknown Message, srvid:msgid = %02X:%02X\n",
-               msg->p.srvid, msg->p.msgid);
-         dump((uint8_t *)msg, 12, 0, 0);
+         //
+         //    DAQ STATISTICS INDICATION
+         //
+         case MSG_IDX_OPC_STAT_IND: {
+            popc_stat_ind_msg_t ind = (popc_stat_ind_msg_t)msg;
+            printf("daq stats : %d msgs, %d samples/ch, %d mS\n",
+                  ind->b.blocks, ind->b.samples, ind->b.period_ms);
+            for (i=0;i<DAQ_MAX_CH;i++) {
+               printf("  ch%d : min %4d  max %4d  mean %9.3f  rms %9.3f  clip %d\n", i,
+                     ind->b.min[i], ind->b.max[i], (double)ind->b.mean[i] / OPC_STAT_FRAC,
+                     (double)ind->b.rms[i] / OPC_STAT_FRAC, ind->b.clip[i]);
+            }
+            break;
+         }
+         //
+         //    OPC STEP INDICATION
+         //
+         case MSG_IDX_OPC_STEP_IND: {
+            // re-arm the pipe step ahead of draining the queue
+            if (msg->p.flags & OPC_STEP_PIPE) __atomic_store_n(&opc.pipe_step, FALSE, __ATOMIC_RELEASE);
+            if (opc.sv.step != NULL) opc.sv.step();
+            break;
+         }
+         //
+         // UNKNOWN MESSAGE
+         //
+         default:
+            if (gc.trace & CFG_TRACE_ERROR) {
+               // Unknown Message
+               printf("opc_msg() Unknown Message, srvid:msgid = %02X:%02X\n",
+                     msg->p.srvid, msg->p.msgid);
+               dump((uint8_t *)msg, 12, 0, 0);
+            }
+            break;
       }
 
       // Release the Slot
       cm_free(msg);
    }
 
-   //
-   // DAQ PIPE MESSAGE
-   //
-   else if (pipe->dst_cmid == CM_ID_PIPE && pipe->msgid == CM_PIPE_DAQ_DATA) {
-      // record pipe message
-      opc_daq.pipe = pipe;
-      // issue step indication
-      cm_local(CM_ID_OPC_SRV, OPC_STEP_IND, OPC_STEP_PIPE, OPC_OK);
-   }
-
    return result;
 
 } // end opc_msg()
@@ -334,27 +407,31 @@ uint32_t opc_timer(pcm_msg_t msg) {
 // 7.3.4   Data Structures
 
    uint32_t    result = OPC_OK;
-   uint16_t    cm_msg = MSG(msg->p.srvid, msg->p.msgid);
 
 // 7.3.5   Code
 
-   //
-   //    APPLICATION TIMEOUT TIMER
-   //
-   if (cm_msg == MSG(CM_ID_OPC_SRV, OPC_TMR_APP_TIMEOUT)) {
-      printf("opc_timer() Warning : Application Timeout, Forced Exit\n");
-      // halt the application
-      gc.error |= LIN_ERROR_APP_TIMEOUT;
-      gc.halt   = TRUE;
-   }
-   //
-   //    UNKNOWN TIMER
-   //
-   else if (gc.trace & CFG_TRACE_ERROR) {
-      // Unknown Timer Message
-      printf("opc_msg() Unknown Timer Message, srvid:msgid = %02X:%02X\n",
-            msg->p.srvid, msg->p.msgid);
-      dump((uint8_t *)msg, 12, 0, 0);
+   switch (MSG_INDEX(gc.msg_index, msg->p.srvid, msg->p.msgid)) {
+      //
+      //    APPLICATION TIMEOUT TIMER
+      //
+      case MSG_IDX_OPC_TMR_APP_TIMEOUT: {
+         printf("opc_timer() Warning : Application Timeout, Forced Exit\n");
+         // halt the application
+         gc.error |= LIN_ERROR_APP_TIMEOUT;
+         gc.halt   = TRUE;
+         break;
+      }
+      //
+      //    UNKNOWN TIMER
+      //
+      default:
+         if (gc.trace & CFG_TRACE_ERROR) {
+            // Unknown Timer Message
+            printf("opc_msg() Unknown Timer Message, srvid:msgid = %02X:%02X\n",
+                  msg->p.srvid, msg->p.msgid);
+            dump((uint8_t *)msg, 12, 0, 0);
+         }
+         break;
    }
 
    return result;
@@ -434,13 +511,25 @@ uint32_t opc_qmsg(pcm_msg_t msg) {
       // Lock the RXQ mutex
       pthread_mutex_lock(&rxq.mutex);
 
-      // place in receive queue
-      rxq.buf[rxq.head] = (uint32_t *)msg;
-      if (++rxq.head == rxq.slots) rxq.head = 0;
+      // place in receive queue, a full queue would wrap onto the tail
+      if ((rxq.head + 1) % rxq.slots != rxq.tail) {
+         rxq.buf[rxq.head] = (uint32_t *)msg;
+         if (++rxq.head == rxq.slots) rxq.head = 0;
+         msg = NULL;
+      }
 
       // Unlock the RXQ mutex
       pthread_mutex_unlock(&rxq.mutex);
 
+      // queue full, release the slot
+      if (msg != NULL) {
+         if (gc.trace & CFG_TRACE_ERROR) {
+            printf("opc_qmsg() Error : receive queue full, srvid:msgid = %02X:%02X\n",
+                  msg->p.srvid, msg->p.msgid);
+         }
+         cm_free(msg);
+      }
+
       // signal the OPC thread
       pthread_cond_signal(&rxq.cv);
 
@@ -569,8 +658,12 @@ uint32_t opc_daq_state(void) {
    char        file[512] = {0};
    char        line[1024];
    char        build_time[64], build_date[64];
+   fifo_stats_t stats;
+   pmon_stats_t pmon;
+   cp_sched_body_t sched;
 
    pcm_pipe_daq_t pipe;
+   uint32_t       seqid;
 
 // 7.7.5   Code
 
@@ -589,7 +682,6 @@ uint32_t opc_daq_state(void) {
             opc_daq.samcnt     = 0;
             opc_daq.opcmd      = cc.daq_opcmd;
             opc_daq.packets    = cc.daq_packets;
-            opc_daq.adc_index  = 0;
             opc_daq.blklen     = 0;
             opc_daq.to_file    = cc.daq_to_file;
             opc_daq.file_type  = cc.daq_file_type;
@@ -600,11 +692,19 @@ uint32_t opc_daq_state(void) {
             opc_daq.dat_done   = FALSE;
             opc_daq.pkt_cnt    = 0;
             opc_daq.file       = NULL;
-            opc_daq.pipe       = NULL;
-            // reset circular pipe buffer
-            fifo_head();
-            // register for DAQ pipe messages
-            cm_pipe_reg(CM_ID_OPC_SRV, CM_PIPE_DAQ_DATA, 1, CM_DEV_WIN);
+            opc_daq.mmap       = FALSE;
+            // pipe ring overruns before the run are not counted as lost
+            if (cc.opc_media == CM_MEDIA_LAN) udp_stats(&stats);
+            else fifo_stats(&stats);
+            opc_daq.lost_base  = stats.overruns;
+            // restart the pipe integrity counters
+            pmon_init(cc.daq_rate);
+            // release any stale pipe blocks
+            cm_pipe_unsub(opc.pipe_sub);
+            // subscribe to DAQ pipe messages, the pipe ring bounds the
+            // number outstanding so the file writer never drops
+            opc.pipe_sub = cm_pipe_sub(CM_ID_OPC_SRV, CM_PIPE_DAQ_DATA, OPC_PIPE_QUE,
+                                       CM_PIPE_DROP_NEW, opc_pipe_notify);
             //
             // file timestamp : YYYYMMDDHHMMSS_filename
             //
@@ -622,7 +722,7 @@ uint32_t opc_daq_state(void) {
             // open file for writing samples
             //
             if (opc_daq.to_file == 1) {
-               if (opc_daq.file_type == 0) {
+               if (opc_daq.file_type == OPC_FILE_TEXT) {
                   // plain text with labels
                   opc_daq.file = fopen(file, "wt");
                   // labels
@@ -651,11 +751,19 @@ uint32_t opc_daq_state(void) {
                      fwrite(line, sizeof(char), strlen(line), opc_daq.file);
                   }
                }
-               else if (opc_daq.file_type == 1) {
+               else if (opc_daq.file_type == OPC_FILE_BINARY) {
                   // binary
                   opc_daq.file = fopen(file, "wb");
                }
-               else if (opc_daq.file_type == 2) {
+               else if (opc_daq.file_type == OPC_FILE_CAPTURE) {
+                  // capture container
+                  opc_daq.file = fopen(file, "wb");
+                  if (opc_daq.file != NULL && opc_cap_open() != OPC_OK) {
+                     fclose(opc_daq.file);
+                     opc_daq.file = NULL;
+                  }
+               }
+               else if (opc_daq.file_type == OPC_FILE_CSV) {
                   // csv text with labels
                   opc_daq.file = fopen(file, "wt");
                   // labels
@@ -684,6 +792,16 @@ uint32_t opc_daq_state(void) {
                      fwrite(line, sizeof(char), strlen(line), opc_daq.file);
                   }
                }
+               // sample strings for text/CSV
+               if (opc_daq.file != NULL) opc_write_init();
+               // sample output through mapped windows, header stays in stdio
+               if (opc_daq.file != NULL && cc.daq_mmap == 1) {
+                  fflush(opc_daq.file);
+                  if (opc_map_open(fileno(opc_daq.file), ftello(opc_daq.file), cc.daq_mmap_mb) == OPC_OK)
+                     opc_daq.mmap = TRUE;
+                  else
+                     printf("opc_daq_state() Warning : capture file not mapped, using stdio\n");
+               }
                // close application if file doesn't open
                if (opc_daq.file == NULL) {
                   printf("opc_daq_state() Fatal Error : ADC sample file did not Open, %s", file);
@@ -696,6 +814,10 @@ uint32_t opc_daq_state(void) {
             // okay to go
             //
             if (opc.sv.state == OPC_DAQ_STATE_RUN) {
+               // restart the firmware task accounting for this run
+               if (cc.daq_sched) cp_sched_req(CP_SCHED_CLR, &sched);
+               // and the cycle profile
+               if (cc.daq_prof) opc_prof_clear();
                // issue DAQ run request using CC parameters
                pcmq_t slot = cm_alloc();
                if (slot != NULL) {
@@ -719,16 +841,26 @@ uint32_t opc_daq_state(void) {
          // PROCESS ACQUIRED SAMPLES
          //
          case OPC_DAQ_STATE_RUN :
-            if ((pipe = opc_daq.pipe) != NULL) {
-               // write to file
-               if (opc_daq.to_file) opc_write_file(pipe);
-               // track packets
-               opc_daq.pkt_cnt += DAQ_MAX_PIPE_RUN;
-               opc_daq.samcnt  += (DAQ_MAX_LEN * FIFO_PACKET_CNT);
-               // Clear pipe message
-               opc_daq.pipe = NULL;
-               // All samples collected
-               if (opc_daq.pkt_cnt == opc_daq.packets) {
+            // drain every queued pipe block, then check for the end of
+            // the run once more as blocks lost at the tail are not seen
+            do {
+               pipe = opc_pipe_get();
+               if (pipe != NULL) {
+                  // the pipe seqid restarts with the run, it places the
+                  // block past any spilled or dropped ahead of it
+                  seqid = pipe->seqid;
+                  // write to file, the writer returns the block
+                  if (opc_daq.file != NULL) opc_write_put(pipe, seqid, TRUE);
+                  // return block to the pipe ring
+                  else cm_pipe_free((pcm_pipe_t)pipe);
+                  // track packets, delivered and the furthest seen
+                  opc_daq.pkt_cnt += DAQ_MAX_PIPE_RUN;
+                  opc_daq.samcnt  += (DAQ_MAX_LEN * FIFO_PACKET_CNT);
+                  if (seqid + DAQ_MAX_PIPE_RUN > opc_daq.seqid) opc_daq.seqid = seqid + DAQ_MAX_PIPE_RUN;
+               }
+               // All samples collected, or lost on the way
+               if (opc_daq.seqid >= opc_daq.packets ||
+                   opc_daq.pkt_cnt + (opc_pipe_lost() * DAQ_MAX_PIPE_RUN) >= opc_daq.packets) {
                   opc_daq.dat_done = TRUE;
                   opc.sv.state  = OPC_DAQ_STATE_DONE;
                   // issue run request DAQ_CMD_STOP
@@ -748,14 +880,52 @@ uint32_t opc_daq_state(void) {
                      result = cm_send(CM_MSG_REQ, &ps);
                   }
                }
-            }
+            } while (opc.sv.state == OPC_DAQ_STATE_RUN && pipe != NULL);
             break;
          //
          // WAIT FOR DAQ COMPLETE
          //
          case OPC_DAQ_STATE_DONE :
+            // release pipe blocks beyond the last packet,
+            // in order behind any blocks still being written
+            while ((pipe = opc_pipe_get()) != NULL) {
+               if (opc_daq.file != NULL) opc_write_put(pipe, 0, FALSE);
+               else cm_pipe_free((pcm_pipe_t)pipe);
+            }
             if (opc_daq.acq_done == TRUE && opc_daq.dat_done == TRUE) {
                opc.sv.state = OPC_STATE_IDLE;
+               // wait for the file writer to drain
+               pthread_mutex_lock(&wrq.mutex);
+               while (wrq.tail != wrq.head) pthread_cond_wait(&wrq.idle, &wrq.mutex);
+               pthread_mutex_unlock(&wrq.mutex);
+               if (opc_daq.file != NULL) fflush(opc_daq.file);
+               // report pipe ring usage
+               if (cc.opc_media == CM_MEDIA_LAN) udp_stats(&stats);
+               else fifo_stats(&stats);
+               if (stats.overruns != 0) {
+                  printf("opc_daq_state() Warning : pipe ring overrun, %d blocks, %d bytes dropped\n",
+                        stats.overruns, stats.dropped);
+               }
+               if (cm_pipe_dropped(opc.pipe_sub) != 0) {
+                  printf("opc_daq_state() Warning : pipe subscription full, %d blocks dropped\n",
+                        cm_pipe_dropped(opc.pipe_sub));
+               }
+               if (gc.trace & LIN_TRACE_PIPE) {
+                  printf("opc_daq_state() pipe ring : blocks %d, overruns %d, dropped %d, hiwater %d/%d, free_err %d\n",
+                        stats.blocks, stats.overruns, stats.dropped, stats.hiwater,
+                        FIFO_PIPE_SLOTS, stats.free_err);
+               }
+               // report pipe integrity
+               pmon_get(&pmon);
+               if (pmon.gaps != 0 || pmon.dups != 0 || pmon.reorder != 0 ||
+                   pmon.magic != 0 || pmon.hdr != 0) {
+                  printf("opc_daq_state() Warning : pipe integrity, %d gaps (%d lost), %d dups, %d reorder, %d magic, %d hdr\n",
+                        pmon.gaps, pmon.lost, pmon.dups, pmon.reorder, pmon.magic, pmon.hdr);
+               }
+               if (gc.trace & LIN_TRACE_PIPE) pmon_print();
+               // report firmware task accounting for the run
+               if (cc.daq_sched) opc_sched_print();
+               if (cc.daq_prof) opc_prof_print(CP_PROF_GET);
                cm_send_reg_req(CM_DEV_DE0, CM_PORT_COM0, CM_REG_CLOSE, (uint8_t *)gc.dev_str);
                usleep(100*1000);
                gc.halt = TRUE;
@@ -773,15 +943,20 @@ uint32_t opc_daq_state(void) {
 
 // 7.8
 
-uint32_t opc_write_file(pcm_pipe_daq_t pipe) {
+uint32_t opc_write_file(pcm_pipe_daq_t pipe, uint32_t pkt_cnt) {
 
 /* 7.8.1   Functional Description
 
    This routine will write the pipe message to the selected data file.
 
+   Text and CSV rows are assembled in one output buffer and written with
+   a single fwrite() per block. Sample columns are copied from the table
+   built by opc_write_init(), the row number uses opc_fmt_uint().
+
    7.8.2   Parameters:
 
-   NONE
+   pipe     First pipe message of the block
+   pkt_cnt  Packet position of the block, its pipe seqid
 
    7.8.3   Return Values:
 
@@ -793,85 +968,54 @@ uint32_t opc_write_file(pcm_pipe_daq_t pipe) {
 // 7.8.4   Data Structures
 
    uint32_t    result = OPC_OK;
-   uint32_t    i,j,l,m;
-   int32_t     k;
-   char        line[1024];
-   float       samf[16];
-   int32_t     sami[16];
+   uint32_t    i,j,m;
+   char       *p = wrq.out;
+   char       *sep;
+   uint32_t    sep_len;
+   uint16_t   *sam;
 
 // 7.8.5   Code
 
    //
    // Write to Binary File
    //
-   if (opc_daq.file_type == 1 && opc_daq.file != NULL) {
-      fwrite(opc_daq.pipe, 1, DAQ_MAX_PIPE_RUN * sizeof(cm_pipe_daq_t), opc_daq.file);
+   if (opc_daq.file_type == OPC_FILE_BINARY && opc_daq.file != NULL) {
+      opc_file_out(pipe, DAQ_MAX_PIPE_RUN * sizeof(cm_pipe_daq_t));
    }
    //
-   // Write to Text File
+   // Write to Capture File
    //
-   else if (opc_daq.file_type == 0 && opc_daq.file != NULL) {
-      // cycle over multiple 1K pipe messages
-      for (i=0;i<DAQ_MAX_PIPE_RUN;i++) {
-         // cycle over samples, packed in channel order
-         for (k=0,m=0;k<DAQ_MAX_SAM;k++) {
-            for (l=0;l<DAQ_MAX_CH;l++) {
-               opc_daq.adc[(i*DAQ_MAX_LEN) + m++] = ((int32_t)pipe->samples[(k * DAQ_MAX_CH) + l]);
-            }
-         }
-         for (l=0,j=0;l<DAQ_MAX_LEN;l+=DAQ_MAX_CH) {
-            k = (i * DAQ_MAX_LEN) + l;
-            if (opc_daq.real) {
-               for (m=0;m<DAQ_MAX_CH;m++) samf[m] = (float)(opc_daq.adc[k+m] * DAQ_LSB);
-               sprintf(line, "  %8d %8E %8E %8E %8E %8E %8E %8E %8E\n",
-                     ((opc_daq.pkt_cnt + i) * DAQ_MAX_SAM) + j++,
-                     samf[0],  samf[1],  samf[2],  samf[3],  samf[4],  samf[5],  samf[6],  samf[7]);
-               fwrite(line, sizeof(char), strlen(line), opc_daq.file);
-            }
-            else {
-               for (m=0;m<DAQ_MAX_CH;m++) sami[m] = opc_daq.adc[k+m];
-               sprintf(line, "  %8d %8d %8d %8d %8d %8d %8d %8d %8d\n",
-                     ((opc_daq.pkt_cnt + i) * DAQ_MAX_SAM) + j++,
-                     sami[0],  sami[1],  sami[2],  sami[3],  sami[4],  sami[5],  sami[6],  sami[7]);
-               fwrite(line, sizeof(char), strlen(line), opc_daq.file);
-            }
-         }
-         // next pipe message
-         pipe = (pcm_pipe_daq_t)((uint8_t *)pipe + sizeof(cm_pipe_daq_t));
-      }
+   else if (opc_daq.file_type == OPC_FILE_CAPTURE && opc_daq.file != NULL) {
+      opc_cap_write(pipe, pkt_cnt);
    }
    //
-   // Write to CSV File
+   // Write to Text or CSV File
    //
-   else if (opc_daq.file_type == 2 && opc_daq.file != NULL) {
+   else if ((opc_daq.file_type == OPC_FILE_TEXT || opc_daq.file_type == OPC_FILE_CSV) &&
+             opc_daq.file != NULL) {
+      sep     = (opc_daq.file_type == OPC_FILE_TEXT) ? " " : ", ";
+      sep_len = (opc_daq.file_type == OPC_FILE_TEXT) ? 1 : 2;
       // cycle over multiple 1K pipe messages
       for (i=0;i<DAQ_MAX_PIPE_RUN;i++) {
-         // cycle over samples, packed in channel order
-         for (k=0,m=0;k<DAQ_MAX_SAM;k++) {
-            for (l=0;l<DAQ_MAX_CH;l++) {
-               opc_daq.adc[(i*DAQ_MAX_LEN) + m++] = ((int32_t)pipe->samples[(k * DAQ_MAX_CH) + l]);
-            }
-         }
-         for (l=0,j=0;l<DAQ_MAX_LEN;l+=DAQ_MAX_CH) {
-            k = (i * DAQ_MAX_LEN) + l;
-            if (opc_daq.real) {
-               for (m=0;m<DAQ_MAX_CH;m++) samf[m] = (float)(opc_daq.adc[k+m] * DAQ_LSB);
-               sprintf(line, "  %8d, %8E, %8E, %8E, %8E, %8E, %8E, %8E, %8E\n",
-                     ((opc_daq.pkt_cnt + i) * DAQ_MAX_SAM) + j++,
-                     samf[0],  samf[1],  samf[2],  samf[3],  samf[4],  samf[5],  samf[6],  samf[7]);
-               fwrite(line, sizeof(char), strlen(line), opc_daq.file);
-            }
-            else {
-               for (m=0;m<DAQ_MAX_CH;m++) sami[m] = opc_daq.adc[k+m];
-               sprintf(line, "  %8d, %8d, %8d, %8d, %8d, %8d, %8d, %8d, %8d\n",
-                     ((opc_daq.pkt_cnt + i) * DAQ_MAX_SAM) + j++,
-                     sami[0],  sami[1],  sami[2],  sami[3],  sami[4],  sami[5],  sami[6],  sami[7]);
-               fwrite(line, sizeof(char), strlen(line), opc_daq.file);
+         // samples are packed in channel order, one row per sample
+         sam = pipe->samples;
+         for (j=0;j<DAQ_MAX_SAM;j++) {
+            *p++ = ' ';
+            *p++ = ' ';
+            p = opc_fmt_uint(p, (pipe->seqid * DAQ_MAX_SAM) + j, 8);
+            for (m=0;m<DAQ_MAX_CH;m++) {
+               memcpy(p, sep, sep_len);
+               p += sep_len;
+               memcpy(p, &wrq.sam_str[sam[m] * OPC_WR_SAM_STR], OPC_WR_SAM_STR);
+               p += wrq.sam_len;
             }
+            *p++ = '\n';
+            sam += DAQ_MAX_CH;
          }
          // next pipe message
          pipe = (pcm_pipe_daq_t)((uint8_t *)pipe + sizeof(cm_pipe_daq_t));
       }
+      opc_file_out(wrq.out, p - wrq.out);
    }
 
    return result;
@@ -908,12 +1052,1075 @@ void opc_final(void) {
    pthread_cancel(opc.tid);
    pthread_join(opc.tid, NULL);
 
-   // Free the ADC Sample buffer
-   free(opc_daq.adc);
+   // Cancel DAQ File Writer
+   pthread_cancel(wrq.tid);
+   pthread_join(wrq.tid, NULL);
+
+   // Stop the DAQ Statistics Engine
+   opc_stat_final();
+
+   // Free the DAQ File Writer buffers
+   free(wrq.sam_str);
+   free(wrq.out);
 
    // Close the ADC file
-   if (opc_daq.file != NULL) fclose(opc_daq.file);
+   if (opc_daq.file != NULL) {
+      // resume stdio after the last mapped byte
+      if (opc_daq.mmap == TRUE) fseeko(opc_daq.file, opc_map_close(), SEEK_SET);
+      if (opc_daq.file_type == OPC_FILE_CAPTURE) opc_cap_close();
+      fclose(opc_daq.file);
+   }
 
 } // end opc_final()
 
 
+// ===========================================================================
+
+// 7.10
+
+static pcm_pipe_daq_t opc_pipe_get(void) {
+
+/* 7.10.1   Functional Description
+
+   This routine will remove the oldest pipe block from the DAQ pipe
+   subscription.
+
+   7.10.2   Parameters:
+
+   NONE
+
+   7.10.3   Return Values:
+
+   pipe     Pipe block or NULL when empty
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.10.4   Data Structures
+
+// 7.10.5   Code
+
+   return (pcm_pipe_daq_t)cm_pipe_get(opc.pipe_sub);
+
+} // end opc_pipe_get()
+
+
+// ===========================================================================
+
+// 7.11
+
+static void *opc_write_thread(void *data) {
+
+/* 7.11.1   Functional Description
+
+   This thread will write pipe blocks to the DAQ file, off the opc_thread
+   which drives the DAQ state machine. Every block is returned to the pipe
+   ring once written, in order, so this thread is the pipe ring consumer
+   while a file is open. The idle condition is signalled when the queue
+   drains.
+
+   7.11.2   Parameters:
+
+   data     Thread parameters
+
+   7.11.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.11.4   Data Structures
+
+   opc_wr_ent_t   ent;
+
+   struct timespec ts;
+
+// 7.11.5   Code
+
+   if (gc.trace & CFG_TRACE_ID) {
+      printf("opc_write_thread() started, data:tid %08X:%lu\n", (uint32_t)(uintptr_t)data, syscall(SYS_gettid));
+   }
+
+   // Block Write Loop
+   while (1) {
+
+      // Lock the Writer mutex
+      pthread_mutex_lock(&wrq.mutex);
+
+      // Wait on condition variable,
+      // this unlocks the mutex while waiting
+      while (wrq.head == wrq.tail) {
+         clock_gettime(CLOCK_REALTIME, &ts);
+         ts.tv_sec += 1;
+         pthread_cond_timedwait(&wrq.cv, &wrq.mutex, &ts);
+         // Prevent arbitrary cancellation point
+         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+         pthread_testcancel();
+         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+      }
+
+      ent = wrq.buf[wrq.tail % OPC_WR_QUE];
+
+      // Unlock the Writer mutex
+      pthread_mutex_unlock(&wrq.mutex);
+
+      // write to file
+      if (ent.write) opc_write_file(ent.pipe, ent.pkt_cnt);
+
+      // return block to the pipe ring
+      cm_pipe_free((pcm_pipe_t)ent.pipe);
+
+      // entry complete, wake the drain once empty
+      pthread_mutex_lock(&wrq.mutex);
+      wrq.tail++;
+      if (wrq.tail == wrq.head) pthread_cond_broadcast(&wrq.idle);
+      pthread_mutex_unlock(&wrq.mutex);
+   }
+
+   return 0;
+
+} // end opc_write_thread()
+
+
+// ===========================================================================
+
+// 7.12
+
+static void opc_write_put(pcm_pipe_daq_t pipe, uint32_t pkt_cnt, uint8_t write) {
+
+/* 7.12.1   Functional Description
+
+   This routine will queue a pipe block for the DAQ file writer. The pipe
+   ring bounds the number of blocks outstanding, so the queue never fills.
+
+   7.12.2   Parameters:
+
+   pipe     First pipe message of the block
+   pkt_cnt  Packet position of the block, its pipe seqid
+   write    FALSE to only return the block to the pipe ring
+
+   7.12.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.12.4   Data Structures
+
+// 7.12.5   Code
+
+   // Lock the Writer mutex
+   pthread_mutex_lock(&wrq.mutex);
+
+   wrq.buf[wrq.head % OPC_WR_QUE].pipe    = pipe;
+   wrq.buf[wrq.head % OPC_WR_QUE].pkt_cnt = pkt_cnt;
+   wrq.buf[wrq.head % OPC_WR_QUE].write   = write;
+   wrq.head++;
+
+   // Unlock the Writer mutex
+   pthread_mutex_unlock(&wrq.mutex);
+
+   // signal the Writer thread
+   pthread_cond_signal(&wrq.cv);
+
+} // end opc_write_put()
+
+
+// ===========================================================================
+
+// 7.13
+
+static uint32_t opc_write_init(void) {
+
+/* 7.13.1   Functional Description
+
+   This routine will build the sample column strings for every 16-bit ADC
+   code, using the same conversion as the original per-row sprintf(), so
+   text and CSV output is unchanged. The DAQ_LSB scaling is done once per
+   code for the whole table.
+
+   7.13.2   Parameters:
+
+   NONE
+
+   7.13.3   Return Values:
+
+   result   OPC_OK
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.13.4   Data Structures
+
+   uint32_t    result = OPC_OK;
+   uint32_t    i;
+   char        str[32];
+   float      *samf;
+
+// 7.13.5   Code
+
+   if (opc_daq.file_type != OPC_FILE_TEXT && opc_daq.file_type != OPC_FILE_CSV) return result;
+
+   if (opc_daq.real) {
+      // %8E of a positive value is always 12 characters
+      wrq.sam_len = OPC_WR_SAM_STR;
+      samf = (float *)malloc(OPC_WR_SAM_CODES * sizeof(float));
+      if (samf == NULL) return CFG_ERROR_OPC;
+      // scale every code
+      for (i=0;i<OPC_WR_SAM_CODES;i++) samf[i] = (float)(i * DAQ_LSB);
+      for (i=0;i<OPC_WR_SAM_CODES;i++) {
+         sprintf(str, "%8E", samf[i]);
+         memcpy(&wrq.sam_str[i * OPC_WR_SAM_STR], str, OPC_WR_SAM_STR);
+      }
+      free(samf);
+   }
+   else {
+      // %8d of a 16-bit code is always 8 characters
+      wrq.sam_len = 8;
+      for (i=0;i<OPC_WR_SAM_CODES;i++) {
+         sprintf(str, "%8d", i);
+         memcpy(&wrq.sam_str[i * OPC_WR_SAM_STR], str, 8);
+      }
+   }
+
+   return result;
+
+} // end opc_write_init()
+
+
+// ===========================================================================
+
+// 7.14
+
+static char *opc_fmt_uint(char *p, uint32_t val, uint32_t width) {
+
+/* 7.14.1   Functional Description
+
+   This routine will convert an unsigned value to decimal text, right
+   aligned to width, the same as the %8d format.
+
+   7.14.2   Parameters:
+
+   p        Output position
+   val      Value to convert
+   width    Minimum field width
+
+   7.14.3   Return Values:
+
+   p        Output position after the field
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.14.4   Data Structures
+
+   char        dig[10];
+   uint32_t    n = 0;
+
+// 7.14.5   Code
+
+   do {
+      dig[n++] = '0' + (val % 10);
+      val /= 10;
+   } while (val != 0);
+
+   while (width-- > n) *p++ = ' ';
+   while (n != 0) *p++ = dig[--n];
+
+   return p;
+
+} // end opc_fmt_uint()
+
+
+// ===========================================================================
+
+// 7.15
+
+static uint32_t opc_cap_open(void) {
+
+/* 7.15.1   Functional Description
+
+   This routine will start a DAQ capture container. The metadata header
+   is written now and rewritten by opc_cap_close() with the final chunk
+   count, sample count and index offset.
+
+   7.15.2   Parameters:
+
+   NONE
+
+   7.15.3   Return Values:
+
+   result   OPC_OK
+            CFG_ERROR_OPC on allocation or write failure
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.15.4   Data Structures
+
+   uint32_t    result = OPC_OK;
+   struct timespec ts;
+
+// 7.15.5   Code
+
+   clock_gettime(CLOCK_REALTIME, &ts);
+
+   memset(&cap.hdr, 0, sizeof(opc_cap_hdr_t));
+   cap.hdr.magic      = OPC_CAP_MAGIC;
+   cap.hdr.version    = OPC_CAP_VERSION;
+   cap.hdr.hdr_len    = sizeof(opc_cap_hdr_t);
+   cap.hdr.opcmd      = opc_daq.opcmd;
+   cap.hdr.packets    = opc_daq.packets;
+   cap.hdr.channels   = DAQ_MAX_CH;
+   cap.hdr.chunk_sam  = OPC_CAP_CHUNK_SAM;
+   cap.hdr.chunk_len  = OPC_CAP_CHUNK_LEN;
+   cap.hdr.fw_ver     = gc.fw_ver;
+   cap.hdr.sysid      = gc.sysid;
+   cap.hdr.fpga_epoch = gc.fpga_epoch;
+   cap.hdr.fpga_date  = gc.fpga_date;
+   cap.hdr.fpga_time  = gc.fpga_time;
+   memcpy(cap.hdr.vhdl, gc.vhdl, sizeof(cap.hdr.vhdl));
+   cap.hdr.start_sec  = (uint32_t)ts.tv_sec;
+   cap.hdr.start_usec = (uint32_t)(ts.tv_nsec / 1000);
+   cap.hdr.real       = opc_daq.real;
+   cap.hdr.lsb        = DAQ_LSB;
+
+   // chunk index, grown as needed
+   free(cap.idx);
+   cap.idx_max = OPC_CAP_IDX_GROW;
+   cap.idx     = (popc_cap_idx_t)malloc(cap.idx_max * sizeof(opc_cap_idx_t));
+
+   if (cap.idx == NULL ||
+       fwrite(&cap.hdr, sizeof(opc_cap_hdr_t), 1, opc_daq.file) != 1) {
+      printf("opc_cap_open() Error : DAQ capture did not start\n");
+      result = CFG_ERROR_OPC;
+   }
+
+   return result;
+
+} // end opc_cap_open()
+
+
+// ===========================================================================
+
+// 7.16
+
+static void opc_cap_write(pcm_pipe_daq_t pipe, uint32_t pkt_cnt) {
+
+/* 7.16.1   Functional Description
+
+   This routine will write one pipe block as a channel-deinterleaved
+   chunk and record its index entry.
+
+   7.16.2   Parameters:
+
+   pipe     First pipe message of the block
+   pkt_cnt  Packet position of the block, its pipe seqid
+
+   7.16.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.16.4   Data Structures
+
+   uint16_t      *out = (uint16_t *)wrq.out;
+   uint16_t      *sam;
+   uint32_t       i,j,m,n;
+   popc_cap_idx_t idx;
+   pcm_pipe_daq_t last;
+
+// 7.16.5   Code
+
+   // grow the index
+   if (cap.hdr.chunks == cap.idx_max) {
+      idx = (popc_cap_idx_t)realloc(cap.idx, (cap.idx_max + OPC_CAP_IDX_GROW) * sizeof(opc_cap_idx_t));
+      if (idx == NULL) {
+         if (gc.trace & CFG_TRACE_ERROR) {
+            printf("opc_cap_write() Error : chunk index full, chunk dropped\n");
+         }
+         return;
+      }
+      cap.idx      = idx;
+      cap.idx_max += OPC_CAP_IDX_GROW;
+   }
+
+   // ADC rate from the first pipe
+   if (cap.hdr.chunks == 0) cap.hdr.rate = pipe->rate;
+
+   // chunk index entry
+   last = (pcm_pipe_daq_t)((uint8_t *)pipe + ((DAQ_MAX_PIPE_RUN - 1) * sizeof(cm_pipe_daq_t)));
+   idx  = &cap.idx[cap.hdr.chunks];
+   idx->offset     = cap.hdr.hdr_len + ((uint64_t)cap.hdr.chunks * OPC_CAP_CHUNK_LEN);
+   idx->sample     = (uint64_t)pkt_cnt * DAQ_MAX_SAM;
+   idx->seqid      = pipe->seqid;
+   idx->seqid_last = last->seqid;
+   idx->stamp      = pipe->stamp;
+   idx->stamp_us   = pipe->stamp_us;
+   idx->status     = pipe->status;
+   idx->reserved   = 0;
+
+   // deinterleave, samples are packed in channel order
+   for (i=0,n=0;i<DAQ_MAX_PIPE_RUN;i++) {
+      sam = pipe->samples;
+      for (j=0;j<DAQ_MAX_SAM;j++,n++) {
+         for (m=0;m<DAQ_MAX_CH;m++) out[(m * OPC_CAP_CHUNK_SAM) + n] = sam[m];
+         sam += DAQ_MAX_CH;
+      }
+      // next pipe message
+      pipe = (pcm_pipe_daq_t)((uint8_t *)pipe + sizeof(cm_pipe_daq_t));
+   }
+
+   opc_file_out(out, OPC_CAP_CHUNK_LEN);
+
+   cap.hdr.chunks++;
+   cap.hdr.samples += OPC_CAP_CHUNK_SAM;
+
+} // end opc_cap_write()
+
+
+// ===========================================================================
+
+// 7.17
+
+static void opc_cap_close(void) {
+
+/* 7.17.1   Functional Description
+
+   This routine will write the chunk index, the pipe integrity summary
+   and footer, then rewrite the metadata header with the final counts.
+
+   7.17.2   Parameters:
+
+   NONE
+
+   7.17.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.17.4   Data Structures
+
+   opc_cap_foot_t foot;
+   opc_cap_pmon_t pmon;
+
+// 7.17.5   Code
+
+   if (cap.idx == NULL) return;
+
+   cap.hdr.index_off = cap.hdr.hdr_len + ((uint64_t)cap.hdr.chunks * OPC_CAP_CHUNK_LEN);
+
+   // index, integrity summary and footer
+   fseeko(opc_daq.file, (off_t)cap.hdr.index_off, SEEK_SET);
+   fwrite(cap.idx, sizeof(opc_cap_idx_t), cap.hdr.chunks, opc_daq.file);
+   pmon.magic     = OPC_CAP_PMON_MAGIC;
+   pmon.len       = sizeof(opc_cap_pmon_t);
+   pmon_get(&pmon.pmon);
+   fwrite(&pmon, sizeof(opc_cap_pmon_t), 1, opc_daq.file);
+   foot.magic     = OPC_CAP_IDX_MAGIC;
+   foot.chunks    = cap.hdr.chunks;
+   foot.index_off = cap.hdr.index_off;
+   fwrite(&foot, sizeof(opc_cap_foot_t), 1, opc_daq.file);
+
+   // final header
+   fseeko(opc_daq.file, 0, SEEK_SET);
+   fwrite(&cap.hdr, sizeof(opc_cap_hdr_t), 1, opc_daq.file);
+
+   free(cap.idx);
+   cap.idx = NULL;
+
+} // end opc_cap_close()
+
+
+// ===========================================================================
+
+// 7.18
+
+static void opc_file_out(void *buf, uint32_t len) {
+
+/* 7.18.1   Functional Description
+
+   This routine will write sample output to the ADC file, through the
+   mapped windows when daq.mmap is set, otherwise through stdio.
+
+   7.18.2   Parameters:
+
+   buf      Output bytes
+   len      Output length
+
+   7.18.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.18.4   Data Structures
+
+// 7.18.5   Code
+
+   if (opc_daq.mmap == TRUE)
+      opc_map_write(buf, len);
+   else
+      fwrite(buf, 1, len, opc_daq.file);
+
+} // end opc_file_out()
+
+
+// ===========================================================================
+
+// 7.19
+
+static void opc_pipe_notify(uint8_t sub) {
+
+/* 7.19.1   Functional Description
+
+   This routine will step the DAQ state machine for a queued or dropped
+   pipe block. It runs on the pipe source thread, so only the indication
+   is issued, and only when none is pending as the state drains every
+   queued block, a burst would otherwise overrun the receive queue.
+
+   7.19.2   Parameters:
+
+   sub      Subscription handle
+
+   7.19.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.19.4   Data Structures
+
+// 7.19.5   Code
+
+   // issue step indication, one at a time
+   if (!__atomic_exchange_n(&opc.pipe_step, TRUE, __ATOMIC_ACQ_REL)) {
+      cm_local(CM_ID_OPC_SRV, OPC_STEP_IND, OPC_STEP_PIPE, OPC_OK);
+   }
+
+} // end opc_pipe_notify()
+
+
+// ===========================================================================
+
+// 7.20
+
+uint32_t opc_mem_state(void) {
+
+/* 7.20.1   Functional Description
+
+   This function will handle the state machine for opcode OPC_CMD_MEM.
+   The device memory region mem.addr:mem.len is read with mem.width
+   accesses through the windowed CP block API and written to mem.file,
+   then the application is closed. With mem.stream the SDRAM region is
+   streamed through the pipe with cp_stream_read() instead.
+
+   7.20.2   Parameters:
+
+   NONE
+
+   7.20.3   Return Values:
+
+   result   OPC_OK
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.20.4   Data Structures
+
+   uint32_t    result = OPC_OK;
+   uint32_t    type, status, us;
+   uint8_t    *buf;
+   FILE       *file;
+
+   struct timespec t0, t1;
+
+// 7.20.5   Code
+
+   if (opc.sv.state == OPC_MEM_STATE_INIT) {
+
+      opc.sv.state = OPC_STATE_IDLE;
+
+      type = (cc.mem_width == 1) ? CFG_INT8U :
+             (cc.mem_width == 2) ? CFG_INT16U : CFG_INT32U;
+
+      buf = (uint8_t *)malloc(cc.mem_len);
+      if (buf == NULL) {
+         printf("opc_mem_state() Fatal Error : %d bytes not allocated\n", cc.mem_len);
+         gc.error |= LIN_ERROR_MALLOC;
+         gc.halt   = TRUE;
+         return result;
+      }
+
+      // read the region
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      if (cc.mem_stream) status = cp_stream_read(cc.mem_addr, cc.mem_len, buf, -1);
+      else status = cp_mem_read(cc.mem_addr, buf, cc.mem_len, type);
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      us = (t1.tv_sec - t0.tv_sec) * 1000000 + (t1.tv_nsec - t0.tv_nsec) / 1000;
+
+      if (status != CP_OK) {
+         printf("opc_mem_state() Error : read %08X:%d, status %X\n",
+               cc.mem_addr, cc.mem_len, status);
+         gc.error |= LIN_ERROR_CP;
+      }
+      else {
+         if (gc.trace & LIN_TRACE_RUN) {
+            printf("opc_mem_state() read %08X:%d in %d uS\n", cc.mem_addr, cc.mem_len, us);
+         }
+         file = fopen(cc.mem_file, "wb");
+         if (file == NULL) {
+            printf("opc_mem_state() Fatal Error : memory file did not Open, %s\n", cc.mem_file);
+            gc.error |= LIN_ERROR_FILE;
+         }
+         else {
+            fwrite(buf, 1, cc.mem_len, file);
+            fclose(file);
+         }
+      }
+
+      free(buf);
+
+      cm_send_reg_req(CM_DEV_DE0, CM_PORT_COM0, CM_REG_CLOSE, (uint8_t *)gc.dev_str);
+      usleep(100*1000);
+      gc.halt = TRUE;
+   }
+
+   return result;
+
+} // end opc_mem_state()
+
+
+// ===========================================================================
+
+// 7.21
+
+uint32_t opc_xlt_state(void) {
+
+/* 7.21.1   Functional Description
+
+   This function will handle the state machine for opcode OPC_CMD_XLT.
+   The firmware trace ring is taken from the UART drain and its records
+   are read, written to xlt.file and freed every xlt.poll_ms for
+   xlt.time_ms, once when 0. The ring is then handed back to the UART
+   and the application is closed. utils/xlt_dump decodes the file.
+
+   7.21.2   Parameters:
+
+   NONE
+
+   7.21.3   Return Values:
+
+   result   OPC_OK
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.21.4   Data Structures
+
+   uint32_t       result = OPC_OK;
+   uint32_t       status, n, first, ms;
+   cp_xlt_body_t  ring;
+   opc_xlt_hdr_t  hdr = {0};
+   uint8_t       *buf = NULL;
+   FILE          *file = NULL;
+
+   struct timespec t0, t1;
+
+// 7.21.5   Code
+
+   if (opc.sv.state != OPC_XLT_STATE_INIT) return result;
+
+   opc.sv.state = OPC_STATE_IDLE;
+
+   // take the ring from the UART
+   status = cp_xlt_req(CP_XLT_GET | CP_XLT_HOST, 0, &ring);
+   if (status == CP_OK && (ring.recs == 0 || (ring.recs & (ring.recs - 1)) != 0)) {
+      status = CP_ERR_NO_DATA;
+   }
+   if (status == CP_OK) {
+      buf = (uint8_t *)malloc(ring.recs * sizeof(cp_xlt_rec_t));
+      if (buf == NULL) {
+         printf("opc_xlt_state() Fatal Error : %d records not allocated\n", ring.recs);
+         gc.error |= LIN_ERROR_MALLOC;
+      }
+      file = fopen(cc.xlt_file, "wb");
+      if (file == NULL) {
+         printf("opc_xlt_state() Fatal Error : trace file did not Open, %s\n", cc.xlt_file);
+         gc.error |= LIN_ERROR_FILE;
+      }
+   }
+   else {
+      printf("opc_xlt_state() Error : trace ring, status %X\n", status);
+      gc.error |= LIN_ERROR_CP;
+   }
+
+   if (buf != NULL && file != NULL) {
+
+      hdr.magic    = OPC_XLT_MAGIC;
+      hdr.version  = OPC_XLT_VERSION;
+      hdr.hdr_len  = sizeof(opc_xlt_hdr_t);
+      hdr.rec_len  = sizeof(cp_xlt_rec_t);
+      hdr.freq     = ring.freq;
+      hdr.recs     = ring.recs;
+      hdr.fw_ver   = gc.fw_ver;
+      hdr.sysid    = gc.sysid;
+      fwrite(&hdr, sizeof(opc_xlt_hdr_t), 1, file);
+
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+
+      for (;;) {
+         // records written since the last pass, in one or two spans
+         n = ring.head - ring.tail;
+         if (n > ring.recs) n = ring.recs;
+         if (n != 0) {
+            first = ring.tail & (ring.recs - 1);
+            if (first + n <= ring.recs) {
+               status = opc_xlt_read(ring.address + first * sizeof(cp_xlt_rec_t), buf,
+                                     n * sizeof(cp_xlt_rec_t));
+            }
+            else {
+               status = opc_xlt_read(ring.address + first * sizeof(cp_xlt_rec_t), buf,
+                                     (ring.recs - first) * sizeof(cp_xlt_rec_t));
+               if (status == CP_OK) {
+                  status = opc_xlt_read(ring.address,
+                                        buf + (ring.recs - first) * sizeof(cp_xlt_rec_t),
+                                        (n - (ring.recs - first)) * sizeof(cp_xlt_rec_t));
+               }
+            }
+            if (status != CP_OK) break;
+            fwrite(buf, sizeof(cp_xlt_rec_t), n, file);
+            hdr.records += n;
+         }
+
+         // free what was read, the response is the next pass
+         status = cp_xlt_req(CP_XLT_FREE, ring.tail + n, &ring);
+         if (status != CP_OK) break;
+
+         clock_gettime(CLOCK_MONOTONIC, &t1);
+         ms = (t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000;
+         if (ms >= cc.xlt_time_ms || gc.halt) break;
+
+         usleep(cc.xlt_poll_ms * 1000);
+      }
+
+      if (status != CP_OK) {
+         printf("opc_xlt_state() Error : trace ring read, status %X\n", status);
+         gc.error |= LIN_ERROR_CP;
+      }
+
+      hdr.drops = ring.drops;
+      fseek(file, 0, SEEK_SET);
+      fwrite(&hdr, sizeof(opc_xlt_hdr_t), 1, file);
+
+      if (gc.trace & LIN_TRACE_RUN) {
+         printf("opc_xlt_state() %d records, %d dropped, to %s\n",
+               hdr.records, hdr.drops, cc.xlt_file);
+      }
+   }
+
+   // hand the ring back to the UART
+   if (buf != NULL || file != NULL) cp_xlt_req(CP_XLT_UART, 0, &ring);
+
+   if (file != NULL) fclose(file);
+   free(buf);
+
+   cm_send_reg_req(CM_DEV_DE0, CM_PORT_COM0, CM_REG_CLOSE, (uint8_t *)gc.dev_str);
+   usleep(100*1000);
+   gc.halt = TRUE;
+
+   return result;
+
+} // end opc_xlt_state()
+
+
+// ===========================================================================
+
+// 7.22
+
+static uint32_t opc_xlt_read(uint32_t address, void *buf, uint32_t len) {
+
+/* 7.22.1   Functional Description
+
+   This routine will read records of the firmware trace ring, through
+   the pipe with xlt.stream, otherwise with CP block requests that share
+   the message path with a DAQ run.
+
+   7.22.2   Parameters:
+
+   address  Device address of the first record
+   buf      Destination
+   len      Length in bytes
+
+   7.22.3   Return Values:
+
+   result   CP_OK, CP_ERR_* status or CP_ERR_TIMEOUT
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.22.4   Data Structures
+
+// 7.22.5   Code
+
+   if (cc.xlt_stream) return cp_stream_read(address, len, buf, -1);
+
+   return cp_mem_read(address, buf, len, CFG_INT32U);
+
+} // end opc_xlt_read()
+
+
+// ===========================================================================
+
+// 7.23
+
+static void opc_sched_print(void) {
+
+/* 7.23.1   Functional Description
+
+   This routine will report where the firmware background loop spent its
+   cycles since the accounting was cleared, CP_SCHED_REQ.
+
+   7.23.2   Parameters:
+
+   NONE
+
+   7.23.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.23.4   Data Structures
+
+   static const char *name[CP_SCHED_TASKS] = {"cm", "daq", "cp", "cli", "xlt"};
+
+   cp_sched_body_t   b;
+   uint32_t          status;
+   uint32_t          i;
+   double            elapsed, cycles;
+
+// 7.23.5   Code
+
+   status = cp_sched_req(CP_SCHED_GET, &b);
+   if (status != CP_OK) {
+      printf("opc_sched_print() Warning : no scheduler accounting, status %X\n", status);
+      return;
+   }
+
+   elapsed = (double)(((uint64_t)b.elapsed_hi << 32) | b.elapsed_lo);
+   if (elapsed == 0 || b.freq == 0) return;
+
+   printf("f/w sched : %.3f sec, %d passes\n", elapsed / b.freq, b.passes);
+   printf("  task      runs      msgs     ready   max uS    busy\n");
+   for (i=0;i<CP_SCHED_TASKS;i++) {
+      cycles = (double)(((uint64_t)b.task[i].cycles_hi << 32) | b.task[i].cycles_lo);
+      printf("  %-4s %9d %9d %9d %8.1f %6.2f%%\n", name[i], b.task[i].runs, b.task[i].msgs,
+            b.task[i].ready, (double)b.task[i].max * 1e6 / b.freq, cycles * 100.0 / elapsed);
+   }
+   cycles = (double)(((uint64_t)b.idle_hi << 32) | b.idle_lo);
+   printf("  idle %44.2f%%\n", cycles * 100.0 / elapsed);
+
+} // end opc_sched_print()
+
+
+// ===========================================================================
+
+// 7.24
+
+uint32_t opc_prof_state(void) {
+
+/* 7.24.1   Functional Description
+
+   This function will handle the state machine for opcode OPC_CMD_PROF.
+   The firmware cycle profile is cleared, left to run for prof.time_ms
+   and reported, as it is when 0. The application is then closed.
+
+   7.24.2   Parameters:
+
+   NONE
+
+   7.24.3   Return Values:
+
+   result   OPC_OK
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.24.4   Data Structures
+
+   uint32_t    result = OPC_OK;
+
+// 7.24.5   Code
+
+   if (opc.sv.state != OPC_PROF_STATE_INIT) return result;
+
+   opc.sv.state = OPC_STATE_IDLE;
+
+   if (cc.prof_time_ms != 0) {
+      opc_prof_clear();
+      usleep(cc.prof_time_ms * 1000);
+   }
+
+   opc_prof_print(cc.prof_clear ? CP_PROF_CLR : CP_PROF_GET);
+
+   cm_send_reg_req(CM_DEV_DE0, CM_PORT_COM0, CM_REG_CLOSE, (uint8_t *)gc.dev_str);
+   usleep(100*1000);
+   gc.halt = TRUE;
+
+   return result;
+
+} // end opc_prof_state()
+
+
+// ===========================================================================
+
+// 7.25
+
+static void opc_prof_clear(void) {
+
+/* 7.25.1   Functional Description
+
+   This routine will clear every firmware cycle profile point.
+
+   7.25.2   Parameters:
+
+   NONE
+
+   7.25.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.25.4   Data Structures
+
+   cp_prof_body_t b;
+   uint32_t       i;
+
+// 7.25.5   Code
+
+   for (i=0;i<CP_PROF_POINTS;i++) {
+      if (cp_prof_req(CP_PROF_CLR, i, &b) != CP_OK) break;
+   }
+
+} // end opc_prof_clear()
+
+
+// ===========================================================================
+
+// 7.26
+
+static void opc_prof_print(uint8_t flags) {
+
+/* 7.26.1   Functional Description
+
+   This routine will report the firmware cycle profile, CP_PROF_REQ, in
+   uS per point with the occupied log2 bins by their upper bound, and the
+   longest interrupts disabled window.
+
+   7.26.2   Parameters:
+
+   flags    CP_PROF_GET, CP_PROF_CLR
+
+   7.26.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.26.4   Data Structures
+
+   static const char *name[CP_PROF_POINTS] = {"opto_isr", "adc_isr", "gpio_isr",
+         "uart_isr", "tick_isr", "cm_alloc", "daq_msg", "cp_msg", "irq_off"};
+
+   cp_prof_body_t b;
+   uint32_t       status;
+   uint32_t       i, n;
+   double         us, sum;
+
+// 7.26.5   Code
+
+   for (i=0;i<CP_PROF_POINTS;i++) {
+      status = cp_prof_req(flags, i, &b);
+      if (status != CP_OK) {
+         printf("opc_prof_print() Warning : no cycle profile, status %X\n", status);
+         return;
+      }
+      if (b.freq == 0) return;
+      us = 1e6 / b.freq;
+      if (i == 0) {
+         printf("f/w prof : %d Hz\n", b.freq);
+         printf("  point         count     min uS    mean uS     max uS\n");
+      }
+      if (b.count == 0) {
+         printf("  %-8s %10d\n", name[i], 0);
+         continue;
+      }
+      sum = (double)(((uint64_t)b.sum_hi << 32) | b.sum_lo);
+      printf("  %-8s %10d %10.2f %10.2f %10.2f\n", name[i], b.count, b.min * us,
+            sum / b.count * us, b.max * us);
+      // bin n holds up to 2^n - 1 cycles, the last bin the rest
+      printf("          ");
+      for (n=0;n<CP_PROF_BINS;n++) {
+         if (b.hist[n] == 0) continue;
+         if (n == CP_PROF_BINS - 1)
+            printf(" >=%.2f:%d", (double)(1 << (n - 1)) * us, b.hist[n]);
+         else
+            printf(" <%.2f:%d", (double)(1 << n) * us, b.hist[n]);
+      }
+      printf("\n");
+      if (i == CP_PROF_IRQ_OFF) {
+         printf("  longest interrupts disabled window %.2f uS\n", b.max * us);
+      }
+   }
+
+} // end opc_prof_print()
+
+
+// ===========================================================================
+
+// 7.27
+
+static uint32_t opc_pipe_lost(void) {
+
+/* 7.27.1   Functional Description
+
+   This routine will return the pipe blocks lost since the run started,
+   spilled by the pipe ring before they reach the subscription or dropped
+   by the subscription when its queue is full.
+
+   7.27.2   Parameters:
+
+   NONE
+
+   7.27.3   Return Values:
+
+   lost     Pipe blocks
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.27.4   Data Structures
+
+   fifo_stats_t   stats;
+
+// 7.27.5   Code
+
+   if (cc.opc_media == CM_MEDIA_LAN) udp_stats(&stats);
+   else fifo_stats(&stats);
+
+   return stats.overruns - opc_daq.lost_base + cm_pipe_dropped(opc.pipe_sub);
+
+} // end opc_pipe_lost()
@@ -1,6 +1,14 @@
 #pragma once
 
 #define  OPC_RX_QUE           8
+#define  OPC_PIPE_QUE         FIFO_PIPE_SLOTS
+#define  OPC_WR_QUE           FIFO_PIPE_SLOTS
+
+// DAQ file writer, text/CSV formatting
+#define  OPC_WR_SAM_CODES     65536
+#define  OPC_WR_SAM_STR       12
+#define  OPC_WR_ROW_MAX       128
+#define  OPC_WR_BUF_LEN       (DAQ_MAX_PIPE_RUN * DAQ_MAX_SAM * OPC_WR_ROW_MAX)
 
 #define  OPC_STATE_IDLE       0
 
@@ -9,11 +17,74 @@
 #define  OPC_DAQ_STATE_RUN    2
 #define  OPC_DAQ_STATE_DONE   3
 
+#define  OPC_MEM_STATE_IDLE   OPC_STATE_IDLE
+#define  OPC_MEM_STATE_INIT   1
+
+#define  OPC_XLT_STATE_IDLE   OPC_STATE_IDLE
+#define  OPC_XLT_STATE_INIT   1
+
+#define  OPC_PROF_STATE_IDLE  OPC_STATE_IDLE
+#define  OPC_PROF_STATE_INIT  1
+
 #define  OPC_BLKS_PER_MSG     8 
 
 #define  OPC_TMR_APP_TIMEOUT  0x60
 
 
+// DAQ file types, daq.file_type
+#define  OPC_FILE_TEXT        0
+#define  OPC_FILE_BINARY      1
+#define  OPC_FILE_CSV         2
+#define  OPC_FILE_CAPTURE     3
+
+// DAQ capture container, daq.file_type = 3
+//
+//    opc_cap_hdr_t     fixed metadata header, rewritten on close
+//    chunk[chunks]     one per pipe block, channel-deinterleaved,
+//                      DAQ_MAX_CH runs of OPC_CAP_CHUNK_SAM uint16_t
+//    opc_cap_idx_t     index[chunks], at hdr.index_off
+//    opc_cap_pmon_t    pipe integrity summary, after the index
+//    opc_cap_foot_t    footer, last bytes of the file
+//
+// Stored sample n of channel c, counting only the chunks written, is at
+//    hdr_len + (n / chunk_sam) * chunk_len + (c * chunk_sam + n % chunk_sam) * 2
+//
+// A lost pipe block leaves no chunk, so stored and acquisition samples
+// differ after it. Acquisition sample a is found through the index, the
+// last entry with sample <= a holds it at
+//    offset + (c * chunk_sam + (a - sample)) * 2
+// when a - sample < chunk_sam, otherwise a was lost.
+//
+#define  OPC_CAP_MAGIC        0x44303143
+#define  OPC_CAP_IDX_MAGIC    0x49303143
+#define  OPC_CAP_PMON_MAGIC   0x50303143
+#define  OPC_CAP_VERSION      2
+#define  OPC_CAP_CHUNK_SAM    (DAQ_MAX_PIPE_RUN * DAQ_MAX_SAM)
+#define  OPC_CAP_CHUNK_LEN    (OPC_CAP_CHUNK_SAM * DAQ_MAX_CH * sizeof(uint16_t))
+#define  OPC_CAP_IDX_GROW     1024
+
+// Firmware trace file, OPC_CMD_XLT
+//
+//    opc_xlt_hdr_t     header, rewritten on close
+//    cp_xlt_rec_t      records[records], in sequence
+//
+#define  OPC_XLT_MAGIC        0x31544C58
+#define  OPC_XLT_VERSION      1
+
+// Firmware Trace File Header
+typedef struct _opc_xlt_hdr_t {
+   uint32_t    magic;
+   uint32_t    version;
+   uint32_t    hdr_len;
+   uint32_t    rec_len;
+   uint32_t    freq;
+   uint32_t    recs;
+   uint32_t    records;
+   uint32_t    drops;
+   uint32_t    fw_ver;
+   uint32_t    sysid;
+} opc_xlt_hdr_t, *popc_xlt_hdr_t;
+
 // OPC Generic State Vector
 typedef struct _opc_sv_t {
    int32_t     opcode;
@@ -36,6 +107,8 @@ typedef struct _opc_t {
    uint32_t    status;
    opc_sv_t    sv;
    pthread_t   tid;
+   uint8_t     pipe_sub;
+   uint8_t     pipe_step;
 } opc_t, *popc_t;
 
 // OPC DAQ State Vector, OPC_CMD_DAQ
@@ -44,7 +117,6 @@ typedef struct _opc_daq_sv_t {
    uint32_t    samcnt;
    uint32_t    opcmd;
    uint32_t    packets;
-   uint32_t    adc_index;
    uint32_t    blklen;
    uint32_t    to_file;
    uint32_t    file_type;
@@ -53,12 +125,71 @@ typedef struct _opc_daq_sv_t {
    uint32_t    real;
    uint8_t     acq_done;
    uint8_t     dat_done;
-   int32_t    *adc;
    FILE       *file;
+   uint8_t     mmap;
    uint32_t    pkt_cnt;
-   pcm_pipe_daq_t pipe;
+   uint32_t    lost_base;
 } opc_daq_sv_t, *popc_daq_sv_t;
 
+// DAQ Capture Header
+typedef struct _opc_cap_hdr_t {
+   uint32_t    magic;
+   uint32_t    version;
+   uint32_t    hdr_len;
+   uint32_t    opcmd;
+   uint32_t    rate;
+   uint32_t    packets;
+   uint32_t    channels;
+   uint32_t    chunk_sam;
+   uint32_t    chunk_len;
+   uint32_t    fw_ver;
+   uint32_t    sysid;
+   uint32_t    fpga_epoch;
+   uint32_t    fpga_date;
+   uint32_t    fpga_time;
+   uint8_t     vhdl[8];
+   uint32_t    start_sec;
+   uint32_t    start_usec;
+   uint32_t    real;
+   uint32_t    chunks;
+   double      lsb;
+   uint64_t    samples;
+   uint64_t    index_off;
+} opc_cap_hdr_t, *popc_cap_hdr_t;
+
+// DAQ Capture Chunk Index Entry
+typedef struct _opc_cap_idx_t {
+   uint64_t    offset;
+   uint64_t    sample;
+   uint32_t    seqid;
+   uint32_t    seqid_last;
+   uint32_t    stamp;
+   uint32_t    stamp_us;
+   uint32_t    status;
+   uint32_t    reserved;
+} opc_cap_idx_t, *popc_cap_idx_t;
+
+// DAQ Capture Pipe Integrity Summary
+typedef struct _opc_cap_pmon_t {
+   uint32_t     magic;
+   uint32_t     len;
+   pmon_stats_t pmon;
+} opc_cap_pmon_t, *popc_cap_pmon_t;
+
+// DAQ Capture Footer
+typedef struct _opc_cap_foot_t {
+   uint32_t    magic;
+   uint32_t    chunks;
+   uint64_t    index_off;
+} opc_cap_foot_t, *popc_cap_foot_t;
+
+// DAQ Capture State
+typedef struct _opc_cap_t {
+   opc_cap_hdr_t  hdr;
+   popc_cap_idx_t idx;
+   uint32_t       idx_max;
+} opc_cap_t, *popc_cap_t;
+
 // Receive Queue
 typedef struct _opc_rxq_t {
    uint32_t         *buf[OPC_RX_QUE];
@@ -69,11 +200,35 @@ typedef struct _opc_rxq_t {
    uint8_t           slots;
 } opc_rxq_t, *popc_rxq_t;
 
+// DAQ File Writer Entry
+typedef struct _opc_wr_ent_t {
+   pcm_pipe_daq_t    pipe;
+   uint32_t          pkt_cnt;
+   uint8_t           write;
+} opc_wr_ent_t, *popc_wr_ent_t;
+
+// DAQ File Writer Queue, opc_thread to opc_write_thread
+typedef struct _opc_wrq_t {
+   opc_wr_ent_t      buf[OPC_WR_QUE];
+   pthread_mutex_t   mutex;
+   pthread_cond_t    cv;
+   pthread_cond_t    idle;
+   pthread_t         tid;
+   uint32_t          head;
+   uint32_t          tail;
+   char             *sam_str;
+   uint32_t          sam_len;
+   char             *out;
+} opc_wrq_t, *popc_wrq_t;
+
 uint32_t opc_init(void);
 uint32_t opc_msg(pcm_msg_t msg);
 uint32_t opc_timer(pcm_msg_t msg);
 uint32_t opc_tick(void);
 uint32_t opc_qmsg(pcm_msg_t msg);
 uint32_t opc_daq_state(void);
-uint32_t opc_write_file(pcm_pipe_daq_t pipe);
+uint32_t opc_mem_state(void);
+uint32_t opc_xlt_state(void);
+uint32_t opc_prof_state(void);
+uint32_t opc_write_file(pcm_pipe_daq_t pipe, uint32_t pkt_cnt);
 void     opc_final(void);
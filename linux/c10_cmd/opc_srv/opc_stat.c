@@ -0,0 +1,706 @@
+/*-----------------------------------------------------------------------------
+
+   1  ABSTRACT
+
+   1.1 Module Type
+
+      DAQ Statistics Engine
+
+   1.2 Functional Description
+
+      This code implements a DAQ pipe subscriber that reduces every pipe
+      message to per-channel min/max/mean/RMS and clip counts, keeps a
+      running histogram per channel, and publishes the results periodically
+      as the OPC_STAT_IND indication.
+
+   1.3 Specification/Design Reference
+
+      See fw_cfg.h under the share directory.
+
+   1.4 Module Test Specification Reference
+
+      opc_stat_bench(), run with the -s command line option, checks the
+      vector reductions against the scalar reference and reports both rates.
+
+   1.5 Compilation Information
+
+      See fw_cfg.h under the share directory.
+
+   1.6 Notes
+
+      The 8 interleaved channels of a sample row are exactly one 128-bit
+      vector of uint16_t, so each row is reduced with GCC vector extensions.
+      These compile to NEON or SSE2 where available and to scalar code on
+      targets without SIMD. Samples are full 16-bit codes, the ADC ramp
+      test mode counts through all of them. Sums are held in 32-bit lanes
+      and squares in 64-bit lanes, flushed every OPC_STAT_ROWS rows.
+      Little-endian hosts only.
+
+   2  CONTENTS
+
+      1 ABSTRACT
+        1.1 Module Type
+        1.2 Functional Description
+        1.3 Specification/Design Reference
+        1.4 Module Test Specification Reference
+        1.5 Compilation Information
+        1.6 Notes
+
+      2 CONTENTS
+
+      3 VOCABULARY
+
+      4 EXTERNAL RESOURCES
+        4.1  Include Files
+        4.2  External Data Structures
+        4.3  External Function Prototypes
+
+      5 LOCAL CONSTANTS AND MACROS
+
+      6 MODULE DATA STRUCTURES
+        6.1  Local Function Prototypes
+        6.2  Local Data Structures
+
+      7 MODULE CODE
+        7.1  opc_stat_init()
+        7.2  opc_stat_thread()
+        7.3  opc_stat_notify()
+        7.4  opc_stat_block()
+        7.5  opc_stat_ref()
+        7.6  opc_stat_hist()
+        7.7  opc_stat_publish()
+        7.8  opc_stat_bench()
+        7.9  opc_stat_final()
+        7.10 opc_stat_clear()
+
+-----------------------------------------------------------------------------*/
+
+// 3 VOCABULARY
+
+// 4 EXTERNAL RESOURCES
+
+// 4.1  Include Files
+
+#include "main.h"
+
+// 4.2   External Data Structures
+
+// 4.3   External Function Prototypes
+
+// 5 LOCAL CONSTANTS AND MACROS
+
+   // one sample row, DAQ_MAX_CH lanes
+   typedef  uint16_t v8u16_t __attribute__ ((vector_size (16)));
+   typedef  int16_t  v8i16_t __attribute__ ((vector_size (16)));
+   typedef  uint32_t v4u32_t __attribute__ ((vector_size (16)));
+   typedef  uint64_t v2u64_t __attribute__ ((vector_size (16)));
+
+   #define  OPC_STAT_MS(a, b)  (((b).tv_sec - (a).tv_sec) * 1000 + \
+                                ((b).tv_nsec - (a).tv_nsec) / 1000000)
+
+// 6 MODULE DATA STRUCTURES
+
+// 6.1  Local Function Prototypes
+
+   static   void *opc_stat_thread(void *data);
+   static   void  opc_stat_notify(uint8_t sub);
+   static   void  opc_stat_block(popc_stat_acc_t acc, uint16_t *sam, uint32_t rows);
+   static   void  opc_stat_ref(popc_stat_acc_t acc, uint16_t *sam, uint32_t rows);
+   static   void  opc_stat_hist(uint16_t *sam, uint32_t rows);
+   static   void  opc_stat_publish(uint32_t period_ms);
+   static   void  opc_stat_clear(popc_stat_acc_t acc);
+
+// 6.2  Local Data Structures
+
+   static   opc_stat_t     st = {0};
+
+// 7 MODULE CODE
+
+// ===========================================================================
+
+// 7.1
+
+uint32_t opc_stat_init(void) {
+
+/* 7.1.1   Functional Description
+
+   This routine will subscribe to DAQ pipe messages and start the
+   statistics thread, when daq.stats is set.
+
+   7.1.2   Parameters:
+
+   NONE
+
+   7.1.3   Return Values:
+
+   result   OPC_OK
+            CFG_ERROR_OPC
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.1.4   Data Structures
+
+   uint32_t    result = OPC_OK;
+
+// 7.1.5   Code
+
+   memset(&st, 0, sizeof(opc_stat_t));
+   st.sub = CM_PIPE_SUB_NULL;
+
+   if (cc.daq_stats == 0) return result;
+
+   opc_stat_clear(&st.acc);
+   clock_gettime(CLOCK_MONOTONIC, &st.last);
+
+   pthread_mutex_init(&st.mutex, NULL);
+   pthread_cond_init(&st.cv, NULL);
+
+   // Start the Statistics Thread
+   if (pthread_create(&st.tid, NULL, opc_stat_thread, NULL)) {
+      result = CFG_ERROR_OPC;
+   }
+   // statistics never hold up the file writer, oldest dropped first
+   else {
+      st.sub = cm_pipe_sub(CM_ID_OPC_SRV, CM_PIPE_DAQ_DATA, OPC_STAT_QUE,
+                           CM_PIPE_DROP_OLD, opc_stat_notify);
+      if (st.sub == CM_PIPE_SUB_NULL) result = CFG_ERROR_OPC;
+   }
+
+   return result;
+
+} // end opc_stat_init()
+
+
+// ===========================================================================
+
+// 7.2
+
+static void *opc_stat_thread(void *data) {
+
+/* 7.2.1   Functional Description
+
+   This thread will reduce every queued pipe block and publish the
+   statistics every daq.stats_ms.
+
+   7.2.2   Parameters:
+
+   data     Thread parameters
+
+   7.2.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.2.4   Data Structures
+
+   pcm_pipe_daq_t    pipe, msg;
+   uint32_t          i, ms;
+
+   struct timespec   ts, now;
+
+// 7.2.5   Code
+
+   if (gc.trace & CFG_TRACE_ID) {
+      printf("opc_stat_thread() started, data:tid %08X:%lu\n", (uint32_t)(uintptr_t)data, syscall(SYS_gettid));
+   }
+
+   while (1) {
+
+      // Lock the Statistics mutex
+      pthread_mutex_lock(&st.mutex);
+
+      // Wait on condition variable,
+      // this unlocks the mutex while waiting
+      if (st.pending == FALSE) {
+         clock_gettime(CLOCK_REALTIME, &ts);
+         ts.tv_nsec += OPC_STAT_WAIT_MS * 1000000L;
+         if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+         }
+         pthread_cond_timedwait(&st.cv, &st.mutex, &ts);
+      }
+      st.pending = FALSE;
+
+      // Unlock the Statistics mutex
+      pthread_mutex_unlock(&st.mutex);
+
+      // Prevent arbitrary cancellation point
+      pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+      pthread_testcancel();
+      pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+      // reduce every queued block
+      while ((pipe = (pcm_pipe_daq_t)cm_pipe_get(st.sub)) != NULL) {
+         msg = pipe;
+         for (i=0;i<DAQ_MAX_PIPE_RUN;i++) {
+            opc_stat_block(&st.acc, msg->samples, DAQ_MAX_SAM);
+            opc_stat_hist(msg->samples, DAQ_MAX_SAM);
+            msg = (pcm_pipe_daq_t)((uint8_t *)msg + sizeof(cm_pipe_daq_t));
+         }
+         st.acc.blocks += DAQ_MAX_PIPE_RUN;
+         cm_pipe_free((pcm_pipe_t)pipe);
+      }
+
+      // publish the period
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      ms = OPC_STAT_MS(st.last, now);
+      if (ms >= cc.daq_stats_ms && st.acc.blocks != 0) {
+         opc_stat_publish(ms);
+         opc_stat_clear(&st.acc);
+         st.last = now;
+      }
+   }
+
+   return (void *)0;
+
+} // end opc_stat_thread()
+
+
+// ===========================================================================
+
+// 7.3
+
+static void opc_stat_notify(uint8_t sub) {
+
+/* 7.3.1   Functional Description
+
+   This routine will wake the statistics thread for a queued pipe block.
+   It runs on the pipe source thread.
+
+   7.3.2   Parameters:
+
+   sub      Subscription handle
+
+   7.3.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.3.4   Data Structures
+
+// 7.3.5   Code
+
+   pthread_mutex_lock(&st.mutex);
+   st.pending = TRUE;
+   pthread_cond_signal(&st.cv);
+   pthread_mutex_unlock(&st.mutex);
+
+} // end opc_stat_notify()
+
+
+// ===========================================================================
+
+// 7.4
+
+static void opc_stat_block(popc_stat_acc_t acc, uint16_t *sam, uint32_t rows) {
+
+/* 7.4.1   Functional Description
+
+   This routine will reduce interleaved sample rows into the channel
+   accumulators, one vector per row. Clip counts are held in 16-bit
+   lanes, sums in 32-bit lanes and squares in 64-bit lanes for
+   OPC_STAT_ROWS rows, then added to the 64-bit accumulators.
+
+   7.4.2   Parameters:
+
+   acc      Channel accumulators
+   sam      DAQ_MAX_CH interleaved samples per row
+   rows     Sample rows
+
+   7.4.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.4.4   Data Structures
+
+   v8u16_t     v, mn, mx;
+   v8i16_t     c, m;
+   v4u32_t     lo, hi, s[2];
+   v2u64_t     sq[4];
+   uint32_t    i, j, n;
+
+   const v8u16_t  zero  = {0};
+   const v4u32_t  zero32 = {0};
+   const v8u16_t  clip0 = {OPC_STAT_CLIP_LO, OPC_STAT_CLIP_LO, OPC_STAT_CLIP_LO, OPC_STAT_CLIP_LO,
+                           OPC_STAT_CLIP_LO, OPC_STAT_CLIP_LO, OPC_STAT_CLIP_LO, OPC_STAT_CLIP_LO};
+   const v8u16_t  clip1 = {OPC_STAT_CLIP_HI, OPC_STAT_CLIP_HI, OPC_STAT_CLIP_HI, OPC_STAT_CLIP_HI,
+                           OPC_STAT_CLIP_HI, OPC_STAT_CLIP_HI, OPC_STAT_CLIP_HI, OPC_STAT_CLIP_HI};
+   const v8u16_t  sel_lo = {0, 8, 1, 9, 2, 10, 3, 11};
+   const v8u16_t  sel_hi = {4, 12, 5, 13, 6, 14, 7, 15};
+   const v4u32_t  sel_q0 = {0, 4, 1, 5};
+   const v4u32_t  sel_q1 = {2, 6, 3, 7};
+
+// 7.4.5   Code
+
+   memcpy(&mn, acc->min, sizeof(v8u16_t));
+   memcpy(&mx, acc->max, sizeof(v8u16_t));
+
+   for (i=0;i<rows;i+=n) {
+      n = (rows - i < OPC_STAT_ROWS) ? rows - i : OPC_STAT_ROWS;
+      c     = (v8i16_t)zero;
+      s[0]  = s[1]  = zero32;
+      sq[0] = sq[1] = sq[2] = sq[3] = (v2u64_t)zero32;
+      for (j=0;j<n;j++) {
+         memcpy(&v, &sam[(i + j) * DAQ_MAX_CH], sizeof(v8u16_t));
+         // min and max, by lane mask
+         m  = (v < mn);
+         mn = (v8u16_t)(((v8i16_t)v & m) | ((v8i16_t)mn & ~m));
+         m  = (v > mx);
+         mx = (v8u16_t)(((v8i16_t)v & m) | ((v8i16_t)mx & ~m));
+         // clipped codes, the mask is -1
+         c -= (v <= clip0) | (v >= clip1);
+         // sums widened to 32 bits, squares to 64 bits
+         lo = (v4u32_t)__builtin_shuffle(v, zero, sel_lo);
+         hi = (v4u32_t)__builtin_shuffle(v, zero, sel_hi);
+         s[0] += lo;
+         s[1] += hi;
+         lo *= lo;
+         hi *= hi;
+         sq[0] += (v2u64_t)__builtin_shuffle(lo, zero32, sel_q0);
+         sq[1] += (v2u64_t)__builtin_shuffle(lo, zero32, sel_q1);
+         sq[2] += (v2u64_t)__builtin_shuffle(hi, zero32, sel_q0);
+         sq[3] += (v2u64_t)__builtin_shuffle(hi, zero32, sel_q1);
+      }
+      for (j=0;j<DAQ_MAX_CH;j++) {
+         acc->sum[j]   += s[j >> 2][j & 3];
+         acc->sumsq[j] += sq[j >> 1][j & 1];
+         acc->clip[j]  += (uint16_t)c[j];
+      }
+   }
+
+   memcpy(acc->min, &mn, sizeof(v8u16_t));
+   memcpy(acc->max, &mx, sizeof(v8u16_t));
+   acc->samples += rows;
+
+} // end opc_stat_block()
+
+
+// ===========================================================================
+
+// 7.5
+
+static void opc_stat_ref(popc_stat_acc_t acc, uint16_t *sam, uint32_t rows) {
+
+/* 7.5.1   Functional Description
+
+   This routine is the scalar reference for opc_stat_block(), used by
+   opc_stat_bench().
+
+   7.5.2   Parameters:
+
+   acc      Channel accumulators
+   sam      DAQ_MAX_CH interleaved samples per row
+   rows     Sample rows
+
+   7.5.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.5.4   Data Structures
+
+   uint32_t    i, j;
+   uint16_t    v;
+
+// 7.5.5   Code
+
+   for (i=0;i<rows;i++) {
+      for (j=0;j<DAQ_MAX_CH;j++) {
+         v = sam[(i * DAQ_MAX_CH) + j];
+         if (v < acc->min[j]) acc->min[j] = v;
+         if (v > acc->max[j]) acc->max[j] = v;
+         if (v <= OPC_STAT_CLIP_LO || v >= OPC_STAT_CLIP_HI) acc->clip[j]++;
+         acc->sum[j]   += v;
+         acc->sumsq[j] += (uint32_t)v * v;
+      }
+   }
+
+   acc->samples += rows;
+
+} // end opc_stat_ref()
+
+
+// ===========================================================================
+
+// 7.6
+
+static void opc_stat_hist(uint16_t *sam, uint32_t rows) {
+
+/* 7.6.1   Functional Description
+
+   This routine will add interleaved sample rows to the running
+   histogram, OPC_STAT_BINS bins per channel.
+
+   7.6.2   Parameters:
+
+   sam      DAQ_MAX_CH interleaved samples per row
+   rows     Sample rows
+
+   7.6.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.6.4   Data Structures
+
+   uint32_t    i, j;
+   uint16_t    v;
+
+// 7.6.5   Code
+
+   for (i=0;i<rows;i++) {
+      for (j=0;j<DAQ_MAX_CH;j++) {
+         v = *sam++;
+         if (v > OPC_STAT_CLIP_HI) v = OPC_STAT_CLIP_HI;
+         st.hist[j][v >> OPC_STAT_BIN_SHIFT]++;
+      }
+   }
+
+} // end opc_stat_hist()
+
+
+// ===========================================================================
+
+// 7.7
+
+static void opc_stat_publish(uint32_t period_ms) {
+
+/* 7.7.1   Functional Description
+
+   This routine will issue the OPC_STAT_IND indication for the period.
+
+   7.7.2   Parameters:
+
+   period_ms   Period length in milliseconds
+
+   7.7.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.7.4   Data Structures
+
+   cm_send_t   ps = {0};
+   uint32_t    i;
+   double      n = (double)st.acc.samples;
+
+// 7.7.5   Code
+
+   pcmq_t slot = cm_alloc();
+   if (slot != NULL) {
+      popc_stat_ind_msg_t msg = (popc_stat_ind_msg_t)slot->buf;
+      msg->p.srvid       = CM_ID_OPC_SRV;
+      msg->p.msgid       = OPC_STAT_IND;
+      msg->p.flags       = OPC_NO_FLAGS;
+      msg->p.status      = OPC_OK;
+      msg->b.blocks      = st.acc.blocks;
+      msg->b.samples     = st.acc.samples;
+      msg->b.period_ms   = period_ms;
+      for (i=0;i<DAQ_MAX_CH;i++) {
+         msg->b.min[i]   = st.acc.min[i];
+         msg->b.max[i]   = st.acc.max[i];
+         msg->b.mean[i]  = (uint32_t)((st.acc.sum[i] * OPC_STAT_FRAC) / st.acc.samples);
+         msg->b.rms[i]   = (uint32_t)(sqrt((double)st.acc.sumsq[i] / n) * OPC_STAT_FRAC);
+         msg->b.clip[i]  = st.acc.clip[i];
+      }
+      ps.msg       = (pcm_msg_t)msg;
+      ps.src_cmid  = CM_ID_OPC_SRV;
+      ps.msglen    = sizeof(opc_stat_ind_msg_t);
+      // Send the Indication
+      cm_send(CM_MSG_IND, &ps);
+      st.published++;
+   }
+
+} // end opc_stat_publish()
+
+
+// ===========================================================================
+
+// 7.8
+
+void opc_stat_bench(void) {
+
+/* 7.8.1   Functional Description
+
+   This routine will run the vector reductions and the scalar reference
+   over the same synthetic pipe blocks, check that they agree and report
+   the rate of each against the pipe rate. The check is repeated over a
+   full range 16-bit ramp, as the ADC ramp test mode produces.
+
+   7.8.2   Parameters:
+
+   NONE
+
+   7.8.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.8.4   Data Structures
+
+   uint16_t         *sam;
+   opc_stat_acc_t    vec, ref;
+   uint32_t          i, len;
+   double            t_vec, t_ref, mb;
+
+   struct timespec   t0, t1;
+
+// 7.8.5   Code
+
+   // one pipe block of samples, noise over a ramp with clipping
+   len = DAQ_MAX_PIPE_RUN * DAQ_MAX_LEN;
+   sam = (uint16_t *)malloc(len * sizeof(uint16_t));
+   if (sam == NULL) return;
+   srand(1);
+   for (i=0;i<len;i++) {
+      sam[i] = (uint16_t)((i & 0x0FFF) + (rand() & 0x3F) - 0x20);
+      if (sam[i] > OPC_STAT_CLIP_HI) sam[i] = (i & 0x800) ? OPC_STAT_CLIP_HI : OPC_STAT_CLIP_LO;
+   }
+
+   mb = (double)OPC_STAT_BENCH_BLKS * DAQ_MAX_PIPE_RUN * sizeof(cm_pipe_daq_t) / 1E6;
+
+   opc_stat_clear(&vec);
+   clock_gettime(CLOCK_MONOTONIC, &t0);
+   for (i=0;i<OPC_STAT_BENCH_BLKS * DAQ_MAX_PIPE_RUN;i++) {
+      opc_stat_block(&vec, &sam[(i % DAQ_MAX_PIPE_RUN) * DAQ_MAX_LEN], DAQ_MAX_SAM);
+   }
+   clock_gettime(CLOCK_MONOTONIC, &t1);
+   t_vec = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1E9;
+
+   opc_stat_clear(&ref);
+   clock_gettime(CLOCK_MONOTONIC, &t0);
+   for (i=0;i<OPC_STAT_BENCH_BLKS * DAQ_MAX_PIPE_RUN;i++) {
+      opc_stat_ref(&ref, &sam[(i % DAQ_MAX_PIPE_RUN) * DAQ_MAX_LEN], DAQ_MAX_SAM);
+   }
+   clock_gettime(CLOCK_MONOTONIC, &t1);
+   t_ref = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1E9;
+
+   printf("opc_stat_bench() %d pipe blocks, %.1f MB\n", OPC_STAT_BENCH_BLKS, mb);
+   printf("  vector : %8.3f s  %8.1f MB/s\n", t_vec, mb / t_vec);
+   printf("  scalar : %8.3f s  %8.1f MB/s\n", t_ref, mb / t_ref);
+   printf("  result : %s\n", (memcmp(&vec, &ref, sizeof(opc_stat_acc_t)) == 0) ?
+         "match" : "MISMATCH");
+
+   // 16-bit ramp, wraps through the top codes
+   for (i=0;i<len;i++) {
+      sam[i] = (uint16_t)(0xF000 + i);
+   }
+   opc_stat_clear(&vec);
+   opc_stat_clear(&ref);
+   for (i=0;i<DAQ_MAX_PIPE_RUN;i++) {
+      opc_stat_block(&vec, &sam[i * DAQ_MAX_LEN], DAQ_MAX_SAM);
+      opc_stat_ref(&ref, &sam[i * DAQ_MAX_LEN], DAQ_MAX_SAM);
+   }
+   printf("  ramp   : %s\n", (memcmp(&vec, &ref, sizeof(opc_stat_acc_t)) == 0) ?
+         "match" : "MISMATCH");
+
+   free(sam);
+
+} // end opc_stat_bench()
+
+
+// ===========================================================================
+
+// 7.9
+
+void opc_stat_final(void) {
+
+/* 7.9.1   Functional Description
+
+   This routine will stop the statistics thread and report the running
+   histogram, as the 1%, 50% and 99% bins per channel.
+
+   7.9.2   Parameters:
+
+   NONE
+
+   7.9.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.9.4   Data Structures
+
+   uint32_t    i, j, n, run;
+   uint32_t    pct[3];
+
+// 7.9.5   Code
+
+   if (cc.daq_stats == 0) return;
+
+   // Cancel Thread
+   pthread_cancel(st.tid);
+   pthread_join(st.tid, NULL);
+
+   cm_pipe_unsub(st.sub);
+   st.sub = CM_PIPE_SUB_NULL;
+
+   printf("opc_stat_final() %d indications, histogram codes 1%%:50%%:99%%\n", st.published);
+   for (i=0;i<DAQ_MAX_CH;i++) {
+      for (j=0,n=0;j<OPC_STAT_BINS;j++) n += st.hist[i][j];
+      if (n == 0) continue;
+      // first bin reaching each fraction of the samples
+      pct[0] = pct[1] = pct[2] = OPC_STAT_BINS;
+      for (j=0,run=0;j<OPC_STAT_BINS;j++) {
+         run += st.hist[i][j];
+         if (pct[0] == OPC_STAT_BINS && run >= n / 100) pct[0] = j;
+         if (pct[1] == OPC_STAT_BINS && run >= n / 2) pct[1] = j;
+         if (pct[2] == OPC_STAT_BINS && run >= n - (n / 100)) pct[2] = j;
+      }
+      printf("  ch%d : %4d:%4d:%4d\n", i, pct[0] << OPC_STAT_BIN_SHIFT,
+            pct[1] << OPC_STAT_BIN_SHIFT, pct[2] << OPC_STAT_BIN_SHIFT);
+   }
+
+} // end opc_stat_final()
+
+
+// ===========================================================================
+
+// 7.10
+
+static void opc_stat_clear(popc_stat_acc_t acc) {
+
+/* 7.10.1   Functional Description
+
+   This routine will reset the channel accumulators for a new period.
+
+   7.10.2   Parameters:
+
+   acc      Channel accumulators
+
+   7.10.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.10.4   Data Structures
+
+   uint32_t    i;
+
+// 7.10.5   Code
+
+   memset(acc, 0, sizeof(opc_stat_acc_t));
+   for (i=0;i<DAQ_MAX_CH;i++) acc->min[i] = 0xFFFF;
+
+} // end opc_stat_clear()
@@ -0,0 +1,45 @@
+#pragma once
+
+// DAQ statistics, daq.stats
+#define  OPC_STAT_QUE         8
+#define  OPC_STAT_ROWS        16
+#define  OPC_STAT_FRAC        16
+#define  OPC_STAT_BINS        64
+#define  OPC_STAT_BIN_SHIFT   6
+#define  OPC_STAT_CLIP_LO     0x0000
+#define  OPC_STAT_CLIP_HI     0x0FFF
+#define  OPC_STAT_WAIT_MS     100
+#define  OPC_STAT_BENCH_BLKS  4096
+
+// 16-bit codes, OPC_STAT_ROWS per 32-bit lane sum
+#if (0xFFFFULL * OPC_STAT_ROWS) > 0xFFFFFFFFULL
+#error OPC_STAT_ROWS overflows the 32-bit lane sums
+#endif
+
+// Per Channel Accumulators
+typedef struct _opc_stat_acc_t {
+   uint16_t          min[DAQ_MAX_CH];
+   uint16_t          max[DAQ_MAX_CH];
+   uint64_t          sum[DAQ_MAX_CH];
+   uint64_t          sumsq[DAQ_MAX_CH];
+   uint32_t          clip[DAQ_MAX_CH];
+   uint32_t          samples;
+   uint32_t          blocks;
+} opc_stat_acc_t, *popc_stat_acc_t;
+
+// DAQ Statistics Engine
+typedef struct _opc_stat_t {
+   uint8_t           sub;
+   uint8_t           pending;
+   pthread_t         tid;
+   pthread_mutex_t   mutex;
+   pthread_cond_t    cv;
+   struct timespec   last;
+   opc_stat_acc_t    acc;
+   uint32_t          hist[DAQ_MAX_CH][OPC_STAT_BINS];
+   uint32_t          published;
+} opc_stat_t, *popc_stat_t;
+
+uint32_t opc_stat_init(void);
+void     opc_stat_bench(void);
+void     opc_stat_final(void);
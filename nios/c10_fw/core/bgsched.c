@@ -0,0 +1,393 @@
+/*-----------------------------------------------------------------------------
+
+   1  ABSTRACT
+
+   1.1 Module Type
+
+      Background Scheduler
+
+   1.2 Functional Description
+
+      The background loop scheduler routines are contained in this module.
+
+      The background tasks, CM routing, the DAQ and CP services, the CLI and
+      the deferred trace drain, are run to completion in priority order.
+      Producers mark a task ready with sched_ready(), from the ISRs or the
+      background, when they queue work for it. Each pass runs the highest
+      priority ready task, which delivers up to its batch of messages, so a
+      DAQ indication waits for at most one batch of CP or CLI work. A task
+      that leaves work queued marks itself ready again. When no task is
+      ready the SCHED_POLL tasks are run with a batch of 0, CM for its
+      timers and the CLI for its loop commands.
+
+      The alt_timestamp() cycles of every run are charged to the task when
+      the run did work and to idle otherwise. CP_SCHED_REQ returns and
+      clears the accounting.
+
+   1.3 Specification/Design Reference
+
+      See fw_cfg.h under the share directory.
+
+   1.4 Module Test Specification Reference
+
+      None
+
+   1.5 Compilation Information
+
+      See fw_cfg.h under the share directory.
+
+   1.6 Notes
+
+      The ready bits are cleared before a task runs, work queued while it
+      runs marks it ready again and is not lost.
+
+   2  CONTENTS
+
+      1 ABSTRACT
+        1.1 Module Type
+        1.2 Functional Description
+        1.3 Specification/Design Reference
+        1.4 Module Test Specification Reference
+        1.5 Compilation Information
+        1.6 Notes
+
+      2 CONTENTS
+
+      3 VOCABULARY
+
+      4 EXTERNAL RESOURCES
+        4.1  Include Files
+        4.2  External Data Structures
+        4.3  External Function Prototypes
+
+      5 LOCAL CONSTANTS AND MACROS
+
+      6 MODULE DATA STRUCTURES
+        6.1  Local Function Prototypes
+        6.2  Local Data Structures
+
+      7 MODULE CODE
+        7.1  sched_init()
+        7.2  sched_ready()
+        7.3  sched_run()
+        7.4  sched_exec()
+        7.5  sched_cli()
+        7.6  sched_ctl()
+
+-----------------------------------------------------------------------------*/
+
+// 3 VOCABULARY
+
+// 4 EXTERNAL RESOURCES
+
+// 4.1  Include Files
+
+#include "main.h"
+
+// 4.2   External Data Structures
+
+// 4.3 External Function Prototypes
+
+// 5 LOCAL CONSTANTS AND MACROS
+
+// 6 MODULE DATA STRUCTURES
+
+// 6.1  Local Function Prototypes
+
+   static   void     sched_exec(uint32_t task, uint32_t batch);
+   static   uint32_t sched_cli(uint32_t batch);
+
+// 6.2  Local Data Structures
+
+   static   sched_t        sched = {0};
+
+   // task table, in priority order
+   static   sched_task_t   tasks[SCHED_TASKS] = {
+      {cm_thread,    SCHED_MSGS,       SCHED_POLL  },
+      {daq_thread,   SCHED_MSGS,       SCHED_EVENT },
+      {cp_thread,    SCHED_MSGS,       SCHED_EVENT },
+      {sched_cli,    1,                SCHED_POLL  },
+      {xlt_drain,    XLT_DRAIN_MAX,    SCHED_EVENT },
+   };
+
+// 7 MODULE CODE
+
+// ===========================================================================
+
+// 7.1
+
+uint32_t sched_init(void) {
+
+/* 7.1.1   Functional Description
+
+   This routine will clear the accounting and mark every task ready, so
+   work queued while the services started is picked up.
+
+   7.1.2   Parameters:
+
+   NONE
+
+   7.1.3   Return Values:
+
+   result   SCHED_OK
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.1.4   Data Structures
+
+   uint32_t    result = SCHED_OK;
+
+   alt_irq_context context;
+
+// 7.1.5   Code
+
+   context = PROF_IRQ_DISABLE();
+
+   memset(&sched, 0, sizeof(sched_t));
+   sched.ready = (1 << SCHED_TASKS) - 1;
+   sched.stamp = alt_timestamp();
+
+   PROF_IRQ_ENABLE(context);
+
+   return result;
+
+} // end sched_init()
+
+
+// ===========================================================================
+
+// 7.2
+
+void sched_ready(uint32_t task) {
+
+/* 7.2.1   Functional Description
+
+   This routine will mark a task ready, safe from the ISRs.
+
+   7.2.2   Parameters:
+
+   task     SCHED_TASK_*
+
+   7.2.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.2.4   Data Structures
+
+   alt_irq_context context;
+
+// 7.2.5   Code
+
+   context = PROF_IRQ_DISABLE();
+
+   sched.ready |= (1 << task);
+   sched.stat[task].ready++;
+
+   PROF_IRQ_ENABLE(context);
+
+} // end sched_ready()
+
+
+// ===========================================================================
+
+// 7.3
+
+void sched_run(void) {
+
+/* 7.3.1   Functional Description
+
+   This routine will make one scheduler pass from the background loop,
+   the highest priority ready task runs, or the SCHED_POLL tasks when no
+   task is ready.
+
+   7.3.2   Parameters:
+
+   NONE
+
+   7.3.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.3.4   Data Structures
+
+   uint32_t    ready;
+   uint32_t    task;
+   uint32_t    now;
+
+   alt_irq_context context;
+
+// 7.3.5   Code
+
+   ready = sched.ready;
+
+   if (ready != 0) {
+      // highest priority ready task
+      for (task=0;(ready & (1 << task)) == 0;task++);
+
+      context = PROF_IRQ_DISABLE();
+      sched.ready &= ~(1 << task);
+      PROF_IRQ_ENABLE(context);
+
+      sched_exec(task, tasks[task].batch);
+   }
+   else {
+      for (task=0;task<SCHED_TASKS;task++) {
+         if (tasks[task].flags & SCHED_POLL) sched_exec(task, 0);
+      }
+   }
+
+   now = alt_timestamp();
+   sched.elapsed += (uint32_t)(now - sched.stamp);
+   sched.stamp    = now;
+   sched.passes++;
+
+} // end sched_run()
+
+
+// ===========================================================================
+
+// 7.4
+
+static void sched_exec(uint32_t task, uint32_t batch) {
+
+/* 7.4.1   Functional Description
+
+   This routine will run a task and charge its cycles.
+
+   7.4.2   Parameters:
+
+   task     SCHED_TASK_*
+   batch    Messages to deliver, 0 for a poll
+
+   7.4.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.4.4   Data Structures
+
+   uint32_t          n;
+   uint32_t          start;
+   uint32_t          cycles;
+   pcp_sched_task_t  stat = &sched.stat[task];
+
+// 7.4.5   Code
+
+   start  = alt_timestamp();
+   n      = tasks[task].fn(batch);
+   cycles = (uint32_t)(alt_timestamp() - start);
+
+   if (n != 0) {
+      sched.cycles[task] += cycles;
+      stat->runs++;
+      stat->msgs += n;
+      if (cycles > stat->max) stat->max = cycles;
+   }
+   else {
+      sched.idle += cycles;
+   }
+
+} // end sched_exec()
+
+
+// ===========================================================================
+
+// 7.5
+
+static uint32_t sched_cli(uint32_t batch) {
+
+/* 7.5.1   Functional Description
+
+   This routine will run the CLI, made ready by the UART ISR for a new
+   character and polled for the loop commands.
+
+   7.5.2   Parameters:
+
+   batch    1 when made ready, 0 for a poll
+
+   7.5.3   Return Values:
+
+   result   1 when a command or loop command ran, else 0
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.5.4   Data Structures
+
+   uint32_t    loop_cnt = gc.cli.loop_cnt;
+
+// 7.5.5   Code
+
+   cli_process(&gc.cli);
+
+   return (batch != 0 || gc.cli.loop_cnt != loop_cnt) ? 1 : 0;
+
+} // end sched_cli()
+
+
+// ===========================================================================
+
+// 7.6
+
+void sched_ctl(uint8_t flags, pcp_sched_body_t body) {
+
+/* 7.6.1   Functional Description
+
+   This routine will serve CP_SCHED_REQ, the accounting is returned in
+   body and CP_SCHED_CLR starts it again.
+
+   7.6.2   Parameters:
+
+   flags    CP_SCHED_GET, CP_SCHED_CLR
+   body     Response body
+
+   7.6.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.6.4   Data Structures
+
+   uint32_t    i;
+
+   alt_irq_context context;
+
+// 7.6.5   Code
+
+   context = PROF_IRQ_DISABLE();
+
+   body->freq       = alt_timestamp_freq();
+   body->elapsed_hi = (uint32_t)(sched.elapsed >> 32);
+   body->elapsed_lo = (uint32_t)sched.elapsed;
+   body->idle_hi    = (uint32_t)(sched.idle >> 32);
+   body->idle_lo    = (uint32_t)sched.idle;
+   body->passes     = sched.passes;
+   for (i=0;i<SCHED_TASKS;i++) {
+      body->task[i] = sched.stat[i];
+      body->task[i].cycles_hi = (uint32_t)(sched.cycles[i] >> 32);
+      body->task[i].cycles_lo = (uint32_t)sched.cycles[i];
+   }
+
+   if (flags & CP_SCHED_CLR) {
+      sched.elapsed = 0;
+      sched.idle    = 0;
+      sched.passes  = 0;
+      memset(sched.cycles, 0, sizeof(sched.cycles));
+      memset(sched.stat, 0, sizeof(sched.stat));
+   }
+
+   PROF_IRQ_ENABLE(context);
+
+} // end sched_ctl()
+
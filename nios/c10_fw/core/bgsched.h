@@ -0,0 +1,44 @@
+#pragma once
+
+#define  SCHED_OK              0x00000000
+
+// Tasks in priority order, the lowest number runs first
+#define  SCHED_TASK_CM         CP_SCHED_CM
+#define  SCHED_TASK_DAQ        CP_SCHED_DAQ
+#define  SCHED_TASK_CP         CP_SCHED_CP
+#define  SCHED_TASK_CLI        CP_SCHED_CLI
+#define  SCHED_TASK_XLT        CP_SCHED_XLT
+#define  SCHED_TASKS           CP_SCHED_TASKS
+
+// Messages delivered per run before higher priority tasks are looked at
+#define  SCHED_MSGS            8
+
+// Task Flags, SCHED_POLL tasks also run when no task is ready
+#define  SCHED_EVENT           0x00
+#define  SCHED_POLL            0x01
+
+// Task Run, delivers up to batch items and returns the count, a task
+// that leaves work queued calls sched_ready() for itself
+typedef uint32_t (*sched_fn_t)(uint32_t batch);
+
+typedef struct _sched_task_t {
+   sched_fn_t        fn;
+   uint32_t          batch;
+   uint32_t          flags;
+} sched_task_t, *psched_task_t;
+
+// Scheduler, the ready bits are set from the ISRs
+typedef struct _sched_t {
+   volatile uint32_t ready;
+   uint32_t          stamp;
+   uint64_t          elapsed;
+   uint64_t          idle;
+   uint32_t          passes;
+   uint64_t          cycles[SCHED_TASKS];
+   cp_sched_task_t   stat[SCHED_TASKS];
+} sched_t, *psched_t;
+
+uint32_t  sched_init(void);
+void      sched_ready(uint32_t task);
+void      sched_run(void);
+void      sched_ctl(uint8_t flags, pcp_sched_body_t body);
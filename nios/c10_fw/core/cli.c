@@ -97,6 +97,8 @@
    static void mw_loop_f(int argc, char **argv);
    static void reg_test_f(int argc, char **argv);
    static void mem_test_f(int argc, char **argv);
+   static void sched_f(int argc, char **argv);
+   static void txq_f(int argc, char **argv);
 
    static cmd_t cmd_tbl[] = {
       {.cmd = "help",      .func = help_f       },
@@ -118,6 +120,8 @@
       {.cmd = "mw_loop",   .func = mw_loop_f    },
       {.cmd = "reg_test",  .func = reg_test_f   },
       {.cmd = "mem_test",  .func = mem_test_f   },
+      {.cmd = "sched",     .func = sched_f      },
+      {.cmd = "txq",       .func = txq_f        },
    };
 
    static uint32_t   loop_ms = 10;
@@ -206,6 +210,10 @@ void help_f(int argc, char **argv) {
    xlprint("   mem_test    periodically write and read verify the selected memory address\n");
    xlprint("               mem_test [address] [count] [loop_ms]\n");
    xlprint("               mem_test 0x00800000 0x400 1\n");
+   xlprint("   sched       background task cycles since cleared, clr to clear\n");
+   xlprint("               sched [clr]\n");
+   xlprint("   txq         OPTO transmit queue counts since cleared, clr to clear\n");
+   xlprint("               txq [clr]\n");
    xlprint("\n");
    xlprint("default loop time : %d ms\n\n", loop_ms);
    xlprint("status : \n\n");
@@ -495,3 +503,33 @@ void mem_test_f(int argc, char **argv) {
       }
    }
 }
+
+void sched_f(int argc, char **argv) {
+   static const char *name[CP_SCHED_TASKS] = {"cm", "daq", "cp", "cli", "xlt"};
+   cp_sched_body_t   b;
+   uint64_t          elapsed, cycles;
+   uint32_t          i;
+   sched_ctl((argc == 2 && strcmp(argv[1], "clr") == 0) ? CP_SCHED_CLR : CP_SCHED_GET, &b);
+   elapsed = ((uint64_t)b.elapsed_hi << 32) | b.elapsed_lo;
+   if (elapsed == 0) elapsed = 1;
+   xlprint("sched : %d passes, %d cycles/sec\n", b.passes, b.freq);
+   xlprint("   task     runs     msgs    ready   max cyc   busy\n");
+   for (i=0;i<CP_SCHED_TASKS;i++) {
+      cycles = ((uint64_t)b.task[i].cycles_hi << 32) | b.task[i].cycles_lo;
+      xlprint("   %-4s %8d %8d %8d %9d %4d.%d%%\n", name[i], b.task[i].runs,
+            b.task[i].msgs, b.task[i].ready, b.task[i].max,
+            (uint32_t)(cycles * 1000 / elapsed) / 10, (uint32_t)(cycles * 1000 / elapsed) % 10);
+   }
+   cycles = ((uint64_t)b.idle_hi << 32) | b.idle_lo;
+   xlprint("   idle %45d.%d%%\n", (uint32_t)(cycles * 1000 / elapsed) / 10,
+         (uint32_t)(cycles * 1000 / elapsed) % 10);
+}
+
+void txq_f(int argc, char **argv) {
+   opto_txq_t        q;
+   opto_tx_stats(&q, (argc == 2 && strcmp(argv[1], "clr") == 0));
+   xlprint("txq : %d of %d queued, %d peak%s\n",
+         (q.head - q.tail + q.slots) % q.slots, q.slots, q.peak,
+         q.rsv ? ", h/w slot reserved" : "");
+   xlprint("   copied %d, in place %d, dropped %d\n", q.copied, q.direct, q.drops);
+}
@@ -81,6 +81,15 @@
         7.25 cm_thread()
         7.26 cm_log()
         7.27 cm_final()
+        7.28 cm_timer_start()
+        7.29 cm_timer_cancel()
+        7.30 cm_tmr_expire()
+        7.31 cm_tmr_now()
+        7.32 cm_tmr_grow()
+        7.33 cm_tmr_sift()
+        7.34 cm_tmr_remove()
+        7.35 cm_alloc_len()
+        7.36 cm_tx_alloc()
 
 -----------------------------------------------------------------------------*/
 
@@ -105,10 +114,24 @@
 
 // 6.1  Local Function Prototypes
 
+   static   uint32_t cm_tmr_expire(void);
+   static   uint64_t cm_tmr_now(void);
+   static   uint32_t cm_tmr_grow(void);
+   static   void  cm_tmr_sift(uint32_t pos);
+   static   void  cm_tmr_remove(uint32_t idx);
+
 // 6.2  Local Data Structures
 
    static   cm_t        cm = {0};
    static   cmq_t       cmq[CM_MSGQ_SLOTS] = {0};
+   static   uint32_t    cmq_raw[CM_Q_RAW_LEN] = {0};
+
+   // slot length and count per size class, smallest first
+   static   const cmq_cls_t cmq_cls[CM_Q_CLASSES] = {
+               {CM_Q_SML_LEN, CM_Q_SML_SLOTS},
+               {CM_Q_MED_LEN, CM_Q_MED_SLOTS},
+               {CM_Q_LRG_LEN, CM_Q_LRG_SLOTS}
+   };
 
    static uint8_t crc_array[] = {
       0x00, 0x5e, 0xbc, 0xe2, 0x61, 0x3f, 0xdd, 0x83,
@@ -171,7 +194,8 @@ uint32_t cm_init(void) {
 // 7.1.4   Data Structures
 
    uint32_t   result = CFG_ERROR_OK;
-   uint32_t   i;
+   uint32_t   i, j, c;
+   uint32_t  *raw;
 
 // 7.1.5   Code
 
@@ -193,6 +217,9 @@ uint32_t cm_init(void) {
       cm.obj[i].sub   = NULL;
    }
 
+   // Direct cmid to handle map, CM_MAX_OBJS is the empty object
+   memset(cm.obj_map, CM_MAX_OBJS, sizeof(cm.obj_map));
+
    // Initialize the CM Pipes
    for (i=0;i<CM_MAX_PIPES;i++) {
       cm.pipe[i].cmid = CM_ID_NULL;
@@ -204,13 +231,15 @@ uint32_t cm_init(void) {
       cm.pipe[i].pipelen = 0;
    }
 
-   // Initialize the CM Timers
+   // Initialize the CM Timer Service, deadlines on the stamp counter
+   cm.tmr.free = CM_TMR_IDLE;
    for (i=0;i<CM_MAX_TIMERS;i++) {
-      cm.tim[i].cmid   = CM_ID_NULL;
-      cm.tim[i].srvid  = CM_ID_NULL;
-      cm.tim[i].msgid  = 0;
-      cm.tim[i].count  = 0;
-      cm.tim[i].reload = 0;
+      cm.tmr.legacy[i] = CM_TMR_NULL;
+   }
+   cm.tmr.last_stamp = stamp_count();
+   cm.tmr.now_ticks  = 0;
+   if (cm_tmr_grow() != CM_OK) {
+      result = CFG_ERROR_CM;
    }
 
    // Initialize the CM Routing Table
@@ -233,16 +262,26 @@ uint32_t cm_init(void) {
    cm.seqid       = 0;
    cm.last_us     = 0;
 
-   // Init Queue
+   // Init Queue, the slots of each size class are carved from the
+   // raw pool and chained into the free list of their class
    memset(&cmq, 0, sizeof(cmq));
    cm.q_head    = 0;
    cm.q_tail    = 0;
    cm.q_msg_cnt = 0;
-   for (i=0;i<CM_MSGQ_SLOTS;i++) {
-      cmq[i].size  = CM_MSGQ_BUF_LEN;
-      cmq[i].state = CM_Q_IDLE;
-      // allow room for uint32_t length
-      cmq[i].buf   = &cmq[i].raw[1];
+   raw = cmq_raw;
+   for (c=0,i=0;c<CM_Q_CLASSES;c++) {
+      cm.q_free[c] = CM_Q_NULL;
+      for (j=0;j<cmq_cls[c].slots;j++,i++) {
+         cmq[i].size  = cmq_cls[c].len;
+         cmq[i].state = CM_Q_IDLE;
+         cmq[i].cls   = c;
+         cmq[i].raw   = raw;
+         // allow room for uint32_t length
+         cmq[i].buf   = &raw[1];
+         cmq[i].next  = cm.q_free[c];
+         cm.q_free[c] = i;
+         raw += cmq_cls[c].len + CM_Q_PAD;
+      }
    }
 
    // Register this instance of the CM
@@ -304,6 +343,7 @@ uint8_t cm_register(uint8_t cmid, uint32_t (*msg)(pcm_msg_t msg),
       cm.obj[cm.num_objs].sub   = cmsub;
       // Store Handle and Next Object
       handle = cm.num_objs++;
+      cm.obj_map[cmid] = handle;
    }
 
    // Place Object in Routing Table
@@ -394,6 +434,13 @@ uint32_t cm_send(uint8_t msg_type, pcm_send_t ps) {
    the incoming pS structure. The newly created message will then be placed in
    in the Media's transmit queue for delivery.
 
+   A response may be turned around in the slot of its request, ps->msg
+   equal to ps->req, the request header is copied before it is replaced.
+
+   An outbound message is handed to its port here rather than through
+   the queue, a message built in place with cm_tx_alloc() is sent without
+   a copy and a full port transmit queue is returned.
+
    7.4.2   Parameters:
 
    msg_type CM_MSG_REQ, CM_MSG_RESP, CM_MSG_IND or CM_MSG_TIMER
@@ -401,7 +448,7 @@ uint32_t cm_send(uint8_t msg_type, pcm_send_t ps) {
 
    7.4.3   Return Values:
 
-   result      CM_OK, else CM_ERROR
+   result      CM_OK, CM_ERR_TX_FULL or CM_ERR_TX_DROP, else CM_ERROR
 
 -----------------------------------------------------------------------------
 */
@@ -409,6 +456,7 @@ uint32_t cm_send(uint8_t msg_type, pcm_send_t ps) {
 // 7.4.4   Data Structures
 
    uint32_t    result = CM_OK;
+   cm_hdr_t    req;
 
 // 7.4.5   Code
 
@@ -447,16 +495,19 @@ uint32_t cm_send(uint8_t msg_type, pcm_send_t ps) {
       //  RESPONSE
       //
       else if (msg_type == CM_MSG_RESP && ps->req != NULL) {
+         // copy of the Request header, the response
+         // may be turned around in the request slot
+         req = ps->req->h;
          // Use the Request's Sequence ID
-         ps->msg->h.seqid     = ps->req->h.seqid;
+         ps->msg->h.seqid     = req.seqid;
          // Destination from Request Msg
-         ps->msg->h.dst_cmid  = ps->req->h.src_cmid;
-         ps->msg->h.dst_devid = ps->req->h.src_devid;
+         ps->msg->h.dst_cmid  = req.src_cmid;
+         ps->msg->h.dst_devid = req.src_devid;
          // Source from Request Msg
-         ps->msg->h.src_cmid  = ps->req->h.dst_cmid;
-         ps->msg->h.src_devid = ps->req->h.dst_devid;
+         ps->msg->h.src_cmid  = req.dst_cmid;
+         ps->msg->h.src_devid = req.dst_devid;
          // Port Connection, from requester
-         ps->msg->h.port      = ps->req->h.port;
+         ps->msg->h.port      = req.port;
       }
       //
       //  INDICATION
@@ -527,8 +578,15 @@ uint32_t cm_send(uint8_t msg_type, pcm_send_t ps) {
       // Compute the Message CRC
       cm_crc(ps->msg, CM_CALC_CRC);
 
+      // outbound, straight to the port
+      if (ps->msg->h.dst_devid != cm.devid || ps->msg->h.slot == CM_Q_NULL) {
+         cm_log(ps->msg);
+         result = cm.port[ps->msg->h.port].io(CM_IO_TX, ps->msg);
+      }
       // queue the message
-      cm_qmsg(ps->msg);
+      else {
+         cm_qmsg(ps->msg);
+      }
 
    }
 
@@ -545,8 +603,9 @@ pcmq_t cm_alloc(void) {
 
 /* 7.5.1   Functional Description
 
-   This routine will allocate a queue slot from the local CM queue.
-   All allocated messages are the same length.
+   This routine will allocate a queue slot of the large class from the
+   local CM queue, for a message of unknown length or one that may be
+   turned around as a longer response. See cm_alloc_len().
 
    7.5.2   Parameters:
 
@@ -561,48 +620,9 @@ pcmq_t cm_alloc(void) {
 
 // 7.5.4   Data Structures
 
-   pcmq_t      slot = NULL;
-   uint32_t    i;
-   pcm_msg_t   msg = NULL;
-
-   alt_irq_context context;
-
 // 7.5.5   Code
 
-   // Disable ALL interrupts
-   context = alt_irq_disable_all();
-
-   // Find next available slot
-   for (i=0;i<CM_MSGQ_SLOTS;i++) {
-      if (cmq[cm.q_head].state == CM_Q_IDLE) {
-         cmq[cm.q_head].state = CM_Q_ALLOC;
-         slot = &cmq[cm.q_head];
-         // clear the entire buffer
-         memset(slot->raw, 0, sizeof(uint32_t) * CM_MSGQ_BUF_LEN);
-         // account for uint32_t length at raw start
-         msg = (pcm_msg_t)slot->buf;
-         // used to retrieve slot from message
-         msg->h.slot = cm.q_head;
-         // in CM circular queue, so don't delete
-         msg->h.keep = 1;
-         if (++cm.q_head >= CM_MSGQ_SLOTS) cm.q_head = 0;
-         if (gc.trace & CFG_TRACE_CM) {
-            xlprint("cm_alloc(), slotid:slot = %02X:%08X\n", msg->h.slot, (uint32_t)slot);
-         }
-         break;
-      }
-      if (++cm.q_head >= CM_MSGQ_SLOTS) cm.q_head = 0;
-   }
-
-   // Enable ALL interrupts
-   alt_irq_enable_all(context);
-
-   if (gc.trace & CFG_TRACE_ERROR) {
-      if (slot == NULL)
-         xlprint("cm_alloc() No Queue Slots Available\n");
-   }
-
-   return slot;
+   return cm_alloc_len(CM_Q_LRG_LEN << 2);
 
 } // end cm_alloc()
 
@@ -615,7 +635,8 @@ void cm_free(pcm_msg_t msg) {
 
 /* 7.6.1   Functional Description
 
-   This routine will release the slot in the queue.
+   This routine will release the slot in the queue, or a message built in
+   place in its port back to the port unsent.
 
    7.6.2   Parameters:
 
@@ -636,23 +657,35 @@ void cm_free(pcm_msg_t msg) {
 
 // 7.6.5   Code
 
-   // Disable ALL interrupts
-   context = alt_irq_disable_all();
+   // Release the Port Reservation
+   if (msg != NULL && msg->h.slot == CM_Q_NULL) {
+      cm.port[msg->h.port].io(CM_IO_FREE, msg);
+   }
+   // Release the Slot, to the head of its free list
+   else if (msg != NULL && msg->h.slot < CM_MSGQ_SLOTS &&
+         (uint32_t *)msg == cmq[msg->h.slot].buf) {
 
-   // Release the Slot
-   if (msg != NULL) {
       slot = &cmq[msg->h.slot];
-      slot->state = CM_Q_IDLE;
+
+      // Disable ALL interrupts
+      context = PROF_IRQ_DISABLE();
+
+      // once only, a second free would link the slot twice
+      if (slot->state != CM_Q_IDLE) {
+         slot->state = CM_Q_IDLE;
+         slot->next  = cm.q_free[slot->cls];
+         cm.q_free[slot->cls] = msg->h.slot;
+      }
+
+      // Enable ALL interrupts
+      PROF_IRQ_ENABLE(context);
    }
    else {
       if (gc.trace & CFG_TRACE_ERROR) {
-         xlprint("cm_free() Null Pointer\n");
+         xlprint("cm_free() Invalid Slot\n");
       }
    }
 
-   // Enable ALL interrupts
-   alt_irq_enable_all(context);
-
 } // end cm_free()
 
 
@@ -773,7 +806,7 @@ uint32_t cm_msg(pcm_msg_t msg) {
       //
       if (msg->p.flags & CM_REG_OPEN) {
          pcm_reg_msg_t req = (pcm_reg_msg_t)msg;
-         pcmq_t slot = cm_alloc();
+         pcmq_t slot = cm_alloc_len(sizeof(cm_reg_msg_t));
          if (slot != NULL) {
             // remove existing devid routes
             for (i=0;i<CM_MAX_ROUTES;i++) {
@@ -895,7 +928,7 @@ uint32_t cm_msg(pcm_msg_t msg) {
    //    CM QUERY REQUEST
    //
    else if (cm_msg == MSG(CM_ID_INSTANCE, CM_QUERY_REQ)) {
-      pcmq_t slot = cm_alloc();
+      pcmq_t slot = cm_alloc_len(sizeof(cm_query_msg_t));
       if (slot != NULL) {
          pcm_query_msg_t rsp = (pcm_query_msg_t)slot->buf;
          rsp->p.srvid      = CM_ID_INSTANCE;
@@ -946,7 +979,8 @@ uint8_t cm_get_handle(uint8_t cmid) {
 
 /* 7.9.1   Functional Description
 
-   This routine will return the handle for a particular cmid.
+   This routine will return the handle for a particular cmid, by direct
+   lookup in the map filled by cm_register().
 
    7.9.2   Parameters:
 
@@ -961,18 +995,10 @@ uint8_t cm_get_handle(uint8_t cmid) {
 
 // 7.9.4   Data Structures
 
-   uint32_t   i;
-
 // 7.9.5   Code
 
-   // Search for cmid in active Objects
-   for (i=0;i<cm.num_objs;i++) {
-      if (cm.obj[i].id == cmid) {
-         return i;
-      }
-   }
-
-   return CM_MAX_OBJS;
+   // Direct lookup, unregistered IDs map to the empty object
+   return cm.obj_map[cmid];
 
 } // end cm_get_handle()
 
@@ -1126,8 +1152,10 @@ uint32_t cm_timer_set(uint8_t timerid, uint8_t msgid, uint32_t time_ms,
 
 /* 7.13.1   Functional Description
 
-   This routine will set the interval count of the timer associated
-   with timerid. Timer resolution is based on WIN_TICKS_PER_SECOND.
+   This routine will set the periodic timer associated with timerid,
+   the fixed timer IDs are kept for existing objects and map onto a
+   handle from cm_timer_start(). Setting an armed timerid replaces the
+   previous interval.
 
    7.13.2   Parameters:
 
@@ -1153,11 +1181,12 @@ uint32_t cm_timer_set(uint8_t timerid, uint8_t msgid, uint32_t time_ms,
 
    // Validate Timer
    if (k < CM_MAX_TIMERS) {
-      cm.tim[k].cmid   = cmid;
-      cm.tim[k].srvid  = srvid;
-      cm.tim[k].msgid  = msgid;
-      cm.tim[k].count  = time_ms / CFG_TICKS_MS;
-      cm.tim[k].reload = time_ms / CFG_TICKS_MS;
+      if (cm.tmr.legacy[k] != CM_TMR_NULL) {
+         cm_timer_cancel(cm.tmr.legacy[k]);
+      }
+      cm.tmr.legacy[k] = cm_timer_start(msgid, time_ms * 1000, cmid, srvid,
+                                        CM_TMR_PERIODIC, timerid);
+      if (cm.tmr.legacy[k] != CM_TMR_NULL) result = CM_OK;
    }
    // Timer ID Error
    else {
@@ -1199,11 +1228,8 @@ uint32_t cm_timer_kill(uint8_t timerid, uint8_t cmid) {
 
    // Validate Timer
    if (k < CM_MAX_TIMERS) {
-      cm.tim[k].cmid   = CM_MSG_NULL;
-      cm.tim[k].srvid  = 0;
-      cm.tim[k].msgid  = 0;
-      cm.tim[k].count  = 0;
-      cm.tim[k].reload = 0;
+      result = cm_timer_cancel(cm.tmr.legacy[k]);
+      cm.tmr.legacy[k] = CM_TMR_NULL;
    }
    // Timer ID Error
    else {
@@ -1223,13 +1249,10 @@ uint32_t cm_tick(void) {
 
 /* 7.15.1   Functional Description
 
-   This routine will look through the list of active timers and decrement
-   their counters, if they expire, a timer message will be generated and
-   sent to the associated CM object.
-
-   Since each call to this routine will decrement the active timers, the
-   resolution of each timer count is based on the frequency with which
-   this call is made.
+   This routine will send a timer message for every timer that has
+   reached its due time. cm_thread() checks the timers whenever the
+   background scheduler is idle, so calls from the system tick pick up
+   what is due while the scheduler is busy.
 
    7.15.2   Parameters:
 
@@ -1244,51 +1267,9 @@ uint32_t cm_tick(void) {
 
 // 7.15.4   Data Structures
 
-   uint32_t    result = CM_OK;
-   uint32_t    i;
-   cm_send_t   ps = {0};
-
 // 7.15.5   Code
 
-   //
-   // Search for any active timers
-   // and decrement their count, when they reach zero
-   // send a timer event to the associated object.
-   //
-   // All timers reload automatically
-   //
-   // Cycle over all active timers
-   for (i=0;i<CM_MAX_TIMERS;i++) {
-      // break if CM_ID_NULL
-      if (cm.tim[i].cmid == CM_ID_NULL) break;
-      // Check for non-zero count
-      if (cm.tim[i].count != 0) {
-         cm.tim[i].count--;
-         // Timer has expired
-         if (cm.tim[i].count == 0) {
-            // reload timer
-            cm.tim[i].count = cm.tim[i].reload;
-            memset(&ps, 0, sizeof(cm_send_t));
-            pcmq_t slot = cm_alloc();
-            if (slot != NULL) {
-               pcm_msg_t msg = (pcm_msg_t)slot->buf;
-               ps.msg = msg;
-               msg->p.srvid  = cm.tim[i].srvid;
-               msg->p.msgid  = cm.tim[i].msgid;
-               msg->p.flags  = CM_NO_FLAGS;
-               msg->p.status = CM_OK;
-               ps.src_cmid   = cm.tim[i].cmid;
-               ps.dst_cmid   = cm.tim[i].cmid;
-               ps.dst_devid  = cm.devid;
-               ps.msglen     = sizeof(cm_msg_t);
-               // Send the Timer Message
-               result = cm_send(CM_MSG_TIMER, &ps);
-            }
-         }
-      }
-   }
-
-   return result;
+   return cm_tmr_expire();
 
 } // end cm_tick()
 
@@ -1319,6 +1300,7 @@ uint32_t cm_route(pcm_msg_t msg) {
 
    uint32_t   result = CM_OK;
    uint8_t    cmid;
+   pcm_obj_t  obj;
 
 // 7.16.5   Code
 
@@ -1332,6 +1314,7 @@ uint32_t cm_route(pcm_msg_t msg) {
    }
 
    cmid  = msg->h.dst_cmid;
+   obj   = &cm.obj[cm_get_handle(cmid)];
 
   // Trace the Message before Routing
   if (gc.trace & CFG_TRACE_ROUTE) {
@@ -1376,8 +1359,8 @@ uint32_t cm_route(pcm_msg_t msg) {
   // forward the message
   switch (msg->h.event) {
      case CM_EVENT_MSG:
-        if (cm.obj[cm_get_handle(cmid)].msg != NULL)
-           cm.obj[cm_get_handle(cmid)].msg(msg);
+        if (obj->msg != NULL)
+           obj->msg(msg);
         else {
            xlprint("cm_route() Error : CMID Invalid (%02X), CM_EVENT_MSG\n", cmid);
            dump((uint8_t *)msg, msg->h.msglen, 0, 0);
@@ -1385,8 +1368,8 @@ uint32_t cm_route(pcm_msg_t msg) {
         }
         break;
      case CM_EVENT_TIMER:
-        if (cm.obj[cm_get_handle(cmid)].timer != NULL)
-           cm.obj[cm_get_handle(cmid)].timer(msg);
+        if (obj->timer != NULL)
+           obj->timer(msg);
         else {
            xlprint("cm_route() Error : CMID Invalid (%02X), CM_EVENT_TIMER\n", cmid);
            dump((uint8_t *)msg, msg->h.msglen, 0, 0);
@@ -1411,7 +1394,7 @@ uint32_t cm_route(pcm_msg_t msg) {
 
 // 7.17
 
-void cm_tx_drop(uint8_t opCode, pcm_msg_t msg) {
+uint32_t cm_tx_drop(uint8_t opCode, pcm_msg_t msg) {
 
 /* 7.17.1   Functional Description
 
@@ -1425,7 +1408,8 @@ void cm_tx_drop(uint8_t opCode, pcm_msg_t msg) {
 
    7.17.3   Return Values:
 
-   msg     Always NULL
+   result   CM_ERR_TX_DROP for CM_IO_TX, else CM_OK, no message is built
+            in place
 
 -----------------------------------------------------------------------------
 */
@@ -1435,10 +1419,14 @@ void cm_tx_drop(uint8_t opCode, pcm_msg_t msg) {
 // 7.17.5   Code
 
    // As the default port connection the message
-   // is simply discarded silently
+   // is discarded and counted
+   if (opCode != CM_IO_TX) return CM_OK;
 
+   cm.tx_drops++;
    cm_free(msg);
 
+   return CM_ERR_TX_DROP;
+
 } // end cm_tx_drop()
 
 
@@ -1529,12 +1517,12 @@ void cm_local(uint8_t srvid, uint8_t msgid, uint8_t flags, uint8_t status) {
 
    // Trace Entry
    if (gc.trace & CFG_TRACE_CM) {
-      xlprint("cm_local(), srvid:msgid:flags:status = %02X:%02X:%02X:%02X\n",
+      XLTRACE("cm_local(), srvid:msgid:flags:status = %02X:%02X:%02X:%02X\n",
                srvid, msgid, flags, status);
    }
 
    // Next Slot in Queue
-   slot = cm_alloc();
+   slot = cm_alloc_len(sizeof(cm_msg_t));
 
    if (slot != NULL) {
 
@@ -1615,7 +1603,7 @@ uint32_t cm_send_req(uint8_t srvid, uint8_t msgid, uint8_t srcid, uint8_t flags)
 
 // 7.20.5   Code
 
-   pcmq_t slot = cm_alloc();
+   pcmq_t slot = cm_alloc_len(sizeof(cm_msg_t));
    if (slot != NULL) {
       pcm_msg_t msg = (pcm_msg_t)slot->buf;
       ps.msg = (pcm_msg_t)msg;
@@ -1854,7 +1842,7 @@ uint32_t cm_send_reg_req(uint8_t devid, uint8_t port, uint8_t flags, uint8_t *de
 
 // 7.23.5   Code
 
-   pcmq_t slot = cm_alloc();
+   pcmq_t slot = cm_alloc_len(sizeof(cm_reg_msg_t));
    if (slot != NULL) {
       pcm_reg_msg_t msg = (pcm_reg_msg_t)slot->buf;
       ps.msg = (pcm_msg_t)msg;
@@ -1932,48 +1920,53 @@ void cm_qmsg(pcm_msg_t msg) {
 
       // Trace Entry
       if (gc.trace & CFG_TRACE_CM) {
-         xlprint("cm_qmsg(), srvid:msgid:port:slot = %02X:%02X:%1X:%02X\n",
+         XLTRACE("cm_qmsg(), srvid:msgid:port:slot = %02X:%02X:%1X:%02X\n",
                msg->p.srvid, msg->p.msgid, msg->h.port, msg->h.slot);
       }
 
       // Trace the Message
       if (gc.trace & CFG_TRACE_CMQ) {
-         xlprint("cm_qmsg() : \n");
-         xlprint("  dst_cmid:  %02X\n", msg->h.dst_cmid);
-         xlprint("  src_cmid:  %02X\n", msg->h.src_cmid);
-         xlprint("  dst_devid: %1X\n",  msg->h.dst_devid);
-         xlprint("  src_devid: %1X\n",  msg->h.src_devid);
-         xlprint("  seqid:     %02X\n", msg->h.seqid);
-         xlprint("  endian:    %1X\n",  msg->h.endian);
-         xlprint("  event:     %1X\n",  msg->h.event);
-         xlprint("  keep:      %1X\n",  msg->h.keep);
-         xlprint("  proto:     %1X\n",  msg->h.proto);
-         xlprint("  crc8:      %02X\n", msg->h.crc8);
-         xlprint("  slot:      %02X\n", msg->h.slot);
-         xlprint("  port:      %1X\n",  msg->h.port);
-         xlprint("  msglen:    %04X\n", msg->h.msglen);
+         XLTRACE("cm_qmsg() : \n");
+         XLTRACE("  dst_cmid:  %02X\n", msg->h.dst_cmid);
+         XLTRACE("  src_cmid:  %02X\n", msg->h.src_cmid);
+         XLTRACE("  dst_devid: %1X\n",  msg->h.dst_devid);
+         XLTRACE("  src_devid: %1X\n",  msg->h.src_devid);
+         XLTRACE("  seqid:     %02X\n", msg->h.seqid);
+         XLTRACE("  endian:    %1X\n",  msg->h.endian);
+         XLTRACE("  event:     %1X\n",  msg->h.event);
+         XLTRACE("  keep:      %1X\n",  msg->h.keep);
+         XLTRACE("  proto:     %1X\n",  msg->h.proto);
+         XLTRACE("  crc8:      %02X\n", msg->h.crc8);
+         XLTRACE("  slot:      %02X\n", msg->h.slot);
+         XLTRACE("  port:      %1X\n",  msg->h.port);
+         XLTRACE("  msglen:    %04X\n", msg->h.msglen);
       }
 
       // Disable ALL interrupts
-      context = alt_irq_disable_all();
+      context = PROF_IRQ_DISABLE();
 
       // log message
       cm_log(msg);
 
+      // delivery ring in queue order, it holds every slot
       slot = &cmq[msg->h.slot];
-      slot->state = CM_Q_DELIVER;
+      if (slot->state != CM_Q_DELIVER) {
+         slot->state = CM_Q_DELIVER;
+         cm.q_ring[cm.q_head] = msg->h.slot;
+         cm.q_head = (cm.q_head + 1) & (CM_Q_RING - 1);
+         cm.q_msg_cnt++;
+      }
 
-      // q_msg_cnt cannot exceed number of slots,
-      // so something has stalled otherwise
-      cm.q_msg_cnt = (cm.q_msg_cnt + 1) & (CM_MSGQ_SLOTS - 1);
+      // wake the router
+      sched_ready(SCHED_TASK_CM);
 
       // Enable ALL interrupts
-      alt_irq_enable_all(context);
+      PROF_IRQ_ENABLE(context);
 
    }
    else {
       if (gc.trace & CFG_TRACE_ERROR)
-         xlprint("cm_qmsg() Null Pointer\n");
+         XLTRACE("cm_qmsg() Null Pointer\n");
    }
 
 } // end cm_qmsg()
@@ -1983,20 +1976,21 @@ void cm_qmsg(pcm_msg_t msg) {
 
 // 7.25
 
-void cm_thread(void) {
+uint32_t cm_thread(uint32_t batch) {
 
 /* 7.25.1   Functional Description
 
    This thread will provide a delivery service for CM messages from the queue,
-   it is called from background during idle time.
+   it is run by the background scheduler when a message is queued and
+   polled with a batch of 0 for the timers.
 
    7.25.2   Parameters:
 
-   NONE
+   batch    Messages to route
 
    7.25.3   Return Values:
 
-   NONE
+   count    Messages routed
 
 -----------------------------------------------------------------------------
 */
@@ -2005,63 +1999,70 @@ void cm_thread(void) {
 
    pcmq_t      slot = NULL;
    uint32_t    i;
+   uint32_t    count;
+   uint8_t     id;
    pcm_msg_t   msg;
 
    alt_irq_context context;
 
 // 7.25.5   Code
 
-   // Disable ALL interrupts
-   context = alt_irq_disable_all();
-
-   // clear previous message
-   slot = NULL;
-
-   // Find Available Message
-   if (cm.q_msg_cnt != 0) {
-      // Find next available message
-      for (i=0;i<CM_MSGQ_SLOTS;i++) {
-         if (cmq[cm.q_tail].state == CM_Q_DELIVER) {
-            cmq[cm.q_tail].state = CM_Q_BUSY;
-            msg = (pcm_msg_t)cmq[cm.q_tail].buf;
-            msg->h.slot = cm.q_tail;
-            slot = &cmq[cm.q_tail];
-            if (++cm.q_tail >= CM_MSGQ_SLOTS) cm.q_tail = 0;
-            cm.q_msg_cnt--;
-            break;
+   // Expired Timers, resolution of the background loop
+   cm_tmr_expire();
+
+   for (count=0;count<batch;count++) {
+
+      // Disable ALL interrupts
+      context = PROF_IRQ_DISABLE();
+
+      // clear previous message
+      slot = NULL;
+
+      // Next Message, oldest in the delivery ring
+      if (cm.q_msg_cnt != 0) {
+         id = cm.q_ring[cm.q_tail];
+         cm.q_tail = (cm.q_tail + 1) & (CM_Q_RING - 1);
+         cm.q_msg_cnt--;
+         slot = &cmq[id];
+         slot->state = CM_Q_BUSY;
+         msg = (pcm_msg_t)slot->buf;
+         msg->h.slot = id;
+      }
+
+      // Enable ALL interrupts
+      PROF_IRQ_ENABLE(context);
+
+      if (slot == NULL) break;
+
+      // Route Message
+      // out bound traffic
+      if (msg->h.dst_devid != cm.devid) {
+         // transmit the message, based on port, use this thread
+         cm.port[msg->h.port].io(CM_IO_TX, msg);
+      }
+      // indication, search for subscriber
+      else if (msg->h.dst_cmid == CM_ID_BCAST) {
+         for (i=0;i<cm.num_objs;i++) {
+            msg->h.dst_cmid = cm_get_sub(i, msg->p.srvid, msg->p.msgid);
+            if (msg->h.dst_cmid != CM_ID_NULL) {
+               cm_route(msg);
+               break;
+            }
          }
-         if (++cm.q_tail >= CM_MSGQ_SLOTS) cm.q_tail = 0;
+         // drop message if no subscriber
+         if (i == cm.num_objs) cm_free(msg);
+      }
+      // in bound traffic
+      else if (msg->h.dst_devid == cm.devid) {
+         // place message in service/client thread queue
+         cm_route(msg);
       }
    }
 
-   // Enable ALL interrupts
-   alt_irq_enable_all(context);
-
-  // Route Message
-  if (slot != NULL) {
-     // out bound traffic
-     if (msg->h.dst_devid != cm.devid) {
-        // transmit the message, based on port, use this thread
-        cm.port[msg->h.port].io(CM_IO_TX, msg);
-     }
-     // indication, search for subscriber
-     else if (msg->h.dst_cmid == CM_ID_BCAST) {
-        for (i=0;i<cm.num_objs;i++) {
-           msg->h.dst_cmid = cm_get_sub(i, msg->p.srvid, msg->p.msgid);
-           if (msg->h.dst_cmid != CM_ID_NULL) {
-              cm_route(msg);
-              break;
-           }
-        }
-        // drop message if no subscriber
-        if (i == cm.num_objs) cm_free(msg);
-     }
-     // in bound traffic
-     else if (msg->h.dst_devid == cm.devid) {
-        // place message in service/client thread queue
-        cm_route(msg);
-     }
-  }
+   // more behind this batch
+   if (cm.q_msg_cnt != 0) sched_ready(SCHED_TASK_CM);
+
+   return count;
 
 } // end cm_thread()
 
@@ -2093,6 +2094,7 @@ void cm_log(pcm_msg_t msg) {
    char     line[512], cat[512];
    uint16_t i,j;
    uint16_t len = msg->h.msglen;
+   uint8_t  k;
    char    *msgid = "-", *cmid = "-";
 
    uint32_t now;
@@ -2130,12 +2132,10 @@ void cm_log(pcm_msg_t msg) {
          strcat(line, cat);
       }
       // find cmid and msgid strings
-      for (i=0;i<gc.msg_table_len; i++) {
-         if ((gc.msg_table[i].cmid  == msg->p.srvid) &&
-             (gc.msg_table[i].msgid == msg->p.msgid)) {
-            msgid = gc.msg_table[i].msg_str;
-            cmid  = gc.msg_table[i].cmid_str;
-         }
+      k = MSG_INDEX(gc.msg_index, msg->p.srvid, msg->p.msgid);
+      if (k != MSG_IDX_NONE) {
+         msgid = gc.msg_table[k].msg_str;
+         cmid  = gc.msg_table[k].cmid_str;
       }
       sprintf(cat, " %6d  %3ld.%04ld  %s:%s\n", msg->h.msglen, delta_secs, delta_us, cmid, msgid);
       strcat(line, cat);
@@ -2231,6 +2231,599 @@ void cm_final(void) {
 
 // 7.27.5   Code
 
+   if (gc.trace & CFG_TRACE_CM) {
+      xlprint("cm_final() timers : started %d, fired %d, cancelled %d, dropped %d, peak %d/%d, late_max %d uS\n",
+            cm.tmr.started, cm.tmr.fired, cm.tmr.cancelled, cm.tmr.dropped,
+            cm.tmr.peak, cm.tmr.size, cm.tmr.late_max_us);
+      xlprint("cm_final() tx drops : %d\n", cm.tx_drops);
+   }
+
+   // Release the Timer Pool
+   free(cm.tmr.heap);
+   free(cm.tmr.pool);
+   cm.tmr.heap  = NULL;
+   cm.tmr.pool  = NULL;
+   cm.tmr.size  = 0;
+   cm.tmr.count = 0;
+   cm.tmr.free  = CM_TMR_IDLE;
+
 } // end cm_final()
 
 
+// ===========================================================================
+
+// 7.28
+
+uint32_t cm_timer_start(uint8_t msgid, uint32_t time_us, uint8_t cmid, uint8_t srvid,
+                        uint8_t flags, uint32_t user) {
+
+/* 7.28.1   Functional Description
+
+   This routine will arm a timer for the CM object cmid. When the timer
+   expires a cm_timer_msg_t carrying the handle and user tag is sent to
+   the object's timer callback. Periodic timers re-arm from their due
+   time, missed periods are skipped rather than delivered as a burst.
+
+   The timer pool grows on demand from the heap, so this routine must
+   be called from the background loop and not from an ISR.
+
+   7.28.2   Parameters:
+
+   msgid       Timer message ID
+   time_us     Interval Time Out value in microseconds
+   cmid        CM ID
+   srvid       Server ID
+   flags       CM_TMR_ONESHOT or CM_TMR_PERIODIC
+   user        Tag returned in the timer message
+
+   7.28.3   Return Values:
+
+   handle   Timer handle, else CM_TMR_NULL
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.28.4   Data Structures
+
+   uint32_t      handle = CM_TMR_NULL;
+   uint32_t      idx;
+   pcm_timer_t   t;
+
+   alt_irq_context context;
+
+// 7.28.5   Code
+
+   if (time_us == 0) time_us = 1;
+
+   // Extend the pool when every node is armed
+   if (cm.tmr.free == CM_TMR_IDLE) cm_tmr_grow();
+
+   // Disable ALL interrupts
+   context = PROF_IRQ_DISABLE();
+
+   if (cm.tmr.free != CM_TMR_IDLE) {
+      idx = cm.tmr.free;
+      t = &cm.tmr.pool[idx];
+      cm.tmr.free = t->next;
+      t->cmid      = cmid;
+      t->srvid     = srvid;
+      t->msgid     = msgid;
+      t->flags     = flags;
+      t->user      = user;
+      t->due_us    = cm_tmr_now() + time_us;
+      t->period_us = (flags & CM_TMR_PERIODIC) ? time_us : 0;
+      // Insert at the heap tail and sift toward the root
+      cm.tmr.heap[cm.tmr.count] = idx;
+      t->pos = cm.tmr.count++;
+      cm_tmr_sift(t->pos);
+      if (cm.tmr.count > cm.tmr.peak) cm.tmr.peak = cm.tmr.count;
+      cm.tmr.started++;
+      handle = t->handle;
+   }
+
+   // Enable ALL interrupts
+   PROF_IRQ_ENABLE(context);
+
+   if ((handle == CM_TMR_NULL) && (gc.trace & CFG_TRACE_ERROR)) {
+      xlprint("cm_timer_start() Error : timer pool exhausted, %d armed\n", cm.tmr.count);
+   }
+
+   return handle;
+
+} // end cm_timer_start()
+
+
+// ===========================================================================
+
+// 7.29
+
+uint32_t cm_timer_cancel(uint32_t handle) {
+
+/* 7.29.1   Functional Description
+
+   This routine will cancel the timer associated with handle. A handle
+   from a one-shot timer that has already expired, or one cancelled
+   earlier, is stale and rejected.
+
+   7.29.2   Parameters:
+
+   handle      Timer handle from cm_timer_start()
+
+   7.29.3   Return Values:
+
+   result   CM_OK, else CM_ERR_TIMER_ID
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.29.4   Data Structures
+
+   uint32_t      result = CM_ERR_TIMER_ID;
+   uint32_t      idx = CM_TMR_INDEX(handle);
+
+   alt_irq_context context;
+
+// 7.29.5   Code
+
+   // Disable ALL interrupts
+   context = PROF_IRQ_DISABLE();
+
+   // Validate Handle and Generation
+   if ((handle != CM_TMR_NULL) && (idx < cm.tmr.size) &&
+       (cm.tmr.pool[idx].handle == handle) &&
+       (cm.tmr.pool[idx].pos != CM_TMR_IDLE)) {
+      cm_tmr_remove(idx);
+      cm.tmr.cancelled++;
+      result = CM_OK;
+   }
+
+   // Enable ALL interrupts
+   PROF_IRQ_ENABLE(context);
+
+   return result;
+
+} // end cm_timer_cancel()
+
+
+// ===========================================================================
+
+// 7.30
+
+static uint32_t cm_tmr_expire(void) {
+
+/* 7.30.1   Functional Description
+
+   This routine will pop every timer that has reached its due time and
+   send a timer message to the associated CM object. Expired timers are
+   collected in batches with interrupts disabled and sent after they are
+   enabled again.
+
+   7.30.2   Parameters:
+
+   NONE
+
+   7.30.3   Return Values:
+
+   result   CM_OK, else CM_ERR
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.30.4   Data Structures
+
+   uint32_t          result = CM_OK;
+   uint32_t          i, n;
+   uint64_t          now;
+   pcm_timer_t       t;
+   pcmq_t            slot;
+   pcm_timer_msg_t   msg;
+   cm_send_t         ps;
+   cm_timer_t        fire[CM_TMR_BATCH];
+
+   alt_irq_context context;
+
+// 7.30.5   Code
+
+   do {
+      n = 0;
+
+      // Disable ALL interrupts
+      context = PROF_IRQ_DISABLE();
+
+      now = cm_tmr_now();
+      while ((cm.tmr.count != 0) && (n < CM_TMR_BATCH)) {
+         t = &cm.tmr.pool[cm.tmr.heap[0]];
+         if (t->due_us > now) break;
+         if (now - t->due_us > cm.tmr.late_max_us) {
+            cm.tmr.late_max_us = (uint32_t)(now - t->due_us);
+         }
+         fire[n++] = *t;
+         // Periodic, re-arm on the next period boundary
+         if (t->flags & CM_TMR_PERIODIC) {
+            t->due_us += t->period_us * ((now - t->due_us) / t->period_us + 1);
+            cm_tmr_sift(0);
+         }
+         // One-shot, release the node
+         else {
+            cm_tmr_remove(cm.tmr.heap[0]);
+         }
+         cm.tmr.fired++;
+      }
+
+      // Enable ALL interrupts
+      PROF_IRQ_ENABLE(context);
+
+      // Send the Timer Messages
+      for (i=0;i<n;i++) {
+         slot = cm_alloc_len(sizeof(cm_timer_msg_t));
+         if (slot == NULL) {
+            cm.tmr.dropped++;
+            result = CM_ERR_MSGQ_EMPTY;
+            continue;
+         }
+         msg = (pcm_timer_msg_t)slot->buf;
+         memset(&ps, 0, sizeof(cm_send_t));
+         ps.msg = (pcm_msg_t)msg;
+         msg->p.srvid  = fire[i].srvid;
+         msg->p.msgid  = fire[i].msgid;
+         msg->p.flags  = CM_NO_FLAGS;
+         msg->p.status = CM_OK;
+         msg->b.handle = fire[i].handle;
+         msg->b.user   = fire[i].user;
+         ps.src_cmid   = fire[i].cmid;
+         ps.dst_cmid   = fire[i].cmid;
+         ps.dst_devid  = cm.devid;
+         ps.msglen     = sizeof(cm_timer_msg_t);
+         result = cm_send(CM_MSG_TIMER, &ps);
+      }
+
+   } while (n == CM_TMR_BATCH);
+
+   return result;
+
+} // end cm_tmr_expire()
+
+
+// ===========================================================================
+
+// 7.31
+
+static uint64_t cm_tmr_now(void) {
+
+/* 7.31.1   Functional Description
+
+   This routine will return the time in microseconds, the time base of
+   every timer deadline. The 32-bit stamp counter wraps every 42 seconds
+   at 100 MHz, so it is extended to 64 bits on each call. Called with
+   interrupts disabled.
+
+   7.31.2   Parameters:
+
+   NONE
+
+   7.31.3   Return Values:
+
+   now      Time in microseconds
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.31.4   Data Structures
+
+   uint32_t    stamp = stamp_count();
+
+// 7.31.5   Code
+
+   cm.tmr.now_ticks += (uint32_t)(stamp - cm.tmr.last_stamp);
+   cm.tmr.last_stamp = stamp;
+
+   return cm.tmr.now_ticks / MICROSECONDS;
+
+} // end cm_tmr_now()
+
+
+// ===========================================================================
+
+// 7.32
+
+static uint32_t cm_tmr_grow(void) {
+
+/* 7.32.1   Functional Description
+
+   This routine will double the timer pool and heap, and chain the new
+   nodes onto the free list. The new arrays are allocated and prepared
+   with interrupts enabled, only the copy and swap is done with them
+   disabled. Nodes are addressed by index so handles remain valid.
+
+   7.32.2   Parameters:
+
+   NONE
+
+   7.32.3   Return Values:
+
+   result   CM_OK, else CM_ERR_TIMER_ID
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.32.4   Data Structures
+
+   uint32_t      size;
+   uint32_t      i;
+   pcm_timer_t   pool, old_pool;
+   uint32_t      *heap, *old_heap;
+
+   alt_irq_context context;
+
+// 7.32.5   Code
+
+   size = (cm.tmr.size == 0) ? CM_TMR_POOL_INIT : cm.tmr.size << 1;
+   if (size > CM_TMR_POOL_MAX) return CM_ERR_TIMER_ID;
+
+   pool = (pcm_timer_t)malloc(size * sizeof(cm_timer_t));
+   heap = (uint32_t *)malloc(size * sizeof(uint32_t));
+   if ((pool == NULL) || (heap == NULL)) {
+      free(pool);
+      free(heap);
+      if (gc.trace & CFG_TRACE_ERROR) {
+         xlprint("cm_tmr_grow() Error : malloc() failed, size %d\n", size);
+      }
+      return CM_ERR_TIMER_ID;
+   }
+
+   // Chain the new nodes, lowest index first
+   for (i=cm.tmr.size;i<size;i++) {
+      memset(&pool[i], 0, sizeof(cm_timer_t));
+      pool[i].handle = CM_TMR_GEN | i;
+      pool[i].cmid   = CM_ID_NULL;
+      pool[i].pos    = CM_TMR_IDLE;
+      pool[i].next   = i + 1;
+   }
+
+   // Disable ALL interrupts
+   context = PROF_IRQ_DISABLE();
+
+   memcpy(pool, cm.tmr.pool, cm.tmr.size * sizeof(cm_timer_t));
+   memcpy(heap, cm.tmr.heap, cm.tmr.count * sizeof(uint32_t));
+   pool[size - 1].next = cm.tmr.free;
+   cm.tmr.free = cm.tmr.size;
+   old_pool = cm.tmr.pool;
+   old_heap = cm.tmr.heap;
+   cm.tmr.pool = pool;
+   cm.tmr.heap = heap;
+   cm.tmr.size = size;
+
+   // Enable ALL interrupts
+   PROF_IRQ_ENABLE(context);
+
+   free(old_pool);
+   free(old_heap);
+
+   return CM_OK;
+
+} // end cm_tmr_grow()
+
+
+// ===========================================================================
+
+// 7.33
+
+static void cm_tmr_sift(uint32_t pos) {
+
+/* 7.33.1   Functional Description
+
+   This routine will restore the heap order for the entry at pos after
+   its due time changed, moving it toward the root or the leaves.
+
+   7.33.2   Parameters:
+
+   pos      Heap position
+
+   7.33.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.33.4   Data Structures
+
+   uint32_t    idx = cm.tmr.heap[pos];
+   uint64_t    due = cm.tmr.pool[idx].due_us;
+   uint32_t    up, down;
+
+// 7.33.5   Code
+
+   // Toward the root while earlier than the parent
+   while (pos > 0) {
+      up = (pos - 1) >> 1;
+      if (cm.tmr.pool[cm.tmr.heap[up]].due_us <= due) break;
+      cm.tmr.heap[pos] = cm.tmr.heap[up];
+      cm.tmr.pool[cm.tmr.heap[pos]].pos = pos;
+      pos = up;
+   }
+
+   // Toward the leaves while later than the earlier child
+   while ((down = (pos << 1) + 1) < cm.tmr.count) {
+      if ((down + 1 < cm.tmr.count) &&
+          (cm.tmr.pool[cm.tmr.heap[down + 1]].due_us < cm.tmr.pool[cm.tmr.heap[down]].due_us)) {
+         down++;
+      }
+      if (cm.tmr.pool[cm.tmr.heap[down]].due_us >= due) break;
+      cm.tmr.heap[pos] = cm.tmr.heap[down];
+      cm.tmr.pool[cm.tmr.heap[pos]].pos = pos;
+      pos = down;
+   }
+
+   cm.tmr.heap[pos] = idx;
+   cm.tmr.pool[idx].pos = pos;
+
+} // end cm_tmr_sift()
+
+
+// ===========================================================================
+
+// 7.34
+
+static void cm_tmr_remove(uint32_t idx) {
+
+/* 7.34.1   Functional Description
+
+   This routine will unlink an armed timer from the heap and return its
+   node to the free list. The handle generation is advanced so any copy
+   of the old handle is rejected by cm_timer_cancel(). Called with
+   interrupts disabled.
+
+   7.34.2   Parameters:
+
+   idx      Pool index
+
+   7.34.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.34.4   Data Structures
+
+   pcm_timer_t   t = &cm.tmr.pool[idx];
+   uint32_t      pos = t->pos;
+
+// 7.34.5   Code
+
+   // Move the heap tail into the hole
+   cm.tmr.count--;
+   if (pos != cm.tmr.count) {
+      cm.tmr.heap[pos] = cm.tmr.heap[cm.tmr.count];
+      cm.tmr.pool[cm.tmr.heap[pos]].pos = pos;
+      cm_tmr_sift(pos);
+   }
+
+   // Release the node, new generation
+   t->pos    = CM_TMR_IDLE;
+   t->cmid   = CM_ID_NULL;
+   t->handle += CM_TMR_GEN;
+   if ((t->handle & ~0x0000FFFF) == 0) t->handle += CM_TMR_GEN;
+   t->next   = cm.tmr.free;
+   cm.tmr.free = idx;
+
+} // end cm_tmr_remove()
+
+
+// ===========================================================================
+
+// 7.35
+
+pcmq_t cm_alloc_len(uint16_t msglen) {
+
+/* 7.35.1   Functional Description
+
+   This routine will allocate a queue slot from the local CM queue, from
+   the smallest size class that holds msglen bytes, or a larger class
+   when that one is empty. The free list head is taken with interrupts
+   disabled, the cost does not depend on the queue occupancy.
+
+   7.35.2   Parameters:
+
+   msglen   Message length in bytes, the longest the slot will hold
+
+   7.35.3   Return Values:
+
+   pcmq_t   Pointer to allocated CM message queue slot
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.35.4   Data Structures
+
+   pcmq_t      slot = NULL;
+   uint32_t    c;
+   uint8_t     id = CM_Q_NULL;
+   pcm_msg_t   msg = NULL;
+
+   alt_irq_context context;
+
+// 7.35.5   Code
+
+   PROF_START(start);
+
+   // Smallest Class
+   for (c=0;c<CM_Q_LRG && (((uint32_t)msglen + 3) >> 2) > cmq_cls[c].len;c++);
+
+   // Disable ALL interrupts
+   context = PROF_IRQ_DISABLE();
+
+   // Free List Head
+   for (;c<CM_Q_CLASSES;c++) {
+      id = cm.q_free[c];
+      if (id != CM_Q_NULL) {
+         cm.q_free[c]  = cmq[id].next;
+         cmq[id].state = CM_Q_ALLOC;
+         break;
+      }
+   }
+
+   // Enable ALL interrupts
+   PROF_IRQ_ENABLE(context);
+
+   if (id != CM_Q_NULL) {
+      slot = &cmq[id];
+      // clear the buffer, the slot is no longer shared
+      memset(slot->raw, 0, sizeof(uint32_t) * slot->size);
+      // account for uint32_t length at raw start
+      msg = (pcm_msg_t)slot->buf;
+      // used to retrieve slot from message
+      msg->h.slot = id;
+      // in CM circular queue, so don't delete
+      msg->h.keep = 1;
+      if (gc.trace & CFG_TRACE_CM) {
+         XLTRACE("cm_alloc(), slotid:slot = %02X:%08X\n", msg->h.slot, (uint32_t)slot);
+      }
+   }
+
+   PROF_END(CP_PROF_CM_ALLOC, start);
+
+   if (gc.trace & CFG_TRACE_ERROR) {
+      if (slot == NULL)
+         XLTRACE("cm_alloc() No Queue Slots Available\n");
+   }
+
+   return slot;
+
+} // end cm_alloc_len()
+
+
+// ===========================================================================
+
+// 7.36
+
+pcm_msg_t cm_tx_alloc(uint8_t port) {
+
+/* 7.36.1   Functional Description
+
+   This routine will reserve the transmit buffer of a port for a message
+   built in place, CM_IO_TX_ALLOC. The message is sent with cm_send()
+   without a copy, or released with cm_free(). The caller falls back to
+   a queue slot when none is returned.
+
+   7.36.2   Parameters:
+
+   port     CM Port, the h.port of the request
+
+   7.36.3   Return Values:
+
+   msg      Message with slot id CM_Q_NULL, NULL when the port has none
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.36.4   Data Structures
+
+// 7.36.5   Code
+
+   if (port >= CM_MAX_PORTS) return NULL;
+
+   return (pcm_msg_t)cm.port[port].io(CM_IO_TX_ALLOC, NULL);
+
+} // end cm_tx_alloc()
@@ -7,14 +7,38 @@
 #define CM_CALC_CRC           FALSE
 #define CM_CHECK_CRC          TRUE
 
-#define CM_MSGQ_SLOTS         128
+#define CM_MSGQ_SLOTS         (CM_Q_SML_SLOTS + CM_Q_MED_SLOTS + CM_Q_LRG_SLOTS)
 #define CM_MSGQ_BUF_LEN       256
 
+// Message Q Size Classes, slot length in uint32_t, a free list each.
+// Indications, timers and short responses fit the small class, the
+// register and version responses the medium, received frames are large
+#define CM_Q_CLASSES          3
+#define CM_Q_SML              0
+#define CM_Q_MED              1
+#define CM_Q_LRG              2
+#define CM_Q_SML_LEN          8
+#define CM_Q_MED_LEN          32
+#define CM_Q_LRG_LEN          CM_MSGQ_BUF_LEN
+#define CM_Q_SML_SLOTS        64
+#define CM_Q_MED_SLOTS        32
+#define CM_Q_LRG_SLOTS        64
+#define CM_Q_PAD              4
+#define CM_Q_RAW_LEN          (CM_Q_SML_SLOTS * (CM_Q_SML_LEN + CM_Q_PAD) + \
+                               CM_Q_MED_SLOTS * (CM_Q_MED_LEN + CM_Q_PAD) + \
+                               CM_Q_LRG_SLOTS * (CM_Q_LRG_LEN + CM_Q_PAD))
+
+// Message Q Delivery Ring, slot ids in queue order, slot ids are uint8_t
+#define CM_Q_RING             256
+#define CM_Q_NULL             0xFF
+
 #define CM_OK                 0x00000000
 #define CM_ERROR              0x80000001
 #define CM_ERR_THREAD         0x80000002
 #define CM_ERR_PIPE           0x80000004
 #define CM_ERR_NUM_PIPE       0x80000008
+#define CM_ERR_TX_FULL        0x80000010
+#define CM_ERR_TX_DROP        0x80000020
 
 // Message Types
 #define CM_MSG_REQ            0x01
@@ -43,8 +67,22 @@
 #define CM_TMR_ID2            0x02
 #define CM_TMR_ID3            0x03
 
-// CM Port Callback Type Definition
-typedef  void (*cmio_t)(uint8_t op_code, pcm_msg_t msg);
+// CM Timer Handles, pool index in the low 16 bits, generation above
+#define CM_TMR_NULL           0x00000000
+#define CM_TMR_IDLE           0xFFFFFFFF
+#define CM_TMR_GEN            0x00010000
+#define CM_TMR_INDEX(h)       ((h) & 0x0000FFFF)
+#define CM_TMR_POOL_INIT      16
+#define CM_TMR_POOL_MAX       0x00010000
+#define CM_TMR_BATCH          8
+
+// CM Timer Flags
+#define CM_TMR_ONESHOT        0x00
+#define CM_TMR_PERIODIC       0x01
+
+// CM Port Callback Type Definition, CM_IO_TX_ALLOC returns the message
+// built in place in the port, slot id CM_Q_NULL, else a CM status
+typedef  uint32_t (*cmio_t)(uint8_t op_code, pcm_msg_t msg);
 
 // cm_send() Parameter Structure
 typedef struct _cm_send_t {
@@ -61,17 +99,24 @@ typedef struct _cm_send_t {
    uint8_t     port;
 } cm_send_t, *pcm_send_t;
 
-// CM Message Queue
+// CM Message Queue Slot, next links the free list of its class
 typedef struct _cmq_t {
    uint8_t     state;
    uint8_t     flags;
-   uint8_t     reserved[2];
+   uint8_t     cls;
+   uint8_t     next;
    uint16_t    size;
    uint16_t    msglen;
-   uint32_t    raw[CM_MSGQ_BUF_LEN+4];
+   uint32_t   *raw;
    uint32_t   *buf;
 } cmq_t, *pcmq_t;
 
+// CM Message Queue Size Class
+typedef struct _cmq_cls_t {
+   uint16_t    len;
+   uint16_t    slots;
+} cmq_cls_t, *pcmq_cls_t;
+
 // CM Port Connection
 typedef struct _cm_port_t {
    uint8_t     media;
@@ -96,15 +141,38 @@ typedef struct _cm_sub_t {
    uint8_t       cmid;
 } cm_sub_t, *pcm_sub_t;
 
-// CM Timers
+// CM Timers, one pool node per armed timer
 typedef struct _cm_timer_t {
+   uint32_t      handle;
    uint8_t       cmid;
    uint8_t       srvid;
    uint8_t       msgid;
-   uint32_t      count;
-   uint32_t      reload;
+   uint8_t       flags;
+   uint32_t      user;
+   uint32_t      pos;
+   uint32_t      next;
+   uint64_t      due_us;
+   uint64_t      period_us;
 } cm_timer_t, *pcm_timer_t;
 
+// CM Timer Service, min-heap of pool indices ordered by due time
+typedef struct _cm_tmr_t {
+   pcm_timer_t       pool;
+   uint32_t          *heap;
+   uint32_t          size;
+   uint32_t          count;
+   uint32_t          free;
+   uint32_t          legacy[CM_MAX_TIMERS];
+   uint32_t          last_stamp;
+   uint64_t          now_ticks;
+   uint32_t          peak;
+   uint32_t          started;
+   uint32_t          fired;
+   uint32_t          cancelled;
+   uint32_t          dropped;
+   uint32_t          late_max_us;
+} cm_tmr_t, *pcm_tmr_t;
+
 // CM Object
 typedef struct _cm_obj_t {
    uint8_t       id;
@@ -127,11 +195,15 @@ typedef struct _cm_t {
    uint8_t           q_head;
    uint8_t           q_tail;
    uint8_t           q_msg_cnt;
+   uint8_t           q_free[CM_Q_CLASSES];
+   uint8_t           q_ring[CM_Q_RING];
    uint32_t          last_us;
-   cm_timer_t        tim[CM_MAX_TIMERS];
+   uint32_t          tx_drops;
+   cm_tmr_t          tmr;
    cm_pipe_con_t     pipe[CM_MAX_PIPES];
    cm_port_t         port[CM_MAX_PORTS + 1];
    cm_obj_t          obj[CM_MAX_OBJS + 1];
+   uint8_t           obj_map[256];
    cm_rt_rec_t       rt[CM_MAX_ROUTES + 1];
 } cm_t, *pcm_t;
 
@@ -142,6 +214,7 @@ uint32_t   cm_ioreg(cmio_t comio, uint8_t port, uint8_t media);
 uint32_t   cm_send(uint8_t msg_type, pcm_send_t ps);
 uint32_t   cm_route(pcm_msg_t msg);
 pcmq_t     cm_alloc(void);
+pcmq_t     cm_alloc_len(uint16_t msglen);
 void       cm_free(pcm_msg_t msg);
 uint32_t   cm_crc(pcm_msg_t msg, uint8_t crc_chk);
 uint32_t   cm_msg(pcm_msg_t msg);
@@ -152,8 +225,11 @@ uint8_t    cm_get_sub(uint8_t h, uint8_t srvID, uint8_t msgid);
 uint32_t   cm_timer_set(uint8_t timerid, uint8_t msgid, uint32_t time_ms,
                         uint8_t cmid, uint8_t srvid);
 uint32_t   cm_timer_kill(uint8_t timerid, uint8_t cmid);
+uint32_t   cm_timer_start(uint8_t msgid, uint32_t time_us, uint8_t cmid, uint8_t srvid,
+                          uint8_t flags, uint32_t user);
+uint32_t   cm_timer_cancel(uint32_t handle);
 uint32_t   cm_tick(void);
-void       cm_tx_drop(uint8_t op_code, pcm_msg_t msg);
+uint32_t   cm_tx_drop(uint8_t op_code, pcm_msg_t msg);
 uint32_t   cm_send_msg(uint8_t msg_type, pcm_msg_t msg, pcm_msg_t preq,
                        uint16_t msglen, uint8_t dst_cmid, uint8_t devid);
 uint32_t   cm_send_reg_req(uint8_t devid, uint8_t port, uint8_t flags, uint8_t *device);
@@ -162,7 +238,8 @@ uint32_t   cm_send_req(uint8_t srvid, uint8_t msgid, uint8_t srcid, uint8_t flag
 uint32_t   cm_pipe_reg(uint8_t cmid, uint8_t msgid, uint32_t mark, uint8_t dstdev);
 uint32_t   cm_pipe_send(pcm_pipe_t pipe, uint32_t pipelen);
 void       cm_qmsg(pcm_msg_t msg);
-void       cm_thread(void);
+uint32_t   cm_thread(uint32_t batch);
 void       cm_log(pcm_msg_t msg);
 void       cm_final(void);
+pcm_msg_t  cm_tx_alloc(uint8_t port);
 
@@ -175,6 +175,7 @@ int main() {
    gc.month     = month_table;
    gc.msg_table = msg_table;
    gc.msg_table_len = DIM(msg_table);
+   gc.msg_index = msg_index;
 
    sprintf(gc.dev_str, "C10-I NIOS, %s", BUILD_STR);
 
@@ -312,6 +313,9 @@ int main() {
    alt_ic_isr_register(STDOUT_IRQ_INTERRUPT_CONTROLLER_ID,
                        STDOUT_IRQ, xlprint_isr, NULL, NULL);
 
+   // Background Scheduler
+   gc.error |= sched_init();
+
    //
    // BACKGROUND PROCESSING
    //
@@ -322,21 +326,10 @@ int main() {
    //
    for (;;) {
       //
-      // CM THREAD
-      //
-      cm_thread();
-      //
-      // CP THREAD
-      //
-      cp_thread();
-      //
-      // DAQ THREAD
+      // CM, DAQ, CP, CLI AND DEFERRED TRACE,
+      // HIGHEST PRIORITY READY TASK
       //
-      daq_thread();
-      //
-      // CLI THREAD
-      //
-      cli_process(&gc.cli);
+      sched_run();
       //
       // UPDATE WATCHDOG
       //
@@ -380,6 +373,8 @@ alt_u32 timer(void *context) {
 
 // 7.2.5   Code
 
+   PROF_ISR_START(start);
+
    // System Time Tick
    gc.sys_time++;
 
@@ -425,6 +420,8 @@ alt_u32 timer(void *context) {
       }
    }
 
+   PROF_ISR_END(CP_PROF_TICK_ISR, start);
+
    return CFG_TIMER_CYCLE;
 
 } // end timer()
@@ -36,6 +36,7 @@
 #include "fw_cfg.h"
 #include "type.h"
 #include "cm_const.h"
+#include "msg_def.h"
 #include "ci.h"
 #include "cm.h"
 #include "build.h"
@@ -46,6 +47,9 @@
 #include "cp_msg.h"
 #include "cp_hal.h"
 #include "cp_srv.h"
+#include "xltrace.h"
+#include "bgsched.h"
+#include "prof.h"
 
 #include "daq_msg.h"
 #include "daq_hal.h"
@@ -118,6 +122,7 @@ typedef struct _gc_t {
    char         **month;
    pmsg_entry_t   msg_table;
    uint16_t       msg_table_len;
+   const uint8_t  (*msg_index)[MSG_IDS];
    cli_t          cli;
 }
 
@@ -10,6 +10,13 @@
 
       This code implements the Service Provider functionality.
 
+      CP_STREAM_REQ sends a region of SDRAM to the host through the OPTO
+      pipe engine. The engine only streams whole pipe transfers whose
+      packets start with a pipe header, so the region is copied into two
+      staging transfers of CP_STREAM_XFER packets, the next one is staged
+      while the engine sends the current one. Each packet carries its
+      offset in the region, the host places it by offset.
+
    1.3 Specification/Design Reference
 
       See fw_cfg.h under the share directory.
@@ -58,6 +65,9 @@
         7.4  cp_tick()
         7.5  cp_qmsg()
         7.6  cp_thread()
+        7.7  cp_stream_start()
+        7.8  cp_stream_next()
+        7.9  cp_stream_stage()
 
 -----------------------------------------------------------------------------*/
 
@@ -79,10 +89,18 @@
 
 // 6.1  Local Function Prototypes
 
+   static   void  cp_stream_start(pcp_stream_msg_t req);
+   static   void  cp_stream_next(void);
+   static   void  cp_stream_stage(void);
+
 // 6.2  Local Data Structures
 
-   static   cp_t     cp  = {0};
-   static   cp_rxq_t rxq = {0};
+   static   cp_t        cp   = {0};
+   static   cp_rxq_t    rxq  = {0};
+   static   cp_stream_t strm = {0};
+
+   // staging transfers for the memory stream
+   static   uint32_t    strm_buf[2][(CP_STREAM_XFER * OPTO_PIPELEN_UINT8) >> 2];
 
 // 7 MODULE CODE
 
@@ -166,9 +184,10 @@ uint32_t cp_msg(pcm_msg_t msg) {
 // 7.2.4   Data Structures
 
    uint32_t    result = CP_OK;
-   uint16_t    cm_msg  = MSG(msg->p.srvid, msg->p.msgid);
    uint32_t    i,j;
    uint32_t    address;
+   uint32_t    width, len;
+   uint8_t     keep = FALSE;
 
 // 7.2.5   Code
 
@@ -178,239 +197,304 @@ uint32_t cp_msg(pcm_msg_t msg) {
          msg->p.srvid, msg->p.msgid, msg->h.port);
    }
 
-   //
-   // VERSION REQUEST MESSAGE
-   //
-   if (cm_msg == MSG(CM_ID_CP_SRV, CP_VER_REQ)) {
-      pcmq_t slot = cm_alloc();
-      if (slot != NULL) {
-         pcp_ver_msg_t rsp = (pcp_ver_msg_t)slot->buf;
-         rsp->p.srvid    = cp.srvid;
-         rsp->p.msgid    = CP_VER_RESP;
-         rsp->p.flags    = CP_NO_FLAGS;
-         rsp->p.status   = CP_OK;
-         rsp->b.fw_ver   = (BUILD_MAJOR << 24) | (BUILD_MINOR << 16) |
-                           (BUILD_NUM   <<  8) |  BUILD_INC;
-         rsp->b.sysid       = stamp_sysid();
-         rsp->b.stamp_epoch = stamp_epoch();
-         rsp->b.stamp_date  = stamp_date();
-         rsp->b.stamp_time  = stamp_time();
-         rsp->b.vhdl[0]     = com_hwver();
-         rsp->b.vhdl[1]     = adc_version();
-         rsp->b.vhdl[2]     = (stamp_version() >> 24);
-         rsp->b.trace       = gc.trace;
-         rsp->b.feature     = gc.feature;
-         rsp->b.debug       = gc.debug;
-         // Send the Response
-         cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(cp_ver_msg_t), 0, 0);
+   switch (MSG_INDEX(gc.msg_index, msg->p.srvid, msg->p.msgid)) {
+      //
+      // VERSION REQUEST MESSAGE
+      //
+      case MSG_IDX_CP_VER_REQ: {
+         pcmq_t slot = cm_alloc_len(sizeof(cp_ver_msg_t));
+         if (slot != NULL) {
+            pcp_ver_msg_t rsp = (pcp_ver_msg_t)slot->buf;
+            rsp->p.srvid    = cp.srvid;
+            rsp->p.msgid    = CP_VER_RESP;
+            rsp->p.flags    = CP_NO_FLAGS;
+            rsp->p.status   = CP_OK;
+            rsp->b.fw_ver   = (BUILD_MAJOR << 24) | (BUILD_MINOR << 16) |
+                              (BUILD_NUM   <<  8) |  BUILD_INC;
+            rsp->b.sysid       = stamp_sysid();
+            rsp->b.stamp_epoch = stamp_epoch();
+            rsp->b.stamp_date  = stamp_date();
+            rsp->b.stamp_time  = stamp_time();
+            rsp->b.vhdl[0]     = com_hwver();
+            rsp->b.vhdl[1]     = adc_version();
+            rsp->b.vhdl[2]     = (stamp_version() >> 24);
+            rsp->b.trace       = gc.trace;
+            rsp->b.feature     = gc.feature;
+            rsp->b.debug       = gc.debug;
+            // Send the Response
+            cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(cp_ver_msg_t), 0, 0);
+         }
+         break;
       }
-   }
-   //
-   // SET/GET TRACE REQUEST
-   //
-   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_TRACE_REQ)) {
-      pcp_trace_msg_t req = (pcp_trace_msg_t)msg;
-      pcmq_t slot = cm_alloc();
-      if (slot != NULL) {
-         pcp_trace_msg_t rsp = (pcp_trace_msg_t)slot->buf;
-         rsp->p.srvid  = CM_ID_CP_SRV;
-         rsp->p.msgid  = CP_TRACE_RESP;
-         rsp->p.flags  = req->p.flags;
-         rsp->p.status = CP_OK;
-         // Determine if we're Setting the Flags
-         if (req->p.flags == CP_TRACE_SET) {
-            gc.debug   = req->b.debug;
-            gc.trace   = req->b.trace;
+      //
+      // SET/GET TRACE REQUEST
+      //
+      case MSG_IDX_CP_TRACE_REQ: {
+         pcp_trace_msg_t req = (pcp_trace_msg_t)msg;
+         pcmq_t slot = cm_alloc_len(sizeof(cp_trace_msg_t));
+         if (slot != NULL) {
+            pcp_trace_msg_t rsp = (pcp_trace_msg_t)slot->buf;
+            rsp->p.srvid  = CM_ID_CP_SRV;
+            rsp->p.msgid  = CP_TRACE_RESP;
+            rsp->p.flags  = req->p.flags;
+            rsp->p.status = CP_OK;
+            // Determine if we're Setting the Flags
+            if (req->p.flags == CP_TRACE_SET) {
+               gc.debug   = req->b.debug;
+               gc.trace   = req->b.trace;
+            }
+            rsp->b.debug  = gc.debug;
+            rsp->b.trace  = gc.trace;
+            // Send the Response
+            cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(cp_trace_msg_t), 0, 0);
          }
-         rsp->b.debug  = gc.debug;
-         rsp->b.trace  = gc.trace;
-         // Send the Response
-         cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(cp_trace_msg_t), 0, 0);
+         break;
       }
-   }
-   //
-   // READ/WRITE MEMORY REQUEST
-   //
-   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_MEM_REQ)) {
-      pcp_mem_msg_t req = (pcp_mem_msg_t)msg;
-      pcmq_t slot = cm_alloc();
-      if (slot != NULL) {
-         pcp_mem_msg_t rsp = (pcp_mem_msg_t)slot->buf;
-         rsp->p.srvid     = CM_ID_CP_SRV;
+      //
+      // READ/WRITE MEMORY REQUEST
+      //
+      case MSG_IDX_CP_MEM_REQ: {
+         // response is turned around in the request slot
+         pcp_mem_msg_t rsp = (pcp_mem_msg_t)msg;
          rsp->p.msgid     = CP_MEM_RESP;
-         rsp->p.flags     = req->p.flags;
          rsp->p.status    = CP_OK;
-         rsp->b.address   = req->b.address;
-         rsp->b.value     = req->b.value;
-         rsp->b.type      = req->b.type;
-         address          = (uint32_t)req->b.address;
+         address          = (uint32_t)rsp->b.address;
          // create the type pointers
          uint8_t  *addr8  = (uint8_t *)(address);
          uint16_t *addr16 = (uint16_t *)(address);
          uint32_t *addr32 = (uint32_t *)(address);
          // determine type
-         switch(req->b.type) {
+         switch(rsp->b.type) {
             case CFG_INT8U:
             case CFG_INT8S:
-               if (req->p.flags & CP_MEM_WR) *addr8 = req->b.value;
-               if (req->p.flags & CP_MEM_RD) rsp->b.value = *addr8;
+               if (rsp->p.flags & CP_MEM_WR) *addr8 = rsp->b.value;
+               if (rsp->p.flags & CP_MEM_RD) rsp->b.value = *addr8;
                break;
             case CFG_INT16U:
             case CFG_INT16S:
-               if (req->p.flags & CP_MEM_WR) *addr16 = req->b.value;
-               if (req->p.flags & CP_MEM_RD) rsp->b.value = *addr16;
+               if (rsp->p.flags & CP_MEM_WR) *addr16 = rsp->b.value;
+               if (rsp->p.flags & CP_MEM_RD) rsp->b.value = *addr16;
                break;
             case CFG_INT32U:
             case CFG_INT32S:
             case CFG_FP32:
-               if (req->p.flags & CP_MEM_WR) *addr32 = req->b.value;
-               if (req->p.flags & CP_MEM_RD) rsp->b.value = *addr32;
+               if (rsp->p.flags & CP_MEM_WR) *addr32 = rsp->b.value;
+               if (rsp->p.flags & CP_MEM_RD) rsp->b.value = *addr32;
                break;
             default:
-               if (req->p.flags & CP_MEM_WR) *addr32 = req->b.value;
-               if (req->p.flags & CP_MEM_RD) rsp->b.value = *addr32;
+               if (rsp->p.flags & CP_MEM_WR) *addr32 = rsp->b.value;
+               if (rsp->p.flags & CP_MEM_RD) rsp->b.value = *addr32;
                break;
          }
-         // Send the Response
+         // Send the Response, the slot now belongs to CM
          cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(cp_mem_msg_t), 0, 0);
+         keep = TRUE;
+         break;
       }
-   }
-   //
-   // READ/WRITE BLOCK REQUEST
-   //
-   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_BLOCK_REQ)) {
-      pcp_block_msg_t req = (pcp_block_msg_t)msg;
-      pcmq_t slot = cm_alloc();
-      if (slot != NULL) {
-         pcp_block_msg_t rsp = (pcp_block_msg_t)slot->buf;
-         rsp->p.srvid     = CM_ID_CP_SRV;
+      //
+      // READ/WRITE BLOCK REQUEST
+      //
+      case MSG_IDX_CP_BLOCK_REQ: {
+         // a read is built in the port transmit staging buffer when
+         // a port slot is free, else the response is turned around in the
+         // request slot, write data is consumed before read data
+         // replaces it
+         pcp_block_msg_t req = (pcp_block_msg_t)msg;
+         pcp_block_msg_t rsp = req;
+         if (req->p.flags & CP_MEM_RD) {
+            pcp_block_msg_t tx = (pcp_block_msg_t)cm_tx_alloc(msg->h.port);
+            if (tx != NULL) {
+               tx->p         = req->p;
+               tx->b.index   = req->b.index;
+               tx->b.type    = req->b.type;
+               tx->b.address = req->b.address;
+               tx->b.length  = req->b.length;
+               rsp           = tx;
+            }
+         }
          rsp->p.msgid     = CP_BLOCK_RESP;
-         rsp->p.flags     = req->p.flags;
          rsp->p.status    = CP_OK;
-         rsp->b.index     = req->b.index;
-         rsp->b.type      = req->b.type;
-         rsp->b.address   = req->b.address;
-         rsp->b.length    = req->b.length;
-         address          = (uint32_t)req->b.address;
+         address          = (uint32_t)rsp->b.address;
          // number of memory type to read/write
          j = rsp->b.length;
-         // create the type pointers
+         // create the type pointers, write from the request and
+         // read to the response
          uint8_t  *addr8  = (uint8_t *)(address);
          uint16_t *addr16 = (uint16_t *)(address);
          uint32_t *addr32 = (uint32_t *)(address);
-         uint8_t  *rsp8  = (uint8_t *)(rsp->b.data);
-         uint16_t *rsp16 = (uint16_t *)(rsp->b.data);
-         uint32_t *rsp32 = (uint32_t *)(rsp->b.data);
-         uint8_t  *req8  = (uint8_t *)(req->b.data);
-         uint16_t *req16 = (uint16_t *)(req->b.data);
-         uint32_t *req32 = (uint32_t *)(req->b.data);
-         // determine type
-         switch(req->b.type) {
+         uint8_t  *wr8    = (uint8_t *)(req->b.data);
+         uint16_t *wr16   = (uint16_t *)(req->b.data);
+         uint32_t *wr32   = (uint32_t *)(req->b.data);
+         uint8_t  *buf8   = (uint8_t *)(rsp->b.data);
+         uint16_t *buf16  = (uint16_t *)(rsp->b.data);
+         uint32_t *buf32  = (uint32_t *)(rsp->b.data);
+         // determine type, the block is bounded by CP_BLOCK_MAX bytes
+         switch(rsp->b.type) {
             case CFG_INT8U:
             case CFG_INT8S:
-               if (req->p.flags & CP_MEM_WR) {
+               width = sizeof(uint8_t);
+               if (j > CP_BLOCK_MAX) {
+                  rsp->p.status = CP_ERR_MSG_LEN_MAX;
+                  break;
+               }
+               if (rsp->p.flags & CP_MEM_WR) {
                   for (i=0;i<j;i++) {
-                     *(addr8 + i) = *(req8 + i);
+                     *(addr8 + i) = *(wr8 + i);
                   }
                }
-               if (req->p.flags & CP_MEM_RD) {
+               if (rsp->p.flags & CP_MEM_RD) {
                   for (i=0;i<j;i++) {
-                     *(rsp8 + i) = *(addr8 + i);
+                     *(buf8 + i) = *(addr8 + i);
                   }
                }
                break;
             case CFG_INT16U:
             case CFG_INT16S:
-               if (req->p.flags & CP_MEM_WR) {
+               width = sizeof(uint16_t);
+               if (j > CP_BLOCK_MAX / sizeof(uint16_t)) {
+                  rsp->p.status = CP_ERR_MSG_LEN_MAX;
+                  break;
+               }
+               if (rsp->p.flags & CP_MEM_WR) {
                   for (i=0;i<j;i++) {
-                     *(addr16 + i) = *(req16 + i);
+                     *(addr16 + i) = *(wr16 + i);
                   }
                }
-               if (req->p.flags & CP_MEM_RD) {
+               if (rsp->p.flags & CP_MEM_RD) {
                   for (i=0;i<j;i++) {
-                     *(rsp16 + i) = *(addr16 + i);
+                     *(buf16 + i) = *(addr16 + i);
                   }
                }
                break;
             case CFG_INT32U:
             case CFG_INT32S:
             case CFG_FP32:
-               if (req->p.flags & CP_MEM_WR) {
-                  for (i=0;i<j;i++) {
-                     *(addr32 + i) = *(req32 + i);
-                  }
-               }
-               if (req->p.flags & CP_MEM_RD) {
-                  for (i=0;i<j;i++) {
-                     *(rsp32 + i) = *(addr32 + i);
-                  }
-               }
-               break;
             default:
-               if (req->p.flags & CP_MEM_WR) {
+               width = sizeof(uint32_t);
+               if (j > CP_BLOCK_MAX / sizeof(uint32_t)) {
+                  rsp->p.status = CP_ERR_MSG_LEN_MAX;
+                  break;
+               }
+               if (rsp->p.flags & CP_MEM_WR) {
                   for (i=0;i<j;i++) {
-                     *(addr32 + i) = *(req32 + i);
+                     *(addr32 + i) = *(wr32 + i);
                   }
                }
-               if (req->p.flags & CP_MEM_RD) {
+               if (rsp->p.flags & CP_MEM_RD) {
                   for (i=0;i<j;i++) {
-                     *(rsp32 + i) = *(addr32 + i);
+                     *(buf32 + i) = *(addr32 + i);
                   }
                }
                break;
          }
-         // send response, only include data if reading
-         if (req->p.flags & CP_MEM_WR)
-            cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(cp_block_msg_t) - CP_BLOCK_MAX, 0, 0);
-         else
-            cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(cp_block_msg_t), 0, 0);
+         // send response, only include the data read
+         len = sizeof(cp_block_msg_t) - CP_BLOCK_MAX;
+         if ((rsp->p.flags & CP_MEM_RD) && rsp->p.status == CP_OK) len += j * width;
+         cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, len, 0, 0);
+         // the request slot is released once built in place
+         keep = (rsp == req);
+         break;
       }
-   }
-   //
-   // PING REQUEST
-   //
-   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_PING_REQ)) {
-      pcmq_t slot = cm_alloc();
-      if (slot != NULL) {
-         pcp_ping_msg_t rsp = (pcp_ping_msg_t)slot->buf;
-         rsp->p.srvid  = CM_ID_CP_SRV;
-         rsp->p.msgid  = CP_PING_RESP;
-         rsp->p.flags  = msg->p.flags;
-         rsp->p.status = CP_OK;
-         // reset ping timeout
-         gc.ping_time = alt_timestamp();
-         gc.ping_cnt  = 0;
-         // Only respond if
-         if (gc.status & CFG_STATUS_CONNECTED)
-            cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(cp_ping_msg_t), 0, 0);
+      //
+      // MEMORY STREAM REQUEST
+      //
+      case MSG_IDX_CP_STREAM_REQ: {
+         // response is turned around in the request slot
+         cp_stream_start((pcp_stream_msg_t)msg);
+         keep = TRUE;
+         break;
       }
-   }
-   //
-   // RESET HARDWARE/SOFTWARE REQUEST, NO RESPONSE
-   //
-   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_RESET_REQ)) {
-      // NOT USED
-   }
-   //
-   // CP INTERRUPT INDICATION
-   //
-   else if (cm_msg == MSG(CM_ID_CP_SRV, CP_INT_IND)) {
-      // NOT USED
-   }
-   //
-   // UNKNOWN MESSAGE
-   //
-   else {
-      if (gc.trace & CFG_TRACE_ERROR) {
-         // Unknown Message
-         xlprint("cp_msg() Unknown Message, srvid:msgid = %02X:%02X\n",
-               msg->p.srvid, msg->p.msgid);
-         dump((uint8_t*)msg, 12, 0, 0);
+      //
+      // TRACE RING REQUEST
+      //
+      case MSG_IDX_CP_XLT_REQ: {
+         // response is turned around in the request slot, b.tag is echoed
+         pcp_xlt_msg_t rsp = (pcp_xlt_msg_t)msg;
+         rsp->p.msgid     = CP_XLT_RESP;
+         rsp->p.status    = CP_OK;
+         xlt_ctl(rsp->p.flags, &rsp->b);
+         // Send the Response, the slot now belongs to CM
+         cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(cp_xlt_msg_t), 0, 0);
+         keep = TRUE;
+         break;
       }
+      //
+      // SCHEDULER ACCOUNTING REQUEST
+      //
+      case MSG_IDX_CP_SCHED_REQ: {
+         // response is turned around in the request slot, b.tag is echoed
+         pcp_sched_msg_t rsp = (pcp_sched_msg_t)msg;
+         rsp->p.msgid     = CP_SCHED_RESP;
+         rsp->p.status    = CP_OK;
+         sched_ctl(rsp->p.flags, &rsp->b);
+         // Send the Response, the slot now belongs to CM
+         cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(cp_sched_msg_t), 0, 0);
+         keep = TRUE;
+         break;
+      }
+      //
+      // PROFILE REQUEST
+      //
+      case MSG_IDX_CP_PROF_REQ: {
+         // response is turned around in the request slot, b.tag is echoed
+         pcp_prof_msg_t rsp = (pcp_prof_msg_t)msg;
+         rsp->p.msgid     = CP_PROF_RESP;
+         rsp->p.status    = prof_ctl(rsp->p.flags, &rsp->b);
+         // Send the Response, the slot now belongs to CM
+         cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(cp_prof_msg_t), 0, 0);
+         keep = TRUE;
+         break;
+      }
+      //
+      // PING REQUEST
+      //
+      case MSG_IDX_CP_PING_REQ: {
+         pcmq_t slot = cm_alloc_len(sizeof(cp_ping_msg_t));
+         if (slot != NULL) {
+            pcp_ping_msg_t rsp = (pcp_ping_msg_t)slot->buf;
+            rsp->p.srvid  = CM_ID_CP_SRV;
+            rsp->p.msgid  = CP_PING_RESP;
+            rsp->p.flags  = msg->p.flags;
+            rsp->p.status = CP_OK;
+            // reset ping timeout
+            gc.ping_time = alt_timestamp();
+            gc.ping_cnt  = 0;
+            // Only respond if
+            if (gc.status & CFG_STATUS_CONNECTED)
+               cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(cp_ping_msg_t), 0, 0);
+         }
+         break;
+      }
+      //
+      // RESET HARDWARE/SOFTWARE REQUEST, NO RESPONSE
+      //
+      case MSG_IDX_CP_RESET_REQ: {
+         // NOT USED
+         break;
+      }
+      //
+      // CP INTERRUPT INDICATION
+      //
+      case MSG_IDX_CP_INT_IND: {
+         // pipe transfer done, memory stream
+         if (msg->p.flags & CP_IND_PIPE) cp_stream_next();
+         break;
+      }
+      //
+      // UNKNOWN MESSAGE
+      //
+      default:
+         if (gc.trace & CFG_TRACE_ERROR) {
+            // Unknown Message
+            xlprint("cp_msg() Unknown Message, srvid:msgid = %02X:%02X\n",
+                  msg->p.srvid, msg->p.msgid);
+            dump((uint8_t*)msg, 12, 0, 0);
+         }
+         break;
    }
 
-   // Release the Slot
-   cm_free(msg);
+   // Release the Slot, unless turned around as the response
+   if (!keep) cm_free(msg);
 
    return result;
 
@@ -550,6 +634,9 @@ uint32_t cp_qmsg(pcm_msg_t msg) {
       if (++rxq.head == rxq.slots) rxq.head = 0;
    }
 
+   // wake the thread
+   sched_ready(SCHED_TASK_CP);
+
    return result;
 
 } // end cp_qmsg()
@@ -559,20 +646,20 @@ uint32_t cp_qmsg(pcm_msg_t msg) {
 
 // 7.6
 
-void cp_thread(void) {
+uint32_t cp_thread(uint32_t batch) {
 
 /* 7.6.1   Functional Description
 
    This thread will provide a delivery service for CM messages from the queue,
-   it is called from background during idle time.
+   it is run by the background scheduler when a message is queued.
 
    7.6.2   Parameters:
 
-   NONE
+   batch    Messages to deliver
 
    7.6.3   Return Values:
 
-   NONE
+   count    Messages taken from the queue
 
 -----------------------------------------------------------------------------
 */
@@ -580,28 +667,222 @@ void cp_thread(void) {
 // 7.6.4   Data Structures
 
    pcm_msg_t   msg;
+   uint32_t    count;
 
 // 7.6.5   Code
 
-   // clear previous message
-   msg = NULL;
-
-   if (rxq.head != rxq.tail) {
+   for (count=0;count<batch && rxq.head != rxq.tail;count++) {
       // Validate message
-      if (rxq.buf[rxq.tail] != NULL) {
-         msg = (pcm_msg_t)rxq.buf[rxq.tail];
-         if (++rxq.tail == rxq.slots) rxq.tail = 0;
+      msg = (pcm_msg_t)rxq.buf[rxq.tail];
+      if (++rxq.tail == rxq.slots) rxq.tail = 0;
+      // Deliver Message using this thread, silently drop
+      if (msg != NULL) {
+         PROF_START(start);
+         cp_msg(msg);
+         PROF_END(CP_PROF_CP_MSG, start);
       }
-      // silently drop
-      else {
-         if (++rxq.tail == rxq.slots) rxq.tail = 0;
+   }
+
+   // more behind this batch
+   if (rxq.head != rxq.tail) sched_ready(SCHED_TASK_CP);
+
+   return count;
+
+} // end cp_thread()
+
+
+// ===========================================================================
+
+// 7.7
+
+static void cp_stream_start(pcp_stream_msg_t req) {
+
+/* 7.7.1   Functional Description
+
+   This routine will validate a memory stream request, respond with the
+   number of packets to expect and start the first pipe transfer. The
+   stream is padded to CP_STREAM_ALIGN packets, padding packets carry no
+   data. The region must lie in SDRAM and the pipe must be idle.
+
+   7.7.2   Parameters:
+
+   req      Stream request, turned around as the response
+
+   7.7.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.7.4   Data Structures
+
+   uint32_t    address = req->b.address;
+   uint32_t    length  = req->b.length;
+   uint32_t    tag     = req->b.tag;
+   uint32_t    packets;
+   uint8_t     status  = CP_OK;
+
+// 7.7.5   Code
+
+   packets = (length + CP_STREAM_DATA - 1) / CP_STREAM_DATA;
+   packets = (packets + CP_STREAM_ALIGN - 1) & ~(CP_STREAM_ALIGN - 1);
+
+   // the pipe engine is shared with the DAQ
+   if (strm.active || (gc.status & CFG_STATUS_DAQ_RUN)) {
+      status = CP_ERR_BUSY;
+   }
+   else if (length == 0 || address < SDRAM_BASE ||
+            address - SDRAM_BASE > SDRAM_SPAN ||
+            length > SDRAM_SPAN - (address - SDRAM_BASE)) {
+      status = CP_ERR_ADDR_RANGE;
+   }
+
+   if (gc.trace & CFG_TRACE_SERVER) {
+      xlprint("cp_stream_start() address:length:packets:status = %08X:%d:%d:%d\n",
+            address, length, packets, status);
+   }
+
+   // Send the Response, the slot now belongs to CM
+   req->p.msgid     = CP_STREAM_RESP;
+   req->p.status    = status;
+   req->b.packets   = (status == CP_OK) ? packets : 0;
+   cm_send_msg(CM_MSG_RESP, (pcm_msg_t)req, (pcm_msg_t)req, sizeof(cp_stream_msg_t), 0, 0);
+
+   if (status != CP_OK) return;
+
+   strm.active  = TRUE;
+   strm.tag     = tag;
+   strm.address = address;
+   strm.length  = length;
+   strm.packets = packets;
+   strm.staged  = 0;
+   strm.sent    = 0;
+   gc.status   |= CFG_STATUS_CP_STREAM;
+
+   // take the pipe done indication from the DAQ server
+   opto_pipe_notify(CM_ID_CP_SRV, CP_INT_IND, CP_IND_PIPE);
+
+   // first transfer, then stage the second behind it
+   cp_stream_stage();
+   opto_pipe(OPTO_OP_START, (uint32_t)strm_buf[0],
+             (uint32_t)strm_buf[0] + sizeof(strm_buf[0]) - 1, CP_STREAM_XFER);
+   if (strm.staged < strm.packets) cp_stream_stage();
+
+} // end cp_stream_start()
+
+
+// ===========================================================================
+
+// 7.8
+
+static void cp_stream_next(void) {
+
+/* 7.8.1   Functional Description
+
+   This routine will run on each pipe done indication of the memory
+   stream. The staged transfer is started and the transfer just sent is
+   refilled, after the last transfer the pipe is handed back to the DAQ.
+
+   7.8.2   Parameters:
+
+   NONE
+
+   7.8.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.8.4   Data Structures
+
+   uint32_t    *buf;
+
+// 7.8.5   Code
+
+   if (!strm.active) return;
+
+   strm.sent += CP_STREAM_XFER;
+
+   // stream done
+   if (strm.sent >= strm.packets) {
+      opto_pipe(OPTO_OP_STOP, 0, 0, 0);
+      opto_pipe_notify(CM_ID_DAQ_SRV, DAQ_INT_IND, DAQ_INT_FLAG_PIPE);
+      strm.active = FALSE;
+      gc.status  &= ~CFG_STATUS_CP_STREAM;
+      if (gc.trace & CFG_TRACE_SERVER) {
+         xlprint("cp_stream_next() done, %d packets\n", strm.sent);
       }
+      return;
    }
 
-   // Deliver Message using this thread
-   if (msg != NULL) {
-      cp_msg(msg);
+   // staged transfer
+   buf = strm_buf[(strm.sent / CP_STREAM_XFER) & 1];
+   opto_pipe(OPTO_OP_START, (uint32_t)buf, (uint32_t)buf + sizeof(strm_buf[0]) - 1,
+             CP_STREAM_XFER);
+
+   // refill the transfer just sent
+   if (strm.staged < strm.packets) cp_stream_stage();
+
+} // end cp_stream_next()
+
+
+// ===========================================================================
+
+// 7.9
+
+static void cp_stream_stage(void) {
+
+/* 7.9.1   Functional Description
+
+   This routine will copy the next CP_STREAM_XFER packets of the region
+   into their staging transfer, each behind its pipe header.
+
+   7.9.2   Parameters:
+
+   NONE
+
+   7.9.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.9.4   Data Structures
+
+   uint32_t          i, offset, len;
+   uint32_t         *buf = strm_buf[(strm.staged / CP_STREAM_XFER) & 1];
+   pcp_stream_pipe_t pkt;
+
+// 7.9.5   Code
+
+   for (i=0;i<CP_STREAM_XFER;i++) {
+      pkt    = (pcp_stream_pipe_t)((uint8_t *)buf + (i * OPTO_PIPELEN_UINT8));
+      offset = strm.staged * CP_STREAM_DATA;
+      len    = 0;
+      if (offset < strm.length) {
+         len = strm.length - offset;
+         if (len > CP_STREAM_DATA) len = CP_STREAM_DATA;
+         memcpy(pkt->data, (uint8_t *)(strm.address + offset), len);
+      }
+      // padding starts at the end of the region
+      else offset = strm.length;
+      pkt->dst_cmid = CM_ID_PIPE;
+      pkt->msgid    = CM_PIPE_STREAM_DATA;
+      pkt->port     = 0;
+      pkt->flags    = 0;
+      pkt->msglen   = sizeof(cp_stream_pipe_t) >> 2;
+      pkt->seqid    = strm.staged++;
+      pkt->offset   = offset;
+      pkt->stamp_us = 0;
+      pkt->tag      = strm.tag;
+      pkt->length   = len;
+      pkt->magic    = CP_STREAM_MAGIC;
    }
 
-} // end cp_thread()
+   // the pipe engine reads SDRAM behind the data cache
+   alt_dcache_flush(buf, sizeof(strm_buf[0]));
 
+} // end cp_stream_stage()
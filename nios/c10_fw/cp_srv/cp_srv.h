@@ -8,6 +8,18 @@ typedef struct _cp_t {
    uint8_t           handle;
 } cp_t, *pcp_t;
 
+// Memory Stream, the region is staged packet by packet into two pipe
+// transfers, one is staged while the pipe engine sends the other
+typedef struct _cp_stream_t {
+   uint8_t           active;
+   uint32_t          tag;
+   uint32_t          address;
+   uint32_t          length;
+   uint32_t          packets;
+   uint32_t          staged;
+   uint32_t          sent;
+} cp_stream_t, *pcp_stream_t;
+
 // Receive Queue
 typedef struct _cp_rxq_t {
    uint32_t         *buf[CP_RX_QUE];
@@ -21,4 +33,4 @@ uint32_t cp_msg(pcm_msg_t msg);
 uint32_t cp_timer(pcm_msg_t msg);
 uint32_t cp_tick(void);
 uint32_t cp_qmsg(pcm_msg_t msg);
-void     cp_thread(void);
\ No newline at end of file
+uint32_t cp_thread(uint32_t batch);
\ No newline at end of file
@@ -168,7 +168,6 @@ uint32_t daq_msg(pcm_msg_t msg) {
 
    uint32_t    result = DAQ_OK;
 
-   uint16_t    cm_msg = MSG(msg->p.srvid, msg->p.msgid);
 
 // 7.4.5   Code
 
@@ -178,90 +177,100 @@ uint32_t daq_msg(pcm_msg_t msg) {
               msg->p.srvid, msg->p.msgid, msg->p.flags, msg->h.port);
    }
 
-   //
-   // RUN REQUEST MESSAGE
-   //
-   if (cm_msg == MSG(CM_ID_DAQ_SRV, DAQ_RUN_REQ)) {
-      pdaq_run_msg_t req = (pdaq_run_msg_t)msg;
-      pcmq_t slot = cm_alloc();
-      if (slot != NULL) {
-         pdaq_run_msg_t rsp = (pdaq_run_msg_t)slot->buf;
-         rsp->p.srvid    = CM_ID_DAQ_SRV;
-         rsp->p.msgid    = DAQ_RUN_RESP;
-         rsp->p.flags    = req->p.flags;
-         rsp->p.status   = DAQ_OK;
-         rsp->b.opcode   = req->b.opcode;
-         rsp->b.packets  = req->b.packets;
-         // Local Parameters
-         sv.opcode        = req->b.opcode;
-         sv.packets       = req->b.packets;
-         // RUN State
-         sv.state         = DAQH_STATE_RUN;
-         sv.adc_index     = 0;
-         sv.blklen        = ADC_POOL_CNT * sizeof(cm_pipe_daq_t);
-         // Issue the H/W Run Command
-         daq_hal_run(&sv);
-         cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(daq_run_msg_t), 0, 0);
-      }
-   }
-   //
-   // DAQ INTERRUPT INDICATION
-   //
-   else if (cm_msg == MSG(CM_ID_DAQ_SRV, DAQ_INT_IND)) {
-      // Packet Ready Indication, Only when not using Head/Tail from hardware
-      if (msg->p.flags & DAQ_INT_FLAG_PKT) {
-         // next location in circular memory
-         if (++sv.adc_index > (ADC_FIFO_SPAN / (ADC_POOL_CNT * sizeof(cm_pipe_daq_t)))) {
-            sv.adc_index = 0;
-         }
-      }
-      // Transfer Done Indication, from FIFO, FTDI or COM
-      else if (msg->p.flags & DAQ_INT_FLAG_PIPE) {
-         // Create Done Indication
-         pcmq_t slot = cm_alloc();
+   switch (MSG_INDEX(gc.msg_index, msg->p.srvid, msg->p.msgid)) {
+      //
+      // RUN REQUEST MESSAGE
+      //
+      case MSG_IDX_DAQ_RUN_REQ: {
+         pdaq_run_msg_t req = (pdaq_run_msg_t)msg;
+         pcmq_t slot = cm_alloc_len(sizeof(daq_run_msg_t));
          if (slot != NULL) {
-            pdaq_done_ind_msg_t ind = (pdaq_done_ind_msg_t)slot->buf;
-            ind->p.srvid    = CM_ID_DAQ_SRV;
-            ind->p.msgid    = DAQ_DONE_IND;
-            ind->p.flags    = DAQ_NO_FLAGS;
-            ind->p.status   = DAQ_OK;
-            ind->b.opcode   = sv.opcode;
-            ind->b.status   = daq.status;
-            ind->b.stamp    = gc.sys_time;
-            // Send the Indication
-            cm_send_msg(CM_MSG_IND, (pcm_msg_t)ind, NULL, sizeof(daq_done_ind_msg_t),
-                        CM_ID_BCAST, gc.winid);
+            pdaq_run_msg_t rsp = (pdaq_run_msg_t)slot->buf;
+            rsp->p.srvid    = CM_ID_DAQ_SRV;
+            rsp->p.msgid    = DAQ_RUN_RESP;
+            rsp->p.flags    = req->p.flags;
+            rsp->p.status   = DAQ_OK;
+            rsp->b.opcode   = req->b.opcode;
+            rsp->b.packets  = req->b.packets;
+            // the pipe engine is held by a CP memory stream
+            if (gc.status & CFG_STATUS_CP_STREAM) {
+               rsp->p.status = DAQ_ERR_BUSY;
+            }
+            else {
+               // Local Parameters
+               sv.opcode        = req->b.opcode;
+               sv.packets       = req->b.packets;
+               // RUN State
+               sv.state         = DAQH_STATE_RUN;
+               sv.adc_index     = 0;
+               sv.blklen        = ADC_POOL_CNT * sizeof(cm_pipe_daq_t);
+               // Issue the H/W Run Command
+               daq_hal_run(&sv);
+            }
+            cm_send_msg(CM_MSG_RESP, (pcm_msg_t)rsp, msg, sizeof(daq_run_msg_t), 0, 0);
          }
+         break;
       }
-      // ADC Done Indication, Ignore when using FIFO, FTDI or COM
-      else if (msg->p.flags & DAQ_INT_FLAG_DONE) {
-         // Create Done Indication
-         pcmq_t slot = cm_alloc();
-         if (slot != NULL) {
-            pdaq_done_ind_msg_t ind = (pdaq_done_ind_msg_t)slot->buf;
-            ind->p.srvid    = CM_ID_DAQ_SRV;
-            ind->p.msgid    = DAQ_DONE_IND;
-            ind->p.flags    = DAQ_NO_FLAGS;
-            ind->p.status   = DAQ_OK;
-            ind->b.opcode   = sv.opcode;
-            ind->b.status   = daq.status;
-            ind->b.stamp    = gc.sys_time;
-            // Send the Indication
-            cm_send_msg(CM_MSG_IND, (pcm_msg_t)ind, NULL, sizeof(daq_done_ind_msg_t),
-                        CM_ID_BCAST, gc.winid);
+      //
+      // DAQ INTERRUPT INDICATION
+      //
+      case MSG_IDX_DAQ_INT_IND: {
+         // Packet Ready Indication, Only when not using Head/Tail from hardware
+         if (msg->p.flags & DAQ_INT_FLAG_PKT) {
+            // next location in circular memory
+            if (++sv.adc_index > (ADC_FIFO_SPAN / (ADC_POOL_CNT * sizeof(cm_pipe_daq_t)))) {
+               sv.adc_index = 0;
+            }
          }
+         // Transfer Done Indication, from FIFO, FTDI or COM
+         else if (msg->p.flags & DAQ_INT_FLAG_PIPE) {
+            // Create Done Indication
+            pcmq_t slot = cm_alloc_len(sizeof(daq_done_ind_msg_t));
+            if (slot != NULL) {
+               pdaq_done_ind_msg_t ind = (pdaq_done_ind_msg_t)slot->buf;
+               ind->p.srvid    = CM_ID_DAQ_SRV;
+               ind->p.msgid    = DAQ_DONE_IND;
+               ind->p.flags    = DAQ_NO_FLAGS;
+               ind->p.status   = DAQ_OK;
+               ind->b.opcode   = sv.opcode;
+               ind->b.status   = daq.status;
+               ind->b.stamp    = gc.sys_time;
+               // Send the Indication
+               cm_send_msg(CM_MSG_IND, (pcm_msg_t)ind, NULL, sizeof(daq_done_ind_msg_t),
+                           CM_ID_BCAST, gc.winid);
+            }
+         }
+         // ADC Done Indication, Ignore when using FIFO, FTDI or COM
+         else if (msg->p.flags & DAQ_INT_FLAG_DONE) {
+            // Create Done Indication
+            pcmq_t slot = cm_alloc_len(sizeof(daq_done_ind_msg_t));
+            if (slot != NULL) {
+               pdaq_done_ind_msg_t ind = (pdaq_done_ind_msg_t)slot->buf;
+               ind->p.srvid    = CM_ID_DAQ_SRV;
+               ind->p.msgid    = DAQ_DONE_IND;
+               ind->p.flags    = DAQ_NO_FLAGS;
+               ind->p.status   = DAQ_OK;
+               ind->b.opcode   = sv.opcode;
+               ind->b.status   = daq.status;
+               ind->b.stamp    = gc.sys_time;
+               // Send the Indication
+               cm_send_msg(CM_MSG_IND, (pcm_msg_t)ind, NULL, sizeof(daq_done_ind_msg_t),
+                           CM_ID_BCAST, gc.winid);
+            }
+         }
+         break;
       }
-   }
-   //
-   // UNKNOWN MESSAGE
-   //
-   else {
-      if (gc.trace & CFG_TRACE_ERROR) {
-         // Unknown Message
-         xlprint("daq_msg() Unknown Message, srvid:msgid = %02X:%02X\n",
-               msg->p.srvid, msg->p.msgid);
-         dump((uint8_t *)msg, 12, 0, 0);
-      }
+      //
+      // UNKNOWN MESSAGE
+      //
+      default:
+         if (gc.trace & CFG_TRACE_ERROR) {
+            // Unknown Message
+            xlprint("daq_msg() Unknown Message, srvid:msgid = %02X:%02X\n",
+                  msg->p.srvid, msg->p.msgid);
+            dump((uint8_t *)msg, 12, 0, 0);
+         }
+         break;
    }
 
    // Release the Slot
@@ -400,6 +409,9 @@ uint32_t daq_qmsg(pcm_msg_t msg) {
       if (++rxq.head == rxq.slots) rxq.head = 0;
    }
 
+   // wake the thread
+   sched_ready(SCHED_TASK_DAQ);
+
    return result;
 
 } // end daq_qmsg()
@@ -409,20 +421,20 @@ uint32_t daq_qmsg(pcm_msg_t msg) {
 
 // 7.6
 
-void daq_thread(void) {
+uint32_t daq_thread(uint32_t batch) {
 
 /* 7.6.1   Functional Description
 
    This thread will provide a delivery service for CM messages from the queue,
-   it is called from background during idle time.
+   it is run by the background scheduler when a message is queued.
 
    7.6.2   Parameters:
 
-   NONE
+   batch    Messages to deliver
 
    7.6.3   Return Values:
 
-   NONE
+   count    Messages taken from the queue
 
 -----------------------------------------------------------------------------
 */
@@ -430,25 +442,25 @@ void daq_thread(void) {
 // 7.6.4   Data Structures
 
    pcm_msg_t   msg;
+   uint32_t    count;
 
 // 7.6.5   Code
 
-   // clear previous message
-   msg = NULL;
-
-   if (rxq.head != rxq.tail) {
+   for (count=0;count<batch && rxq.head != rxq.tail;count++) {
       // Validate message
-      if (rxq.buf[rxq.tail] != NULL) {
-         msg = (pcm_msg_t)rxq.buf[rxq.tail];
-         if (++rxq.tail == rxq.slots) rxq.tail = 0;
-      }
-      // silently drop
-      else {
-         if (++rxq.tail == rxq.slots) rxq.tail = 0;
+      msg = (pcm_msg_t)rxq.buf[rxq.tail];
+      if (++rxq.tail == rxq.slots) rxq.tail = 0;
+      // Deliver Message using this thread, silently drop
+      if (msg != NULL) {
+         PROF_START(start);
+         daq_msg(msg);
+         PROF_END(CP_PROF_DAQ_MSG, start);
       }
    }
 
-   // Deliver Message using this thread
-   if (msg != NULL) daq_msg(msg);
+   // more behind this batch
+   if (rxq.head != rxq.tail) sched_ready(SCHED_TASK_DAQ);
+
+   return count;
 
 } // end daq_thread()
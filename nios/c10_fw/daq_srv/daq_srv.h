@@ -33,4 +33,4 @@ uint32_t daq_msg(pcm_msg_t msg);
 uint32_t daq_timer(pcm_msg_t msg);
 uint32_t daq_tick(void);
 uint32_t daq_qmsg(pcm_msg_t msg);
-void     daq_thread(void);
+uint32_t daq_thread(uint32_t batch);
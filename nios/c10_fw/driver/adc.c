@@ -187,12 +187,14 @@ void adc_isr(void *arg) {
 
 // 7.2.5   Code
 
+   PROF_ISR_START(start);
+
    // local irq copy
    irq.i = regs->irq;
 
    // report interrupt request
    if (gc.trace & CFG_TRACE_IRQ) {
-      xlprint("adc_isr() irq = %02X\n", irq.i);
+      XLTRACE("adc_isr() irq = %02X\n", irq.i);
    }
 
    //
@@ -215,6 +217,8 @@ void adc_isr(void *arg) {
       cm_local(CM_ID_DAQ_SRV, DAQ_INT_IND, DAQ_INT_FLAG_DONE, DAQ_OK);
    }
 
+   PROF_ISR_END(CP_PROF_ADC_ISR, start);
+
 } // end adc_isr()
 
 
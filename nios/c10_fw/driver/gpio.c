@@ -192,12 +192,16 @@ void gpio_isr(void *arg) {
 
 // 7.2.5   Code
 
+   PROF_ISR_START(start);
+
    // Disable the ADXL345 Interrupt
    gpio_i2c_set(GPIO_XL345_INT_EN, 0x00);
 
    // Send Interrupt Indication for Transferring samples
    cm_local(CM_ID_CP_SRV, CP_INT_IND, CP_IND_XL345, CP_OK);
 
+   PROF_ISR_END(CP_PROF_GPIO_ISR, start);
+
 } // end gpio_isr()
 
 
@@ -20,6 +20,11 @@
          6. Set ADC_POOL_CNT for interface speed
          7. Disable ADC PKT and DONE interrupts
 
+      A message is sent from a CM slot, queued and copied to a free h/w
+      TX slot, or built in the staging buffer that holds the h/w TX slot
+      reserved with opto_tx_alloc(), CM_IO_TX_ALLOC, and copied to it on
+      commit without a CM slot.
+
    1.3 Specification/Design Reference
 
       See fw_cfg.h under the share directory.
@@ -34,7 +39,9 @@
 
    1.6 Notes
 
-      NONE
+      The OPTO Avalon slave has no byteenable, a byte or halfword store
+      rewrites its whole word. The h/w TX slots are only written a word
+      at a time, a message is never built in them.
 
    2  CONTENTS
 
@@ -70,6 +77,10 @@
          7.6   opto_msgtx()
          7.7   opto_pipe()
          7.8   opto_version()
+         7.9   opto_pipe_notify()
+         7.10  opto_tx_alloc()
+         7.11  opto_tx_commit()
+         7.12  opto_tx_stats()
 
 -----------------------------------------------------------------------------*/
 
@@ -96,11 +107,17 @@
    static   uint8_t        cm_port = CM_PORT_NONE;
 
    static   opto_txq_t     txq;
+   static   uint32_t       tx_rsv[OPTO_MSGLEN_UINT32];
    static   uint8_t        tx_head;
    static   uint8_t        rx_tail;
 
    static   volatile popto_regs_t   regs = (volatile popto_regs_t)OPTO_BASE;
 
+   // pipe done indication
+   static   uint8_t        pipe_srvid = CM_ID_DAQ_SRV;
+   static   uint8_t        pipe_msgid = DAQ_INT_IND;
+   static   uint8_t        pipe_flags = DAQ_INT_FLAG_PIPE;
+
 // 7 MODULE CODE
 
 // ===========================================================================
@@ -251,11 +268,13 @@ void opto_isr(void *arg) {
 
 // 7.2.5   Code
 
+   PROF_ISR_START(start);
+
    // process all interrupt signals, receive has priority
    while ((irq.i = regs->irq) != 0) {
       // report interrupt request
       if (gc.trace & CFG_TRACE_IRQ) {
-         xlprint("opto_isr() irq = %02X\n", irq.i);
+         XLTRACE("opto_isr() irq = %02X\n", irq.i);
       }
       //
       // RX INTERRUPT
@@ -290,8 +309,8 @@ void opto_isr(void *arg) {
                msg->h.slot = slotid;
                // report message content
                if ((gc.trace & CFG_TRACE_UART) && (slot != NULL)) {
-                  xlprint("opto_isr() msglen:slotid = %d:%d\n", msg->h.msglen, msg->h.slot);
-                  dump((uint8_t *)slot->buf, slot->msglen, LIB_ASCII, 0);
+                  XLTRACE("opto_isr() msglen:slotid = %d:%d, %08X %08X %08X\n",
+                        msg->h.msglen, msg->h.slot, slot->buf[0], slot->buf[1], slot->buf[2]);
                }
             }
             // advance the h/w tail pointer
@@ -322,10 +341,12 @@ void opto_isr(void *arg) {
       if (irq.b.pipe == 1) {
          // clear the interrupt
          opto_intack(OPTO_INT_PIPE);
-         cm_local(CM_ID_DAQ_SRV, DAQ_INT_IND, DAQ_INT_FLAG_PIPE, DAQ_OK);
+         cm_local(pipe_srvid, pipe_msgid, pipe_flags, CM_OK);
       }
    }
 
+   PROF_ISR_END(CP_PROF_OPTO_ISR, start);
+
 } // end opto_isr()
 
 
@@ -420,9 +441,8 @@ void opto_tx(pcm_msg_t msg) {
 
    // Trace Entry
    if (gc.trace & CFG_TRACE_UART) {
-      xlprint("opto_tx() srvid:msgid:msglen:msg = %02X:%02X:%d:%08X\n",
+      XLTRACE("opto_tx() srvid:msgid:msglen:msg = %02X:%02X:%d:%08X\n",
                msg->p.srvid, msg->p.msgid, msg->h.msglen, (uint32_t)msg);
-      dump((uint8_t *)msg, msg->h.msglen, LIB_ASCII, 0);
    }
 
    // h/w transmit tail
@@ -434,8 +454,8 @@ void opto_tx(pcm_msg_t msg) {
       // advance the tx queue
       if (++txq.tail == txq.slots) txq.tail = 0;
    }
-   // check for h/w slot availability?
-   else if (tx_head != tail) {
+   // check for h/w slot availability, not held for a message built in place
+   else if (!txq.rsv && tx_head != tail) {
       // copy message to hardware
       for (i=0;i<(msg->h.msglen + 3) >> 2;i++) {
          regs->tx_buf[i + (tx_head * OPTO_MSGLEN_UINT32)] = out[i];
@@ -452,6 +472,7 @@ void opto_tx(pcm_msg_t msg) {
       regs->ctl      = ctl.i;
       // show activity
       gpio_set_val(GPIO_LED_COM, GPIO_LED_ON);
+      txq.copied++;
       // release message
       cm_free(msg);
    }
@@ -466,41 +487,79 @@ void opto_tx(pcm_msg_t msg) {
 
 // 7.5
 
-void opto_cmio(uint8_t op_code, pcm_msg_t msg) {
+uint32_t opto_cmio(uint8_t op_code, pcm_msg_t msg) {
 
 /* 7.5.1   Functional Description
 
    OPCODES
 
    CM_IO_TX : The transmit queue index will be incremented,
-   this causes the top of the queue to be transmitted.
+   this causes the top of the queue to be transmitted. A message
+   built in the staging buffer is copied to its h/w slot. When the queue is full
+   the message is dropped and counted.
+
+   CM_IO_TX_ALLOC : The next h/w TX slot is reserved for a message
+   built in the staging buffer, see opto_tx_alloc().
+
+   CM_IO_FREE : The reservation is released unsent.
 
    7.5.2   Parameters:
 
    msg     Message Pointer
-   opCode  CM_IO_TX
+   opCode  CM_IO_TX, CM_IO_TX_ALLOC or CM_IO_FREE
 
    7.5.3   Return Values:
 
-   NONE
+   result   CM_OK or CM_ERR_TX_FULL, the message address for CM_IO_TX_ALLOC
 
 -----------------------------------------------------------------------------
 */
 
 // 7.5.4   Data Structures
 
+   uint32_t    result = CM_OK;
+   uint8_t     head, depth;
+
 // 7.5.5   Code
 
    if (gc.trace & CFG_TRACE_UART) {
       xlprint("opto_cmio() op_code:msg = %02X:%08X\n", op_code, (uint32_t)msg);
    }
 
-   // place in transmit queue
-   txq.buf[txq.head] = (uint32_t *)msg;
-   if (++txq.head == txq.slots) txq.head = 0;
+   switch (op_code) {
+      case CM_IO_TX_ALLOC:
+         result = (uint32_t)opto_tx_alloc();
+         break;
+      case CM_IO_FREE:
+         opto_tx_commit(msg, FALSE);
+         break;
+      case CM_IO_TX:
+      default:
+         // built in the staging buffer, no CM slot
+         if (msg->h.slot == CM_Q_NULL) {
+            result = opto_tx_commit(msg, TRUE);
+            break;
+         }
+         // full, the ISR only advances the tail
+         head = txq.head + 1;
+         if (head == txq.slots) head = 0;
+         if (head == txq.tail) {
+            txq.drops++;
+            cm_free(msg);
+            result = CM_ERR_TX_FULL;
+            break;
+         }
+         // place in transmit queue
+         txq.buf[txq.head] = (uint32_t *)msg;
+         txq.head = head;
+         depth = (txq.head + txq.slots - txq.tail) % txq.slots;
+         if (depth > txq.peak) txq.peak = depth;
+         // try to transmit message
+         opto_msgtx();
+         break;
+   }
 
-   // try to transmit message
-   opto_msgtx();
+   return result;
 
 } // end opto_cmio()
 
@@ -582,6 +641,12 @@ void opto_pipe(uint32_t opcode, uint32_t addr_beg, uint32_t addr_end, uint32_t p
    ctl.i = regs->ctl;
 
    if (opcode & OPTO_OP_START) {
+      // the read master starts on a rising PIPE_RUN, drop
+      // the run left set by a finished transfer
+      if (ctl.b.pipe_run == 1) {
+         ctl.b.pipe_run = 0;
+         regs->ctl      = ctl.i;
+      }
       // begin-end memory address of pipe message OPTO
       regs->addr_beg = addr_beg;
       regs->addr_end = addr_end;
@@ -633,3 +698,229 @@ uint32_t opto_version(void) {
    return regs->version;
 
 } // end opto_version()
+
+
+// ===========================================================================
+
+// 7.9
+
+void opto_pipe_notify(uint8_t srvid, uint8_t msgid, uint8_t flags) {
+
+/* 7.9.1   Functional Description
+
+   This routine will select the indication sent when a pipe transfer is
+   done. Only change it while the pipe is stopped.
+
+   7.9.2   Parameters:
+
+   srvid      Server ID
+   msgid      Message ID
+   flags      Message Flags
+
+   7.9.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.9.4   Data Structures
+
+// 7.9.5   Code
+
+   // Disable OPTO ISR
+   alt_ic_irq_disable(OPTO_IRQ_INTERRUPT_CONTROLLER_ID, OPTO_IRQ);
+
+   pipe_srvid = srvid;
+   pipe_msgid = msgid;
+   pipe_flags = flags;
+
+   // Enable OPTO ISR
+   alt_ic_irq_enable(OPTO_IRQ_INTERRUPT_CONTROLLER_ID, OPTO_IRQ);
+
+} // end opto_pipe_notify()
+
+
+// ===========================================================================
+
+// 7.10
+
+pcm_msg_t opto_tx_alloc(void) {
+
+/* 7.10.1   Functional Description
+
+   This routine will reserve the next h/w TX slot, when no message is
+   queued ahead of it, and return the staging buffer the message is
+   built in. The header and parameters are cleared and the slot id is
+   CM_Q_NULL, the message is sent with cm_send() or released with
+   cm_free().
+
+   7.10.2   Parameters:
+
+   NONE
+
+   7.10.3   Return Values:
+
+   msg      Message in the staging buffer, NULL when no h/w slot is free
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.10.4   Data Structures
+
+   pcm_msg_t   msg = NULL;
+   uint32_t    i;
+   uint8_t     tail;
+   uint32_t   *out;
+
+   opto_sta_reg_t sta;
+
+// 7.10.5   Code
+
+   // Disable OPTO ISR
+   alt_ic_irq_disable(OPTO_IRQ_INTERRUPT_CONTROLLER_ID, OPTO_IRQ);
+
+   // h/w transmit tail
+   sta.i = regs->sta;
+   tail  = (sta.b.tx_tail + 1) & (OPTO_TX_SLOTS - 1);
+
+   // one reservation, queued messages go first
+   if (!txq.rsv && txq.head == txq.tail && tx_head != tail) {
+      txq.rsv = TRUE;
+      msg = (pcm_msg_t)tx_rsv;
+   }
+
+   // Enable OPTO ISR
+   alt_ic_irq_enable(OPTO_IRQ_INTERRUPT_CONTROLLER_ID, OPTO_IRQ);
+
+   if (msg != NULL) {
+      out = (uint32_t *)msg;
+      for (i=0;i<sizeof(cm_msg_t) >> 2;i++) {
+         out[i] = 0;
+      }
+      msg->h.slot = CM_Q_NULL;
+      msg->h.port = cm_port;
+   }
+
+   return msg;
+
+} // end opto_tx_alloc()
+
+
+// ===========================================================================
+
+// 7.11
+
+uint32_t opto_tx_commit(pcm_msg_t msg, uint8_t send) {
+
+/* 7.11.1   Functional Description
+
+   This routine will copy a message from the staging buffer to the
+   reserved h/w TX slot a word at a time and transmit it, or release the
+   slot unsent. The queue is then resumed.
+
+   7.11.2   Parameters:
+
+   msg      Message from opto_tx_alloc()
+   send     TRUE to transmit, FALSE to release
+
+   7.11.3   Return Values:
+
+   result   CM_OK, CM_ERROR when msg is not the reserved slot
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.11.4   Data Structures
+
+   uint32_t    result = CM_OK;
+   uint32_t    i;
+
+   opto_ctl_reg_t ctl;
+
+// 7.11.5   Code
+
+   // Disable OPTO ISR
+   alt_ic_irq_disable(OPTO_IRQ_INTERRUPT_CONTROLLER_ID, OPTO_IRQ);
+
+   if (txq.rsv && msg == (pcm_msg_t)tx_rsv) {
+      if (send) {
+         // Trace Entry
+         if (gc.trace & CFG_TRACE_UART) {
+            XLTRACE("opto_tx_commit() srvid:msgid:msglen:msg = %02X:%02X:%d:%08X\n",
+                     msg->p.srvid, msg->p.msgid, msg->h.msglen, (uint32_t)msg);
+         }
+         // copy message to hardware, whole words only
+         for (i=0;i<(msg->h.msglen + 3) >> 2;i++) {
+            regs->tx_buf[i + (tx_head * OPTO_MSGLEN_UINT32)] = tx_rsv[i];
+         }
+         // advance the h/w tx queue
+         if (++tx_head == OPTO_TX_SLOTS) tx_head = 0;
+         // transmit, read-modify-write control
+         ctl.i = regs->ctl;
+         ctl.b.tx_head  = tx_head;
+         regs->ctl      = ctl.i;
+         // show activity
+         gpio_set_val(GPIO_LED_COM, GPIO_LED_ON);
+         txq.direct++;
+      }
+      txq.rsv = FALSE;
+   }
+   else {
+      result = CM_ERROR;
+   }
+
+   // Enable OPTO ISR
+   alt_ic_irq_enable(OPTO_IRQ_INTERRUPT_CONTROLLER_ID, OPTO_IRQ);
+
+   // messages queued behind the reservation
+   opto_msgtx();
+
+   return result;
+
+} // end opto_tx_commit()
+
+
+// ===========================================================================
+
+// 7.12
+
+void opto_tx_stats(popto_txq_t stats, uint8_t clear) {
+
+/* 7.12.1   Functional Description
+
+   This routine will return the transmit queue counters, cleared after
+   the copy when requested.
+
+   7.12.2   Parameters:
+
+   stats    Copy of the transmit queue
+   clear    TRUE to clear the counters
+
+   7.12.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.12.4   Data Structures
+
+// 7.12.5   Code
+
+   // Disable OPTO ISR
+   alt_ic_irq_disable(OPTO_IRQ_INTERRUPT_CONTROLLER_ID, OPTO_IRQ);
+
+   memcpy(stats, &txq, sizeof(opto_txq_t));
+
+   if (clear) {
+      txq.peak   = 0;
+      txq.copied = 0;
+      txq.direct = 0;
+      txq.drops  = 0;
+   }
+
+   // Enable OPTO ISR
+   alt_ic_irq_enable(OPTO_IRQ_INTERRUPT_CONTROLLER_ID, OPTO_IRQ);
+
+} // end opto_tx_stats()
@@ -37,7 +37,7 @@
 #define  OPTO_TX_BUFFER_LEN    2048
 #define  OPTO_RX_BUFFER_LEN    2048
 
-#define  OPTO_TX_QUE           8
+#define  OPTO_TX_QUE           32
 #define  OPTO_RX_QUE           8
 
 #define  OPTO_TX_SLOTS        (OPTO_TX_BUFFER_LEN / OPTO_MSGLEN_UINT8)
@@ -101,12 +101,19 @@ typedef struct _opto_regs_t {
    uint32_t       pipe[512];
 } opto_regs_t, *popto_regs_t;
 
-// Transmit Queue
+// Transmit Queue, rsv holds the h/w slot at tx_head for a message
+// built in the staging buffer, copied and direct count the messages
+// sent from a CM slot and from the staging buffer
 typedef struct _opto_txq_t {
    uint32_t     *buf[OPTO_TX_QUE];
    uint8_t       tail;
    uint8_t       head;
    uint8_t       slots;
+   uint8_t       rsv;
+   uint32_t      peak;
+   uint32_t      copied;
+   uint32_t      direct;
+   uint32_t      drops;
 } opto_txq_t, *popto_txq_t;
 
 // Receive Queue
@@ -121,8 +128,12 @@ uint32_t  opto_init(uint32_t baudrate, uint8_t port);
 void      opto_isr(void *arg);
 void      opto_intack(uint8_t int_type);
 void      opto_tx(pcm_msg_t msg);
-void      opto_cmio(uint8_t op_code, pcm_msg_t msg);
+uint32_t  opto_cmio(uint8_t op_code, pcm_msg_t msg);
 void      opto_msgtx(void);
 void      opto_pipe(uint32_t opcode, uint32_t addr_beg, uint32_t addr_end, uint32_t pktcnt);
 uint32_t  opto_version(void);
+void      opto_pipe_notify(uint8_t srvid, uint8_t msgid, uint8_t flags);
+pcm_msg_t opto_tx_alloc(void);
+uint32_t  opto_tx_commit(pcm_msg_t msg, uint8_t send);
+void      opto_tx_stats(popto_txq_t stats, uint8_t clear);
 
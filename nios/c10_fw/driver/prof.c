@@ -0,0 +1,353 @@
+/*-----------------------------------------------------------------------------
+
+   1  ABSTRACT
+
+   1.1 Module Type
+
+      Cycle Profiling
+
+   1.2 Functional Description
+
+      The cycle profiling routines are contained in this module.
+
+      The ISRs, cm_alloc() and the DAQ and CP message handlers are timed
+      with stamp_count() through the PROF_ macros of prof.h. Every profile
+      point keeps the count, min, max and sum of its cycles and a log2
+      histogram. The outermost interrupts disabled windows, a whole ISR or
+      a background PROF_IRQ_DISABLE() section, are kept as CP_PROF_IRQ_OFF.
+
+      CP_PROF_REQ returns one point per request and CP_PROF_CLR clears it.
+
+   1.3 Specification/Design Reference
+
+      See fw_cfg.h under the share directory.
+
+   1.4 Module Test Specification Reference
+
+      None
+
+   1.5 Compilation Information
+
+      See fw_cfg.h under the share directory, CFG_PROF 0 compiles the
+      profiling out and CP_PROF_REQ is answered with CP_ERR_NO_DATA.
+
+   1.6 Notes
+
+      The stamp counter runs at ALT_CPU_FREQ, a snapshot is a register
+      write and read, which is included in every measurement.
+
+   2  CONTENTS
+
+      1 ABSTRACT
+        1.1 Module Type
+        1.2 Functional Description
+        1.3 Specification/Design Reference
+        1.4 Module Test Specification Reference
+        1.5 Compilation Information
+        1.6 Notes
+
+      2 CONTENTS
+
+      3 VOCABULARY
+
+      4 EXTERNAL RESOURCES
+        4.1  Include Files
+        4.2  External Data Structures
+        4.3  External Function Prototypes
+
+      5 LOCAL CONSTANTS AND MACROS
+
+      6 MODULE DATA STRUCTURES
+        6.1  Local Function Prototypes
+        6.2  Local Data Structures
+
+      7 MODULE CODE
+        7.1  prof_add()
+        7.2  prof_isr_enter()
+        7.3  prof_isr_exit()
+        7.4  prof_irq_disable()
+        7.5  prof_irq_enable()
+        7.6  prof_ctl()
+
+-----------------------------------------------------------------------------*/
+
+// 3 VOCABULARY
+
+// 4 EXTERNAL RESOURCES
+
+// 4.1  Include Files
+
+#include "main.h"
+
+// 4.2   External Data Structures
+
+// 4.3 External Function Prototypes
+
+// 5 LOCAL CONSTANTS AND MACROS
+
+// 6 MODULE DATA STRUCTURES
+
+// 6.1  Local Function Prototypes
+
+// 6.2  Local Data Structures
+
+#if CFG_PROF
+   static   prof_t   prof = {0};
+#endif
+
+// 7 MODULE CODE
+
+#if CFG_PROF
+
+// ===========================================================================
+
+// 7.1
+
+void prof_add(uint32_t point, uint32_t cycles) {
+
+/* 7.1.1   Functional Description
+
+   This routine will add a measurement to a profile point, safe from the
+   ISRs.
+
+   7.1.2   Parameters:
+
+   point    CP_PROF_*
+   cycles   Measurement
+
+   7.1.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.1.4   Data Structures
+
+   pprof_point_t  p = &prof.point[point];
+   uint32_t       bin;
+
+   alt_irq_context context;
+
+// 7.1.5   Code
+
+   // log2 bin, 0 cycles in bin 0
+   bin = (cycles == 0) ? 0 : 32 - __builtin_clz(cycles);
+   if (bin >= PROF_BINS) bin = PROF_BINS - 1;
+
+   context = alt_irq_disable_all();
+
+   if (p->count == 0 || cycles < p->min) p->min = cycles;
+   if (cycles > p->max) p->max = cycles;
+   p->count++;
+   p->sum += cycles;
+   p->hist[bin]++;
+
+   alt_irq_enable_all(context);
+
+} // end prof_add()
+
+
+// ===========================================================================
+
+// 7.2
+
+uint32_t prof_isr_enter(void) {
+
+/* 7.2.1   Functional Description
+
+   This routine will start an ISR measurement, the ISR runs with the
+   interrupts disabled so it also opens a window.
+
+   7.2.2   Parameters:
+
+   NONE
+
+   7.2.3   Return Values:
+
+   start    stamp_count() at entry
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.2.4   Data Structures
+
+   uint32_t    start;
+
+// 7.2.5   Code
+
+   start = stamp_count();
+   if (prof.depth++ == 0) prof.off_start = start;
+
+   return start;
+
+} // end prof_isr_enter()
+
+
+// ===========================================================================
+
+// 7.3
+
+void prof_isr_exit(uint32_t point, uint32_t start) {
+
+/* 7.3.1   Functional Description
+
+   This routine will end an ISR measurement and its window.
+
+   7.3.2   Parameters:
+
+   point    CP_PROF_*
+   start    prof_isr_enter() snapshot
+
+   7.3.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.3.4   Data Structures
+
+   uint32_t    now;
+
+// 7.3.5   Code
+
+   now = stamp_count();
+   prof_add(point, now - start);
+   if (--prof.depth == 0) prof_add(CP_PROF_IRQ_OFF, now - prof.off_start);
+
+} // end prof_isr_exit()
+
+
+// ===========================================================================
+
+// 7.4
+
+alt_irq_context prof_irq_disable(void) {
+
+/* 7.4.1   Functional Description
+
+   This routine will disable the interrupts like alt_irq_disable_all()
+   and open a window when none is open.
+
+   7.4.2   Parameters:
+
+   NONE
+
+   7.4.3   Return Values:
+
+   context  For prof_irq_enable()
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.4.4   Data Structures
+
+   alt_irq_context context;
+
+// 7.4.5   Code
+
+   context = alt_irq_disable_all();
+   if (prof.depth++ == 0) prof.off_start = stamp_count();
+
+   return context;
+
+} // end prof_irq_disable()
+
+
+// ===========================================================================
+
+// 7.5
+
+void prof_irq_enable(alt_irq_context context) {
+
+/* 7.5.1   Functional Description
+
+   This routine will close the outermost window and restore the
+   interrupts like alt_irq_enable_all().
+
+   7.5.2   Parameters:
+
+   context  prof_irq_disable() context
+
+   7.5.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.5.4   Data Structures
+
+// 7.5.5   Code
+
+   if (--prof.depth == 0) prof_add(CP_PROF_IRQ_OFF, stamp_count() - prof.off_start);
+   alt_irq_enable_all(context);
+
+} // end prof_irq_enable()
+
+#endif
+
+// ===========================================================================
+
+// 7.6
+
+uint32_t prof_ctl(uint8_t flags, pcp_prof_body_t body) {
+
+/* 7.6.1   Functional Description
+
+   This routine will serve CP_PROF_REQ, the point of body->point is
+   returned in body and cleared with CP_PROF_CLR.
+
+   7.6.2   Parameters:
+
+   flags    CP_PROF_GET, CP_PROF_CLR
+   body     Request body, returned as the response body
+
+   7.6.3   Return Values:
+
+   result   CP_OK, CP_ERR_DATA_RANGE or CP_ERR_NO_DATA
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.6.4   Data Structures
+
+   uint32_t       result = CP_OK;
+
+#if CFG_PROF
+   pprof_point_t  p;
+
+   alt_irq_context context;
+#endif
+
+// 7.6.5   Code
+
+   body->points = PROF_POINTS;
+   body->freq   = ALT_CPU_FREQ;
+
+#if CFG_PROF
+   if (body->point >= PROF_POINTS) return CP_ERR_DATA_RANGE;
+
+   p = &prof.point[body->point];
+
+   context = alt_irq_disable_all();
+
+   body->count  = p->count;
+   body->min    = p->min;
+   body->max    = p->max;
+   body->sum_hi = (uint32_t)(p->sum >> 32);
+   body->sum_lo = (uint32_t)p->sum;
+   memcpy(body->hist, p->hist, sizeof(body->hist));
+
+   if (flags & CP_PROF_CLR) memset(p, 0, sizeof(prof_point_t));
+
+   alt_irq_enable_all(context);
+#else
+   result = CP_ERR_NO_DATA;
+#endif
+
+   return result;
+
+} // end prof_ctl()
+
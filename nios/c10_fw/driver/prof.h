@@ -0,0 +1,50 @@
+#pragma once
+
+#define  PROF_OK               0x00000000
+
+// Profile Points and log2 Bins
+#define  PROF_POINTS           CP_PROF_POINTS
+#define  PROF_BINS             CP_PROF_BINS
+
+// Cycle profiling on stamp_count(), compiled out with CFG_PROF 0.
+// PROF_START declares the start snapshot, PROF_ISR_START also opens an
+// interrupts disabled window, PROF_IRQ_DISABLE and PROF_IRQ_ENABLE stand
+// in for alt_irq_disable_all() and alt_irq_enable_all()
+#if CFG_PROF
+#define  PROF_START(s)         uint32_t s = stamp_count()
+#define  PROF_END(p, s)        prof_add(p, stamp_count() - (s))
+#define  PROF_ISR_START(s)     uint32_t s = prof_isr_enter()
+#define  PROF_ISR_END(p, s)    prof_isr_exit(p, s)
+#define  PROF_IRQ_DISABLE()    prof_irq_disable()
+#define  PROF_IRQ_ENABLE(c)    prof_irq_enable(c)
+#else
+#define  PROF_START(s)
+#define  PROF_END(p, s)
+#define  PROF_ISR_START(s)
+#define  PROF_ISR_END(p, s)
+#define  PROF_IRQ_DISABLE()    alt_irq_disable_all()
+#define  PROF_IRQ_ENABLE(c)    alt_irq_enable_all(c)
+#endif
+
+// Profile Point, cycles
+typedef struct _prof_point_t {
+   uint32_t          count;
+   uint32_t          min;
+   uint32_t          max;
+   uint64_t          sum;
+   uint32_t          hist[PROF_BINS];
+} prof_point_t, *pprof_point_t;
+
+// Profile, depth counts the nested interrupts disabled sections
+typedef struct _prof_t {
+   uint32_t          depth;
+   uint32_t          off_start;
+   prof_point_t      point[PROF_POINTS];
+} prof_t, *pprof_t;
+
+void      prof_add(uint32_t point, uint32_t cycles);
+uint32_t  prof_isr_enter(void);
+void      prof_isr_exit(uint32_t point, uint32_t start);
+alt_irq_context prof_irq_disable(void);
+void      prof_irq_enable(alt_irq_context context);
+uint32_t  prof_ctl(uint8_t flags, pcp_prof_body_t body);
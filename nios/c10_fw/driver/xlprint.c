@@ -301,7 +301,7 @@ static int print_uart(char **out, const char *format, va_list args) {
             width += *format - '0';
          }
          if( *format == 's' ) {
-            register char *s = (char *)va_arg( args, int );
+            register char *s = va_arg( args, char * );
             pc += prints (out, s?s:"(null)", width, pad);
             continue;
          }
@@ -369,6 +369,8 @@ void xlprint_isr(void *arg) {
 
 // 7.3.5   Code
 
+   PROF_ISR_START(start);
+
    // Up-Arrow is 0x5B 0x41
    // Down-Arrow is 0x5B 0x42
 
@@ -386,6 +388,9 @@ void xlprint_isr(void *arg) {
 
    // send character to CLI
    cli_put(&gc.cli, (char)ch);
+   sched_ready(SCHED_TASK_CLI);
+
+   PROF_ISR_END(CP_PROF_UART_ISR, start);
 
 } // end xlprint_isr()
 
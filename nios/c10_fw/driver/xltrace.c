@@ -0,0 +1,273 @@
+/*-----------------------------------------------------------------------------
+
+   1  ABSTRACT
+
+   1.1 Module Type
+
+      Deferred Trace
+
+   1.2 Functional Description
+
+      The deferred trace routines are contained in this module.
+
+      XLTRACE() records the address of its format string, alt_timestamp()
+      and up to CP_XLT_ARGS arguments as one cp_xlt_rec_t in a ring in
+      SDRAM, with interrupts disabled for the few stores of the record.
+      Nothing is formatted and the UART is not touched, so XLTRACE() may
+      be used from the ISRs at the full DAQ rate. A full ring drops the
+      record and counts it.
+
+      The ring is drained by the background scheduler with xlt_drain(),
+      which formats XLT_DRAIN_MAX records per run to the UART with
+      xlprint().
+      CP_XLT_REQ hands the ring to the host instead, the host reads the
+      records with the CP block or stream requests, frees them with
+      CP_XLT_FREE and decodes the format strings from the firmware ELF.
+
+   1.3 Specification/Design Reference
+
+      See fw_cfg.h under the share directory.
+
+   1.4 Module Test Specification Reference
+
+      None
+
+   1.5 Compilation Information
+
+      See fw_cfg.h under the share directory.
+
+   1.6 Notes
+
+      The arguments are kept as uint32_t, %s arguments are printed or
+      decoded when the record is drained and must point at strings that
+      are still valid then, literals in the firmware image.
+
+   2  CONTENTS
+
+      1 ABSTRACT
+        1.1 Module Type
+        1.2 Functional Description
+        1.3 Specification/Design Reference
+        1.4 Module Test Specification Reference
+        1.5 Compilation Information
+        1.6 Notes
+
+      2 CONTENTS
+
+      3 VOCABULARY
+
+      4 EXTERNAL RESOURCES
+        4.1  Include Files
+        4.2  External Data Structures
+        4.3  External Function Prototypes
+
+      5 LOCAL CONSTANTS AND MACROS
+
+      6 MODULE DATA STRUCTURES
+        6.1  Local Function Prototypes
+        6.2  Local Data Structures
+
+      7 MODULE CODE
+        7.1  xltrace()
+        7.2  xlt_drain()
+        7.3  xlt_ctl()
+
+-----------------------------------------------------------------------------*/
+
+// 3 VOCABULARY
+
+// 4 EXTERNAL RESOURCES
+
+// 4.1  Include Files
+
+#include "main.h"
+
+// 4.2   External Data Structures
+
+// 4.3 External Function Prototypes
+
+// 5 LOCAL CONSTANTS AND MACROS
+
+// 6 MODULE DATA STRUCTURES
+
+// 6.1  Local Function Prototypes
+
+// 6.2  Local Data Structures
+
+   static   xlt_t          xlt = {0};
+
+   // trace ring
+   static   cp_xlt_rec_t   ring[XLT_RECS];
+
+// 7 MODULE CODE
+
+// ===========================================================================
+
+// 7.1
+
+void xltrace(const char *fmt, uint32_t a, uint32_t b, uint32_t c,
+             uint32_t d, uint32_t e) {
+
+/* 7.1.1   Functional Description
+
+   This routine will record a trace in the ring, or count it as dropped
+   when the ring is full. Safe from the ISRs, use through XLTRACE().
+
+   7.1.2   Parameters:
+
+   fmt      xlprint Format string, a literal
+   a .. e   Arguments
+
+   7.1.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.1.4   Data Structures
+
+   pcp_xlt_rec_t  rec;
+   uint32_t       head;
+
+   alt_irq_context context;
+
+// 7.1.5   Code
+
+   context = PROF_IRQ_DISABLE();
+
+   head = xlt.head;
+   if (head - xlt.tail < XLT_RECS) {
+      rec = &ring[head & (XLT_RECS - 1)];
+      rec->fmt    = (uint32_t)fmt;
+      rec->stamp  = alt_timestamp();
+      rec->seqid  = head;
+      rec->arg[0] = a;
+      rec->arg[1] = b;
+      rec->arg[2] = c;
+      rec->arg[3] = d;
+      rec->arg[4] = e;
+      xlt.head    = head + 1;
+      // wake the drain
+      if (xlt.sink == CP_XLT_SINK_UART) sched_ready(SCHED_TASK_XLT);
+   }
+   else {
+      xlt.drops++;
+   }
+
+   PROF_IRQ_ENABLE(context);
+
+} // end xltrace()
+
+
+// ===========================================================================
+
+// 7.2
+
+uint32_t xlt_drain(uint32_t batch) {
+
+/* 7.2.1   Functional Description
+
+   This routine will format up to batch records to the UART, run by the
+   background scheduler. Records are left for the host while it holds
+   the ring. The tail is only moved here and by CP_XLT_FREE.
+
+   7.2.2   Parameters:
+
+   batch    Records to format, XLT_DRAIN_MAX
+
+   7.2.3   Return Values:
+
+   count    Records formatted
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.2.4   Data Structures
+
+   pcp_xlt_rec_t  rec;
+   uint32_t       i;
+   uint32_t       drops;
+
+// 7.2.5   Code
+
+   if (xlt.sink != CP_XLT_SINK_UART) return 0;
+
+   for (i=0;i<batch && xlt.tail != xlt.head;i++) {
+      rec = &ring[xlt.tail & (XLT_RECS - 1)];
+      xlprint((const char *)rec->fmt, rec->arg[0], rec->arg[1], rec->arg[2],
+              rec->arg[3], rec->arg[4]);
+      xlt.tail++;
+   }
+
+   // report drops once the ring has emptied
+   if (xlt.drops != 0 && xlt.tail == xlt.head) {
+      drops = xlt.drops;
+      xlt.drops = 0;
+      xlprint("xlt_drain() %d records dropped\n", drops);
+   }
+
+   // more behind this batch
+   if (xlt.tail != xlt.head) sched_ready(SCHED_TASK_XLT);
+
+   return i;
+
+} // end xlt_drain()
+
+
+// ===========================================================================
+
+// 7.3
+
+void xlt_ctl(uint8_t flags, pcp_xlt_body_t body) {
+
+/* 7.3.1   Functional Description
+
+   This routine will serve CP_XLT_REQ. CP_XLT_HOST hands the ring to the
+   host, CP_XLT_UART hands it back to xlt_drain(), CP_XLT_FREE releases
+   the records before body->tail. The ring state is returned in body.
+
+   7.3.2   Parameters:
+
+   flags    CP_XLT_GET, CP_XLT_HOST, CP_XLT_UART, CP_XLT_FREE
+   body     Request body, returned as the response body
+
+   7.3.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.3.4   Data Structures
+
+   alt_irq_context context;
+
+// 7.3.5   Code
+
+   if (flags & CP_XLT_HOST) xlt.sink = CP_XLT_SINK_HOST;
+   if (flags & CP_XLT_UART) {
+      xlt.sink = CP_XLT_SINK_UART;
+      sched_ready(SCHED_TASK_XLT);
+   }
+
+   context = PROF_IRQ_DISABLE();
+
+   // the host may only free what has been written
+   if ((flags & CP_XLT_FREE) && body->tail - xlt.tail <= xlt.head - xlt.tail) {
+      xlt.tail = body->tail;
+   }
+
+   body->address = (uint32_t)ring;
+   body->recs    = XLT_RECS;
+   body->head    = xlt.head;
+   body->tail    = xlt.tail;
+   body->drops   = xlt.drops;
+   body->sink    = xlt.sink;
+
+   PROF_IRQ_ENABLE(context);
+
+   body->freq    = alt_timestamp_freq();
+
+} // end xlt_ctl()
+
@@ -0,0 +1,30 @@
+#pragma once
+
+#define  XLT_OK                0x00000000
+
+// Ring Records, power of 2, CP_XLT_ARGS arguments per record
+#define  XLT_RECS              1024
+
+// Records formatted to the UART per scheduler run
+#define  XLT_DRAIN_MAX         4
+
+// Deferred trace, the arguments are taken as uint32_t and the format
+// string is printed later by xlt_drain() or decoded by the host, format
+// strings must be literals and %s arguments must stay valid
+#define  XLTRACE(...)          XLT_ARGS(__VA_ARGS__, 0, 0, 0, 0, 0, 0)
+#define  XLT_ARGS(fmt, a, b, c, d, e, ...) \
+            xltrace(fmt, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), \
+                    (uint32_t)(d), (uint32_t)(e))
+
+// Trace Ring, head and tail are free running record counts
+typedef struct _xlt_t {
+   volatile uint32_t    head;
+   volatile uint32_t    tail;
+   uint32_t             drops;
+   uint32_t             sink;
+} xlt_t, *pxlt_t;
+
+void      xltrace(const char *fmt, uint32_t a, uint32_t b, uint32_t c,
+                  uint32_t d, uint32_t e);
+uint32_t  xlt_drain(uint32_t batch);
+void      xlt_ctl(uint8_t flags, pcp_xlt_body_t body);
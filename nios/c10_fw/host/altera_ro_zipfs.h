@@ -0,0 +1,5 @@
+#pragma once
+
+// Host Build, the read-only ZIP file system is not mounted
+
+typedef struct alt_fd_s alt_fd;
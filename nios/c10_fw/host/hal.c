@@ -0,0 +1,1124 @@
+/*-----------------------------------------------------------------------------
+
+   1  ABSTRACT
+
+   1.1 Module Type
+
+      Host Build HAL
+
+   1.2 Functional Description
+
+      This module stands in for the Nios V HAL when the firmware is built
+      for Linux. The firmware runs unchanged on its own thread, the CPU,
+      with the interrupt controller, system tick, alarms, timestamp and
+      EPCQ flash device of the HAL calls it makes. The register blocks
+      behind the drivers are modelled by model.c.
+
+   1.3 Specification/Design Reference
+
+      See fw_cfg.h under the share directory.
+
+   1.4 Module Test Specification Reference
+
+      None
+
+   1.5 Compilation Information
+
+      See host/CMakeLists.txt, core/main.c is built with main renamed to
+      fw_main().
+
+   1.6 Notes
+
+      An interrupt is HAL_IRQ_SIGNAL sent to the CPU thread, the handler
+      runs the ISRs of the enabled lines whose level is asserted, as the
+      Nios V takes them on its single hart. alt_irq_disable_all() holds
+      the signal off with a flag rather than a mask, a signal taken while
+      disabled is deferred and run from alt_irq_enable_all(). Lines
+      disabled with alt_ic_irq_disable() are checked again when enabled.
+
+      The system tick is a line of its own, HAL_IRQ_TIMER, raised every
+      HAL_TICK_NS by the main thread once the CPU is started. The alarm
+      list is run from its ISR.
+
+      The firmware keeps pointers in uint32_t, so the binary is linked
+      at fixed addresses, malloc() is kept to the heap and the CPU runs on
+      a stack below 4 GB.
+
+   2  CONTENTS
+
+      1 ABSTRACT
+        1.1 Module Type
+        1.2 Functional Description
+        1.3 Specification/Design Reference
+        1.4 Module Test Specification Reference
+        1.5 Compilation Information
+        1.6 Notes
+
+      2 CONTENTS
+
+      3 VOCABULARY
+
+      4 EXTERNAL RESOURCES
+        4.1  Include Files
+        4.2  External Data Structures
+        4.3  External Function Prototypes
+
+      5 LOCAL CONSTANTS AND MACROS
+
+      6 MODULE DATA STRUCTURES
+        6.1  Local Function Prototypes
+        6.2  Local Data Structures
+
+      7 MODULE CODE
+        7.1   main()
+        7.2   hal_cpu()
+        7.3   hal_irq_signal()
+        7.4   hal_irq_entry()
+        7.5   hal_irq_line()
+        7.6   hal_irq_raise()
+        7.7   hal_clock()
+        7.8   hal_tick()
+        7.9   hal_tick_level()
+        7.10  alt_ic_isr_register()
+        7.11  alt_ic_irq_enable()
+        7.12  alt_ic_irq_disable()
+        7.13  alt_irq_disable_all()
+        7.14  alt_irq_enable_all()
+        7.15  alt_alarm_start()
+        7.16  alt_alarm_stop()
+        7.17  alt_ticks_per_second()
+        7.18  alt_nticks()
+        7.19  alt_timestamp_start()
+        7.20  alt_timestamp()
+        7.21  alt_timestamp_freq()
+        7.22  alt_dcache_flush()
+        7.23  alt_flash_open_dev()
+        7.24  alt_flash_close_dev()
+        7.25  alt_get_flash_info()
+
+-----------------------------------------------------------------------------*/
+
+// 3 VOCABULARY
+
+// 4 EXTERNAL RESOURCES
+
+// 4.1  Include Files
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <malloc.h>
+#include <sys/mman.h>
+
+#include "hal.h"
+#include "sys/alt_irq.h"
+#include "sys/alt_alarm.h"
+#include "sys/alt_timestamp.h"
+#include "sys/alt_flash.h"
+
+// 4.2   External Data Structures
+
+// 4.3   External Function Prototypes
+
+// 5 LOCAL CONSTANTS AND MACROS
+
+   // compiler barrier around the interrupt flag
+   #define HAL_BARRIER()   __asm__ __volatile__ ("" ::: "memory")
+
+// 6 MODULE DATA STRUCTURES
+
+// 6.1  Local Function Prototypes
+
+   static   void     *hal_cpu(void *data);
+   static   void      hal_irq_signal(int sig);
+   static   void      hal_irq_entry(void);
+   static   void      hal_tick(void *context);
+   static   uint32_t  hal_tick_level(void);
+
+// 6.2  Local Data Structures
+
+   // EPCQ device, one region of 64 KB sectors
+   struct alt_flash_dev {
+      const char     *name;
+      int             number_of_regions;
+      flash_region    region[1];
+   };
+
+   static   hal_t     hal = {0};
+
+   static   volatile sig_atomic_t   hal_started = 0;
+
+   static   struct alt_flash_dev    hal_flash = {
+      EPCQ_AVL_MEM_NAME, 1, {{0, EPCQ_AVL_MEM_SPAN, EPCQ_AVL_MEM_SPAN / 65536, 65536}}
+   };
+
+
+// 7 MODULE CODE
+
+// ===========================================================================
+
+// 7.1
+
+int main(int argc, char *argv[]) {
+
+/* 7.1.1   Functional Description
+
+   This is the entry point of the host build. The register model is opened
+   on the link socket, the CPU thread is started on its low stack and this
+   thread then becomes the system tick.
+
+   7.1.2   Parameters:
+
+   argc     Argument count
+   argv     -s fd, the link socket inherited from linux/c10_cmd
+
+   7.1.3   Return Values:
+
+   return   Exit status, the process exits from model.c when the link closes
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.1.4   Data Structures
+
+   int                  opt;
+   int                  sock = -1;
+   void                *stack;
+   pthread_attr_t       attr;
+   struct sigaction     sa;
+   struct timespec      ts;
+
+// 7.1.5   Code
+
+   while ((opt = getopt(argc, argv, "s:")) != -1) {
+      switch (opt) {
+         case 's' :
+            sock = atoi(optarg);
+            break;
+         default :
+            fprintf(stderr, "usage: %s [-s fd]\n", argv[0]);
+            return 1;
+      }
+   }
+
+   // the firmware heap stays below 4 GB
+   mallopt(M_MMAP_MAX, 0);
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   hal.t0_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+   // interrupts are taken on the CPU thread
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_handler = hal_irq_signal;
+   sa.sa_flags   = SA_RESTART;
+   sigemptyset(&sa.sa_mask);
+   sigaction(HAL_IRQ_SIGNAL, &sa, NULL);
+
+   // system tick
+   hal.isr[HAL_IRQ_TIMER]   = hal_tick;
+   hal.level[HAL_IRQ_TIMER] = hal_tick_level;
+   hal.enabled |= (1u << HAL_IRQ_TIMER);
+
+   // register blocks and link
+   if (model_open(sock) != HAL_OK) {
+      fprintf(stderr, "hal: model_open() failed\n");
+      return 1;
+   }
+
+   // CPU thread
+   stack = mmap(NULL, HAL_STACK_LEN, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT | MAP_STACK, -1, 0);
+   if (stack == MAP_FAILED) {
+      fprintf(stderr, "hal: stack mmap() failed, %s\n", strerror(errno));
+      return 1;
+   }
+   pthread_attr_init(&attr);
+   pthread_attr_setstack(&attr, stack, HAL_STACK_LEN);
+   if (pthread_create(&hal.cpu, &attr, hal_cpu, NULL)) {
+      fprintf(stderr, "hal: CPU thread failed\n");
+      return 1;
+   }
+   pthread_attr_destroy(&attr);
+   hal_started = 1;
+
+   // system tick, absolute so the rate doesn't drift
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   for (;;) {
+      ts.tv_nsec += HAL_TICK_NS;
+      if (ts.tv_nsec >= 1000000000L) {
+         ts.tv_sec++;
+         ts.tv_nsec -= 1000000000L;
+      }
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+      __atomic_add_fetch(&hal.ticks_due, 1, __ATOMIC_RELEASE);
+      hal_irq_raise();
+   }
+
+   return 0;
+
+} // end main()
+
+
+// ===========================================================================
+
+// 7.2
+
+static void *hal_cpu(void *data) {
+
+/* 7.2.1   Functional Description
+
+   This thread is the Nios V, it runs the firmware main() which never
+   returns.
+
+   7.2.2   Parameters:
+
+   data     Thread parameters, unused
+
+   7.2.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.2.4   Data Structures
+
+// 7.2.5   Code
+
+   fw_main();
+
+   return (void *)0;
+
+} // end hal_cpu()
+
+
+// ===========================================================================
+
+// 7.3
+
+static void hal_irq_signal(int sig) {
+
+/* 7.3.1   Functional Description
+
+   This routine is the interrupt entry on the CPU thread. The interrupt is
+   deferred while alt_irq_disable_all() holds interrupts off.
+
+   7.3.2   Parameters:
+
+   sig      HAL_IRQ_SIGNAL
+
+   7.3.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.3.4   Data Structures
+
+   int      err = errno;
+
+// 7.3.5   Code
+
+   if (hal.irq_off) hal.deferred = 1;
+   else hal_irq_entry();
+
+   errno = err;
+
+} // end hal_irq_signal()
+
+
+// ===========================================================================
+
+// 7.4
+
+static void hal_irq_entry(void) {
+
+/* 7.4.1   Functional Description
+
+   This routine will run the ISRs of the enabled lines until none is
+   asserted, with interrupts held off. A signal that arrives after the
+   last check and before interrupts are back on is picked up here.
+
+   7.4.2   Parameters:
+
+   NONE
+
+   7.4.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.4.4   Data Structures
+
+   uint32_t    i, pend, mask;
+
+// 7.4.5   Code
+
+   for (;;) {
+      hal.irq_off  = 1;
+      hal.deferred = 0;
+      HAL_BARRIER();
+      do {
+         pend = 0;
+         mask = __atomic_load_n(&hal.enabled, __ATOMIC_ACQUIRE);
+         for (i=0;i<HAL_IRQ_LINES;i++) {
+            if ((mask & (1u << i)) && hal.isr[i] != NULL &&
+                 hal.level[i] != NULL && hal.level[i]()) {
+               pend |= (1u << i);
+               hal.isr[i](hal.ctx[i]);
+            }
+         }
+      } while (pend != 0);
+      HAL_BARRIER();
+      hal.irq_off = 0;
+      HAL_BARRIER();
+      if (hal.deferred == 0) break;
+   }
+
+} // end hal_irq_entry()
+
+
+// ===========================================================================
+
+// 7.5
+
+void hal_irq_line(uint32_t irq, hal_level_t level) {
+
+/* 7.5.1   Functional Description
+
+   This routine will attach the level of a modelled interrupt request to
+   its line. Lines without a level are never taken.
+
+   7.5.2   Parameters:
+
+   irq      Interrupt line, *_IRQ of system.h
+   level    Returns non-zero while the request is asserted
+
+   7.5.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.5.4   Data Structures
+
+// 7.5.5   Code
+
+   if (irq < HAL_IRQ_LINES) hal.level[irq] = level;
+
+} // end hal_irq_line()
+
+
+// ===========================================================================
+
+// 7.6
+
+void hal_irq_raise(void) {
+
+/* 7.6.1   Functional Description
+
+   This routine will interrupt the CPU, called by the models after they
+   assert a request. It is safe from any thread and from the CPU itself.
+
+   7.6.2   Parameters:
+
+   NONE
+
+   7.6.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.6.4   Data Structures
+
+// 7.6.5   Code
+
+   if (hal_started) pthread_kill(hal.cpu, HAL_IRQ_SIGNAL);
+
+} // end hal_irq_raise()
+
+
+// ===========================================================================
+
+// 7.7
+
+uint64_t hal_clock(void) {
+
+/* 7.7.1   Functional Description
+
+   This routine will return the FPGA clocks since power-up, counted at
+   ALT_CPU_FREQ.
+
+   7.7.2   Parameters:
+
+   NONE
+
+   7.7.3   Return Values:
+
+   return   Clocks
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.7.4   Data Structures
+
+   struct timespec   ts;
+   uint64_t          ns;
+
+// 7.7.5   Code
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec - hal.t0_ns;
+
+   return (ns * (ALT_CPU_FREQ / 1000000)) / 1000;
+
+} // end hal_clock()
+
+
+// ===========================================================================
+
+// 7.8
+
+static void hal_tick(void *context) {
+
+/* 7.8.1   Functional Description
+
+   This is the system tick ISR. Every tick that is due advances alt_nticks
+   and runs the alarms that have expired, an alarm returning 0 is removed.
+
+   7.8.2   Parameters:
+
+   context  ISR context, unused
+
+   7.8.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.8.4   Data Structures
+
+   alt_alarm  *alarm, **link;
+   alt_u32     next;
+
+// 7.8.5   Code
+
+   while (hal.ticks_done != __atomic_load_n(&hal.ticks_due, __ATOMIC_ACQUIRE)) {
+      hal.ticks_done++;
+      hal.nticks++;
+      link = &hal.alarm;
+      while ((alarm = *link) != NULL) {
+         if (alarm->time <= hal.nticks) {
+            next = alarm->callback(alarm->context);
+            if (next == 0) {
+               *link = alarm->next;
+               continue;
+            }
+            alarm->time = hal.nticks + next;
+         }
+         link = &alarm->next;
+      }
+   }
+
+} // end hal_tick()
+
+
+// ===========================================================================
+
+// 7.9
+
+static uint32_t hal_tick_level(void) {
+
+/* 7.9.1   Functional Description
+
+   This routine will return the system tick request, asserted while ticks
+   are due.
+
+   7.9.2   Parameters:
+
+   NONE
+
+   7.9.3   Return Values:
+
+   return   Non-zero while asserted
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.9.4   Data Structures
+
+// 7.9.5   Code
+
+   return hal.ticks_done != __atomic_load_n(&hal.ticks_due, __ATOMIC_ACQUIRE);
+
+} // end hal_tick_level()
+
+
+// ===========================================================================
+
+// 7.10
+
+int alt_ic_isr_register(alt_u32 ic_id, alt_u32 irq, alt_isr_func isr,
+                        void *isr_context, void *flags) {
+
+/* 7.10.1   Functional Description
+
+   This routine will register the ISR of a line and enable the line, or
+   disable it when the ISR is NULL.
+
+   7.10.2   Parameters:
+
+   ic_id        Interrupt controller, unused
+   irq          Interrupt line
+   isr          ISR
+   isr_context  ISR argument
+   flags        Unused
+
+   7.10.3   Return Values:
+
+   return   0, -EINVAL for a line out of range
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.10.4   Data Structures
+
+   alt_irq_context   context;
+
+// 7.10.5   Code
+
+   if (irq >= HAL_IRQ_LINES || irq == HAL_IRQ_TIMER) return -EINVAL;
+
+   context = alt_irq_disable_all();
+   hal.isr[irq] = isr;
+   hal.ctx[irq] = isr_context;
+   alt_irq_enable_all(context);
+
+   return (isr != NULL) ? alt_ic_irq_enable(ic_id, irq) : alt_ic_irq_disable(ic_id, irq);
+
+} // end alt_ic_isr_register()
+
+
+// ===========================================================================
+
+// 7.11
+
+int alt_ic_irq_enable(alt_u32 ic_id, alt_u32 irq) {
+
+/* 7.11.1   Functional Description
+
+   This routine will enable a line. A request asserted while the line was
+   disabled is taken now, when interrupts are on.
+
+   7.11.2   Parameters:
+
+   ic_id    Interrupt controller, unused
+   irq      Interrupt line
+
+   7.11.3   Return Values:
+
+   return   0, -EINVAL for a line out of range
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.11.4   Data Structures
+
+// 7.11.5   Code
+
+   if (irq >= HAL_IRQ_LINES) return -EINVAL;
+
+   __atomic_or_fetch(&hal.enabled, 1u << irq, __ATOMIC_RELEASE);
+
+   if (hal.irq_off == 0 && (hal.deferred ||
+      (hal.isr[irq] != NULL && hal.level[irq] != NULL && hal.level[irq]()))) {
+      hal_irq_entry();
+   }
+
+   return 0;
+
+} // end alt_ic_irq_enable()
+
+
+// ===========================================================================
+
+// 7.12
+
+int alt_ic_irq_disable(alt_u32 ic_id, alt_u32 irq) {
+
+/* 7.12.1   Functional Description
+
+   This routine will disable a line, its request is held until enabled.
+
+   7.12.2   Parameters:
+
+   ic_id    Interrupt controller, unused
+   irq      Interrupt line
+
+   7.12.3   Return Values:
+
+   return   0, -EINVAL for a line out of range
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.12.4   Data Structures
+
+// 7.12.5   Code
+
+   if (irq >= HAL_IRQ_LINES) return -EINVAL;
+
+   __atomic_and_fetch(&hal.enabled, ~(1u << irq), __ATOMIC_RELEASE);
+
+   return 0;
+
+} // end alt_ic_irq_disable()
+
+
+// ===========================================================================
+
+// 7.13
+
+alt_irq_context alt_irq_disable_all(void) {
+
+/* 7.13.1   Functional Description
+
+   This routine will hold all interrupts off.
+
+   7.13.2   Parameters:
+
+   NONE
+
+   7.13.3   Return Values:
+
+   context  Previous state for alt_irq_enable_all()
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.13.4   Data Structures
+
+   alt_irq_context   context = hal.irq_off;
+
+// 7.13.5   Code
+
+   hal.irq_off = 1;
+   HAL_BARRIER();
+
+   return context;
+
+} // end alt_irq_disable_all()
+
+
+// ===========================================================================
+
+// 7.14
+
+void alt_irq_enable_all(alt_irq_context context) {
+
+/* 7.14.1   Functional Description
+
+   This routine will restore the state saved by alt_irq_disable_all() and
+   take an interrupt deferred in the meantime.
+
+   7.14.2   Parameters:
+
+   context  Saved state
+
+   7.14.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.14.4   Data Structures
+
+// 7.14.5   Code
+
+   HAL_BARRIER();
+   hal.irq_off = context;
+   HAL_BARRIER();
+
+   if (context == 0 && hal.deferred) hal_irq_entry();
+
+} // end alt_irq_enable_all()
+
+
+// ===========================================================================
+
+// 7.15
+
+int alt_alarm_start(alt_alarm *the_alarm, alt_u32 nticks,
+                    alt_u32 (*callback)(void *context), void *context) {
+
+/* 7.15.1   Functional Description
+
+   This routine will start an alarm, the callback runs from the system
+   tick after nticks and its return value sets the next period.
+
+   7.15.2   Parameters:
+
+   the_alarm   Alarm
+   nticks      Ticks to the first callback
+   callback    Callback
+   context     Callback argument
+
+   7.15.3   Return Values:
+
+   return   0, -EINVAL when there is no alarm
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.15.4   Data Structures
+
+   alt_irq_context   irq;
+
+// 7.15.5   Code
+
+   if (the_alarm == NULL || callback == NULL) return -EINVAL;
+
+   irq = alt_irq_disable_all();
+   the_alarm->callback = callback;
+   the_alarm->context  = context;
+   the_alarm->time     = hal.nticks + (nticks ? nticks : 1);
+   the_alarm->next     = hal.alarm;
+   hal.alarm           = the_alarm;
+   alt_irq_enable_all(irq);
+
+   return 0;
+
+} // end alt_alarm_start()
+
+
+// ===========================================================================
+
+// 7.16
+
+void alt_alarm_stop(alt_alarm *the_alarm) {
+
+/* 7.16.1   Functional Description
+
+   This routine will remove an alarm from the list.
+
+   7.16.2   Parameters:
+
+   the_alarm   Alarm
+
+   7.16.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.16.4   Data Structures
+
+   alt_irq_context   irq;
+   alt_alarm       **link;
+
+// 7.16.5   Code
+
+   irq = alt_irq_disable_all();
+   for (link=&hal.alarm;*link!=NULL;link=&(*link)->next) {
+      if (*link == the_alarm) {
+         *link = the_alarm->next;
+         break;
+      }
+   }
+   alt_irq_enable_all(irq);
+
+} // end alt_alarm_stop()
+
+
+// ===========================================================================
+
+// 7.17
+
+alt_u32 alt_ticks_per_second(void) {
+
+/* 7.17.1   Functional Description
+
+   This routine will return the system tick rate.
+
+   7.17.2   Parameters:
+
+   NONE
+
+   7.17.3   Return Values:
+
+   return   HAL_TICKS_PER_SEC
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.17.4   Data Structures
+
+// 7.17.5   Code
+
+   return HAL_TICKS_PER_SEC;
+
+} // end alt_ticks_per_second()
+
+
+// ===========================================================================
+
+// 7.18
+
+alt_u64 alt_nticks(void) {
+
+/* 7.18.1   Functional Description
+
+   This routine will return the system ticks since the CPU started.
+
+   7.18.2   Parameters:
+
+   NONE
+
+   7.18.3   Return Values:
+
+   return   Ticks
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.18.4   Data Structures
+
+// 7.18.5   Code
+
+   return hal.nticks;
+
+} // end alt_nticks()
+
+
+// ===========================================================================
+
+// 7.19
+
+int alt_timestamp_start(void) {
+
+/* 7.19.1   Functional Description
+
+   This routine will start the timestamp counter, it runs from power-up.
+
+   7.19.2   Parameters:
+
+   NONE
+
+   7.19.3   Return Values:
+
+   return   0
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.19.4   Data Structures
+
+// 7.19.5   Code
+
+   return 0;
+
+} // end alt_timestamp_start()
+
+
+// ===========================================================================
+
+// 7.20
+
+alt_timestamp_type alt_timestamp(void) {
+
+/* 7.20.1   Functional Description
+
+   This routine will return the timestamp counter.
+
+   7.20.2   Parameters:
+
+   NONE
+
+   7.20.3   Return Values:
+
+   return   Clocks since power-up
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.20.4   Data Structures
+
+// 7.20.5   Code
+
+   return hal_clock();
+
+} // end alt_timestamp()
+
+
+// ===========================================================================
+
+// 7.21
+
+alt_u32 alt_timestamp_freq(void) {
+
+/* 7.21.1   Functional Description
+
+   This routine will return the timestamp counter rate.
+
+   7.21.2   Parameters:
+
+   NONE
+
+   7.21.3   Return Values:
+
+   return   ALT_CPU_FREQ
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.21.4   Data Structures
+
+// 7.21.5   Code
+
+   return ALT_CPU_FREQ;
+
+} // end alt_timestamp_freq()
+
+
+// ===========================================================================
+
+// 7.22
+
+void alt_dcache_flush(void *start, alt_u32 len) {
+
+/* 7.22.1   Functional Description
+
+   This routine will make prior stores visible to the models, the host
+   caches are coherent so a fence is all that is needed.
+
+   7.22.2   Parameters:
+
+   start    Start address, unused
+   len      Length, unused
+
+   7.22.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.22.4   Data Structures
+
+// 7.22.5   Code
+
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+} // end alt_dcache_flush()
+
+
+// ===========================================================================
+
+// 7.23
+
+alt_flash_fd *alt_flash_open_dev(const char *name) {
+
+/* 7.23.1   Functional Description
+
+   This routine will open the EPCQ flash device, mapped by model.c at
+   EPCQ_AVL_MEM_BASE.
+
+   7.23.2   Parameters:
+
+   name     Device name
+
+   7.23.3   Return Values:
+
+   return   Device, NULL when the name is unknown
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.23.4   Data Structures
+
+// 7.23.5   Code
+
+   if (name == NULL || strcmp(name, hal_flash.name) != 0) return NULL;
+
+   return &hal_flash;
+
+} // end alt_flash_open_dev()
+
+
+// ===========================================================================
+
+// 7.24
+
+void alt_flash_close_dev(alt_flash_fd *fd) {
+
+/* 7.24.1   Functional Description
+
+   This routine will close the flash device.
+
+   7.24.2   Parameters:
+
+   fd       Device
+
+   7.24.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.24.4   Data Structures
+
+// 7.24.5   Code
+
+} // end alt_flash_close_dev()
+
+
+// ===========================================================================
+
+// 7.25
+
+int alt_get_flash_info(alt_flash_fd *fd, flash_region **info, int *number_of_regions) {
+
+/* 7.25.1   Functional Description
+
+   This routine will return the region map of the flash device.
+
+   7.25.2   Parameters:
+
+   fd                  Device
+   info                Region table
+   number_of_regions   Regions in the table
+
+   7.25.3   Return Values:
+
+   return   0, -EINVAL without a device
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.25.4   Data Structures
+
+// 7.25.5   Code
+
+   if (fd == NULL) return -EINVAL;
+
+   *info              = fd->region;
+   *number_of_regions = fd->number_of_regions;
+
+   return 0;
+
+} // end alt_get_flash_info()
+
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "alt_types.h"
+#include "system.h"
+
+// Host Build Interrupt Controller
+#define  HAL_IRQ_LINES         32
+#define  HAL_IRQ_TIMER         31
+#define  HAL_IRQ_SIGNAL        SIGUSR1
+
+// System Tick, NIOSV_INTERNAL_TIMER_TICKS_PER_SECOND
+#define  HAL_TICKS_PER_SEC     NIOSV_INTERNAL_TIMER_TICKS_PER_SECOND
+#define  HAL_TICK_NS           (1000000000L / HAL_TICKS_PER_SEC)
+
+// Firmware stack, below 4 GB as pointers are kept in uint32_t
+#define  HAL_STACK_LEN         (1 << 20)
+
+#define  HAL_OK                0x00000000
+#define  HAL_ERROR             0x80000001
+#define  HAL_ERR_MAP           0x80000002
+#define  HAL_ERR_THREAD        0x80000004
+#define  HAL_ERR_SOCK          0x80000008
+
+// Interrupt Request Level, non-zero while the line is asserted
+typedef uint32_t (*hal_level_t)(void);
+
+// Host Build HAL
+typedef struct _hal_t {
+   pthread_t               cpu;
+   volatile sig_atomic_t   irq_off;
+   volatile sig_atomic_t   deferred;
+   uint32_t                enabled;
+   void                  (*isr[HAL_IRQ_LINES])(void *context);
+   void                   *ctx[HAL_IRQ_LINES];
+   hal_level_t             level[HAL_IRQ_LINES];
+   struct alt_alarm_s     *alarm;
+   uint64_t                nticks;
+   uint32_t                ticks_due;
+   uint32_t                ticks_done;
+   uint64_t                t0_ns;
+} hal_t, *phal_t;
+
+void      hal_irq_line(uint32_t irq, hal_level_t level);
+void      hal_irq_raise(void);
+uint64_t  hal_clock(void);
+uint32_t  model_open(int sock);
+void      model_report(void);
+int       fw_main(void);
@@ -0,0 +1,15 @@
+#pragma once
+
+// Host Build, register access through the modelled register pages
+
+#include "alt_types.h"
+
+#define IORD_32DIRECT(BASE, OFFSET) \
+   (*(volatile alt_u32 *)(uintptr_t)((BASE) + (OFFSET)))
+#define IOWR_32DIRECT(BASE, OFFSET, DATA) \
+   (*(volatile alt_u32 *)(uintptr_t)((BASE) + (OFFSET)) = (DATA))
+
+#define IORD(BASE, REGNUM) \
+   IORD_32DIRECT(BASE, (REGNUM) * 4)
+#define IOWR(BASE, REGNUM, DATA) \
+   IOWR_32DIRECT(BASE, (REGNUM) * 4, (DATA))
@@ -0,0 +1,12 @@
+#pragma once
+
+// Host Build, the BSP linker regions follow the moved SDRAM
+
+#include "system.h"
+#include "../share/linker.h"
+
+#undef   SDRAM_REGION_BASE
+#define  SDRAM_REGION_BASE          SDRAM_BASE
+
+#undef   SDRAM_FIFO_REGION_BASE
+#define  SDRAM_FIFO_REGION_BASE     (SDRAM_BASE + 0x100000)
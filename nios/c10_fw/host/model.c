@@ -0,0 +1,1149 @@
+/*-----------------------------------------------------------------------------
+
+   1  ABSTRACT
+
+   1.1 Module Type
+
+      Host Build Register Model
+
+   1.2 Functional Description
+
+      This module models the FPGA behind the firmware drivers for the host
+      build. The STAMP, GPIO, UART, ADC and OPTO register blocks sit at
+      their system.h addresses, the SDRAM and EPCQ are plain memory, and
+      the OPTO link is a socket to linux/c10_cmd carrying the frames its
+      FIFO driver reads and writes.
+
+   1.3 Specification/Design Reference
+
+      c10_top/ip/opto/opto_ctl.vhd, c10_top/ip/adc/adc_ctl.vhd and
+      c10_top/ip/stamp/stamp_regs.vhd.
+
+   1.4 Module Test Specification Reference
+
+      None
+
+   1.5 Compilation Information
+
+      See host/CMakeLists.txt.
+
+   1.6 Notes
+
+      The register pages are one memfd. The firmware sees each block
+      through a mapping at its fixed address, the models through a second
+      read-write mapping. Blocks whose stores have side effects are mapped
+      read-only, a store faults and mdl_trap() decodes the x86-64 move,
+      writes the value through the model mapping, calls the block's write
+      routine and steps over the instruction. Reads are never trapped, the
+      models keep the status registers current.
+
+      The STAMP, ADC and OPTO slaves have no byteenable, a byte or
+      halfword store writes the whole word with the data repeated across
+      the lanes, as the Nios drives it. Their stores are all trapped, the
+      OPTO buffers included, and the narrow ones are counted and reported
+      by model_report().
+
+      mdl_rx() is the OPTO receiver, a frame from the socket is written to
+      the next receive slot and raises the RX interrupt. mdl_engine() is
+      the transmitter, control frames go first, then the pipe in transfers
+      of up to MDL_PIPE_MSGS packets of OPTO_PIPELEN_UINT8 bytes, reading
+      from ADR_BEG to ADR_END and wrapping as opto_ctl.vhd does. A pipe
+      over the whole ADC FIFO is fed by the ADC model, each packet is
+      written to SDRAM with the adc_ctl.vhd header when the pipe reads it.
+
+      The link is modelled at the frame level the host FIFO driver reads,
+      as linux/c10_cmd/driver/sim.c does, not the FT245 byte timing. The
+      DMA_REQ and ADC head address gating of the pipe are not modelled,
+      the pipe runs as fast as the host takes the stream.
+
+      mdl_report() gives the clocks from a request frame reaching the
+      receive slot to the firmware writing the next TX_HEAD, and the pipe
+      rate, when the link closes.
+
+   2  CONTENTS
+
+      1 ABSTRACT
+        1.1 Module Type
+        1.2 Functional Description
+        1.3 Specification/Design Reference
+        1.4 Module Test Specification Reference
+        1.5 Compilation Information
+        1.6 Notes
+
+      2 CONTENTS
+
+      3 VOCABULARY
+
+      4 EXTERNAL RESOURCES
+        4.1  Include Files
+        4.2  External Data Structures
+        4.3  External Function Prototypes
+
+      5 LOCAL CONSTANTS AND MACROS
+
+      6 MODULE DATA STRUCTURES
+        6.1  Local Function Prototypes
+        6.2  Local Data Structures
+
+      7 MODULE CODE
+        7.1   model_open()
+        7.2   model_report()
+        7.3   mdl_trap()
+        7.4   mdl_decode()
+        7.5   mdl_stamp_wr()
+        7.6   mdl_uart_wr()
+        7.7   mdl_adc_wr()
+        7.8   mdl_opto_wr()
+        7.9   mdl_opto_level()
+        7.10  mdl_adc_level()
+        7.11  mdl_rx()
+        7.12  mdl_engine()
+        7.13  mdl_pipe()
+        7.14  mdl_adc_pkt()
+
+-----------------------------------------------------------------------------*/
+
+// 3 VOCABULARY
+
+// 4 EXTERNAL RESOURCES
+
+// 4.1  Include Files
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "hal.h"
+#include "main.h"
+
+// 4.2   External Data Structures
+
+// 4.3   External Function Prototypes
+
+// 5 LOCAL CONSTANTS AND MACROS
+
+   #define MDL_PAGE           4096
+   #define MDL_PAGE_BASE(a)   ((a) & ~(MDL_PAGE - 1))
+   #define MDL_PAGES          8
+   #define MDL_PIPE_MSGS      8
+   #define MDL_CON_LEN        256
+   #define MDL_OPTO_VERSION   0x0E
+   #define MDL_ADC_VERSION    0x02
+   #define MDL_STAMP_VERSION  0x04
+   #define MDL_STAMP_MAGIC    0x012355AA
+   #define MDL_ADC_MAGIC      0x123455AA
+   #define MDL_GPI_IDLE       0x3F
+
+   // receive slots in use, one is kept free
+   #define MDL_RX_USED(s, c)  (((s).b.rx_head - (c).b.rx_tail) & (OPTO_RX_SLOTS - 1))
+
+// 6 MODULE DATA STRUCTURES
+
+// 6.1  Local Function Prototypes
+
+   static   void      mdl_trap(int sig, siginfo_t *si, void *uc);
+   static   int       mdl_decode(uint8_t *ip, greg_t *gregs, uint64_t *val, uint32_t *size);
+   static   void      mdl_stamp_wr(uint32_t off, uint32_t old, uint32_t val);
+   static   void      mdl_uart_wr(uint32_t off, uint32_t old, uint32_t val);
+   static   void      mdl_adc_wr(uint32_t off, uint32_t old, uint32_t val);
+   static   void      mdl_opto_wr(uint32_t off, uint32_t old, uint32_t val);
+   static   uint32_t  mdl_opto_level(void);
+   static   uint32_t  mdl_adc_level(void);
+   static   void     *mdl_rx(void *data);
+   static   void     *mdl_engine(void *data);
+   static   uint32_t  mdl_pipe(void);
+   static   void      mdl_adc_pkt(pcm_pipe_daq_t pkt);
+
+// 6.2  Local Data Structures
+
+   // Register Block
+   typedef struct _mdl_dev_t {
+      const char   *name;
+      uint32_t      base;
+      uint32_t      page;
+      uint32_t      pages;
+      uint32_t      be;
+      void        (*wr)(uint32_t off, uint32_t old, uint32_t val);
+   } mdl_dev_t, *pmdl_dev_t;
+
+   // Register Model
+   typedef struct _mdl_t {
+      uint8_t           *io;
+      volatile pstamp_regs_t  stamp;
+      volatile pgpio_regs_t   gpx;
+      volatile pgpin_regs_t   gpi;
+      volatile puart_regs_t   uart;
+      volatile padc_regs_t    adc;
+      volatile popto_regs_t   opto;
+      int                sock;
+      pthread_t          rx_tid;
+      pthread_t          eng_tid;
+      pthread_mutex_t    mutex;
+      pthread_cond_t     cv;
+      uint32_t           idle;
+      char               con[MDL_CON_LEN];
+      uint32_t           con_len;
+      uint32_t           pipe_on;
+      uint32_t           pipe_adc;
+      uint32_t           pipe_addr;
+      uint32_t           pipe_cnt;
+      uint8_t            pipe[MDL_PIPE_MSGS * OPTO_PIPELEN_UINT8];
+      uint32_t           adc_run;
+      uint32_t           adc_pkts;
+      uint32_t           adc_seq;
+      uint32_t           adc_stamp;
+      uint16_t           adc_ramp;
+      uint32_t           adc_phase;
+      uint32_t           frames_rx;
+      uint32_t           frames_tx;
+      uint32_t           pkts;
+      uint64_t           rx_clk;
+      uint64_t           lat_n;
+      uint64_t           lat_sum;
+      uint64_t           lat_min;
+      uint64_t           lat_max;
+      uint64_t           pipe_t0;
+      uint64_t           pipe_t1;
+      uint32_t           narrow;
+      uint32_t           narrow_addr;
+   } mdl_t, *pmdl_t;
+
+   static   mdl_t     mdl = {0};
+
+   // register pages, firmware view, stores to blocks with a write
+   // routine or without byteenable are trapped
+   static   mdl_dev_t  mdl_dev[] = {
+      { "stamp",  STAMP_BASE,  0, 1, FALSE, mdl_stamp_wr },
+      { "gpx",    GPX_BASE,    1, 1, TRUE,  NULL         },
+      { "gpi",    GPI_BASE,    2, 1, TRUE,  NULL         },
+      { "uart",   STDOUT_BASE, 3, 1, TRUE,  mdl_uart_wr  },
+      { "adc",    ADC_BASE,    4, 1, FALSE, mdl_adc_wr   },
+      { "opto",   OPTO_BASE,   5, 1, FALSE, mdl_opto_wr  },
+      { "opto_buf", MDL_PAGE_BASE(OPTO_BASE) + MDL_PAGE, 6, 2, FALSE, NULL },
+   };
+
+   // x86-64 general registers in ModRM order
+   static   const int   mdl_greg[16] = {
+      REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+      REG_R8,  REG_R9,  REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15
+   };
+
+
+// 7 MODULE CODE
+
+// ===========================================================================
+
+// 7.1
+
+uint32_t model_open(int sock) {
+
+/* 7.1.1   Functional Description
+
+   This routine will map the memories and register pages at their Nios
+   addresses, power up the registers and start the OPTO threads.
+
+   7.1.2   Parameters:
+
+   sock     Link socket, -1 to run without a host
+
+   7.1.3   Return Values:
+
+   result   HAL_OK
+            HAL_ERR_MAP when an address is taken or can't be mapped
+            HAL_ERR_THREAD when a model thread doesn't start
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.1.4   Data Structures
+
+   int                  fd;
+   uint32_t             i, trap;
+   void                *p;
+   struct sigaction     sa;
+
+// 7.1.5   Code
+
+   memset(&mdl, 0, sizeof(mdl_t));
+   mdl.sock    = sock;
+   mdl.lat_min = UINT64_MAX;
+   pthread_mutex_init(&mdl.mutex, NULL);
+   pthread_cond_init(&mdl.cv, NULL);
+
+   // register pages
+   fd = memfd_create("c10_regs", 0);
+   if (fd < 0 || ftruncate(fd, MDL_PAGES * MDL_PAGE) != 0) return HAL_ERR_MAP;
+
+   mdl.io = mmap(NULL, MDL_PAGES * MDL_PAGE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   if (mdl.io == MAP_FAILED) return HAL_ERR_MAP;
+
+   for (i=0;i<DIM(mdl_dev);i++) {
+      trap = (mdl_dev[i].wr != NULL || !mdl_dev[i].be);
+      p = mmap((void *)(uintptr_t)MDL_PAGE_BASE(mdl_dev[i].base), mdl_dev[i].pages * MDL_PAGE,
+               trap ? PROT_READ : PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_FIXED_NOREPLACE, fd, mdl_dev[i].page * MDL_PAGE);
+      if (p == MAP_FAILED || p != (void *)(uintptr_t)MDL_PAGE_BASE(mdl_dev[i].base)) {
+         fprintf(stderr, "model_open() %s at %08X, %s\n", mdl_dev[i].name,
+                 mdl_dev[i].base, strerror(errno));
+         return HAL_ERR_MAP;
+      }
+   }
+   close(fd);
+
+   // SDRAM and EPCQ
+   p = mmap((void *)SDRAM_BASE, SDRAM_SPAN, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+   if (p != (void *)SDRAM_BASE) return HAL_ERR_MAP;
+   p = mmap((void *)EPCQ_AVL_MEM_BASE, EPCQ_AVL_MEM_SPAN, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+   if (p != (void *)EPCQ_AVL_MEM_BASE) return HAL_ERR_MAP;
+   memset(p, 0xFF, EPCQ_AVL_MEM_SPAN);
+
+   // model view of the registers
+   mdl.stamp = (pstamp_regs_t)(mdl.io + (STAMP_BASE  - MDL_PAGE_BASE(STAMP_BASE)));
+   mdl.gpx   = (pgpio_regs_t)(mdl.io + 1 * MDL_PAGE);
+   mdl.gpi   = (pgpin_regs_t)(mdl.io + 2 * MDL_PAGE);
+   mdl.uart  = (puart_regs_t)(mdl.io + 3 * MDL_PAGE);
+   mdl.adc   = (padc_regs_t)(mdl.io + 4 * MDL_PAGE);
+   mdl.opto  = (popto_regs_t)(mdl.io + 5 * MDL_PAGE + (OPTO_BASE - MDL_PAGE_BASE(OPTO_BASE)));
+
+   // power-up values
+   mdl.stamp->version  = MDL_STAMP_VERSION;
+   mdl.stamp->pid      = FPGA_PID;
+   mdl.stamp->epoch    = FPGA_EPOCH;
+   mdl.stamp->date     = FPGA_DATE_HEX;
+   mdl.stamp->time     = FPGA_TIME_HEX;
+   mdl.stamp->inc      = FPGA_INC;
+   mdl.stamp->magic    = MDL_STAMP_MAGIC;
+   mdl.stamp->fpga_ver = FPGA_VER_HEX;
+   mdl.stamp->map_date = FPGA_MAP_DATE;
+   mdl.gpi->dat        = MDL_GPI_IDLE;
+   mdl.uart->status    = RS232_TRDY;
+   mdl.adc->version    = MDL_ADC_VERSION;
+   mdl.opto->version   = MDL_OPTO_VERSION;
+
+   // register stores
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_sigaction = mdl_trap;
+   sa.sa_flags     = SA_SIGINFO;
+   sigemptyset(&sa.sa_mask);
+   sigaddset(&sa.sa_mask, HAL_IRQ_SIGNAL);
+   sigaction(SIGSEGV, &sa, NULL);
+
+   hal_irq_line(OPTO_IRQ, mdl_opto_level);
+   hal_irq_line(ADC_IRQ, mdl_adc_level);
+
+   if (pthread_create(&mdl.eng_tid, NULL, mdl_engine, NULL)) return HAL_ERR_THREAD;
+   if (sock >= 0 && pthread_create(&mdl.rx_tid, NULL, mdl_rx, NULL)) return HAL_ERR_THREAD;
+
+   return HAL_OK;
+
+} // end model_open()
+
+
+// ===========================================================================
+
+// 7.2
+
+void model_report(void) {
+
+/* 7.2.1   Functional Description
+
+   This routine will report the link counts, the firmware request to
+   response clocks and the pipe rate.
+
+   7.2.2   Parameters:
+
+   NONE
+
+   7.2.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.2.4   Data Structures
+
+   double      secs;
+
+// 7.2.5   Code
+
+   pthread_mutex_lock(&mdl.mutex);
+
+   fprintf(stderr, "model: frames rx %u, tx %u, pipe packets %u\n",
+           mdl.frames_rx, mdl.frames_tx, mdl.pkts);
+   if (mdl.lat_n != 0) {
+      fprintf(stderr, "model: request to response clocks min %llu, mean %llu, max %llu, n %llu\n",
+              (unsigned long long)mdl.lat_min,
+              (unsigned long long)(mdl.lat_sum / mdl.lat_n),
+              (unsigned long long)mdl.lat_max, (unsigned long long)mdl.lat_n);
+   }
+   if (mdl.pipe_t1 > mdl.pipe_t0) {
+      secs = (double)(mdl.pipe_t1 - mdl.pipe_t0) / ALT_CPU_FREQ;
+      fprintf(stderr, "model: pipe %.1f MB/s\n",
+              ((double)mdl.pkts * OPTO_PIPELEN_UINT8) / (secs * 1e6));
+   }
+   if (mdl.narrow != 0) {
+      fprintf(stderr, "model: Warning : %u narrow stores without byteenable, first at %08X\n",
+              mdl.narrow, mdl.narrow_addr);
+   }
+
+   pthread_mutex_unlock(&mdl.mutex);
+
+} // end model_report()
+
+
+// ===========================================================================
+
+// 7.3
+
+static void mdl_trap(int sig, siginfo_t *si, void *uc) {
+
+/* 7.3.1   Functional Description
+
+   This routine will complete a firmware store to a trapped register page
+   and step over the instruction. A byte or halfword store to a block
+   without byteenable writes the whole word, the data repeated across
+   the lanes. A fault anywhere else is left to the default action.
+
+   7.3.2   Parameters:
+
+   sig      SIGSEGV
+   si       Fault information, si_addr is the store address
+   uc       CPU context at the fault
+
+   7.3.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.3.4   Data Structures
+
+   ucontext_t *ctx   = (ucontext_t *)uc;
+   greg_t     *gregs = ctx->uc_mcontext.gregs;
+   uintptr_t   addr  = (uintptr_t)si->si_addr;
+   pmdl_dev_t  dev   = NULL;
+   uint64_t    val;
+   uint32_t    i, size, off, old, idle;
+   int         len;
+   uint8_t    *reg;
+   uint32_t   *word;
+
+// 7.3.5   Code
+
+   for (i=0;i<DIM(mdl_dev);i++) {
+      if ((mdl_dev[i].wr != NULL || !mdl_dev[i].be) &&
+          addr - MDL_PAGE_BASE(mdl_dev[i].base) < mdl_dev[i].pages * MDL_PAGE) {
+         dev = &mdl_dev[i];
+         break;
+      }
+   }
+
+   len = (dev != NULL) ? mdl_decode((uint8_t *)gregs[REG_RIP], gregs, &val, &size) : -1;
+   if (len < 0) {
+      if (dev != NULL) {
+         fprintf(stderr, "mdl_trap() Error : %s store at %08X not decoded\n",
+                 dev->name, (uint32_t)addr);
+      }
+      signal(SIGSEGV, SIG_DFL);
+      return;
+   }
+
+   // register word and its page in the model view
+   off  = (addr - dev->base) & ~3u;
+   reg  = mdl.io + dev->page * MDL_PAGE + (addr - MDL_PAGE_BASE(dev->base));
+   word = (uint32_t *)((uintptr_t)reg & ~(uintptr_t)3);
+
+   pthread_mutex_lock(&mdl.mutex);
+   old = *(volatile uint32_t *)word;
+   if (size < 4 && !dev->be) {
+      // no byteenable, the lanes all carry the data
+      *(volatile uint32_t *)word = (size == 1) ? (uint32_t)(uint8_t)val * 0x01010101u :
+                                                 (uint32_t)(uint16_t)val * 0x00010001u;
+      if (mdl.narrow++ == 0) mdl.narrow_addr = (uint32_t)addr;
+   }
+   else {
+      memcpy(reg, &val, size);
+   }
+   if (dev->wr != NULL) dev->wr(off, old, *(volatile uint32_t *)word);
+   idle = mdl.idle;
+   mdl.idle = 0;
+   pthread_mutex_unlock(&mdl.mutex);
+
+   gregs[REG_RIP] += len;
+
+   // the main loop has gone round, let the models run
+   if (idle) sched_yield();
+
+} // end mdl_trap()
+
+
+// ===========================================================================
+
+// 7.4
+
+static int mdl_decode(uint8_t *ip, greg_t *gregs, uint64_t *val, uint32_t *size) {
+
+/* 7.4.1   Functional Description
+
+   This routine will decode the x86-64 store at ip, the MOV forms 88, 89,
+   C6 and C7 the compiler emits for volatile register writes. Only the
+   instruction length is taken from the addressing bytes, the address is
+   the fault address.
+
+   7.4.2   Parameters:
+
+   ip       Faulting instruction
+   gregs    CPU registers at the fault
+   val      Returns the value stored
+   size     Returns the store width in bytes
+
+   7.4.3   Return Values:
+
+   len      Instruction length, -1 for anything else
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.4.4   Data Structures
+
+   uint8_t    *p = ip;
+   uint8_t     rex = 0, op, modrm, mod, rm, reg;
+   uint32_t    wide = 4;
+
+// 7.4.5   Code
+
+   // operand size and segment prefixes
+   for (;;) {
+      if (*p == 0x66) wide = 2;
+      else if (*p != 0x2E && *p != 0x36 && *p != 0x3E &&
+               *p != 0x26 && *p != 0x64 && *p != 0x65) break;
+      p++;
+   }
+   if ((*p & 0xF0) == 0x40) rex = *p++;
+   if (rex & 0x08) wide = 8;
+
+   op    = *p++;
+   modrm = *p++;
+   mod   = modrm >> 6;
+   rm    = modrm & 7;
+   reg   = ((modrm >> 3) & 7) | ((rex & 0x04) ? 8 : 0);
+
+   if (mod == 3) return -1;
+   if (rm == 4) {
+      // SIB, no base with mod 0 takes a disp32
+      if (mod == 0 && (*p & 7) == 5) p += 4;
+      p++;
+   }
+   else if (mod == 0 && rm == 5) p += 4;
+   if (mod == 1) p += 1;
+   else if (mod == 2) p += 4;
+
+   switch (op) {
+      case 0x88 :
+         *size = 1;
+         // AH, CH, DH and BH without a REX prefix
+         if (rex == 0 && reg >= 4) *val = (gregs[mdl_greg[reg - 4]] >> 8) & 0xFF;
+         else *val = gregs[mdl_greg[reg]] & 0xFF;
+         break;
+      case 0x89 :
+         *size = wide;
+         *val  = gregs[mdl_greg[reg]];
+         break;
+      case 0xC6 :
+         if ((reg & 7) != 0) return -1;
+         *size = 1;
+         *val  = *p++;
+         break;
+      case 0xC7 :
+         if ((reg & 7) != 0) return -1;
+         *size = wide;
+         if (wide == 2) {
+            *val = *(uint16_t *)p;
+            p += 2;
+         }
+         else {
+            // imm32, sign extended for a 64-bit store
+            *val = (uint64_t)(int64_t)*(int32_t *)p;
+            p += 4;
+         }
+         break;
+      default :
+         return -1;
+   }
+
+   return (int)(p - ip);
+
+} // end mdl_decode()
+
+
+// ===========================================================================
+
+// 7.5
+
+static void mdl_stamp_wr(uint32_t off, uint32_t old, uint32_t val) {
+
+/* 7.5.1   Functional Description
+
+   This routine will model a STAMP store. Writing count takes the snapshot
+   of the FPGA clock, writing wd_clear marks a pass of the main loop.
+
+   7.5.2   Parameters:
+
+   off      Register offset
+   old      Register value before the store
+   val      Register value after the store
+
+   7.5.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.5.4   Data Structures
+
+// 7.5.5   Code
+
+   if (off == offsetof(stamp_regs_t, count)) {
+      mdl.stamp->count = (uint32_t)hal_clock();
+   }
+   else if (off == offsetof(stamp_regs_t, wd_clear)) {
+      mdl.idle = TRUE;
+   }
+
+} // end mdl_stamp_wr()
+
+
+// ===========================================================================
+
+// 7.6
+
+static void mdl_uart_wr(uint32_t off, uint32_t old, uint32_t val) {
+
+/* 7.6.1   Functional Description
+
+   This routine will model a UART store, transmitted characters go to
+   standard output a line at a time. The transmitter is always ready.
+
+   7.6.2   Parameters:
+
+   off      Register offset
+   old      Register value before the store
+   val      Register value after the store
+
+   7.6.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.6.4   Data Structures
+
+// 7.6.5   Code
+
+   if (off != offsetof(uart_regs_t, tx_dat)) return;
+
+   mdl.con[mdl.con_len++] = (char)val;
+   if ((char)val == '\n' || mdl.con_len == MDL_CON_LEN) {
+      if (write(STDOUT_FILENO, mdl.con, mdl.con_len) < 0) {}
+      mdl.con_len = 0;
+   }
+
+} // end mdl_uart_wr()
+
+
+// ===========================================================================
+
+// 7.7
+
+static void mdl_adc_wr(uint32_t off, uint32_t old, uint32_t val) {
+
+/* 7.7.1   Functional Description
+
+   This routine will model an ADC store. The interrupt request is write 1
+   to clear, a rising RUN restarts the sequence and the sample clock.
+
+   7.7.2   Parameters:
+
+   off      Register offset
+   old      Register value before the store
+   val      Register value after the store
+
+   7.7.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.7.4   Data Structures
+
+   adc_ctl_reg_t  ctl = {.i = val};
+   adc_ctl_reg_t  was = {.i = old};
+   adc_sta_reg_t  sta;
+
+// 7.7.5   Code
+
+   if (off == offsetof(adc_regs_t, irq)) {
+      mdl.adc->irq = old & ~val;
+   }
+   else if (off == offsetof(adc_regs_t, ctl)) {
+      if (ctl.b.run && !was.b.run) {
+         mdl.adc_run   = TRUE;
+         mdl.adc_pkts  = 0;
+         mdl.adc_seq   = 0;
+         mdl.adc_ramp  = 0;
+         mdl.adc_phase = 0;
+         mdl.adc_stamp = (uint32_t)hal_clock();
+      }
+      else if (!ctl.b.run) {
+         mdl.adc_run   = FALSE;
+      }
+      sta.i = mdl.adc->sta;
+      sta.b.adc_busy = mdl.adc_run;
+      mdl.adc->sta = sta.i;
+      pthread_cond_broadcast(&mdl.cv);
+   }
+
+} // end mdl_adc_wr()
+
+
+// ===========================================================================
+
+// 7.8
+
+static void mdl_opto_wr(uint32_t off, uint32_t old, uint32_t val) {
+
+/* 7.8.1   Functional Description
+
+   This routine will model an OPTO store. The interrupt request is write 1
+   to clear, RX stays asserted while frames wait. Control starts and stops
+   the link on OPTO_RUN, the pipe on the edges of PIPE_RUN, and wakes the
+   threads when TX_HEAD or RX_TAIL move.
+
+   7.8.2   Parameters:
+
+   off      Register offset
+   old      Register value before the store
+   val      Register value after the store
+
+   7.8.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.8.4   Data Structures
+
+   opto_ctl_reg_t ctl = {.i = val};
+   opto_ctl_reg_t was = {.i = old};
+   opto_sta_reg_t sta = {.i = mdl.opto->sta};
+   opto_int_reg_t irq;
+   uint64_t       now, lat;
+
+// 7.8.5   Code
+
+   if (off == offsetof(opto_regs_t, irq)) {
+      irq.i = old & ~val;
+      ctl.i = mdl.opto->ctl;
+      // frames still waiting keep the receive request up
+      if (ctl.b.rx_int && MDL_RX_USED(sta, ctl) != 0) irq.b.rx = 1;
+      mdl.opto->irq = irq.i;
+      return;
+   }
+
+   if (off != offsetof(opto_regs_t, ctl)) return;
+
+   // link reset, the slot pointers follow the firmware's
+   if (ctl.b.opto_run && !was.b.opto_run) {
+      sta.b.rx_head = 0;
+      sta.b.tx_tail = 0;
+      mdl.opto->sta = sta.i;
+   }
+
+   // request to response, the firmware has queued a frame
+   if (ctl.b.tx_head != was.b.tx_head && mdl.rx_clk != 0) {
+      now = hal_clock();
+      lat = now - mdl.rx_clk;
+      mdl.lat_sum += lat;
+      mdl.lat_n++;
+      if (lat < mdl.lat_min) mdl.lat_min = lat;
+      if (lat > mdl.lat_max) mdl.lat_max = lat;
+      mdl.rx_clk = 0;
+   }
+
+   // rising PIPE_RUN latches the transfer
+   if (ctl.b.pipe_run && !was.b.pipe_run) {
+      mdl.pipe_on   = TRUE;
+      mdl.pipe_addr = mdl.opto->addr_beg;
+      mdl.pipe_cnt  = 0;
+      mdl.pipe_adc  = (mdl.opto->addr_beg == ADC_FIFO_BASE &&
+                       mdl.opto->addr_end == ADC_FIFO_BASE + ADC_FIFO_SPAN - 1);
+   }
+   else if (!ctl.b.pipe_run) {
+      mdl.pipe_on   = FALSE;
+   }
+
+   pthread_cond_broadcast(&mdl.cv);
+
+} // end mdl_opto_wr()
+
+
+// ===========================================================================
+
+// 7.9
+
+static uint32_t mdl_opto_level(void) {
+
+/* 7.9.1   Functional Description
+
+   This routine will return the OPTO interrupt request.
+
+   7.9.2   Parameters:
+
+   NONE
+
+   7.9.3   Return Values:
+
+   return   Non-zero while asserted
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.9.4   Data Structures
+
+// 7.9.5   Code
+
+   return mdl.opto->irq != 0;
+
+} // end mdl_opto_level()
+
+
+// ===========================================================================
+
+// 7.10
+
+static uint32_t mdl_adc_level(void) {
+
+/* 7.10.1   Functional Description
+
+   This routine will return the ADC interrupt request.
+
+   7.10.2   Parameters:
+
+   NONE
+
+   7.10.3   Return Values:
+
+   return   Non-zero while asserted
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.10.4   Data Structures
+
+// 7.10.5   Code
+
+   return mdl.adc->irq != 0;
+
+} // end mdl_adc_level()
+
+
+// ===========================================================================
+
+// 7.11
+
+static void *mdl_rx(void *data) {
+
+/* 7.11.1   Functional Description
+
+   This thread is the OPTO receiver. Each frame from the host is written
+   to the next free receive slot once the firmware has cleared the buffers
+   and enabled RX_INT, RX_HEAD advanced and the RX interrupt raised. The
+   process ends with the link.
+
+   7.11.2   Parameters:
+
+   data     Thread parameters, unused
+
+   7.11.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.11.4   Data Structures
+
+   uint8_t           frame[OPTO_MSGLEN_UINT8];
+   ssize_t           len;
+   opto_ctl_reg_t    ctl;
+   opto_sta_reg_t    sta;
+   opto_int_reg_t    irq;
+
+// 7.11.5   Code
+
+   for (;;) {
+      len = recv(mdl.sock, frame, OPTO_MSGLEN_UINT8, MSG_WAITALL);
+      if (len != OPTO_MSGLEN_UINT8) break;
+
+      pthread_mutex_lock(&mdl.mutex);
+      for (;;) {
+         ctl.i = mdl.opto->ctl;
+         sta.i = mdl.opto->sta;
+         if (ctl.b.opto_run && ctl.b.rx_int &&
+             MDL_RX_USED(sta, ctl) < OPTO_RX_SLOTS - 1) break;
+         pthread_cond_wait(&mdl.cv, &mdl.mutex);
+      }
+      memcpy((void *)&mdl.opto->rx_buf[sta.b.rx_head * OPTO_MSGLEN_UINT32], frame, OPTO_MSGLEN_UINT8);
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+      sta.b.rx_head = (sta.b.rx_head + 1) & (OPTO_RX_SLOTS - 1);
+      mdl.opto->sta = sta.i;
+      mdl.frames_rx++;
+      if (mdl.rx_clk == 0) mdl.rx_clk = hal_clock();
+      irq.i = mdl.opto->irq;
+      irq.b.rx = 1;
+      mdl.opto->irq = irq.i;
+      pthread_mutex_unlock(&mdl.mutex);
+
+      hal_irq_raise();
+   }
+
+   model_report();
+   exit(0);
+
+   return (void *)0;
+
+} // end mdl_rx()
+
+
+// ===========================================================================
+
+// 7.12
+
+static void *mdl_engine(void *data) {
+
+/* 7.12.1   Functional Description
+
+   This thread is the OPTO transmitter. Frames queued by the firmware go
+   out first, each completion advancing TX_TAIL with the TX interrupt,
+   then the pipe is advanced one transfer at a time.
+
+   7.12.2   Parameters:
+
+   data     Thread parameters, unused
+
+   7.12.3   Return Values:
+
+   return   Thread exit status
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.12.4   Data Structures
+
+   uint8_t           frame[OPTO_MSGLEN_UINT8];
+   opto_ctl_reg_t    ctl;
+   opto_sta_reg_t    sta;
+   opto_int_reg_t    irq;
+   uint32_t          raise, pkts;
+
+// 7.12.5   Code
+
+   pthread_mutex_lock(&mdl.mutex);
+
+   for (;;) {
+      ctl.i = mdl.opto->ctl;
+      sta.i = mdl.opto->sta;
+      raise = FALSE;
+
+      //
+      // CONTROL FRAME
+      //
+      if (ctl.b.opto_run && sta.b.tx_tail != ctl.b.tx_head) {
+         memcpy(frame, (void *)&mdl.opto->tx_buf[sta.b.tx_tail * OPTO_MSGLEN_UINT32], OPTO_MSGLEN_UINT8);
+         pthread_mutex_unlock(&mdl.mutex);
+         if (mdl.sock >= 0) send(mdl.sock, frame, OPTO_MSGLEN_UINT8, MSG_NOSIGNAL);
+         pthread_mutex_lock(&mdl.mutex);
+         sta.i = mdl.opto->sta;
+         sta.b.tx_tail = (sta.b.tx_tail + 1) & (OPTO_TX_SLOTS - 1);
+         mdl.opto->sta = sta.i;
+         mdl.frames_tx++;
+         ctl.i = mdl.opto->ctl;
+         if (ctl.b.tx_int) {
+            irq.i = mdl.opto->irq;
+            irq.b.tx = 1;
+            mdl.opto->irq = irq.i;
+            raise = TRUE;
+         }
+      }
+      //
+      // PIPE TRANSFER
+      //
+      else if (mdl.pipe_on && (pkts = mdl_pipe()) != 0) {
+         pthread_mutex_unlock(&mdl.mutex);
+         if (mdl.sock >= 0) send(mdl.sock, mdl.pipe, pkts * OPTO_PIPELEN_UINT8, MSG_NOSIGNAL);
+         pthread_mutex_lock(&mdl.mutex);
+         if (mdl.pkts == 0) mdl.pipe_t0 = hal_clock();
+         mdl.pkts   += pkts;
+         mdl.pipe_t1 = hal_clock();
+         // the last packet of the count ends the transfer
+         if (mdl.pipe_on && mdl.opto->pktcnt != 0 && mdl.pipe_cnt >= mdl.opto->pktcnt) {
+            mdl.pipe_on = FALSE;
+            ctl.i = mdl.opto->ctl;
+            if (ctl.b.pipe_int) {
+               irq.i = mdl.opto->irq;
+               irq.b.pipe = 1;
+               mdl.opto->irq = irq.i;
+               raise = TRUE;
+            }
+         }
+      }
+      else {
+         pthread_cond_wait(&mdl.cv, &mdl.mutex);
+      }
+
+      if (raise) {
+         pthread_mutex_unlock(&mdl.mutex);
+         hal_irq_raise();
+         pthread_mutex_lock(&mdl.mutex);
+      }
+   }
+
+   return (void *)0;
+
+} // end mdl_engine()
+
+
+// ===========================================================================
+
+// 7.13
+
+static uint32_t mdl_pipe(void) {
+
+/* 7.13.1   Functional Description
+
+   This routine will read the next pipe transfer into mdl.pipe, up to
+   MDL_PIPE_MSGS packets and no further than the packet count. A pipe over
+   the ADC FIFO waits for the ADC to run and takes its packets.
+
+   7.13.2   Parameters:
+
+   NONE
+
+   7.13.3   Return Values:
+
+   pkts     Packets read, 0 when the pipe must wait
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.13.4   Data Structures
+
+   uint32_t    pkts = 0;
+   uint32_t    pktcnt = mdl.opto->pktcnt;
+   uint8_t    *src;
+   adc_int_reg_t  irq;
+   adc_ctl_reg_t  ctl;
+
+// 7.13.5   Code
+
+   while (pkts < MDL_PIPE_MSGS && (pktcnt == 0 || mdl.pipe_cnt < pktcnt)) {
+      src = (uint8_t *)(uintptr_t)mdl.pipe_addr;
+      if (mdl.pipe_adc) {
+         if (!mdl.adc_run) break;
+         mdl_adc_pkt((pcm_pipe_daq_t)src);
+         // ADC packet count reached
+         if (mdl.adc->pkt_cnt != 0 && ++mdl.adc_pkts >= mdl.adc->pkt_cnt) {
+            mdl.adc_run = FALSE;
+            ctl.i = mdl.adc->ctl;
+            if (ctl.b.done_int) {
+               irq.i = mdl.adc->irq;
+               irq.b.done = 1;
+               mdl.adc->irq = irq.i;
+               hal_irq_raise();
+            }
+         }
+      }
+      memcpy(mdl.pipe + pkts * OPTO_PIPELEN_UINT8, src, OPTO_PIPELEN_UINT8);
+      pkts++;
+      mdl.pipe_cnt++;
+      mdl.pipe_addr += OPTO_PIPELEN_UINT8;
+      if (mdl.pipe_addr >= mdl.opto->addr_end) mdl.pipe_addr = mdl.opto->addr_beg;
+   }
+
+   return pkts;
+
+} // end mdl_pipe()
+
+
+// ===========================================================================
+
+// 7.14
+
+static void mdl_adc_pkt(pcm_pipe_daq_t pkt) {
+
+/* 7.14.1   Functional Description
+
+   This routine will write one ADC packet, the header of adc_ctl.vhd and
+   DAQ_MAX_SAM rows of DAQ_MAX_CH samples. RAMP gives the 16-bit running
+   count, otherwise each channel is a 12-bit sawtooth at its own rate.
+
+   7.14.2   Parameters:
+
+   pkt      Packet in SDRAM
+
+   7.14.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.14.4   Data Structures
+
+   uint32_t       j, m;
+   uint16_t      *sam = pkt->samples;
+   adc_ctl_reg_t  ctl = {.i = mdl.adc->ctl};
+
+// 7.14.5   Code
+
+   pkt->dst_cmid  = CM_ID_PIPE;
+   pkt->msgid     = CM_PIPE_DAQ_DATA;
+   pkt->port      = 0;
+   pkt->flags     = 0;
+   pkt->msglen    = sizeof(cm_pipe_daq_t) >> 2;
+   pkt->seqid     = mdl.adc_seq++;
+   pkt->stamp     = (mdl.adc_stamp += mdl.adc->adc_rate * DAQ_MAX_SAM);
+   pkt->stamp_us  = 0;
+   pkt->status    = 0;
+   pkt->rate      = 0;
+   pkt->magic     = MDL_ADC_MAGIC;
+
+   if (ctl.b.ramp) {
+      for (j=0;j<DAQ_MAX_LEN;j++) *sam++ = mdl.adc_ramp++;
+      return;
+   }
+
+   for (j=0;j<DAQ_MAX_SAM;j++,mdl.adc_phase++) {
+      for (m=0;m<DAQ_MAX_CH;m++) {
+         *sam++ = (uint16_t)((mdl.adc_phase * (m + 1) * 8) & 0x0FFF);
+      }
+   }
+
+} // end mdl_adc_pkt()
+
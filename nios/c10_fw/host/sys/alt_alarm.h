@@ -0,0 +1,18 @@
+#pragma once
+
+// Host Build, alarms run from the system tick of hal.c
+
+#include "alt_types.h"
+
+typedef struct alt_alarm_s {
+   struct alt_alarm_s  *next;
+   alt_u64              time;
+   alt_u32            (*callback)(void *context);
+   void                *context;
+} alt_alarm;
+
+int      alt_alarm_start(alt_alarm *the_alarm, alt_u32 nticks,
+                         alt_u32 (*callback)(void *context), void *context);
+void     alt_alarm_stop(alt_alarm *the_alarm);
+alt_u32  alt_ticks_per_second(void);
+alt_u64  alt_nticks(void);
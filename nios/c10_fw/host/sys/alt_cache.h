@@ -0,0 +1,7 @@
+#pragma once
+
+// Host Build, the host caches are coherent
+
+#include "alt_types.h"
+
+void  alt_dcache_flush(void *start, alt_u32 len);
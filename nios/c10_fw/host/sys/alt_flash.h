@@ -0,0 +1,22 @@
+#pragma once
+
+// Host Build, the EPCQ is a block of host memory at EPCQ_AVL_MEM_BASE
+
+#include "alt_types.h"
+#include "sys/alt_cache.h"
+
+#define  ALT_MAX_NUMBER_OF_FLASH_REGIONS   8
+
+typedef struct flash_region {
+   int   offset;
+   int   region_size;
+   int   number_of_blocks;
+   int   block_size;
+} flash_region;
+
+typedef struct alt_flash_dev alt_flash_fd;
+
+alt_flash_fd  *alt_flash_open_dev(const char *name);
+void           alt_flash_close_dev(alt_flash_fd *fd);
+int            alt_get_flash_info(alt_flash_fd *fd, flash_region **info,
+                                  int *number_of_regions);
@@ -0,0 +1,18 @@
+#pragma once
+
+// Host Build, interrupt controller of hal.c, interrupts are taken on
+// the firmware thread as in the single Nios V hart
+
+#include "alt_types.h"
+#include "system.h"
+
+typedef int alt_irq_context;
+
+typedef void (*alt_isr_func)(void *isr_context);
+
+int              alt_ic_isr_register(alt_u32 ic_id, alt_u32 irq, alt_isr_func isr,
+                                     void *isr_context, void *flags);
+int              alt_ic_irq_enable(alt_u32 ic_id, alt_u32 irq);
+int              alt_ic_irq_disable(alt_u32 ic_id, alt_u32 irq);
+alt_irq_context  alt_irq_disable_all(void);
+void             alt_irq_enable_all(alt_irq_context context);
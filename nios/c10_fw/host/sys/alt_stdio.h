@@ -0,0 +1,5 @@
+#pragma once
+
+// Host Build, console output goes through xlprint and the UART model
+
+#include <stdarg.h>
@@ -0,0 +1,11 @@
+#pragma once
+
+// Host Build, timestamp counts at ALT_CPU_FREQ from power-up
+
+#include "alt_types.h"
+
+#define  alt_timestamp_type   alt_u64
+
+int                  alt_timestamp_start(void);
+alt_timestamp_type   alt_timestamp(void);
+alt_u32              alt_timestamp_freq(void);
@@ -0,0 +1,14 @@
+#pragma once
+
+// Host Build, the BSP system.h with the SDRAM moved onto the pages
+// mapped by model.c. The register blocks keep their Nios addresses,
+// except the OPTO which is moved up half a page so its control
+// registers sit alone on a page that traps stores.
+
+#include "../share/system.h"
+
+#undef   OPTO_BASE
+#define  OPTO_BASE                  0x10070800
+
+#undef   SDRAM_BASE
+#define  SDRAM_BASE                 0x08000000
@@ -259,6 +259,7 @@ typedef struct _cm_pipe_fixed_t {
 // Pipe Message IDs
 #define CM_PIPE_NULL          0x00
 #define CM_PIPE_DAQ_DATA      0x15
+#define CM_PIPE_STREAM_DATA   0x16
 
 // Pipe Message Flags
 #define CM_PIPE_KEEP          0x00
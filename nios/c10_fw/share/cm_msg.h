@@ -105,3 +105,16 @@ typedef struct _cm_query_msg_t {
    msg_parms_t      p;
    cm_query_body_t  b;
 } cm_query_msg_t, * pcm_query_msg_t;
+
+// TIMER EVENT MESSAGE BODY, handle and user tag of the expired timer
+typedef struct _cm_timer_body_t {
+   uint32_t    handle;
+   uint32_t    user;
+} cm_timer_body_t, *pcm_timer_body_t;
+
+// TIMER EVENT MESSAGE COMPLETE
+typedef struct _cm_timer_msg_t {
+   cm_hdr_t         h;
+   msg_parms_t      p;
+   cm_timer_body_t  b;
+} cm_timer_msg_t, *pcm_timer_msg_t;
@@ -20,6 +20,7 @@ enum CP_ERR {
       CP_ERR_MSG_COUNT,
       CP_ERR_FILE_CHECKSUM,
       CP_ERR_FILE_ERROR,
+      CP_ERR_BUSY,
 };
 
 // CP Error String Table
@@ -52,6 +53,12 @@ typedef struct _cp_error_table_t {
 #define CP_STREAM_RESP     0x12
 #define CP_PING_REQ        0x13
 #define CP_PING_RESP       0x14
+#define CP_XLT_REQ         0x15
+#define CP_XLT_RESP        0x16
+#define CP_SCHED_REQ       0x17
+#define CP_SCHED_RESP      0x18
+#define CP_PROF_REQ        0x19
+#define CP_PROF_RESP       0x1A
 #define CP_ERROR_REQ       0x3E
 #define CP_ERROR_RESP      0x3F
 #define CP_INT_IND         0x40
@@ -72,17 +79,67 @@ typedef struct _cp_error_table_t {
 #define CP_RESET_CFG       0x04
 #define CP_XL345_RUN       0x10
 #define CP_XL345_STOP      0x20
+#define CP_XLT_GET         0x01
+#define CP_XLT_HOST        0x02
+#define CP_XLT_UART        0x04
+#define CP_XLT_FREE        0x08
+#define CP_SCHED_GET       0x01
+#define CP_SCHED_CLR       0x02
+#define CP_PROF_GET        0x01
+#define CP_PROF_CLR        0x02
 
 // CP INTERRUPT INDICATIONS
 #define CP_IND_XL345       0x01
 #define CP_IND_PING        0x02
+#define CP_IND_PIPE        0x04
 
-#define CP_BLOCK_MAX       256
+// block data fills the 512-byte frame after the 28-byte block header
+#define CP_BLOCK_MAX       480
 #define CP_XL345_LEN       6
 #define CP_XL345_MARK      25
 #define CP_XL345_RATE      0x0F
 #define CP_XL345_SENSE     0x03
 
+// memory stream packets carry CP_STREAM_DATA bytes after the 32-byte pipe
+// header, CP_STREAM_XFER packets to a pipe transfer and the stream is padded
+// to CP_STREAM_ALIGN packets, one host pipe block
+#define CP_STREAM_DATA     992
+#define CP_STREAM_XFER     8
+#define CP_STREAM_ALIGN    32
+#define CP_STREAM_MAGIC    0x5354524D
+
+// trace ring records, a format string address in the firmware image, the
+// alt_timestamp() of the record, its sequence and up to CP_XLT_ARGS
+// arguments
+#define CP_XLT_ARGS        5
+#define CP_XLT_SINK_UART   0
+#define CP_XLT_SINK_HOST   1
+
+// background scheduler tasks in priority order, cycles are alt_timestamp()
+// counts kept as 64-bit hi:lo pairs
+#define CP_SCHED_TASKS     5
+#define CP_SCHED_CM        0
+#define CP_SCHED_DAQ       1
+#define CP_SCHED_CP        2
+#define CP_SCHED_CLI       3
+#define CP_SCHED_XLT       4
+
+// cycle profile points, stamp_count() cycles in log2 bins, bin 0 holds
+// 0 cycles, bin n holds 2^(n-1) to 2^n - 1 and the last bin the rest.
+// CP_PROF_IRQ_OFF is every outermost interrupts disabled window, ISRs
+// included
+#define CP_PROF_POINTS     9
+#define CP_PROF_BINS       20
+#define CP_PROF_OPTO_ISR   0
+#define CP_PROF_ADC_ISR    1
+#define CP_PROF_GPIO_ISR   2
+#define CP_PROF_UART_ISR   3
+#define CP_PROF_TICK_ISR   4
+#define CP_PROF_CM_ALLOC   5
+#define CP_PROF_DAQ_MSG    6
+#define CP_PROF_CP_MSG     7
+#define CP_PROF_IRQ_OFF    8
+
 // ===========================================================================
 //
 // CH SERVER MESSAGE DATA DEFINITIONS
@@ -150,6 +207,114 @@ typedef struct {
    cp_block_body_t  b;
 } cp_block_msg_t, *pcp_block_msg_t;
 
+// MEMORY STREAM REQ/RESP MESSAGE BODY
+typedef struct {
+   uint32_t    tag;
+   uint32_t    address;
+   uint32_t    length;
+   uint32_t    packets;
+} cp_stream_body_t, *pcp_stream_body_t;
+
+// MEMORY STREAM REQ/RESP MESSAGE COMPLETE
+typedef struct {
+   cm_hdr_t          h;
+   msg_parms_t       p;
+   cp_stream_body_t  b;
+} cp_stream_msg_t, *pcp_stream_msg_t;
+
+// MEMORY STREAM PIPE MESSAGE, CM_PIPE_STREAM_DATA
+typedef struct {
+   uint8_t     dst_cmid;       // Destination CM ID
+   uint8_t     msgid;          // Pipe Message ID, CM_PIPE_STREAM_DATA
+   uint8_t     port;           // Destination Port
+   uint8_t     flags;          // Message Flags
+   uint32_t    msglen;         // Message Length in 32-Bit words
+   uint32_t    seqid;          // Packet Number
+   uint32_t    offset;         // Byte Offset in the Region
+   uint32_t    stamp_us;       // 32-Bit Time Stamp in microseconds
+   uint32_t    tag;            // Stream Tag from the Request
+   uint32_t    length;         // Data Bytes, 0 for padding
+   uint32_t    magic;          // CP_STREAM_MAGIC
+   uint8_t     data[CP_STREAM_DATA];
+} cp_stream_pipe_t, *pcp_stream_pipe_t;
+
+// TRACE RING RECORD
+typedef struct {
+   uint32_t    fmt;            // Format String Address
+   uint32_t    stamp;          // alt_timestamp()
+   uint32_t    seqid;          // Record Number
+   uint32_t    arg[CP_XLT_ARGS];
+} cp_xlt_rec_t, *pcp_xlt_rec_t;
+
+// TRACE RING REQ/RESP MESSAGE BODY
+typedef struct {
+   uint32_t    tag;            // Request Tag, echoed
+   uint32_t    address;        // Ring Address
+   uint32_t    recs;           // Ring Records, power of 2
+   uint32_t    head;           // Records Written
+   uint32_t    tail;           // Records Consumed, CP_XLT_FREE sets
+   uint32_t    drops;          // Records Dropped, ring full
+   uint32_t    sink;           // CP_XLT_SINK_UART or CP_XLT_SINK_HOST
+   uint32_t    freq;           // alt_timestamp_freq()
+} cp_xlt_body_t, *pcp_xlt_body_t;
+
+// TRACE RING REQ/RESP MESSAGE COMPLETE
+typedef struct {
+   cm_hdr_t         h;
+   msg_parms_t      p;
+   cp_xlt_body_t    b;
+} cp_xlt_msg_t, *pcp_xlt_msg_t;
+
+// SCHEDULER TASK ACCOUNTING
+typedef struct {
+   uint32_t    cycles_hi;      // Cycles in Runs that did Work
+   uint32_t    cycles_lo;
+   uint32_t    runs;           // Runs that did Work
+   uint32_t    msgs;           // Messages or Items Handled
+   uint32_t    max;            // Longest Run, cycles
+   uint32_t    ready;          // Times made Ready
+} cp_sched_task_t, *pcp_sched_task_t;
+
+// SCHEDULER REQUEST/RESPONSE MESSAGE BODY
+typedef struct {
+   uint32_t          tag;            // Request Tag, echoed
+   uint32_t          freq;           // alt_timestamp_freq()
+   uint32_t          elapsed_hi;     // Cycles since Cleared
+   uint32_t          elapsed_lo;
+   uint32_t          idle_hi;        // Cycles in Runs that found no Work
+   uint32_t          idle_lo;
+   uint32_t          passes;         // Scheduler Passes
+   cp_sched_task_t   task[CP_SCHED_TASKS];
+} cp_sched_body_t, *pcp_sched_body_t;
+
+// SCHEDULER REQUEST/RESPONSE MESSAGE COMPLETE
+typedef struct {
+   cm_hdr_t          h;
+   msg_parms_t       p;
+   cp_sched_body_t   b;
+} cp_sched_msg_t, *pcp_sched_msg_t;
+
+// CYCLE PROFILE REQUEST/RESPONSE MESSAGE BODY, ONE POINT
+typedef struct {
+   uint32_t    tag;            // Request Tag, echoed
+   uint32_t    point;          // CP_PROF_*
+   uint32_t    points;         // CP_PROF_POINTS
+   uint32_t    freq;           // Cycles per Second
+   uint32_t    count;          // Samples
+   uint32_t    min;            // Cycles
+   uint32_t    max;
+   uint32_t    sum_hi;         // Cycles, 64-bit
+   uint32_t    sum_lo;
+   uint32_t    hist[CP_PROF_BINS];
+} cp_prof_body_t, *pcp_prof_body_t;
+
+// CYCLE PROFILE REQUEST/RESPONSE MESSAGE COMPLETE
+typedef struct {
+   cm_hdr_t         h;
+   msg_parms_t      p;
+   cp_prof_body_t   b;
+} cp_prof_msg_t, *pcp_prof_msg_t;
+
 // PING REQ/RESP MESSAGE COMPLETE
 typedef struct {
    cm_hdr_t         h;
@@ -19,6 +19,7 @@ enum DAQ_ERR {
       DAQ_ERR_MSG_COUNT,
       DAQ_ERR_FILE_CHECKSUM,
       DAQ_ERR_FILE_ERROR,
+      DAQ_ERR_BUSY,
 };
 
 // Error String Table
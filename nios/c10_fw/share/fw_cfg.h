@@ -55,6 +55,13 @@
 //    in units of alt_nticks.
 #define  CFG_TIMER_CYCLE         1
 
+// CYCLE PROFILING
+//    This value is used to build the ISR, message handler and interrupts
+//    disabled window profiling of prof.c, 0 compiles it out.
+#ifndef CFG_PROF
+#define  CFG_PROF                1
+#endif
+
 // ACTIVITY INDICATOR CYCLING
 //    This value is used to determine the activity indicator
 //    rate of flashing, based on the CFG_TIMER_CYCLE.
@@ -224,6 +231,7 @@
 #define CFG_STATUS_CONNECTED     0x00000004
 #define CFG_STATUS_DAQ_RUN       0x00000008
 #define CFG_STATUS_XL345_RUN     0x00000010
+#define CFG_STATUS_CP_STREAM     0x00000020
 #define CFG_STATUS_DEV_ID        0x00000F00
 #define CFG_STATUS_FTDI_CLOCK    0x00001000
 
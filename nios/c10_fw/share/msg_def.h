@@ -0,0 +1,127 @@
+#pragma once
+
+//
+// WARNING: THIS FILE IS SHARED BETWEEN MULTIPLE APPLICATIONS, ANY CHANGES
+// SHOULD BE UPDATED ACROSS PLATFORMS IN ORDER TO MAINTAIN CM COMPATIBILITY!
+//
+
+//
+// CM MESSAGE SCHEMA
+//
+// One row per srvid:msgid, the single source for the message name table
+// and the direct dispatch index built in msg_str.h. S() rows are common
+// to the host and firmware, H() rows exist only on the host.
+//
+#define MSG_SCHEMA(S, H) \
+   \
+   /* CMID                  MSG ID                  CMID STR          MSGID STR          */ \
+   /* ============          ============            ============      ============       */ \
+   \
+   S( CM_ID_CP_SRV,         CP_NULL_MSG,            "CP_SRV",         "NULL_MSG"            ) \
+   S( CM_ID_CP_SRV,         CP_VER_REQ,             "CP_SRV",         "VER_REQ"             ) \
+   S( CM_ID_CP_SRV,         CP_VER_RESP,            "CP_SRV",         "VER_RESP"            ) \
+   S( CM_ID_CP_SRV,         CP_MEM_REQ,             "CP_SRV",         "MEM_REQ"             ) \
+   S( CM_ID_CP_SRV,         CP_MEM_RESP,            "CP_SRV",         "MEM_RESP"            ) \
+   S( CM_ID_CP_SRV,         CP_TRACE_REQ,           "CP_SRV",         "TRACE_REQ"           ) \
+   S( CM_ID_CP_SRV,         CP_TRACE_RESP,          "CP_SRV",         "TRACE_RESP"          ) \
+   S( CM_ID_CP_SRV,         CP_RESET_REQ,           "CP_SRV",         "RESET_REQ"           ) \
+   S( CM_ID_CP_SRV,         CP_RESET_RESP,          "CP_SRV",         "RESET_RESP"          ) \
+   S( CM_ID_CP_SRV,         CP_BLOCK_REQ,           "CP_SRV",         "BLOCK_REQ"           ) \
+   S( CM_ID_CP_SRV,         CP_BLOCK_RESP,          "CP_SRV",         "BLOCK_RESP"          ) \
+   S( CM_ID_CP_SRV,         CP_XL345_REQ,           "CP_SRV",         "XL345_REQ"           ) \
+   S( CM_ID_CP_SRV,         CP_XL345_RESP,          "CP_SRV",         "XL345_RESP"          ) \
+   S( CM_ID_CP_SRV,         CP_EEPROM_REQ,          "CP_SRV",         "EEPROM_REQ"          ) \
+   S( CM_ID_CP_SRV,         CP_EEPROM_RESP,         "CP_SRV",         "EEPROM_RESP"         ) \
+   S( CM_ID_CP_SRV,         CP_RPC_REQ,             "CP_SRV",         "RPC_REQ"             ) \
+   S( CM_ID_CP_SRV,         CP_RPC_RESP,            "CP_SRV",         "RPC_RESP"            ) \
+   S( CM_ID_CP_SRV,         CP_STREAM_REQ,          "CP_SRV",         "STREAM_REQ"          ) \
+   S( CM_ID_CP_SRV,         CP_STREAM_RESP,         "CP_SRV",         "STREAM_RESP"         ) \
+   S( CM_ID_CP_SRV,         CP_PING_REQ,            "CP_SRV",         "PING_REQ"            ) \
+   S( CM_ID_CP_SRV,         CP_PING_RESP,           "CP_SRV",         "PING_RESP"           ) \
+   S( CM_ID_CP_SRV,         CP_XLT_REQ,             "CP_SRV",         "XLT_REQ"             ) \
+   S( CM_ID_CP_SRV,         CP_XLT_RESP,            "CP_SRV",         "XLT_RESP"            ) \
+   S( CM_ID_CP_SRV,         CP_SCHED_REQ,           "CP_SRV",         "SCHED_REQ"           ) \
+   S( CM_ID_CP_SRV,         CP_SCHED_RESP,          "CP_SRV",         "SCHED_RESP"          ) \
+   S( CM_ID_CP_SRV,         CP_PROF_REQ,            "CP_SRV",         "PROF_REQ"            ) \
+   S( CM_ID_CP_SRV,         CP_PROF_RESP,           "CP_SRV",         "PROF_RESP"           ) \
+   S( CM_ID_CP_SRV,         CP_ERROR_REQ,           "CP_SRV",         "ERROR_REQ"           ) \
+   S( CM_ID_CP_SRV,         CP_ERROR_RESP,          "CP_SRV",         "ERROR_RESP"          ) \
+   S( CM_ID_CP_SRV,         CP_INT_IND,             "CP_SRV",         "INT_IND"             ) \
+   S( CM_ID_CP_SRV,         CP_STATUS_IND,          "CP_SRV",         "STATUS_IND"          ) \
+   S( CM_ID_CP_SRV,         CP_XL345_IND,           "CP_SRV",         "XL345_IND"           ) \
+   S( CM_ID_CP_SRV,         CP_PING_IND,            "CP_SRV",         "PING_IND"            ) \
+   \
+   S( CM_ID_DAQ_SRV,        DAQ_NULL_MSG,           "DAQ_SRV",        "NULL_MSG"            ) \
+   S( CM_ID_DAQ_SRV,        DAQ_RUN_REQ,            "DAQ_SRV",        "RUN_REQ"             ) \
+   S( CM_ID_DAQ_SRV,        DAQ_RUN_RESP,           "DAQ_SRV",        "RUN_RESP"            ) \
+   S( CM_ID_DAQ_SRV,        DAQ_DATA_REQ,           "DAQ_SRV",        "DATA_REQ"            ) \
+   S( CM_ID_DAQ_SRV,        DAQ_DATA_RESP,          "DAQ_SRV",        "DATA_RESP"           ) \
+   S( CM_ID_DAQ_SRV,        DAQ_ERROR_REQ,          "DAQ_SRV",        "ERROR_REQ"           ) \
+   S( CM_ID_DAQ_SRV,        DAQ_ERROR_RESP,         "DAQ_SRV",        "ERROR_RESP"          ) \
+   S( CM_ID_DAQ_SRV,        DAQ_INT_IND,            "DAQ_SRV",        "INT_IND"             ) \
+   S( CM_ID_DAQ_SRV,        DAQ_PKT_IND,            "DAQ_SRV",        "PKT_IND"             ) \
+   S( CM_ID_DAQ_SRV,        DAQ_DONE_IND,           "DAQ_SRV",        "DONE_IND"            ) \
+   \
+   H( CM_ID_OPC_SRV,        OPC_NULL_MSG,           "OPC_SRV",        "NULL_MSG"            ) \
+   H( CM_ID_OPC_SRV,        OPC_RUN_REQ,            "OPC_SRV",        "RUN_REQ"             ) \
+   H( CM_ID_OPC_SRV,        OPC_RUN_RESP,           "OPC_SRV",        "RUN_RESP"            ) \
+   H( CM_ID_OPC_SRV,        OPC_ERROR_REQ,          "OPC_SRV",        "ERROR_REQ"           ) \
+   H( CM_ID_OPC_SRV,        OPC_ERROR_RESP,         "OPC_SRV",        "ERROR_RESP"          ) \
+   H( CM_ID_OPC_SRV,        OPC_INT_IND,            "OPC_SRV",        "INT_IND"             ) \
+   H( CM_ID_OPC_SRV,        OPC_RUN_IND,            "OPC_SRV",        "RUN_IND"             ) \
+   H( CM_ID_OPC_SRV,        OPC_STEP_IND,           "OPC_SRV",        "STEP_IND"            ) \
+   H( CM_ID_OPC_SRV,        OPC_STAT_IND,           "OPC_SRV",        "STAT_IND"            ) \
+   H( CM_ID_OPC_SRV,        OPC_TMR_APP_TIMEOUT,    "OPC_SRV",        "TMR_APP_TIMEOUT"     ) \
+   \
+   S( CM_ID_INSTANCE,       CM_NULL_MSG,            "CM_INST",        "NULL_MSG"            ) \
+   S( CM_ID_INSTANCE,       CM_REG_REQ,             "CM_INST",        "REG_REQ"             ) \
+   S( CM_ID_INSTANCE,       CM_REG_RESP,            "CM_INST",        "REG_RESP"            ) \
+   S( CM_ID_INSTANCE,       CM_RPC_REQ,             "CM_INST",        "RPC_REQ"             ) \
+   S( CM_ID_INSTANCE,       CM_RPC_RESP,            "CM_INST",        "RPC_RESP"            ) \
+   S( CM_ID_INSTANCE,       CM_ECHO_REQ,            "CM_INST",        "ECHO_REQ"            ) \
+   S( CM_ID_INSTANCE,       CM_ECHO_RESP,           "CM_INST",        "ECHO_RESP"           ) \
+   S( CM_ID_INSTANCE,       CM_STATUS_REQ,          "CM_INST",        "STATUS_REQ"          ) \
+   S( CM_ID_INSTANCE,       CM_STATUS_RESP,         "CM_INST",        "STATUS_RESP"         ) \
+   S( CM_ID_INSTANCE,       CM_QUERY_REQ,           "CM_INST",        "QUERY_REQ"           ) \
+   S( CM_ID_INSTANCE,       CM_QUERY_RESP,          "CM_INST",        "QUERY_RESP"          ) \
+   S( CM_ID_INSTANCE,       CM_ERROR_REQ,           "CM_INST",        "ERROR_REQ"           ) \
+   S( CM_ID_INSTANCE,       CM_ERROR_RESP,          "CM_INST",        "ERROR_RESP"          ) \
+   S( CM_ID_INSTANCE,       CM_START_IND,           "CM_INST",        "START_IND"           ) \
+   S( CM_ID_INSTANCE,       CM_REG_IND,             "CM_INST",        "REG_IND"             ) \
+   S( CM_ID_INSTANCE,       CM_PING_IND,            "CM_INST",        "PING_IND"            ) \
+   \
+   H( CM_ID_CP_CLI,         CP_TMR_PING,            "CP_CLI",         "TMR_PING"            ) \
+   H( CM_ID_CP_CLI,         CP_TMR_PING_TIMEOUT,    "CP_CLI",         "TMR_PING_TIMEOUT"    ) \
+   \
+   S( CM_ID_PIPE,           CM_PIPE_NULL,           "CM_PIPE",        "PIPE_NULL"           ) \
+   S( CM_ID_PIPE,           CM_PIPE_DAQ_DATA,       "CM_PIPE",        "PIPE_DAQ_DATA"       ) \
+   S( CM_ID_PIPE,           CM_PIPE_STREAM_DATA,    "CM_PIPE",        "PIPE_STREAM_DATA"    )
+
+//
+// MESSAGE INDEX
+//
+// Every schema row has a dense index, MSG_IDX_NONE marks an unknown
+// srvid:msgid. The host-only rows are enumerated on both platforms so
+// the indices agree, the firmware simply never produces them.
+//
+#define MSG_IDX_ROW(srvid, msgid, srv_str, msg_str)   MSG_IDX_##msgid,
+
+enum msg_idx {
+   MSG_IDX_NONE,
+   MSG_SCHEMA(MSG_IDX_ROW, MSG_IDX_ROW)
+   MSG_IDX_MAX
+};
+
+//
+// DIRECT INDEX
+//
+// msg_index[MSG_SLOT(srvid)][msgid] holds the MSG_IDX of a message, the
+// slot packs the two CM ID type bits above the low three object bits.
+// A lookup is one bounds test and one load on every platform.
+//
+#define MSG_SLOTS             32
+#define MSG_IDS               128
+#define MSG_SLOT(cmid)        ((((cmid) >> 3) & 0x18) | ((cmid) & 0x07))
+#define MSG_INDEX(tbl, srvid, msgid) \
+   ((((srvid) & 0x38) == 0 && (msgid) < MSG_IDS) ? \
+      (tbl)[MSG_SLOT(srvid)][(msgid)] : MSG_IDX_NONE)
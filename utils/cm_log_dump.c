@@ -0,0 +1,288 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+   //
+   // Renders the binary CM traffic log, cm_traffic.bin, written by
+   // linux/c10_cmd/core/cm.c in the text traffic format.
+   //
+   // usage : cm_log_dump cm_traffic.bin [cm_traffic.txt]
+   //
+
+   #define CM_LOG_MAGIC          0x474C4D43
+   #define CM_LOG_VERSION        1
+   #define CM_LOG_DATA_LEN       512
+   #define CM_MAX_MSG_INT8U      512
+   #define MSG_MAX_STR           32
+
+   // CM Message Header
+   typedef struct _cm_hdr_t {
+      uint8_t  dst_cmid;        // Destination CM Address
+      uint8_t  src_cmid;        // Source CM Address
+      uint8_t  dst_devid :  4;  // Destination Device ID
+      uint8_t  src_devid :  4;  // Source Device ID
+      uint8_t  seqid     :  4;  // Message Sequence Number
+      uint8_t  endian    :  1;  // Processor Endianess
+      uint8_t  event     :  1;  // Event ID
+      uint8_t  keep      :  1;  // Don't Delete
+      uint8_t  proto     :  1;  // Protocol ID
+      uint8_t  crc8;            // CRC-8 using x^8 + x^5 + x^4 + 1
+      uint8_t  slot;            // Slot position in queue
+      uint16_t msglen    : 12;  // Message Length
+      uint16_t port      :  4;  // Port Connection
+   } cm_hdr_t, *pcm_hdr_t;
+
+   // parameters common to all messages
+   typedef struct _msg_parms_t {
+      uint8_t srvid;
+      uint8_t msgid;
+      uint8_t flags;
+      uint8_t status;
+   } msg_parms_t, *pmsg_parms_t;
+
+   // cm message structure
+   typedef struct _cm_msg_t {
+      cm_hdr_t       h;
+      msg_parms_t    p;
+   } cm_msg_t, *pcm_msg_t;
+
+   // message string table
+   typedef struct _msg_entry_t {
+      uint8_t     cmid;
+      uint8_t     msgid;
+      char        cmid_str[MSG_MAX_STR];
+      char        msg_str[MSG_MAX_STR];
+   } msg_entry_t, *pmsg_entry_t;
+
+   // Binary Traffic Log File Header
+   typedef struct _cm_log_file_t {
+      uint32_t    magic;
+      uint32_t    version;
+      uint32_t    start;
+      uint16_t    tbl_len;
+      uint16_t    entry_len;
+   } cm_log_file_t, *pcm_log_file_t;
+
+   // Binary Traffic Log Record Header
+   typedef struct _cm_log_hdr_t {
+      uint32_t    stamp_us;
+      uint16_t    len;
+      uint8_t     dir;
+      uint8_t     reserved;
+   } cm_log_hdr_t, *pcm_log_hdr_t;
+
+   static char  *month[] = {
+            "JAN", "FEB", "MAR", "APR",
+            "MAY", "JUN", "JUL", "AUG",
+            "SEP", "OCT", "NOV", "DEC"
+          };
+
+   static   msg_entry_t   *msg_table = NULL;
+   static   uint16_t       msg_table_len = 0;
+   static   uint32_t       last_us = 0;
+
+// ===========================================================================
+
+// 7.1
+
+void log_text(FILE *out, pcm_log_hdr_t h, uint8_t *data) {
+
+/* 7.1.1   Functional Description
+
+   This routine will render a binary log record in the text traffic
+   format, the same as cm_log_text() in linux/c10_cmd/core/cm.c.
+
+   7.1.2   Parameters:
+
+   out      Output stream
+   h        Record header
+   data     Record message bytes
+
+   7.1.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.1.4   Data Structures
+
+   char        line[512], cat[64];
+   uint16_t    i,j;
+   uint16_t    len;
+   char       *msgid = "-", *cmid = "-";
+   double      delta;
+   uint32_t    delta_secs, delta_us;
+
+   pcm_msg_t   msg  = (pcm_msg_t)data;
+
+// 7.1.5   Code
+
+   if (last_us == 0) last_us = h->stamp_us;
+   delta = (double)(h->stamp_us - last_us);
+   if (delta != 0) delta = delta / 100E6;
+   delta_secs = (uint32_t)delta;
+   delta_us   = (uint32_t)((delta - delta_secs) * 1E4);
+
+   // Control Message
+   if (h->dir != '@') {
+      // cm_hdr_t is 8 bytes
+      sprintf(line, "%c\t00 : ", h->dir);
+      for (i=0;i<8;i++) {
+         sprintf(cat, "%02X", data[i]);
+         strcat(line, cat);
+      }
+      // find cmid and msgid strings
+      for (i=0;i<msg_table_len; i++) {
+         if ((msg_table[i].cmid  == msg->p.srvid) &&
+             (msg_table[i].msgid == msg->p.msgid)) {
+            msgid = msg_table[i].msg_str;
+            cmid  = msg_table[i].cmid_str;
+         }
+      }
+      sprintf(cat, " %6d  %3d.%04d  %s:%s\n", msg->h.msglen, delta_secs, delta_us, cmid, msgid);
+      strcat(line, cat);
+      fputs(line, out);
+      // msg_parms_t is 4 bytes + body
+      if (msg->h.msglen < CM_MAX_MSG_INT8U &&
+          msg->h.msglen > sizeof(cm_hdr_t)) {
+         len = msg->h.msglen - 8;
+         for (i=0;i<len;i+=8) {
+            sprintf(line, "\t%02X : ", i+8);
+            for (j=0;j<8;j++) {
+               if ((i+j) >= (len))
+                  strcat(line, "  ");
+               else {
+                  sprintf(cat, "%02X", data[i+j+8]);
+                  strcat(line, cat);
+               }
+            }
+            strcat(line, "\n");
+            fputs(line, out);
+         }
+         fputs("\n", out);
+      }
+   }
+   // Pipe Message
+   else {
+      //  8 bytes of pipe header
+      sprintf(line, "%s\t000 : ", "@");
+      for (i=0;i<8;i++) {
+         sprintf(cat, "%02X", data[i]);
+         strcat(line, cat);
+      }
+      // find cmid and msgid strings
+      for (i=0;i<msg_table_len;i++) {
+         if ((msg_table[i].cmid  == data[0]) &&
+               (msg_table[i].msgid == data[1])) {
+            msgid = msg_table[i].msg_str;
+            cmid  = msg_table[i].cmid_str;
+         }
+      }
+      sprintf(cat, " %6d  %3d.%04d  %s:%s\n", 1024, delta_secs, delta_us, cmid, msgid);
+      strcat(line, cat);
+      fputs(line, out);
+      // the next 48 bytes of pipe, after msglen
+      len = 48;
+      for (i=0;i<len;i+=8) {
+         sprintf(line, "\t%03X : ", i+8);
+         for (j=0;j<8;j++) {
+            sprintf(cat, "%02X", data[i+j+12]);
+            strcat(line, cat);
+         }
+         strcat(line, "\n");
+         fputs(line, out);
+      }
+      fputs("\n\n", out);
+   }
+
+   last_us = h->stamp_us;
+
+} // end log_text()
+
+
+int main(int argc, char *argv[]) {
+
+   FILE          *fid;
+   FILE          *out = stdout;
+   cm_log_file_t  hdr;
+   cm_log_hdr_t   rec;
+   uint8_t        data[CM_LOG_DATA_LEN];
+   uint32_t       cnt = 0;
+   time_t         start;
+   struct tm     *c_tm;
+
+   uint32_t  j;
+
+   fprintf(stderr, "\nCM Traffic Log Decoder 1.0 [AEL]\n");
+
+   // command Line
+   fprintf(stderr, "cmd : ");
+   for (j=0;j<argc;j++) {
+      fprintf(stderr, "%s ", argv[j]);
+   }
+   fprintf(stderr, "\n");
+
+   if (argc < 2) {
+      fprintf(stderr, "Error: Filename not specified.\n");
+      return -1;
+   }
+
+   if ((fid = fopen(argv[1], "rb")) == NULL) {
+      fprintf(stderr, "Fatal Error : Log File %s did not Open for Read\n", argv[1]);
+      return -1;
+   }
+
+   // file header
+   if (fread(&hdr, sizeof(cm_log_file_t), 1, fid) != 1 ||
+         hdr.magic != CM_LOG_MAGIC || hdr.version != CM_LOG_VERSION ||
+         hdr.entry_len != sizeof(msg_entry_t)) {
+      fprintf(stderr, "Fatal Error : %s is not a CM traffic log\n", argv[1]);
+      fclose(fid);
+      return -1;
+   }
+
+   // message string table
+   msg_table_len = hdr.tbl_len;
+   msg_table = (msg_entry_t *)malloc(msg_table_len * sizeof(msg_entry_t));
+   if (msg_table == NULL ||
+         fread(msg_table, sizeof(msg_entry_t), msg_table_len, fid) != msg_table_len) {
+      fprintf(stderr, "Fatal Error : message table is truncated\n");
+      fclose(fid);
+      return -1;
+   }
+
+   if (argc > 2 && (out = fopen(argv[2], "wt")) == NULL) {
+      fprintf(stderr, "Fatal Error : Text File %s did not Open for Write\n", argv[2]);
+      fclose(fid);
+      return -1;
+   }
+
+   // date and legend
+   start = (time_t)hdr.start;
+   c_tm  = localtime(&start);
+   fprintf(out, "%02d.%s.%02d %02d:%02d:%02d \n\n", c_tm->tm_mday, month[c_tm->tm_mon],
+         (c_tm->tm_year+1900)-2000, c_tm->tm_hour, c_tm->tm_min, c_tm->tm_sec);
+   fprintf(out, "< outbound, > inbound, * local, # timer, @ pipe\n\n");
+
+   // cycle over records
+   while (fread(&rec, sizeof(cm_log_hdr_t), 1, fid) == 1) {
+      if (rec.len > CM_LOG_DATA_LEN || fread(data, 1, rec.len, fid) != rec.len) {
+         fprintf(stderr, "Error : record %d is truncated\n", cnt);
+         break;
+      }
+      log_text(out, &rec, data);
+      cnt++;
+   }
+
+   fprintf(stderr, "%d records\n", cnt);
+
+   if (out != stdout) fclose(out);
+   fclose(fid);
+   free(msg_table);
+
+   return 0;
+}
@@ -0,0 +1,380 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+   //
+   // Decodes the firmware trace file, xlt_trace.bin, written by OPC_CMD_XLT
+   // of linux/c10_cmd against the string table of the firmware ELF that
+   // made it. Each record holds the address of its format string, which is
+   // looked up in the ELF image with any %s arguments.
+   //
+   // usage : xlt_dump c10_fw.elf xlt_trace.bin [xlt_trace.txt]
+   //
+
+   #define OPC_XLT_MAGIC         0x31544C58
+   #define OPC_XLT_VERSION       1
+   #define CP_XLT_ARGS           5
+   #define XLT_SPEC_LEN          32
+   #define XLT_LINE_LEN          1024
+
+   // ELF identification and section types
+   #define EI_CLASS              4
+   #define EI_DATA               5
+   #define ELFCLASS32            1
+   #define ELFCLASS64            2
+   #define ELFDATA2LSB           1
+   #define SHT_NOBITS            8
+   #define SHF_ALLOC             0x2
+
+   // Firmware Trace File Header
+   typedef struct _opc_xlt_hdr_t {
+      uint32_t    magic;
+      uint32_t    version;
+      uint32_t    hdr_len;
+      uint32_t    rec_len;
+      uint32_t    freq;
+      uint32_t    recs;
+      uint32_t    records;
+      uint32_t    drops;
+      uint32_t    fw_ver;
+      uint32_t    sysid;
+   } opc_xlt_hdr_t, *popc_xlt_hdr_t;
+
+   // Trace Ring Record
+   typedef struct {
+      uint32_t    fmt;
+      uint32_t    stamp;
+      uint32_t    seqid;
+      uint32_t    arg[CP_XLT_ARGS];
+   } cp_xlt_rec_t, *pcp_xlt_rec_t;
+
+   // ELF section, either class
+   typedef struct _xlt_sec_t {
+      uint64_t    addr;
+      uint64_t    offset;
+      uint64_t    size;
+   } xlt_sec_t, *pxlt_sec_t;
+
+   static   uint8_t       *elf = NULL;
+   static   size_t         elf_len = 0;
+   static   xlt_sec_t     *sec = NULL;
+   static   uint32_t       sec_cnt = 0;
+
+// ===========================================================================
+
+// 7.1
+
+int elf_load(char *name) {
+
+/* 7.1.1   Functional Description
+
+   This routine will read the ELF file and keep the allocated sections
+   with file contents, .text, .rodata and .data, 32 or 64-bit little
+   endian.
+
+   7.1.2   Parameters:
+
+   name     ELF file name
+
+   7.1.3   Return Values:
+
+   result   0 on success, -1 otherwise
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.1.4   Data Structures
+
+   FILE       *fid;
+   uint64_t    shoff;
+   uint32_t    shentsize, shnum, i;
+   uint8_t    *sh;
+   uint32_t    type;
+   uint64_t    flags;
+   long        len;
+
+// 7.1.5   Code
+
+   if ((fid = fopen(name, "rb")) == NULL) return -1;
+   fseek(fid, 0, SEEK_END);
+   len = ftell(fid);
+   fseek(fid, 0, SEEK_SET);
+   if (len < 64 || (elf = (uint8_t *)malloc(len)) == NULL ||
+         fread(elf, 1, len, fid) != (size_t)len) {
+      fclose(fid);
+      return -1;
+   }
+   fclose(fid);
+   elf_len = len;
+
+   if (memcmp(elf, "\177ELF", 4) != 0 || elf[EI_DATA] != ELFDATA2LSB) return -1;
+
+   // section header table
+   if (elf[EI_CLASS] == ELFCLASS32) {
+      shoff     = *(uint32_t *)&elf[0x20];
+      shentsize = *(uint16_t *)&elf[0x2E];
+      shnum     = *(uint16_t *)&elf[0x30];
+   }
+   else if (elf[EI_CLASS] == ELFCLASS64) {
+      shoff     = *(uint64_t *)&elf[0x28];
+      shentsize = *(uint16_t *)&elf[0x3A];
+      shnum     = *(uint16_t *)&elf[0x3C];
+   }
+   else return -1;
+
+   if (shoff + (uint64_t)shentsize * shnum > elf_len) return -1;
+
+   sec = (xlt_sec_t *)calloc(shnum, sizeof(xlt_sec_t));
+   if (sec == NULL) return -1;
+
+   for (i=0;i<shnum;i++) {
+      sh = elf + shoff + (uint64_t)i * shentsize;
+      type = *(uint32_t *)&sh[4];
+      if (elf[EI_CLASS] == ELFCLASS32) {
+         flags                = *(uint32_t *)&sh[8];
+         sec[sec_cnt].addr    = *(uint32_t *)&sh[12];
+         sec[sec_cnt].offset  = *(uint32_t *)&sh[16];
+         sec[sec_cnt].size    = *(uint32_t *)&sh[20];
+      }
+      else {
+         flags                = *(uint64_t *)&sh[8];
+         sec[sec_cnt].addr    = *(uint64_t *)&sh[16];
+         sec[sec_cnt].offset  = *(uint64_t *)&sh[24];
+         sec[sec_cnt].size    = *(uint64_t *)&sh[32];
+      }
+      if (!(flags & SHF_ALLOC) || type == SHT_NOBITS) continue;
+      if (sec[sec_cnt].offset + sec[sec_cnt].size > elf_len) continue;
+      sec_cnt++;
+   }
+
+   return 0;
+
+} // end elf_load()
+
+
+// ===========================================================================
+
+// 7.2
+
+char *elf_str(uint32_t addr) {
+
+/* 7.2.1   Functional Description
+
+   This routine will return the string at a firmware address, or NULL
+   when the address is not in the image or the string is not terminated
+   in its section.
+
+   7.2.2   Parameters:
+
+   addr     Firmware address
+
+   7.2.3   Return Values:
+
+   result   String, or NULL
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.2.4   Data Structures
+
+   uint32_t    i;
+   char       *s;
+
+// 7.2.5   Code
+
+   for (i=0;i<sec_cnt;i++) {
+      if (addr >= sec[i].addr && addr < sec[i].addr + sec[i].size) {
+         s = (char *)(elf + sec[i].offset + (addr - sec[i].addr));
+         if (memchr(s, 0, sec[i].addr + sec[i].size - addr) == NULL) return NULL;
+         return s;
+      }
+   }
+
+   return NULL;
+
+} // end elf_str()
+
+
+// ===========================================================================
+
+// 7.3
+
+void xlt_format(char *line, uint32_t len, char *fmt, uint32_t *arg) {
+
+/* 7.3.1   Functional Description
+
+   This routine will format a record the way xlprint() does, every
+   argument is a uint32_t and %s arguments are looked up in the ELF.
+
+   7.3.2   Parameters:
+
+   line     Output line
+   len      Output line length
+   fmt      Format string
+   arg      Record arguments
+
+   7.3.3   Return Values:
+
+   NONE
+
+-----------------------------------------------------------------------------
+*/
+
+// 7.3.4   Data Structures
+
+   char        spec[XLT_SPEC_LEN];
+   uint32_t    n = 0, k, a = 0, val;
+   char       *s;
+
+// 7.3.5   Code
+
+   line[0] = '\0';
+
+   while (*fmt != '\0' && n < len - 1) {
+      if (*fmt != '%') {
+         line[n++] = *fmt++;
+         continue;
+      }
+      // flags, width and precision are passed on, length is dropped
+      k = 0;
+      spec[k++] = *fmt++;
+      while (*fmt != '\0' && strchr("-0+ #.123456789", *fmt) && k < XLT_SPEC_LEN - 3) {
+         spec[k++] = *fmt++;
+      }
+      while (*fmt == 'l' || *fmt == 'h') fmt++;
+      if (*fmt == '\0') break;
+      if (*fmt == '%') {
+         line[n++] = *fmt++;
+         continue;
+      }
+      val = (a < CP_XLT_ARGS) ? arg[a] : 0;
+      a++;
+      spec[k++] = *fmt;
+      spec[k]   = '\0';
+      switch (*fmt++) {
+         case 'd':
+         case 'i':
+            n += snprintf(line + n, len - n, spec, (int32_t)val);
+            break;
+         case 'u':
+         case 'x':
+         case 'X':
+         case 'o':
+         case 'c':
+            n += snprintf(line + n, len - n, spec, val);
+            break;
+         case 's':
+            s = elf_str(val);
+            if (s == NULL) {
+               n += snprintf(line + n, len - n, "<%08X>", val);
+            }
+            else {
+               n += snprintf(line + n, len - n, spec, s);
+            }
+            break;
+         default:
+            n += snprintf(line + n, len - n, "%s", spec);
+            break;
+      }
+      if (n > len - 1) n = len - 1;
+   }
+
+   line[n] = '\0';
+
+} // end xlt_format()
+
+
+int main(int argc, char *argv[]) {
+
+   FILE          *fid;
+   FILE          *out = stdout;
+   opc_xlt_hdr_t  hdr;
+   cp_xlt_rec_t   rec;
+   char           line[XLT_LINE_LEN];
+   char          *fmt;
+   uint32_t       cnt = 0, lost = 0, last_stamp = 0, last_seq = 0;
+   uint64_t       ticks = 0;
+   double         secs;
+
+   uint32_t  j;
+
+   fprintf(stderr, "\nFirmware Trace Decoder 1.0 [AEL]\n");
+
+   // command Line
+   fprintf(stderr, "cmd : ");
+   for (j=0;j<argc;j++) {
+      fprintf(stderr, "%s ", argv[j]);
+   }
+   fprintf(stderr, "\n");
+
+   if (argc < 3) {
+      fprintf(stderr, "Error: ELF and trace file not specified.\n");
+      return -1;
+   }
+
+   if (elf_load(argv[1]) != 0) {
+      fprintf(stderr, "Fatal Error : %s is not a little endian ELF file\n", argv[1]);
+      return -1;
+   }
+
+   if ((fid = fopen(argv[2], "rb")) == NULL) {
+      fprintf(stderr, "Fatal Error : Trace File %s did not Open for Read\n", argv[2]);
+      return -1;
+   }
+
+   // file header
+   if (fread(&hdr, sizeof(opc_xlt_hdr_t), 1, fid) != 1 ||
+         hdr.magic != OPC_XLT_MAGIC || hdr.version != OPC_XLT_VERSION ||
+         hdr.rec_len != sizeof(cp_xlt_rec_t)) {
+      fprintf(stderr, "Fatal Error : %s is not a firmware trace file\n", argv[2]);
+      fclose(fid);
+      return -1;
+   }
+   fseek(fid, hdr.hdr_len, SEEK_SET);
+
+   if (argc > 3 && (out = fopen(argv[3], "wt")) == NULL) {
+      fprintf(stderr, "Fatal Error : Text File %s did not Open for Write\n", argv[3]);
+      fclose(fid);
+      return -1;
+   }
+
+   fprintf(out, "f/w ver %08X, sysid %08X, %d records, %d dropped, %d Hz\n\n",
+         hdr.fw_ver, hdr.sysid, hdr.records, hdr.drops, hdr.freq);
+
+   // cycle over records, the stamp is 32-bit and wraps
+   while (fread(&rec, sizeof(cp_xlt_rec_t), 1, fid) == 1) {
+      if (cnt != 0) {
+         ticks += (uint32_t)(rec.stamp - last_stamp);
+         if (rec.seqid != last_seq + 1) {
+            fprintf(out, "--- %d records lost ---\n", rec.seqid - last_seq - 1);
+            lost += rec.seqid - last_seq - 1;
+         }
+      }
+      last_stamp = rec.stamp;
+      last_seq   = rec.seqid;
+      secs = (hdr.freq != 0) ? (double)ticks / hdr.freq : 0;
+
+      fmt = elf_str(rec.fmt);
+      if (fmt == NULL) {
+         snprintf(line, sizeof(line), "<%08X> %08X %08X %08X %08X %08X\n", rec.fmt,
+               rec.arg[0], rec.arg[1], rec.arg[2], rec.arg[3], rec.arg[4]);
+      }
+      else {
+         xlt_format(line, sizeof(line), fmt, rec.arg);
+      }
+      fprintf(out, "%12.6f  %s", secs, line);
+      if (line[0] == '\0' || line[strlen(line) - 1] != '\n') fputs("\n", out);
+      cnt++;
+   }
+
+   fprintf(stderr, "%d records, %d lost\n", cnt, lost);
+
+   if (out != stdout) fclose(out);
+   fclose(fid);
+   free(sec);
+   free(elf);
+
+   return 0;
+}